@@ -0,0 +1,208 @@
+﻿#include "cdc.h"
+
+#include <algorithm>     // std::min
+#include <functional>    // std::ref
+#include <thread>        // 并行扫描
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "../libgmsm/gmsm.h"  // SM3（生成Gear表）、CPU特性
+
+namespace gmdedup {
+
+    namespace {
+
+        constexpr size_t GEAR_WINDOW = 64;  // 64位Gear哈希只记得最近64个字节
+
+        /**
+         * @brief Gear表：G[b]取 SM3("gmdedup-gear" || b) 的前8字节（小端），固定且各字节独立随机
+         */
+        struct GearTable {
+            uint64_t G[256];
+
+            GearTable() {
+                uint8_t msg[13] = { 'g', 'm', 'd', 'e', 'd', 'u', 'p', '-', 'g', 'e', 'a', 'r', 0 };
+                for (int b = 0; b < 256; ++b) {
+                    msg[12] = static_cast<uint8_t>(b);
+                    uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+                    gmsm_sm3(msg, sizeof(msg), digest);
+                    uint64_t v = 0;
+                    for (int i = 7; i >= 0; --i) v = (v << 8) | digest[i];
+                    G[b] = v;
+                }
+            }
+        };
+
+        const uint64_t* Gear() {
+            static const GearTable table;
+            return table.G;
+        }
+
+        // 取哈希的高位做掩码：Gear哈希的第k位只受最近k+1个字节影响，高位才覆盖整个窗口
+        uint64_t TopBits(unsigned n) {
+            return n == 0 ? 0 : ~0ULL << (64 - n);
+        }
+
+        // 候选位置编码为 (i << 1) | strong，strong表示同时满足严格掩码
+        inline uint64_t Candidate(size_t i, uint64_t h, uint64_t maskS) {
+            return static_cast<uint64_t>(i) << 1 | ((h & maskS) == 0 ? 1 : 0);
+        }
+
+        // 位置begin之前（最多63个字节）的哈希，使扫描可以从任意位置开始
+        uint64_t WarmUp(const uint8_t* data, size_t begin) {
+            const uint64_t* G = Gear();
+            uint64_t h = 0;
+            for (size_t j = begin >= GEAR_WINDOW - 1 ? begin - (GEAR_WINDOW - 1) : 0; j < begin; ++j) {
+                h = (h << 1) + G[data[j]];
+            }
+            return h;
+        }
+
+        void ScanScalar(const uint8_t* data, size_t begin, size_t end, uint64_t maskL, uint64_t maskS,
+            std::vector<uint64_t>& out) {
+            const uint64_t* G = Gear();
+            uint64_t h = WarmUp(data, begin);
+            for (size_t i = begin; i < end; ++i) {
+                h = (h << 1) + G[data[i]];
+                if ((h & maskL) == 0) out.push_back(Candidate(i, h, maskS));
+            }
+        }
+
+#if defined(__x86_64__)
+        constexpr size_t AVX2_STRIPES = 8;
+
+        /**
+         * @brief 把[begin, end)分成8段，每段一个64位通道（两个ymm寄存器），各段同时滚动：
+         *        每步取8个Gear值，移位相加后与宽松掩码比较。两个寄存器的依赖链互相独立，
+         *        移位加法的延迟被掩盖；命中很少，命中时才逐通道记录。
+         *        Gear值用标量读入再拼成向量，不用vpgatherqq：在开启GDS缓解的CPU上gather很慢，
+         *        实测标量拼装约1000 MB/s，gather约700 MB/s
+         */
+        __attribute__((target("avx2"))) void ScanAvx2(const uint8_t* data, size_t begin, size_t end,
+            uint64_t maskL, uint64_t maskS, std::vector<uint64_t>& out) {
+            const size_t stripe = (end - begin) / AVX2_STRIPES;
+            if (stripe < GEAR_WINDOW) {
+                ScanScalar(data, begin, end, maskL, maskS, out);
+                return;
+            }
+            const long long* G = reinterpret_cast<const long long*>(Gear());
+            const uint8_t* p[AVX2_STRIPES];
+            alignas(32) uint64_t warm[AVX2_STRIPES];
+            for (size_t k = 0; k < AVX2_STRIPES; ++k) {
+                p[k] = data + begin + k * stripe;
+                warm[k] = WarmUp(data, begin + k * stripe);
+            }
+            __m256i h0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(warm));
+            __m256i h1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(warm + 4));
+            const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(maskL));
+            const __m256i zero = _mm256_setzero_si256();
+            std::vector<uint64_t> hits[AVX2_STRIPES];
+
+            for (size_t j = 0; j < stripe; ++j) {
+                h0 = _mm256_add_epi64(_mm256_slli_epi64(h0, 1), _mm256_setr_epi64x(G[p[0][j]], G[p[1][j]], G[p[2][j]], G[p[3][j]]));
+                h1 = _mm256_add_epi64(_mm256_slli_epi64(h1, 1), _mm256_setr_epi64x(G[p[4][j]], G[p[5][j]], G[p[6][j]], G[p[7][j]]));
+                const int m0 = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(h0, mask), zero)));
+                const int m1 = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(h1, mask), zero)));
+                if ((m0 | m1) == 0) continue;
+                alignas(32) uint64_t h[AVX2_STRIPES];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(h), h0);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(h + 4), h1);
+                const int m = m0 | m1 << 4;
+                for (size_t k = 0; k < AVX2_STRIPES; ++k) {
+                    if (m >> k & 1) hits[k].push_back(Candidate(begin + k * stripe + j, h[k], maskS));
+                }
+            }
+            for (size_t k = 0; k < AVX2_STRIPES; ++k) out.insert(out.end(), hits[k].begin(), hits[k].end());
+            ScanScalar(data, begin + AVX2_STRIPES * stripe, end, maskL, maskS, out);
+        }
+#endif
+
+        bool UseAvx2() {
+#if defined(__x86_64__)
+            return (gmsm_cpu_features() & GMSM_CPU_AVX2) != 0;
+#else
+            return false;
+#endif
+        }
+
+        void Scan(const uint8_t* data, size_t begin, size_t end, uint64_t maskL, uint64_t maskS,
+            std::vector<uint64_t>& out) {
+#if defined(__x86_64__)
+            if (UseAvx2()) {
+                ScanAvx2(data, begin, end, maskL, maskS, out);
+                return;
+            }
+#endif
+            ScanScalar(data, begin, end, maskL, maskS, out);
+        }
+
+        unsigned Log2(size_t v) {
+            unsigned n = 0;
+            while ((static_cast<size_t>(1) << (n + 1)) <= v) ++n;
+            return n;
+        }
+
+    } // namespace
+
+    void ChunkBuffer(const uint8_t* data, size_t len, const CdcParams& params, unsigned threads,
+        std::vector<Chunk>& chunks) {
+        // 归一化分块（FastCDC第2级）：严格掩码比平均块长多2位，宽松掩码少2位，两者嵌套
+        const unsigned bits = Log2(params.avgSize);
+        const uint64_t maskS = TopBits(bits + 2);
+        const uint64_t maskL = TopBits(bits > 2 ? bits - 2 : 0);
+
+        // 1. 并行扫描候选位置：每个线程一段，段首从前63个字节预热，结果与串行扫描相同
+        threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(len / (1 << 20) + 1)));
+        std::vector<std::vector<uint64_t>> parts(threads);
+        std::vector<std::thread> pool;
+        const size_t part = len / threads;
+        for (unsigned t = 0; t < threads; ++t) {
+            const size_t begin = t * part, end = t + 1 == threads ? len : begin + part;
+            parts[t].reserve((end - begin) / (params.avgSize / 8) + 16);
+            if (t + 1 == threads) {
+                Scan(data, begin, end, maskL, maskS, parts[t]);
+            }
+            else {
+                pool.emplace_back(Scan, data, begin, end, maskL, maskS, std::ref(parts[t]));
+            }
+        }
+        for (auto& th : pool) th.join();
+
+        // 2. 串行挑切点：只看候选位置，不再读数据
+        size_t s = 0;
+        unsigned t = 0;
+        size_t c = 0;
+        auto next = [&]() -> const uint64_t* {
+            while (t < threads && c >= parts[t].size()) {
+                ++t;
+                c = 0;
+            }
+            return t < threads ? &parts[t][c] : nullptr;
+        };
+        while (s < len) {
+            const size_t n = std::min(params.maxSize, len - s);
+            size_t cut = n;
+            if (n > params.minSize) {
+                const size_t normal = std::min(params.avgSize, n);
+                for (const uint64_t* e = next(); e != nullptr; ++c, e = next()) {
+                    const size_t i = static_cast<size_t>(*e >> 1);
+                    if (i < s + params.minSize) continue;
+                    if (i >= s + n) break;
+                    if (i < s + normal && (*e & 1) == 0) continue;
+                    cut = i - s + 1;
+                    ++c;
+                    break;
+                }
+            }
+            chunks.push_back({ s, static_cast<uint32_t>(cut) });
+            s += cut;
+        }
+    }
+
+    const char* CdcScanImpl() {
+        return UseAvx2() ? "avx2" : "scalar";
+    }
+
+} // namespace gmdedup
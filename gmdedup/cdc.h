@@ -0,0 +1,40 @@
+﻿#ifndef GMDEDUP_CDC_H
+#define GMDEDUP_CDC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 内容定义分块（FastCDC的归一化分块，Gear滚动哈希）
+
+namespace gmdedup {
+
+    struct CdcParams {
+        size_t minSize = 2 * 1024;
+        size_t avgSize = 8 * 1024;   // 取2的幂
+        size_t maxSize = 64 * 1024;
+    };
+
+    struct Chunk {
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    /**
+     * @brief 把data切成内容定义的块，追加到chunks。
+     *        位置i的Gear哈希只取决于以i结尾的64个字节，切点因此只由内容决定：文件中间插入或删除数据后，
+     *        之后的切点随内容平移，块仍能与旧版本对上。先用threads个线程并行扫描整个缓冲区，记下满足
+     *        宽松掩码的候选位置，再按FastCDC的规则串行挑出切点：块长不足avgSize时要求严格掩码，
+     *        超过后改用宽松掩码，到maxSize强制切断
+     */
+    void ChunkBuffer(const uint8_t* data, size_t len, const CdcParams& params, unsigned threads,
+        std::vector<Chunk>& chunks);
+
+    /**
+     * @brief 候选位置扫描使用的实现："avx2" 或 "scalar"
+     */
+    const char* CdcScanImpl();
+
+} // namespace gmdedup
+
+#endif // GMDEDUP_CDC_H
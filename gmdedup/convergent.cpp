@@ -0,0 +1,160 @@
+﻿#include "convergent.h"
+
+#include <algorithm>     // std::min
+#include <cstring>       // 内存操作
+#include <functional>    // std::cref
+#include <thread>        // 并行加密
+
+#include "../libgmsm/gmsm.h"  // SM3（批量接口）、SM4-CTR
+
+namespace gmdedup {
+
+    namespace {
+
+        constexpr size_t GROUP = CE_GROUP;
+        constexpr char ID_LABEL[] = "gmdedup-id";
+
+        void Wipe(void* p, size_t len) {
+            volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+            while (len-- > 0) *v++ = 0;
+        }
+
+        /**
+         * @brief 把chunks[i, i + n)连同domain拷进本线程的暂存区，ptrs、lens指向各条 块 || domain。
+         *        gmsm_sm3_batch只接受连续的消息；暂存区只有一组大小，每个线程保留自己的一份，不必每组重新分配
+         */
+        void Gather(const uint8_t* data, const std::vector<Chunk>& chunks, size_t i, size_t n,
+            const std::string& domain, const void** ptrs, size_t* lens) {
+            thread_local std::vector<uint8_t> scratch;
+            size_t total = 0;
+            for (size_t k = 0; k < n; ++k) total += chunks[i + k].length + domain.size();
+            scratch.resize(total);
+            size_t pos = 0;
+            for (size_t k = 0; k < n; ++k) {
+                const Chunk& c = chunks[i + k];
+                std::memcpy(&scratch[pos], data + c.offset, c.length);
+                std::memcpy(&scratch[pos + c.length], domain.data(), domain.size());
+                lens[k] = c.length + domain.size();
+                pos += lens[k];
+            }
+            pos = 0;
+            for (size_t k = 0; k < n; ++k) {
+                ptrs[k] = &scratch[pos];
+                pos += lens[k];
+            }
+        }
+
+        /**
+         * @brief 用D（前16字节密钥、后16字节计数器）对一块做SM4-CTR
+         */
+        void CtrChunk(const uint8_t secret[CE_SECRET_SIZE], const uint8_t* in, uint8_t* out, size_t len) {
+            gmsm_sm4_key key;
+            uint8_t counter[GMSM_SM4_BLOCK_SIZE];
+            gmsm_sm4_set_encrypt_key(&key, secret);
+            std::memcpy(counter, secret + GMSM_SM4_KEY_SIZE, sizeof(counter));
+            gmsm_sm4_ctr(&key, counter, in, out, len);
+            Wipe(&key, sizeof(key));
+        }
+
+        /**
+         * @brief 一组n块的存储标识 SM3(D || "gmdedup-id")，一次批量调用
+         */
+        void DeriveIds(const uint8_t* secrets, size_t n, uint8_t* ids) {
+            uint8_t labelled[GROUP][CE_SECRET_SIZE + sizeof(ID_LABEL) - 1];
+            const void* ptrs[GROUP];
+            size_t lens[GROUP];
+            for (size_t k = 0; k < n; ++k) {
+                std::memcpy(labelled[k], secrets + k * CE_SECRET_SIZE, CE_SECRET_SIZE);
+                std::memcpy(labelled[k] + CE_SECRET_SIZE, ID_LABEL, sizeof(ID_LABEL) - 1);
+                ptrs[k] = labelled[k];
+                lens[k] = sizeof(labelled[k]);
+            }
+            gmsm_sm3_batch(ptrs, lens, n, ids);
+            Wipe(labelled, sizeof(labelled));
+        }
+
+        /**
+         * @brief 融合的一段：每组先拷进暂存区导出D，再从暂存区里的同一份明文做CTR，不再回原缓冲区读
+         */
+        void EncryptRange(const uint8_t* data, const std::vector<Chunk>& chunks, size_t begin, size_t end,
+            const std::string& domain, uint8_t* out, uint64_t outBase, uint8_t* secrets, uint8_t* ids) {
+            const void* ptrs[GROUP];
+            size_t lens[GROUP];
+            for (size_t i = begin; i < end; i += GROUP) {
+                const size_t n = std::min(GROUP, end - i);
+                Gather(data, chunks, i, n, domain, ptrs, lens);
+                gmsm_sm3_batch(ptrs, lens, n, secrets + i * CE_SECRET_SIZE);
+                for (size_t k = 0; k < n; ++k) {
+                    const Chunk& c = chunks[i + k];
+                    CtrChunk(secrets + (i + k) * CE_SECRET_SIZE, static_cast<const uint8_t*>(ptrs[k]),
+                        out + (c.offset - outBase), c.length);
+                }
+                DeriveIds(secrets + i * CE_SECRET_SIZE, n, ids + i * FP_SIZE);
+            }
+        }
+
+    } // namespace
+
+    void DeriveSecrets(const uint8_t* data, const std::vector<Chunk>& chunks, size_t begin, size_t end,
+        const std::string& domain, uint8_t* secrets) {
+        const void* ptrs[GROUP];
+        size_t lens[GROUP];
+        for (size_t i = begin; i < end; i += GROUP) {
+            const size_t n = std::min(GROUP, end - i);
+            Gather(data, chunks, i, n, domain, ptrs, lens);
+            gmsm_sm3_batch(ptrs, lens, n, secrets + i * CE_SECRET_SIZE);
+        }
+    }
+
+    void EncryptChunks(const uint8_t* data, const std::vector<Chunk>& chunks, size_t begin, size_t end,
+        const uint8_t* secrets, uint8_t* out, uint8_t* ids) {
+        for (size_t i = begin; i < end; i += GROUP) {
+            const size_t n = std::min(GROUP, end - i);
+            for (size_t k = 0; k < n; ++k) {
+                const Chunk& c = chunks[i + k];
+                CtrChunk(secrets + (i + k) * CE_SECRET_SIZE, data + c.offset, out + c.offset, c.length);
+            }
+            DeriveIds(secrets + i * CE_SECRET_SIZE, n, ids + i * FP_SIZE);
+        }
+    }
+
+    void ConvergentEncrypt(const uint8_t* data, const std::vector<Chunk>& chunks, size_t begin, size_t end,
+        const std::string& domain, unsigned threads, uint8_t* out, uint8_t* secrets, uint8_t* ids) {
+        if (begin >= end) return;
+        const uint64_t outBase = chunks[begin].offset;
+        const size_t count = end - begin;
+        threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>((count + GROUP - 1) / GROUP)));
+        std::vector<std::thread> pool;
+        const size_t part = count / threads;
+        for (unsigned t = 0; t < threads; ++t) {
+            const size_t lo = begin + t * part, hi = t + 1 == threads ? end : lo + part;
+            if (t + 1 == threads) {
+                EncryptRange(data, chunks, lo, hi, domain, out, outBase, secrets, ids);
+            }
+            else {
+                pool.emplace_back(EncryptRange, data, std::cref(chunks), lo, hi, std::cref(domain), out, outBase,
+                    secrets, ids);
+            }
+        }
+        for (auto& th : pool) th.join();
+    }
+
+    bool ConvergentDecrypt(const uint8_t* in, size_t len, const uint8_t secret[CE_SECRET_SIZE],
+        const std::string& domain, uint8_t* out) {
+        gmsm_sm4_key key;
+        uint8_t counter[GMSM_SM4_BLOCK_SIZE];
+        gmsm_sm4_set_encrypt_key(&key, secret);
+        std::memcpy(counter, secret + GMSM_SM4_KEY_SIZE, sizeof(counter));
+        gmsm_sm4_ctr(&key, counter, in, out, len);
+        Wipe(&key, sizeof(key));
+
+        gmsm_sm3_ctx ctx;
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+        gmsm_sm3_init(&ctx);
+        gmsm_sm3_update(&ctx, out, len);
+        gmsm_sm3_update(&ctx, domain.data(), domain.size());
+        gmsm_sm3_final(&ctx, digest);
+        return std::memcmp(digest, secret, CE_SECRET_SIZE) == 0;
+    }
+
+} // namespace gmdedup
@@ -0,0 +1,53 @@
+﻿#ifndef GMDEDUP_CONVERGENT_H
+#define GMDEDUP_CONVERGENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cdc.h"      // Chunk
+#include "fpindex.h"  // FP_SIZE
+
+// 收敛加密：块的SM4密钥和计数器由块内容本身导出，相同的块加密结果相同，加密后仍能去重
+
+namespace gmdedup {
+
+    constexpr size_t CE_SECRET_SIZE = 32;
+    constexpr size_t CE_GROUP = 64;  // 每组块数，与gmsm_sm3_batch的一次调用对应
+
+    /**
+     * @brief 块密钥材料 D = SM3(块 || domain)：前16字节为SM4密钥，后16字节为CTR初始计数器。
+     *        domain区分不同的租户或用途，不同domain下相同的块互不相同；作为秘密使用时还能防止
+     *        外人猜测明文后加密比对。chunks[begin, end)的结果写入secrets（每块32字节，按块号存放）
+     */
+    void DeriveSecrets(const uint8_t* data, const std::vector<Chunk>& chunks, size_t begin, size_t end,
+        const std::string& domain, uint8_t* secrets);
+
+    /**
+     * @brief 用已导出的D对chunks[begin, end)做SM4-CTR，密文写到out中与明文相同的偏移处，
+     *        同时算出每块的存储标识 SM3(D || "gmdedup-id")，写入ids（每块32字节）。
+     *        标识只依赖D，仓库按它去重，但从标识推不出密钥
+     */
+    void EncryptChunks(const uint8_t* data, const std::vector<Chunk>& chunks, size_t begin, size_t end,
+        const uint8_t* secrets, uint8_t* out, uint8_t* ids);
+
+    /**
+     * @brief 融合的收敛加密：chunks[begin, end)按数量均分给threads个线程，每个线程64块一组，
+     *        把这一组连同domain拷进暂存区、用gmsm_sm3_batch导出D，再直接从暂存区做CTR。
+     *        一组约0.5 MB，加密时暂存区还在L2里，每块明文只从原缓冲区读一次；
+     *        分开做（DeriveSecrets后再EncryptChunks）要读两遍。
+     *        密文写到 out + (c.offset - chunks[begin].offset)，out只需容纳这一段；secrets、ids按块号存放
+     */
+    void ConvergentEncrypt(const uint8_t* data, const std::vector<Chunk>& chunks, size_t begin, size_t end,
+        const std::string& domain, unsigned threads, uint8_t* out, uint8_t* secrets, uint8_t* ids);
+
+    /**
+     * @brief 解密一个块并核对：重新计算 SM3(明文 || domain)，与D不符（密文被改动、D或domain不对）时返回false
+     */
+    bool ConvergentDecrypt(const uint8_t* in, size_t len, const uint8_t secret[CE_SECRET_SIZE],
+        const std::string& domain, uint8_t* out);
+
+} // namespace gmdedup
+
+#endif // GMDEDUP_CONVERGENT_H
@@ -0,0 +1,252 @@
+﻿#include "fpindex.h"
+
+#include <cerrno>        // errno
+#include <cstdio>        // rename
+#include <cstring>       // 内存操作
+#include <vector>        // 丢弃未提交条目时暂存其余条目
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gmdedup {
+
+    namespace {
+
+        constexpr char MAGIC[8] = { 'G', 'M', 'D', 'E', 'D', 'U', 'P', '2' };  // 2：文件头加了已提交长度
+        constexpr uint64_t INITIAL_CAPACITY = 1 << 16;
+        constexpr size_t HEADER_SIZE = 64;
+
+        struct Header {
+            char magic[8];
+            uint64_t capacity;   // 槽位数，2的幂
+            uint64_t count;      // 已用槽位数
+            uint64_t committed;  // chunks.dat中已落盘的长度
+            uint64_t dirty;      // 非0表示有条目插入后尚未提交
+        };
+
+        struct Slot {
+            uint8_t fp[FP_SIZE];
+            uint64_t offset;
+            uint32_t length;
+            uint32_t used;
+        };
+        static_assert(sizeof(Header) <= HEADER_SIZE, "header too large");
+        static_assert(sizeof(Slot) == 48, "slot layout");
+
+        size_t FileSize(uint64_t capacity) {
+            return HEADER_SIZE + static_cast<size_t>(capacity) * sizeof(Slot);
+        }
+
+        Header* HeaderOf(uint8_t* base) {
+            return reinterpret_cast<Header*>(base);
+        }
+
+        Slot* SlotsOf(uint8_t* base) {
+            return reinterpret_cast<Slot*>(base + HEADER_SIZE);
+        }
+
+        uint64_t HashOf(const uint8_t fp[FP_SIZE]) {
+            uint64_t h;
+            std::memcpy(&h, fp, sizeof(h));
+            return h;
+        }
+
+        // 定位指纹所在的槽位，或它应插入的空槽位
+        Slot* Probe(uint8_t* base, const uint8_t fp[FP_SIZE]) {
+            const uint64_t mask = HeaderOf(base)->capacity - 1;
+            Slot* slots = SlotsOf(base);
+            for (uint64_t i = HashOf(fp) & mask;; i = (i + 1) & mask) {
+                Slot* s = &slots[i];
+                if (!s->used || std::memcmp(s->fp, fp, FP_SIZE) == 0) return s;
+            }
+        }
+
+        // 新建一个空索引文件并映射
+        uint8_t* Create(const std::string& path, uint64_t capacity, int* fdOut) {
+            const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) return nullptr;
+            const size_t size = FileSize(capacity);
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                const int e = errno;
+                ::close(fd);
+                errno = e;
+                return nullptr;
+            }
+            void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                const int e = errno;
+                ::close(fd);
+                errno = e;
+                return nullptr;
+            }
+            uint8_t* base = static_cast<uint8_t*>(p);
+            std::memcpy(HeaderOf(base)->magic, MAGIC, sizeof(MAGIC));
+            HeaderOf(base)->capacity = capacity;
+            HeaderOf(base)->count = 0;
+            HeaderOf(base)->committed = 0;
+            HeaderOf(base)->dirty = 0;
+            *fdOut = fd;
+            return base;
+        }
+
+    } // namespace
+
+    FpIndex::~FpIndex() {
+        Close();
+    }
+
+    bool FpIndex::Map(int fd, uint64_t capacity) {
+        const size_t size = FileSize(capacity);
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) return false;
+        fd_ = fd;
+        base_ = static_cast<uint8_t*>(p);
+        mapped_ = size;
+        return true;
+    }
+
+    bool FpIndex::Open(const std::string& path, bool create) {
+        path_ = path;
+        const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno != ENOENT || !create) return false;
+            int newFd = -1;
+            uint8_t* base = Create(path, INITIAL_CAPACITY, &newFd);
+            if (base == nullptr) return false;
+            fd_ = newFd;
+            base_ = base;
+            mapped_ = FileSize(INITIAL_CAPACITY);
+            return true;
+        }
+        Header h;
+        struct stat st;
+        if (::pread(fd, &h, sizeof(h), 0) != static_cast<ssize_t>(sizeof(h)) || ::fstat(fd, &st) != 0 ||
+            std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.capacity == 0 ||
+            (h.capacity & (h.capacity - 1)) != 0 || static_cast<uint64_t>(st.st_size) != FileSize(h.capacity)) {
+            ::close(fd);
+            errno = EINVAL;
+            return false;
+        }
+        if (!Map(fd, h.capacity)) {
+            const int e = errno;
+            ::close(fd);
+            errno = e;
+            return false;
+        }
+        return !HeaderOf(base_)->dirty || DropUncommitted();
+    }
+
+    bool FpIndex::DropUncommitted() {
+        // 上次插入后没有提交就中断了：已写回的条目可能指向没来得及落盘的块数据。
+        // 线性探测不能直接删除槽位，留下的条目暂存后整表重建
+        Header* h = HeaderOf(base_);
+        Slot* slots = SlotsOf(base_);
+        std::vector<Slot> kept;
+        for (uint64_t i = 0; i < h->capacity; ++i) {
+            if (!slots[i].used) continue;
+            if (slots[i].offset + slots[i].length <= h->committed) kept.push_back(slots[i]);
+            else ++dropped_;
+        }
+        std::memset(slots, 0, static_cast<size_t>(h->capacity) * sizeof(Slot));
+        for (const Slot& s : kept) *Probe(base_, s.fp) = s;
+        h->count = kept.size();
+        h->dirty = 0;
+        return ::msync(base_, mapped_, MS_SYNC) == 0;
+    }
+
+    bool FpIndex::Lookup(const uint8_t fp[FP_SIZE], ChunkRef* ref) const {
+        const Slot* s = Probe(base_, fp);
+        if (!s->used) return false;
+        ref->offset = s->offset;
+        ref->length = s->length;
+        return true;
+    }
+
+    bool FpIndex::Insert(const uint8_t fp[FP_SIZE], const ChunkRef& ref) {
+        Header* h = HeaderOf(base_);
+        if (!h->dirty) {
+            // 标志必须先于任何新条目落盘，中断后打开时才知道要检查
+            h->dirty = 1;
+            if (::msync(base_, HEADER_SIZE, MS_SYNC) != 0) return false;
+        }
+        if ((h->count + 1) * 10 > h->capacity * 7) {
+            if (!Grow()) return false;
+            h = HeaderOf(base_);
+        }
+        Slot* s = Probe(base_, fp);
+        if (!s->used) {
+            std::memcpy(s->fp, fp, FP_SIZE);
+            s->used = 1;
+            ++h->count;
+        }
+        s->offset = ref.offset;
+        s->length = ref.length;
+        return true;
+    }
+
+    bool FpIndex::Grow() {
+        const Header* old = HeaderOf(base_);
+        const std::string tmp = path_ + ".tmp";
+        int fd = -1;
+        uint8_t* base = Create(tmp, old->capacity * 2, &fd);
+        if (base == nullptr) return false;
+
+        const Slot* slots = SlotsOf(base_);
+        for (uint64_t i = 0; i < old->capacity; ++i) {
+            if (!slots[i].used) continue;
+            *Probe(base, slots[i].fp) = slots[i];
+        }
+        HeaderOf(base)->count = old->count;
+        HeaderOf(base)->committed = old->committed;
+        HeaderOf(base)->dirty = old->dirty;
+
+        const size_t size = FileSize(HeaderOf(base)->capacity);
+        if (::msync(base, size, MS_SYNC) != 0 || std::rename(tmp.c_str(), path_.c_str()) != 0) {
+            const int e = errno;
+            ::munmap(base, size);
+            ::close(fd);
+            ::unlink(tmp.c_str());
+            errno = e;
+            return false;
+        }
+        ::munmap(base_, mapped_);
+        ::close(fd_);
+        fd_ = fd;
+        base_ = base;
+        mapped_ = size;
+        return true;
+    }
+
+    bool FpIndex::SetCommitted(uint64_t length) {
+        Header* h = HeaderOf(base_);
+        h->committed = length;
+        h->dirty = 0;
+        return ::msync(base_, mapped_, MS_SYNC) == 0;
+    }
+
+    bool FpIndex::Close() {
+        if (base_ == nullptr) return true;
+        const bool ok = ::msync(base_, mapped_, MS_SYNC) == 0;
+        ::munmap(base_, mapped_);
+        ::close(fd_);
+        base_ = nullptr;
+        fd_ = -1;
+        mapped_ = 0;
+        return ok;
+    }
+
+    uint64_t FpIndex::Count() const {
+        return HeaderOf(base_)->count;
+    }
+
+    uint64_t FpIndex::Capacity() const {
+        return HeaderOf(base_)->capacity;
+    }
+
+    uint64_t FpIndex::Committed() const {
+        return HeaderOf(base_)->committed;
+    }
+
+} // namespace gmdedup
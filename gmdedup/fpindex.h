@@ -0,0 +1,83 @@
+﻿#ifndef GMDEDUP_FPINDEX_H
+#define GMDEDUP_FPINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 磁盘上的指纹索引：SM3指纹 -> 块在chunks.dat中的位置
+
+namespace gmdedup {
+
+    constexpr size_t FP_SIZE = 32;
+
+    struct ChunkRef {
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    /**
+     * @brief mmap到内存的开放寻址哈希表（线性探测）。
+     *        文件布局：64字节文件头（魔数、容量、条目数、已提交的数据长度、未提交标志）后接容量个48字节槽位，
+     *        容量为2的幂。指纹是SM3输出，本身均匀分布，直接取前8字节定位槽位。条目只增不删；
+     *        装载因子超过0.7时写出两倍容量的新文件，rename替换旧文件，中途失败时旧索引不受影响。
+     *        共享映射的条目可能先于块数据写回磁盘：第一次插入前先把未提交标志同步落盘，
+     *        块数据fdatasync之后由SetCommitted记下数据长度并清除标志。打开时标志仍在（上次没有提交就中断），
+     *        丢弃指向已提交长度之后的条目
+     */
+    class FpIndex {
+    public:
+        FpIndex() = default;
+        ~FpIndex();
+        FpIndex(const FpIndex&) = delete;
+        FpIndex& operator=(const FpIndex&) = delete;
+
+        /**
+         * @brief 打开索引文件；不存在时create为true则新建，否则失败（errno为ENOENT）。失败时返回false并保留errno
+         */
+        bool Open(const std::string& path, bool create);
+
+        /**
+         * @brief 查找指纹，找到时写入ref并返回true
+         */
+        bool Lookup(const uint8_t fp[FP_SIZE], ChunkRef* ref) const;
+
+        /**
+         * @brief 插入一个新指纹（调用方保证尚不存在）。扩容失败时返回false
+         */
+        bool Insert(const uint8_t fp[FP_SIZE], const ChunkRef& ref);
+
+        /**
+         * @brief 块数据已落盘到length字节：记下这一长度，清除未提交标志并同步索引
+         */
+        bool SetCommitted(uint64_t length);
+
+        /**
+         * @brief 把修改写回磁盘并关闭
+         */
+        bool Close();
+
+        uint64_t Count() const;
+        uint64_t Capacity() const;
+        uint64_t Committed() const;
+
+        /**
+         * @brief 打开时丢弃的未提交条目数
+         */
+        uint64_t Dropped() const { return dropped_; }
+
+    private:
+        bool Map(int fd, uint64_t capacity);
+        bool Grow();
+        bool DropUncommitted();
+
+        std::string path_;
+        int fd_ = -1;
+        uint8_t* base_ = nullptr;
+        size_t mapped_ = 0;
+        uint64_t dropped_ = 0;
+    };
+
+} // namespace gmdedup
+
+#endif // GMDEDUP_FPINDEX_H
@@ -0,0 +1,795 @@
+﻿#include <algorithm>     // std::min
+#include <array>         // 密钥缓存的索引
+#include <atomic>        // 计数器
+#include <cerrno>        // errno
+#include <chrono>        // 时间测量
+#include <condition_variable>
+#include <csignal>       // 信号
+#include <cstdio>        // 输出
+#include <cstdlib>       // 命令行参数
+#include <cstring>       // 内存操作
+#include <deque>         // 请求队列
+#include <list>          // LRU链表
+#include <map>           // 按密钥分组
+#include <memory>        // shared_ptr
+#include <mutex>         // 互斥锁
+#include <thread>        // 工作线程
+#include <unordered_map> // 连接表
+#include <vector>        // 动态数组
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../libgmsm/gmsm.h"  // SM4-GCM、SM3（批量接口）
+#include "gmsmd_proto.h"      // 线上格式
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        const char* socketPath = GMSMD_DEFAULT_SOCKET;
+        unsigned workers = 0;        // 0：按CPU核数
+        unsigned windowUs = 20;      // 合并窗口：最早的请求最多等这么久
+        size_t batchMax = 64;        // 每批最多取出的请求数
+        size_t keyCacheSize = 1024;  // 密钥编排缓存的条目数
+    };
+
+    // 每个连接的资源上限：客户端只发不收或一次灌入大量请求时，守护进程的内存和队列不随之增长
+    constexpr size_t MAX_FRAME = sizeof(gmsmd_request) + GMSMD_KEY_SIZE + GMSMD_IV_SIZE + 2 * GMSMD_MAX_INLINE;
+    constexpr size_t MAX_INBUF = 2 * MAX_FRAME;     // 读缓冲区达到此值后不再从套接字读
+    constexpr size_t MAX_PENDING = 64;              // 每个连接排队和处理中的请求数
+    constexpr size_t MAX_OUTBUF = 256 * 1024;       // 未发出的回复达到此值后不再读新请求
+
+    void Wipe(void* p, size_t len) {
+        volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+        while (len-- > 0) *v++ = 0;
+    }
+
+    // ---------------- 指标 ----------------
+
+    struct Metrics {
+        std::atomic<uint64_t> requests[3] = {};
+        std::atomic<uint64_t> batches{ 0 };
+        std::atomic<uint64_t> batchedRequests{ 0 };
+        std::atomic<uint64_t> maxQueueDepth{ 0 };
+        std::atomic<uint64_t> keyCacheHits{ 0 };
+        std::atomic<uint64_t> keyCacheMisses{ 0 };
+        std::atomic<uint64_t> connections{ 0 };
+        std::atomic<uint64_t> latencyTotalUs{ 0 };
+        std::atomic<uint64_t> latencyHist[GMSMD_LATENCY_BUCKETS] = {};
+
+        void RecordLatency(Clock::time_point received) {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - received).count();
+            uint64_t v = us < 0 ? 0 : static_cast<uint64_t>(us);
+            int bucket = 0;
+            while (bucket + 1 < GMSMD_LATENCY_BUCKETS && (uint64_t(1) << bucket) <= v) ++bucket;
+            latencyHist[bucket].fetch_add(1, std::memory_order_relaxed);
+            latencyTotalUs.fetch_add(v, std::memory_order_relaxed);
+        }
+    };
+
+    Metrics g_metrics;
+
+    // ---------------- 连接与共享区 ----------------
+
+    struct ShmRegion {
+        uint8_t* base;
+        size_t size;
+
+        ShmRegion(uint8_t* b, size_t s) : base(b), size(s) {}
+        ShmRegion(const ShmRegion&) = delete;
+        ShmRegion& operator=(const ShmRegion&) = delete;
+        ~ShmRegion() { munmap(base, size); }
+    };
+
+    /**
+     * @brief 工作线程请I/O线程处理某个连接（有回复待发、或在途请求降到上限以下可以继续读）。
+     *        连接号放进列表，再经eventfd唤醒epoll；连接已关闭时I/O线程查不到它，直接忽略
+     */
+    class Wakeups {
+    public:
+        Wakeups() : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+        ~Wakeups() { if (fd_ >= 0) close(fd_); }
+
+        int Fd() const { return fd_; }
+
+        void Post(int conn) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (conns_.empty()) {
+                uint64_t one = 1;
+                ssize_t n = write(fd_, &one, sizeof(one));
+                (void)n;  // 计数器满（EAGAIN）时eventfd本来就处于可读状态
+            }
+            conns_.push_back(conn);
+        }
+
+        std::vector<int> Take() {
+            uint64_t count;
+            ssize_t n = read(fd_, &count, sizeof(count));
+            (void)n;
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<int> out;
+            out.swap(conns_);
+            return out;
+        }
+
+    private:
+        int fd_;
+        std::mutex mutex_;
+        std::vector<int> conns_;
+    };
+
+    struct Connection {
+        int fd;
+        Wakeups& wakeups;
+        std::vector<uint8_t> inbuf;                // 只由I/O线程访问
+        std::vector<int> receivedFds;              // 随ATTACH传来、尚未使用的描述符
+        std::shared_ptr<ShmRegion> shm;            // 只由I/O线程替换；请求各自持有引用
+        uint32_t events = EPOLLIN;                 // 当前在epoll中关注的事件，只由I/O线程访问
+
+        std::mutex mutex;                          // 保护以下成员，工作线程与I/O线程共用
+        std::vector<uint8_t> outbuf;               // 套接字写满时未发出的回复
+        size_t outpos = 0;                         // outbuf中已发出的部分
+        size_t pending = 0;                        // 已入队、尚未回复的请求数
+
+        Connection(int f, Wakeups& w) : fd(f), wakeups(w) {}
+        ~Connection() {
+            for (int f : receivedFds) close(f);
+            Wipe(outbuf.data(), outbuf.size());
+            close(fd);  // 所有请求都回复完才关闭，描述符号不会被新连接提前复用
+        }
+
+        /**
+         * @brief 是否还能接收新请求（调用时持有mutex）
+         */
+        bool Accepting() const { return pending < MAX_PENDING && outbuf.size() - outpos < MAX_OUTBUF; }
+    };
+
+    /**
+     * @brief 尽量写出outbuf中积压的回复（调用时持有conn.mutex）。对端出错时返回false
+     */
+    bool FlushLocked(Connection& conn) {
+        while (conn.outpos < conn.outbuf.size()) {
+            ssize_t n = send(conn.fd, conn.outbuf.data() + conn.outpos, conn.outbuf.size() - conn.outpos,
+                MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN) break;
+                return false;
+            }
+            conn.outpos += static_cast<size_t>(n);
+        }
+        // 发完后清零（OPEN的回复是明文）；只发出一部分时把剩余的挪到开头，缓冲区不随时间增长
+        if (conn.outpos == conn.outbuf.size() || conn.outpos >= conn.outbuf.size() / 2) {
+            size_t rest = conn.outbuf.size() - conn.outpos;
+            std::memmove(conn.outbuf.data(), conn.outbuf.data() + conn.outpos, rest);
+            Wipe(conn.outbuf.data() + rest, conn.outpos);
+            conn.outbuf.resize(rest);
+            conn.outpos = 0;
+        }
+        return true;
+    }
+
+    /**
+     * @brief 写出回复，不阻塞：前面没有积压时直接写套接字，写不完的部分追加到outbuf，
+     *        由I/O线程在套接字可写时继续发送。客户端不读回复只会让它的outbuf变长，
+     *        不会占住工作线程；outbuf超过上限后I/O线程停止读取该连接的新请求。
+     *        写失败时放弃（I/O线程随后会看到连接关闭）
+     */
+    void SendResponse(Connection& conn, uint32_t id, int status, const uint8_t* data, size_t len) {
+        gmsmd_response resp = {};
+        resp.magic = GMSMD_MAGIC;
+        resp.status = status;
+        resp.id = id;
+        resp.data_len = len;
+        iovec iov[2] = { { &resp, sizeof(resp) }, { const_cast<uint8_t*>(data), data != nullptr ? len : 0 } };
+        int count = data != nullptr && len > 0 ? 2 : 1;
+        iovec* cur = iov;
+
+        std::lock_guard<std::mutex> lock(conn.mutex);
+        const bool idle = conn.outpos == conn.outbuf.size();
+        while (idle && count > 0) {
+            msghdr msg = {};
+            msg.msg_iov = cur;
+            msg.msg_iovlen = static_cast<size_t>(count);
+            ssize_t n = sendmsg(conn.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN) return;
+                break;
+            }
+            size_t sent = static_cast<size_t>(n);
+            while (count > 0 && sent >= cur->iov_len) {
+                sent -= cur->iov_len;
+                ++cur;
+                --count;
+            }
+            if (count > 0) {
+                cur->iov_base = static_cast<char*>(cur->iov_base) + sent;
+                cur->iov_len -= sent;
+            }
+        }
+        if (count == 0) return;
+        for (int i = 0; i < count; ++i) {
+            const uint8_t* p = static_cast<const uint8_t*>(cur[i].iov_base);
+            conn.outbuf.insert(conn.outbuf.end(), p, p + cur[i].iov_len);
+        }
+        if (idle) conn.wakeups.Post(conn.fd);  // 原来没有积压，I/O线程还没在等可写
+    }
+
+    /**
+     * @brief 一个请求已回复；在途请求数从上限降下来时请I/O线程继续读这个连接
+     */
+    void FinishRequest(Connection& conn) {
+        std::lock_guard<std::mutex> lock(conn.mutex);
+        if (conn.pending-- == MAX_PENDING) conn.wakeups.Post(conn.fd);
+    }
+
+    // ---------------- 密钥编排缓存 ----------------
+
+    /**
+     * @brief 所有连接共用的SM4-GCM密钥编排（轮密钥与GHASH表）缓存，以密钥的SM3为索引，按最久未使用淘汰
+     */
+    class KeyCache {
+    public:
+        explicit KeyCache(size_t capacity) : capacity_(capacity) {}
+
+        std::shared_ptr<const gmsm_gcm_key> Get(const uint8_t key[GMSMD_KEY_SIZE]) {
+            Digest id;
+            gmsm_sm3(key, GMSMD_KEY_SIZE, id.data());
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(id);
+            if (it != index_.end()) {
+                lru_.splice(lru_.begin(), lru_, it->second);
+                g_metrics.keyCacheHits.fetch_add(1, std::memory_order_relaxed);
+                return it->second->second;
+            }
+            g_metrics.keyCacheMisses.fetch_add(1, std::memory_order_relaxed);
+            std::shared_ptr<gmsm_gcm_key> schedule(new gmsm_gcm_key, [](gmsm_gcm_key* k) {
+                Wipe(k, sizeof(*k));
+                delete k;
+            });
+            gmsm_gcm_init(schedule.get(), key);
+            lru_.emplace_front(id, schedule);
+            index_[id] = lru_.begin();
+            if (lru_.size() > capacity_) {
+                index_.erase(lru_.back().first);
+                lru_.pop_back();  // 仍在使用中的编排由请求持有，用完后清零释放
+            }
+            return schedule;
+        }
+
+    private:
+        using Digest = std::array<uint8_t, 32>;
+        struct DigestHash {
+            size_t operator()(const Digest& d) const {
+                size_t h;
+                std::memcpy(&h, d.data(), sizeof(h));
+                return h;
+            }
+        };
+
+        size_t capacity_;
+        std::mutex mutex_;
+        std::list<std::pair<Digest, std::shared_ptr<const gmsm_gcm_key>>> lru_;
+        std::unordered_map<Digest, decltype(lru_)::iterator, DigestHash> index_;
+    };
+
+    // ---------------- 请求与队列 ----------------
+
+    struct Job {
+        std::shared_ptr<Connection> conn;
+        std::shared_ptr<ShmRegion> shm;  // 使用共享区时持有，防止期间被替换后解除映射
+        gmsmd_request req;
+        uint8_t key[GMSMD_KEY_SIZE];
+        uint8_t iv[GMSMD_IV_SIZE];
+        std::vector<uint8_t> aad;
+        std::vector<uint8_t> inlineData;
+        uint8_t* data = nullptr;        // 指向inlineData或共享区
+        std::vector<uint8_t> output;    // 内联回复
+        uint8_t digest[32];
+        int status = GMSM_OK;
+        Clock::time_point received;
+
+        ~Job() { Wipe(key, sizeof(key)); }
+    };
+
+    class JobQueue {
+    public:
+        void Push(Job* job) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(job);
+            uint64_t depth = jobs_.size();
+            uint64_t seen = g_metrics.maxQueueDepth.load(std::memory_order_relaxed);
+            while (depth > seen && !g_metrics.maxQueueDepth.compare_exchange_weak(seen, depth)) {
+            }
+            cv_.notify_one();
+        }
+
+        /**
+         * @brief 取出一批请求：队首请求到达后最多等待window，期间凑满batchMax个则立即返回。
+         *        停止且队列为空时返回false
+         */
+        bool PopBatch(std::vector<Job*>& batch, std::chrono::microseconds window, size_t batchMax) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;) {
+                cv_.wait(lock, [&] { return stop_ || !jobs_.empty(); });
+                if (jobs_.empty()) return false;
+                auto deadline = jobs_.front()->received + window;
+                cv_.wait_until(lock, deadline, [&] { return stop_ || jobs_.empty() || jobs_.size() >= batchMax; });
+                if (!jobs_.empty()) break;  // 可能已被其他工作线程取走
+            }
+            size_t n = std::min(batchMax, jobs_.size());
+            batch.assign(jobs_.begin(), jobs_.begin() + static_cast<std::ptrdiff_t>(n));
+            jobs_.erase(jobs_.begin(), jobs_.begin() + static_cast<std::ptrdiff_t>(n));
+            if (!jobs_.empty()) cv_.notify_one();
+            return true;
+        }
+
+        size_t Depth() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return jobs_.size();
+        }
+
+        void Stop() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            cv_.notify_all();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<Job*> jobs_;
+        bool stop_ = false;
+    };
+
+    // ---------------- 工作线程 ----------------
+
+    /**
+     * @brief 一批请求：HASH一次多缓冲SM3，SEAL/OPEN按（操作, 密钥）分组后各调用一次批量GCM
+     */
+    void ProcessBatch(const std::vector<Job*>& batch, KeyCache& keys) {
+        std::vector<const void*> hashData;
+        std::vector<size_t> hashLens;
+        std::vector<Job*> hashJobs;
+        // （操作, 密钥编排）-> 请求；相同密钥的请求共用缓存中的同一份编排
+        std::map<std::pair<int, const gmsm_gcm_key*>, std::vector<Job*>> groups;
+        std::vector<std::shared_ptr<const gmsm_gcm_key>> schedules;
+
+        for (Job* job : batch) {
+            if (job->req.op == GMSMD_OP_HASH) {
+                hashData.push_back(job->data);
+                hashLens.push_back(static_cast<size_t>(job->req.data_len));
+                hashJobs.push_back(job);
+                continue;
+            }
+            schedules.push_back(keys.Get(job->key));
+            groups[{ job->req.op, schedules.back().get() }].push_back(job);
+        }
+
+        if (!hashJobs.empty()) {
+            std::vector<uint8_t> digests(hashJobs.size() * 32);
+            gmsm_sm3_batch(hashData.data(), hashLens.data(), hashJobs.size(), digests.data());
+            for (size_t i = 0; i < hashJobs.size(); ++i) std::memcpy(hashJobs[i]->digest, &digests[32 * i], 32);
+        }
+
+        std::vector<gmsm_gcm_batch_item> items;
+        for (auto& group : groups) {
+            const bool seal = group.first.first == GMSMD_OP_SEAL;
+            const gmsm_gcm_key* schedule = group.first.second;
+            items.clear();
+            for (Job* job : group.second) {
+                size_t len = static_cast<size_t>(job->req.data_len) - (seal ? 0 : GMSMD_TAG_SIZE);
+                bool inPlace = (job->req.flags & GMSMD_FLAG_SHM) != 0;
+                if (!inPlace) job->output.resize(seal ? len + GMSMD_TAG_SIZE : len);
+                uint8_t* out = inPlace ? job->data : job->output.data();
+                gmsm_gcm_batch_item item = {};
+                item.iv = job->iv;
+                item.iv_len = GMSMD_IV_SIZE;
+                item.aad = job->aad.data();
+                item.aad_len = job->aad.size();
+                item.in = job->data;
+                item.len = len;
+                item.out = out;
+                item.tag = seal ? out + len : job->data + len;
+                item.tag_len = GMSMD_TAG_SIZE;
+                items.push_back(item);
+            }
+            if (seal) gmsm_gcm_encrypt_batch(schedule, items.data(), items.size());
+            else gmsm_gcm_decrypt_batch(schedule, items.data(), items.size());
+            for (size_t i = 0; i < items.size(); ++i) group.second[i]->status = items[i].status;
+        }
+
+        for (Job* job : batch) {
+            const bool inPlace = (job->req.flags & GMSMD_FLAG_SHM) != 0;
+            if (job->req.op == GMSMD_OP_HASH) {
+                SendResponse(*job->conn, job->req.id, GMSM_OK, job->digest, 32);
+            }
+            else if (job->status != GMSM_OK) {
+                SendResponse(*job->conn, job->req.id, job->status, nullptr, 0);
+            }
+            else if (inPlace) {
+                size_t len = static_cast<size_t>(job->req.data_len);
+                len = job->req.op == GMSMD_OP_SEAL ? len + GMSMD_TAG_SIZE : len - GMSMD_TAG_SIZE;
+                SendResponse(*job->conn, job->req.id, GMSM_OK, nullptr, len);
+            }
+            else {
+                SendResponse(*job->conn, job->req.id, GMSM_OK, job->output.data(), job->output.size());
+                Wipe(job->output.data(), job->output.size());
+            }
+            FinishRequest(*job->conn);
+            g_metrics.requests[job->req.op - GMSMD_OP_SEAL].fetch_add(1, std::memory_order_relaxed);
+            g_metrics.RecordLatency(job->received);
+            delete job;
+        }
+    }
+
+    void WorkerLoop(JobQueue& queue, KeyCache& keys, const Options& opt) {
+        std::vector<Job*> batch;
+        while (queue.PopBatch(batch, std::chrono::microseconds(opt.windowUs), opt.batchMax)) {
+            g_metrics.batches.fetch_add(1, std::memory_order_relaxed);
+            g_metrics.batchedRequests.fetch_add(batch.size(), std::memory_order_relaxed);
+            ProcessBatch(batch, keys);
+        }
+    }
+
+    // ---------------- I/O线程 ----------------
+
+    class Server {
+    public:
+        Server(const Options& opt, JobQueue& queue) : opt_(opt), queue_(queue) {}
+
+        bool Listen() {
+            sockaddr_un addr = {};
+            addr.sun_family = AF_UNIX;
+            if (std::strlen(opt_.socketPath) >= sizeof(addr.sun_path)) return false;
+            std::strcpy(addr.sun_path, opt_.socketPath);
+
+            listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listenFd_ < 0) return false;
+            unlink(opt_.socketPath);
+            mode_t old = umask(077);  // 只允许同一用户连接
+            int rc = bind(listenFd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            umask(old);
+            if (rc != 0 || listen(listenFd_, 128) != 0) return false;
+
+            sigset_t mask;
+            sigemptyset(&mask);
+            sigaddset(&mask, SIGINT);
+            sigaddset(&mask, SIGTERM);
+            pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+            signalFd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+            epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+            if (signalFd_ < 0 || epollFd_ < 0 || wakeups_.Fd() < 0) return false;
+            Watch(listenFd_);
+            Watch(signalFd_);
+            Watch(wakeups_.Fd());
+            return true;
+        }
+
+        void Run() {
+            epoll_event events[64];
+            for (;;) {
+                int n = epoll_wait(epollFd_, events, 64, -1);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    return;
+                }
+                for (int i = 0; i < n; ++i) {
+                    int fd = events[i].data.fd;
+                    if (fd == signalFd_) return;
+                    if (fd == listenFd_) Accept();
+                    else if (fd == wakeups_.Fd()) {
+                        for (int conn : wakeups_.Take()) Service(conn);
+                    }
+                    // 对端已关闭：暂停读取时epoll仍会报告挂断，不能留给Service，否则会反复醒来
+                    else if ((events[i].events & (EPOLLHUP | EPOLLERR)) != 0) Drop(fd);
+                    else Service(fd);
+                }
+            }
+        }
+
+        void Shutdown() {
+            connections_.clear();
+            close(epollFd_);
+            close(signalFd_);
+            close(listenFd_);
+            unlink(opt_.socketPath);
+        }
+
+    private:
+        void Watch(int fd) {
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+        }
+
+        void Accept() {
+            for (;;) {
+                int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) return;
+                connections_[fd] = std::make_shared<Connection>(fd, wakeups_);
+                g_metrics.connections.fetch_add(1, std::memory_order_relaxed);
+                Watch(fd);
+            }
+        }
+
+        void Drop(int fd) {
+            if (connections_.erase(fd) == 0) return;  // 仍有请求在途时由请求持有，回复完再关闭
+            epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+            g_metrics.connections.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        bool Accepting(Connection& conn) {
+            std::lock_guard<std::mutex> lock(conn.mutex);
+            return conn.Accepting();
+        }
+
+        /**
+         * @brief 处理一个连接：发出积压的回复，解析已读到的请求，再在限额之内从套接字读。
+         *        在途请求或积压回复达到上限时不再读，新数据留在套接字缓冲区里，客户端的写随之阻塞
+         */
+        void Service(int fd) {
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) return;
+            std::shared_ptr<Connection> conn = it->second;
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                if (!FlushLocked(*conn)) {
+                    Drop(fd);
+                    return;
+                }
+            }
+
+            uint8_t buf[64 * 1024];
+            alignas(cmsghdr) char control[CMSG_SPACE(4 * sizeof(int))];
+            bool closed = false;
+            for (;;) {
+                if (!ParseFrames(conn)) {
+                    Drop(fd);
+                    return;
+                }
+                if (closed || conn->inbuf.size() >= MAX_INBUF || !Accepting(*conn)) break;
+                iovec iov = { buf, std::min(sizeof(buf), MAX_INBUF - conn->inbuf.size()) };
+                msghdr msg = {};
+                msg.msg_iov = &iov;
+                msg.msg_iovlen = 1;
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+                ssize_t n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && errno == EAGAIN) break;
+                if (n <= 0) {
+                    closed = true;  // 先处理已经收到的完整请求
+                    continue;
+                }
+                for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c != nullptr; c = CMSG_NXTHDR(&msg, c)) {
+                    if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+                    size_t count = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    for (size_t k = 0; k < count; ++k) {
+                        int passed;
+                        std::memcpy(&passed, CMSG_DATA(c) + k * sizeof(int), sizeof(int));
+                        if (conn->receivedFds.size() < 4) conn->receivedFds.push_back(passed);
+                        else close(passed);
+                    }
+                }
+                conn->inbuf.insert(conn->inbuf.end(), buf, buf + n);
+            }
+            if (closed) {
+                Drop(fd);
+                return;
+            }
+            Rearm(*conn);
+        }
+
+        /**
+         * @brief 按连接的状态调整epoll关注的事件：能接收新请求时关注可读，有积压回复时关注可写
+         */
+        void Rearm(Connection& conn) {
+            uint32_t want = 0;
+            {
+                std::lock_guard<std::mutex> lock(conn.mutex);
+                if (conn.Accepting()) want |= EPOLLIN;
+                if (conn.outpos < conn.outbuf.size()) want |= EPOLLOUT;
+            }
+            if (want == conn.events) return;
+            epoll_event ev = {};
+            ev.events = want;
+            ev.data.fd = conn.fd;
+            epoll_ctl(epollFd_, EPOLL_CTL_MOD, conn.fd, &ev);
+            conn.events = want;
+        }
+
+        /**
+         * @brief 解析缓冲区中完整的请求，在途请求达到上限时停下，其余留在缓冲区中；
+         *        格式错误无法继续分帧时返回false
+         */
+        bool ParseFrames(const std::shared_ptr<Connection>& conn) {
+            std::vector<uint8_t>& in = conn->inbuf;
+            size_t pos = 0;
+            while (in.size() - pos >= sizeof(gmsmd_request) && Accepting(*conn)) {
+                gmsmd_request req;
+                std::memcpy(&req, in.data() + pos, sizeof(req));
+                if (req.magic != GMSMD_MAGIC) return false;
+                const bool shm = (req.flags & GMSMD_FLAG_SHM) != 0;
+                size_t body = 0;
+                switch (req.op) {
+                case GMSMD_OP_SEAL:
+                case GMSMD_OP_OPEN:
+                    if (req.aad_len > GMSMD_MAX_INLINE) return false;
+                    body = GMSMD_KEY_SIZE + GMSMD_IV_SIZE + req.aad_len;
+                    [[fallthrough]];
+                case GMSMD_OP_HASH:
+                    if (!shm && req.data_len > GMSMD_MAX_INLINE) return false;
+                    if (!shm) body += static_cast<size_t>(req.data_len);
+                    break;
+                case GMSMD_OP_ATTACH:
+                case GMSMD_OP_STATS:
+                    break;
+                default:
+                    return false;
+                }
+                if (in.size() - pos - sizeof(req) < body) break;
+                HandleRequest(conn, req, in.data() + pos + sizeof(req));
+                pos += sizeof(req) + body;
+            }
+            in.erase(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(pos));
+            return true;
+        }
+
+        void HandleRequest(const std::shared_ptr<Connection>& conn, const gmsmd_request& req, const uint8_t* body) {
+            if (req.op == GMSMD_OP_ATTACH) {
+                SendResponse(*conn, req.id, Attach(*conn, req.data_len), nullptr, 0);
+                return;
+            }
+            if (req.op == GMSMD_OP_STATS) {
+                gmsmd_stats stats = Snapshot();
+                SendResponse(*conn, req.id, GMSM_OK, reinterpret_cast<const uint8_t*>(&stats), sizeof(stats));
+                return;
+            }
+
+            std::unique_ptr<Job> job(new Job());
+            job->conn = conn;
+            job->req = req;
+            job->received = Clock::now();
+            if (req.op != GMSMD_OP_HASH) {
+                std::memcpy(job->key, body, GMSMD_KEY_SIZE);
+                std::memcpy(job->iv, body + GMSMD_KEY_SIZE, GMSMD_IV_SIZE);
+                body += GMSMD_KEY_SIZE + GMSMD_IV_SIZE;
+                job->aad.assign(body, body + req.aad_len);
+                body += req.aad_len;
+                if (req.op == GMSMD_OP_OPEN && req.data_len < GMSMD_TAG_SIZE) {
+                    SendResponse(*conn, req.id, GMSM_ERR_PARAM, nullptr, 0);
+                    return;
+                }
+            }
+            if ((req.flags & GMSMD_FLAG_SHM) != 0) {
+                // 封装的结果多出16字节标签，原位写回也必须在共享区之内
+                uint64_t need = req.data_len + (req.op == GMSMD_OP_SEAL ? GMSMD_TAG_SIZE : 0);
+                const ShmRegion* region = conn->shm.get();
+                if (region == nullptr || req.shm_offset > region->size || need > region->size - req.shm_offset) {
+                    SendResponse(*conn, req.id, GMSMD_ERR_PROTO, nullptr, 0);
+                    return;
+                }
+                job->shm = conn->shm;
+                job->data = region->base + req.shm_offset;
+            }
+            else {
+                job->inlineData.assign(body, body + req.data_len);
+                job->data = job->inlineData.data();
+            }
+            {
+                std::lock_guard<std::mutex> lock(conn->mutex);
+                ++conn->pending;
+            }
+            queue_.Push(job.release());
+        }
+
+        int Attach(Connection& conn, uint64_t size) {
+            if (conn.receivedFds.empty()) return GMSMD_ERR_PROTO;
+            int fd = conn.receivedFds.front();
+            conn.receivedFds.erase(conn.receivedFds.begin());
+            // 映射之后客户端若能截短文件，访问被截掉的部分会让守护进程收到SIGBUS；
+            // 只接受已加F_SEAL_SHRINK封印的memfd，此后大小不会再小于检查时的值
+            struct stat st;
+            void* p = MAP_FAILED;
+            int seals = fcntl(fd, F_GET_SEALS);
+            if (seals >= 0 && (seals & F_SEAL_SHRINK) != 0 &&
+                size > 0 && fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) >= size) {
+                p = mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+            if (p == MAP_FAILED) return GMSMD_ERR_PROTO;
+            conn.shm = std::make_shared<ShmRegion>(static_cast<uint8_t*>(p), static_cast<size_t>(size));
+            return GMSM_OK;
+        }
+
+        gmsmd_stats Snapshot() {
+            gmsmd_stats s = {};
+            for (int i = 0; i < 3; ++i) s.requests[i] = g_metrics.requests[i].load();
+            s.batches = g_metrics.batches.load();
+            s.batched_requests = g_metrics.batchedRequests.load();
+            s.queue_depth = queue_.Depth();
+            s.max_queue_depth = g_metrics.maxQueueDepth.load();
+            s.key_cache_hits = g_metrics.keyCacheHits.load();
+            s.key_cache_misses = g_metrics.keyCacheMisses.load();
+            s.connections = g_metrics.connections.load();
+            s.latency_total_us = g_metrics.latencyTotalUs.load();
+            for (int i = 0; i < GMSMD_LATENCY_BUCKETS; ++i) s.latency_hist[i] = g_metrics.latencyHist[i].load();
+            return s;
+        }
+
+        const Options& opt_;
+        JobQueue& queue_;
+        int listenFd_ = -1;
+        int signalFd_ = -1;
+        int epollFd_ = -1;
+        Wakeups wakeups_;
+        std::unordered_map<int, std::shared_ptr<Connection>> connections_;
+    };
+
+    void Usage(const char* prog) {
+        std::fprintf(stderr,
+            "用法: %s [-s 套接字路径] [-w 工作线程数] [-t 合并窗口(微秒)] [-b 每批上限] [-k 密钥缓存条目]\n"
+            "默认: -s %s -w CPU核数 -t 20 -b 64 -k 1024\n", prog, GMSMD_DEFAULT_SOCKET);
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc || arg[0] != '-' || arg[2] != '\0') {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        switch (arg[1]) {
+        case 's': opt.socketPath = value; break;
+        case 'w': opt.workers = static_cast<unsigned>(std::strtoul(value, nullptr, 10)); break;
+        case 't': opt.windowUs = static_cast<unsigned>(std::strtoul(value, nullptr, 10)); break;
+        case 'b': opt.batchMax = std::max<size_t>(1, std::strtoul(value, nullptr, 10)); break;
+        case 'k': opt.keyCacheSize = std::max<size_t>(1, std::strtoul(value, nullptr, 10)); break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opt.workers == 0) opt.workers = std::max(1u, std::thread::hardware_concurrency());
+    std::signal(SIGPIPE, SIG_IGN);
+
+    JobQueue queue;
+    KeyCache keys(opt.keyCacheSize);
+    Server server(opt, queue);
+    if (!server.Listen()) {
+        std::perror("gmsmd");
+        return 1;
+    }
+    // 工作线程在屏蔽信号之后创建，继承信号掩码，SIGINT/SIGTERM只经signalfd交给I/O线程
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < opt.workers; ++i) {
+        workers.emplace_back(WorkerLoop, std::ref(queue), std::ref(keys), std::cref(opt));
+    }
+    std::printf("gmsmd: %s，%u 个工作线程，合并窗口 %u us，每批最多 %zu 个请求，SM4实现 %s\n",
+        opt.socketPath, opt.workers, opt.windowUs, opt.batchMax, gmsm_sm4_impl_name());
+    std::fflush(stdout);
+
+    server.Run();
+    queue.Stop();
+    for (auto& t : workers) t.join();
+    server.Shutdown();
+    return 0;
+}
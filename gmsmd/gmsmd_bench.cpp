@@ -0,0 +1,146 @@
+﻿#include <atomic>       // 计数
+#include <chrono>       // 时间测量
+#include <cstdio>       // 输出
+#include <cstdlib>      // 命令行参数
+#include <cstring>      // 内存操作
+#include <thread>       // 客户端线程
+#include <vector>       // 动态数组
+#include "../libgmsm/gmsm.h"  // 本地结果，用于核对
+#include "gmsmd_client.h"     // 守护进程客户端
+
+namespace {
+
+    const uint8_t kKey[16] = {
+        0x01,0x23,0x45,0x67,0x89,0xab,0xcd,0xef,
+        0xfe,0xdc,0xba,0x98,0x76,0x54,0x32,0x10
+    };
+
+    /**
+     * @brief 一个客户端线程：交替发送封装与哈希请求，前几个结果与本地libgmsm核对
+     */
+    void ClientLoop(const char* path, int index, int requests, size_t size, std::atomic<int>& errors) {
+        gmsmd_client* c = gmsmd_connect(path);
+        if (c == nullptr) {
+            ++errors;
+            return;
+        }
+        gmsm_gcm_key local;
+        gmsm_gcm_init(&local, kKey);
+        std::vector<uint8_t> msg(size), sealed(size + 16), opened(size), expect(size + 16);
+        uint8_t iv[12] = { 0 }, digest[32], expectDigest[32];
+        for (int r = 0; r < requests; ++r) {
+            for (size_t i = 0; i < size; ++i) msg[i] = static_cast<uint8_t>(index + r + i);
+            std::memcpy(iv, &r, sizeof(r));
+            std::memcpy(iv + 4, &index, sizeof(index));
+            if (r % 2 == 0) {
+                if (gmsmd_seal(c, kKey, iv, nullptr, 0, msg.data(), size, sealed.data()) != GMSM_OK) ++errors;
+                if (r < 8) {
+                    gmsm_gcm_encrypt(&local, iv, 12, nullptr, 0, msg.data(), size, expect.data(), expect.data() + size, 16);
+                    if (std::memcmp(sealed.data(), expect.data(), size + 16) != 0) ++errors;
+                    if (gmsmd_open(c, kKey, iv, nullptr, 0, sealed.data(), size + 16, opened.data()) != GMSM_OK ||
+                        std::memcmp(opened.data(), msg.data(), size) != 0) ++errors;
+                    sealed[0] ^= 1;
+                    if (gmsmd_open(c, kKey, iv, nullptr, 0, sealed.data(), size + 16, opened.data()) != GMSM_ERR_AUTH) ++errors;
+                }
+            }
+            else {
+                if (gmsmd_hash(c, msg.data(), size, digest) != GMSM_OK) ++errors;
+                if (r < 8) {
+                    gmsm_sm3(msg.data(), size, expectDigest);
+                    if (std::memcmp(digest, expectDigest, 32) != 0) ++errors;
+                }
+            }
+        }
+        gmsmd_close(c);
+    }
+
+    /**
+     * @brief 大数据经共享区：数据直接写在共享区中，封装、解封都原位完成
+     */
+    bool LargeRoundTrip(const char* path, size_t size) {
+        gmsmd_client* c = gmsmd_connect(path);
+        if (c == nullptr) return false;
+        uint8_t* buf = static_cast<uint8_t*>(gmsmd_shared_buffer(c, size + 16));
+        std::vector<uint8_t> plain(size), expect(size + 16);
+        for (size_t i = 0; i < size; ++i) plain[i] = static_cast<uint8_t>(i * 7);
+        uint8_t iv[12] = { 9 };
+        gmsm_gcm_key local;
+        gmsm_gcm_init(&local, kKey);
+        gmsm_gcm_encrypt(&local, iv, 12, nullptr, 0, plain.data(), size, expect.data(), expect.data() + size, 16);
+
+        bool ok = buf != nullptr;
+        if (ok) {
+            std::memcpy(buf, plain.data(), size);
+            auto start = std::chrono::steady_clock::now();
+            ok = gmsmd_seal(c, kKey, iv, nullptr, 0, buf, size, buf) == GMSM_OK &&
+                std::memcmp(buf, expect.data(), size + 16) == 0;
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            ok = ok && gmsmd_open(c, kKey, iv, nullptr, 0, buf, size + 16, buf) == GMSM_OK &&
+                std::memcmp(buf, plain.data(), size) == 0;
+            uint8_t d1[32], d2[32];
+            ok = ok && gmsmd_hash(c, buf, size, d1) == GMSM_OK;
+            gmsm_sm3(plain.data(), size, d2);
+            ok = ok && std::memcmp(d1, d2, 32) == 0;
+            std::printf("共享区 %zu MB 封装: %.2f ms（%.1f MB/s），解封与哈希%s\n", size >> 20, ms,
+                size / (ms / 1000) / (1024 * 1024), ok ? "一致" : "不一致");
+        }
+        gmsmd_close(c);
+        return ok;
+    }
+
+    /**
+     * @brief 由直方图估计分位数：返回第一个累计比例达到q的桶的上界（微秒）
+     */
+    uint64_t Percentile(const gmsmd_stats& s, double q) {
+        uint64_t total = 0;
+        for (int i = 0; i < GMSMD_LATENCY_BUCKETS; ++i) total += s.latency_hist[i];
+        uint64_t seen = 0;
+        for (int i = 0; i < GMSMD_LATENCY_BUCKETS; ++i) {
+            seen += s.latency_hist[i];
+            if (seen >= q * total) return uint64_t(1) << i;
+        }
+        return uint64_t(1) << (GMSMD_LATENCY_BUCKETS - 1);
+    }
+
+} // namespace
+
+// 多个客户端并发发送短请求，统计吞吐量，再读取守护进程的合并与延迟指标
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : GMSMD_DEFAULT_SOCKET;
+    int threads = argc > 2 ? std::atoi(argv[2]) : 32;
+    int requests = argc > 3 ? std::atoi(argv[3]) : 2000;
+    size_t size = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 64;
+
+    std::atomic<int> errors{ 0 };
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (int t = 0; t < threads; ++t) {
+        clients.emplace_back(ClientLoop, path, t, requests, size, std::ref(errors));
+    }
+    for (auto& t : clients) t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%d 个客户端 x %d 个 %zu 字节请求（封装/哈希交替）: %.0f 请求/秒，错误 %d\n",
+        threads, requests, size, threads * static_cast<double>(requests) / seconds, errors.load());
+
+    bool largeOk = LargeRoundTrip(path, size_t(16) << 20);
+
+    gmsmd_client* c = gmsmd_connect(path);
+    gmsmd_stats s = {};
+    if (c == nullptr || gmsmd_get_stats(c, &s) != GMSM_OK) {
+        std::fprintf(stderr, "无法读取指标\n");
+        return 1;
+    }
+    gmsmd_close(c);
+    uint64_t total = s.requests[0] + s.requests[1] + s.requests[2];
+    std::printf("守护进程累计: 封装 %llu，解封 %llu，哈希 %llu\n", static_cast<unsigned long long>(s.requests[0]),
+        static_cast<unsigned long long>(s.requests[1]), static_cast<unsigned long long>(s.requests[2]));
+    std::printf("  批次 %llu，平均每批 %.1f 个请求，最大队列深度 %llu\n", static_cast<unsigned long long>(s.batches),
+        s.batches ? static_cast<double>(s.batched_requests) / s.batches : 0.0,
+        static_cast<unsigned long long>(s.max_queue_depth));
+    std::printf("  密钥缓存命中 %llu / 未命中 %llu\n", static_cast<unsigned long long>(s.key_cache_hits),
+        static_cast<unsigned long long>(s.key_cache_misses));
+    std::printf("  延迟: 平均 %.1f us，p50 < %llu us，p99 < %llu us\n",
+        total ? static_cast<double>(s.latency_total_us) / total : 0.0,
+        static_cast<unsigned long long>(Percentile(s, 0.5)), static_cast<unsigned long long>(Percentile(s, 0.99)));
+    return errors.load() == 0 && largeOk ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+﻿#include "gmsmd_client.h"
+#include "../libgmsm/gmsm.h"
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct gmsmd_client {
+    int fd = -1;
+    uint32_t nextId = 1;
+    std::mutex mutex;
+    uint8_t* shm = nullptr;
+    size_t shmSize = 0;
+};
+
+namespace {
+
+    constexpr size_t SHM_GRANULE = size_t(1) << 20;
+
+    /**
+     * @brief 写出全部iov；passFd >= 0 时随第一段以SCM_RIGHTS传递
+     */
+    bool SendAll(int fd, iovec* iov, int count, int passFd) {
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        while (count > 0) {
+            msghdr msg = {};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = static_cast<size_t>(count);
+            if (passFd >= 0) {
+                std::memset(control, 0, sizeof(control));
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof(control);
+                cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_RIGHTS;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+                std::memcpy(CMSG_DATA(cmsg), &passFd, sizeof(int));
+            }
+            ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if (n < 0) return false;
+            passFd = -1;
+            size_t sent = static_cast<size_t>(n);
+            while (count > 0 && sent >= iov->iov_len) {
+                sent -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + sent;
+                iov->iov_len -= sent;
+            }
+        }
+        return true;
+    }
+
+    bool RecvAll(int fd, void* buf, size_t len) {
+        uint8_t* p = static_cast<uint8_t*>(buf);
+        while (len > 0) {
+            ssize_t n = recv(fd, p, len, 0);
+            if (n <= 0) return false;
+            p += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 发送一个请求并等待回复；内联回复数据写入out（最多outCap字节）
+     */
+    int Transact(gmsmd_client* c, gmsmd_request& req, iovec* body, int count, int passFd,
+        uint8_t* out, size_t outCap, size_t* outLen) {
+        req.magic = GMSMD_MAGIC;
+        req.id = c->nextId++;
+        iovec iov[6];
+        iov[0] = { &req, sizeof(req) };
+        for (int i = 0; i < count; ++i) iov[i + 1] = body[i];
+        if (!SendAll(c->fd, iov, count + 1, passFd)) return GMSMD_ERR_IO;
+
+        gmsmd_response resp;
+        if (!RecvAll(c->fd, &resp, sizeof(resp)) || resp.magic != GMSMD_MAGIC || resp.id != req.id) {
+            return GMSMD_ERR_IO;
+        }
+        // 摘要总是内联返回，其余操作使用共享区时结果原位写回
+        bool inlineData = resp.status == GMSM_OK &&
+            ((req.flags & GMSMD_FLAG_SHM) == 0 || req.op == GMSMD_OP_HASH);
+        if (inlineData) {
+            if (resp.data_len > outCap) return GMSMD_ERR_IO;
+            if (!RecvAll(c->fd, out, static_cast<size_t>(resp.data_len))) return GMSMD_ERR_IO;
+        }
+        if (outLen != nullptr) *outLen = static_cast<size_t>(resp.data_len);
+        return resp.status;
+    }
+
+    uint8_t* EnsureShm(gmsmd_client* c, size_t size) {
+        if (size <= c->shmSize) return c->shm;
+        size_t want = c->shmSize * 2 > size ? c->shmSize * 2 : size;
+        want = (want + SHM_GRANULE - 1) / SHM_GRANULE * SHM_GRANULE;
+
+        int fd = memfd_create("gmsmd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd < 0) return nullptr;
+        void* p = MAP_FAILED;
+        // 守护进程只接受封印了大小的memfd：截短已映射的共享区会让它收到SIGBUS
+        if (ftruncate(fd, static_cast<off_t>(want)) == 0 &&
+            fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW) == 0) {
+            p = mmap(nullptr, want, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        int status = GMSMD_ERR_IO;
+        if (p != MAP_FAILED) {
+            gmsmd_request req = {};
+            req.op = GMSMD_OP_ATTACH;
+            req.data_len = want;
+            status = Transact(c, req, nullptr, 0, fd, nullptr, 0, nullptr);
+        }
+        close(fd);
+        if (status != GMSM_OK) {
+            if (p != MAP_FAILED) munmap(p, want);
+            return nullptr;
+        }
+        if (c->shm != nullptr) munmap(c->shm, c->shmSize);
+        c->shm = static_cast<uint8_t*>(p);
+        c->shmSize = want;
+        return c->shm;
+    }
+
+    /**
+     * @brief 大数据走共享区：in已在共享区且放得下need字节时原位使用，否则复制到共享区开头
+     * @return 数据在共享区中的偏移，失败返回SIZE_MAX
+     */
+    size_t PlaceInShm(gmsmd_client* c, const uint8_t* in, size_t len, size_t need) {
+        if (c->shm != nullptr && in >= c->shm && in < c->shm + c->shmSize) {
+            size_t offset = static_cast<size_t>(in - c->shm);
+            return offset + need <= c->shmSize ? offset : SIZE_MAX;
+        }
+        if (EnsureShm(c, need) == nullptr) return SIZE_MAX;
+        std::memmove(c->shm, in, len);
+        return 0;
+    }
+
+    int Crypt(gmsmd_client* c, uint8_t op, const uint8_t key[GMSMD_KEY_SIZE], const uint8_t iv[GMSMD_IV_SIZE],
+        const uint8_t* aad, size_t aadLen, const uint8_t* in, size_t len, uint8_t* out) {
+        if (aadLen > GMSMD_MAX_INLINE || (op == GMSMD_OP_OPEN && len < GMSMD_TAG_SIZE)) return GMSM_ERR_PARAM;
+        const size_t outLen = op == GMSMD_OP_SEAL ? len + GMSMD_TAG_SIZE : len - GMSMD_TAG_SIZE;
+
+        std::lock_guard<std::mutex> lock(c->mutex);
+        gmsmd_request req = {};
+        req.op = op;
+        req.aad_len = static_cast<uint32_t>(aadLen);
+        req.data_len = len;
+        iovec body[4] = {
+            { const_cast<uint8_t*>(key), GMSMD_KEY_SIZE },
+            { const_cast<uint8_t*>(iv), GMSMD_IV_SIZE },
+            { const_cast<uint8_t*>(aad), aadLen },
+            { const_cast<uint8_t*>(in), len },
+        };
+        if (len <= GMSMD_MAX_INLINE) {
+            return Transact(c, req, body, 4, -1, out, outLen, nullptr);
+        }
+
+        size_t offset = PlaceInShm(c, in, len, len > outLen ? len : outLen);
+        if (offset == SIZE_MAX) return c->shm == nullptr ? GMSMD_ERR_IO : GMSM_ERR_PARAM;
+        req.flags = GMSMD_FLAG_SHM;
+        req.shm_offset = offset;
+        int status = Transact(c, req, body, 3, -1, nullptr, 0, nullptr);
+        if (status == GMSM_OK && out != c->shm + offset) std::memcpy(out, c->shm + offset, outLen);
+        return status;
+    }
+
+} // namespace
+
+extern "C" {
+
+    gmsmd_client* gmsmd_connect(const char* path) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (std::strlen(path) >= sizeof(addr.sun_path)) return nullptr;
+        std::strcpy(addr.sun_path, path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return nullptr;
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            return nullptr;
+        }
+        gmsmd_client* c = new (std::nothrow) gmsmd_client();
+        if (c == nullptr) {
+            close(fd);
+            return nullptr;
+        }
+        c->fd = fd;
+        return c;
+    }
+
+    void gmsmd_close(gmsmd_client* client) {
+        if (client == nullptr) return;
+        if (client->shm != nullptr) munmap(client->shm, client->shmSize);
+        close(client->fd);
+        delete client;
+    }
+
+    void* gmsmd_shared_buffer(gmsmd_client* client, size_t size) {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        return EnsureShm(client, size);
+    }
+
+    int gmsmd_seal(gmsmd_client* client, const uint8_t key[GMSMD_KEY_SIZE], const uint8_t iv[GMSMD_IV_SIZE],
+        const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out) {
+        return Crypt(client, GMSMD_OP_SEAL, key, iv, aad, aad_len, in, len, out);
+    }
+
+    int gmsmd_open(gmsmd_client* client, const uint8_t key[GMSMD_KEY_SIZE], const uint8_t iv[GMSMD_IV_SIZE],
+        const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out) {
+        return Crypt(client, GMSMD_OP_OPEN, key, iv, aad, aad_len, in, len, out);
+    }
+
+    int gmsmd_hash(gmsmd_client* client, const void* data, size_t len, uint8_t digest[32]) {
+        const uint8_t* in = static_cast<const uint8_t*>(data);
+        std::lock_guard<std::mutex> lock(client->mutex);
+        gmsmd_request req = {};
+        req.op = GMSMD_OP_HASH;
+        req.data_len = len;
+        iovec body[1] = { { const_cast<uint8_t*>(in), len } };
+        if (len <= GMSMD_MAX_INLINE) {
+            return Transact(client, req, body, 1, -1, digest, 32, nullptr);
+        }
+        size_t offset = PlaceInShm(client, in, len, len);
+        if (offset == SIZE_MAX) return GMSMD_ERR_IO;
+        req.flags = GMSMD_FLAG_SHM;
+        req.shm_offset = offset;
+        return Transact(client, req, nullptr, 0, -1, digest, 32, nullptr);
+    }
+
+    int gmsmd_get_stats(gmsmd_client* client, gmsmd_stats* stats) {
+        std::lock_guard<std::mutex> lock(client->mutex);
+        gmsmd_request req = {};
+        req.op = GMSMD_OP_STATS;
+        return Transact(client, req, nullptr, 0, -1, reinterpret_cast<uint8_t*>(stats), sizeof(*stats), nullptr);
+    }
+
+} // extern "C"
@@ -0,0 +1,47 @@
+﻿#ifndef GMSMD_CLIENT_H
+#define GMSMD_CLIENT_H
+
+/*
+ * gmsmd 客户端：连接本机守护进程，由它完成SM4-GCM封装/解封和SM3。
+ * 每个连接同一时刻只有一个请求在途，调用会阻塞到收到回复；多线程共享一个连接时由内部的锁串行化，
+ * 需要并发时每个线程各开一个连接，守护进程会把它们的短请求合并成批次。
+ * 超过 GMSMD_MAX_INLINE 的数据经共享内存（memfd）传递，不再经过套接字复制。
+ * 返回值为gmsm.h中的GMSM_*或gmsmd_proto.h中的GMSMD_ERR_*
+ */
+
+#include <stddef.h>
+#include "gmsmd_proto.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct gmsmd_client gmsmd_client;
+
+/* 连接path处的守护进程，失败返回NULL */
+gmsmd_client* gmsmd_connect(const char* path);
+void gmsmd_close(gmsmd_client* client);
+
+/*
+ * 返回至少size字节的共享区起始地址（必要时重新创建并交给守护进程）。
+ * 输入放在这里的请求不再复制；输出指针也指向同一位置时结果直接写在这里
+ */
+void* gmsmd_shared_buffer(gmsmd_client* client, size_t size);
+
+/* SM4-GCM加密：out写入 len + 16 字节（密文 || 标签），in与out可以相同 */
+int gmsmd_seal(gmsmd_client* client, const uint8_t key[GMSMD_KEY_SIZE], const uint8_t iv[GMSMD_IV_SIZE],
+    const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out);
+
+/* SM4-GCM解密：in为密文 || 标签（len含16字节标签），out写入 len - 16 字节；标签不匹配返回GMSM_ERR_AUTH */
+int gmsmd_open(gmsmd_client* client, const uint8_t key[GMSMD_KEY_SIZE], const uint8_t iv[GMSMD_IV_SIZE],
+    const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out);
+
+int gmsmd_hash(gmsmd_client* client, const void* data, size_t len, uint8_t digest[32]);
+
+int gmsmd_get_stats(gmsmd_client* client, gmsmd_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GMSMD_CLIENT_H */
@@ -0,0 +1,76 @@
+﻿#ifndef GMSMD_PROTO_H
+#define GMSMD_PROTO_H
+
+/*
+ * gmsmd 的线上格式（Unix域流套接字，本机字节序）
+ *
+ * 每个请求为 gmsmd_request 头 + 正文：
+ *   SEAL / OPEN：key[16] iv[12] aad[aad_len]，未置 GMSMD_FLAG_SHM 时后接 data[data_len]
+ *   HASH：未置 GMSMD_FLAG_SHM 时为 data[data_len]
+ *   ATTACH：无正文，共享内存的文件描述符随消息以 SCM_RIGHTS 传递，data_len 为其大小；
+ *           须为已加 F_SEAL_SHRINK 封印的 memfd，否则返回 GMSMD_ERR_PROTO
+ *   STATS：无正文
+ * 置 GMSMD_FLAG_SHM 时数据位于共享区 [shm_offset, shm_offset + data_len)，结果原位写回。
+ *
+ * 每个回复为 gmsmd_response 头，未使用共享区时后接 data[data_len]：
+ *   SEAL：密文 || 16字节标签    OPEN：明文（data_len 含标签，回复长度为 data_len - 16）
+ *   HASH：32字节摘要（始终内联）  STATS：gmsmd_stats
+ */
+
+#include <stdint.h>
+
+#define GMSMD_MAGIC 0x444D5347u  /* "GSMD" */
+#define GMSMD_DEFAULT_SOCKET "/tmp/gmsmd.sock"
+
+#define GMSMD_OP_SEAL 1
+#define GMSMD_OP_OPEN 2
+#define GMSMD_OP_HASH 3
+#define GMSMD_OP_ATTACH 4
+#define GMSMD_OP_STATS 5
+
+#define GMSMD_FLAG_SHM 0x01
+
+#define GMSMD_KEY_SIZE 16
+#define GMSMD_IV_SIZE 12
+#define GMSMD_TAG_SIZE 16
+#define GMSMD_MAX_INLINE (64 * 1024)  /* 内联数据与AAD的上限，更大的数据须经共享区 */
+
+/* 除gmsm.h中的返回值外，守护进程可能返回 */
+#define GMSMD_ERR_PROTO (-100)  /* 格式错误或共享区越界 */
+#define GMSMD_ERR_IO (-101)     /* 客户端：连接断开或系统调用失败 */
+
+typedef struct gmsmd_request {
+    uint32_t magic;
+    uint8_t op;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t id;
+    uint32_t aad_len;
+    uint64_t data_len;
+    uint64_t shm_offset;
+} gmsmd_request;
+
+typedef struct gmsmd_response {
+    uint32_t magic;
+    int32_t status;
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t data_len;
+} gmsmd_response;
+
+#define GMSMD_LATENCY_BUCKETS 20
+
+typedef struct gmsmd_stats {
+    uint64_t requests[3];         /* SEAL / OPEN / HASH */
+    uint64_t batches;             /* 工作线程取出的批次数 */
+    uint64_t batched_requests;    /* 这些批次中的请求数，除以batches为平均合并数 */
+    uint64_t queue_depth;         /* 当前排队的请求数 */
+    uint64_t max_queue_depth;
+    uint64_t key_cache_hits;
+    uint64_t key_cache_misses;
+    uint64_t connections;         /* 当前连接数 */
+    uint64_t latency_total_us;    /* 从读完请求到写出回复的总耗时 */
+    uint64_t latency_hist[GMSMD_LATENCY_BUCKETS];  /* 第i桶：耗时 < 2^i 微秒（最后一桶含更大值） */
+} gmsmd_stats;
+
+#endif /* GMSMD_PROTO_H */
@@ -0,0 +1,210 @@
+﻿#include "gmsm_internal.h"
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace gmsm {
+
+    namespace {
+
+        constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+        constexpr int MIN_SLAB_SHIFT = 12;  // 最小slab 4 KiB
+        constexpr int SMALL_CLASSES = 9;    // 4 KiB ~ 1 MiB，每类从一个2 MiB区域切出
+        constexpr size_t MAX_SMALL_SLAB = size_t(1) << (MIN_SLAB_SHIFT + SMALL_CLASSES - 1);
+        // 空闲的大块映射最多缓存这么多字节，超出时直接归还系统
+        constexpr size_t MAX_IDLE_BYTES = size_t(256) << 20;
+
+        enum class PageKind { HugeTlb, Transparent, Small };
+
+        struct Slab {
+            size_t size;
+            PageKind kind;   // 仅对独占映射有意义
+            bool dedicated;  // 独占一个映射（大于1 MiB的请求）
+        };
+
+        struct Arena {
+            std::mutex mutex;
+            std::unordered_map<void*, Slab> live;
+            std::vector<void*> freeSmall[SMALL_CLASSES];
+            std::multimap<size_t, std::pair<void*, PageKind>> idleLarge;
+            size_t idleBytes = 0;
+            gmsm_buffer_stats stats = {};
+        };
+
+        Arena& GetArena() {
+            static Arena* arena = new Arena();  // 不析构：其他静态对象析构时仍可能释放缓冲区
+            return *arena;
+        }
+
+        void CountMapped(gmsm_buffer_stats& stats, PageKind kind, size_t size, bool add) {
+            uint64_t& counter = kind == PageKind::HugeTlb ? stats.hugetlb_bytes :
+                kind == PageKind::Transparent ? stats.thp_bytes : stats.small_page_bytes;
+            counter = add ? counter + size : counter - size;
+        }
+
+        /**
+         * @brief 申请size字节（2 MiB的倍数）的映射：显式大页 -> 2 MiB对齐并建议透明大页 -> 普通页
+         */
+        void* MapRegion(size_t size, PageKind& kind) {
+#if defined(_WIN32)
+            SIZE_T large = GetLargePageMinimum();
+            if (large != 0 && size % large == 0) {  // 需要SeLockMemoryPrivilege，通常会失败
+                void* p = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+                if (p != nullptr) {
+                    kind = PageKind::HugeTlb;
+                    return p;
+                }
+            }
+            kind = PageKind::Small;
+            return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+#if defined(MAP_HUGETLB)
+            int hugeFlags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#if defined(MAP_HUGE_SHIFT)
+            hugeFlags |= 21 << MAP_HUGE_SHIFT;  // 明确要求2 MiB页
+#endif
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, hugeFlags, -1, 0);
+            if (p != MAP_FAILED) {
+                kind = PageKind::HugeTlb;
+                return p;
+            }
+#endif
+            // 多映射一个大页再裁掉首尾，使区域按2 MiB对齐，透明大页才能整页覆盖
+            size_t span = size + HUGE_PAGE_SIZE;
+            void* raw = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED) return nullptr;
+            uint8_t* begin = static_cast<uint8_t*>(raw);
+            uint8_t* aligned = reinterpret_cast<uint8_t*>(
+                (reinterpret_cast<uintptr_t>(begin) + HUGE_PAGE_SIZE - 1) & ~static_cast<uintptr_t>(HUGE_PAGE_SIZE - 1));
+            if (aligned > begin) munmap(begin, static_cast<size_t>(aligned - begin));
+            size_t tail = static_cast<size_t>(begin + span - (aligned + size));
+            if (tail > 0) munmap(aligned + size, tail);
+            kind = PageKind::Small;
+#if defined(MADV_HUGEPAGE)
+            if (madvise(aligned, size, MADV_HUGEPAGE) == 0) kind = PageKind::Transparent;
+#endif
+            return aligned;
+#endif
+        }
+
+        void UnmapRegion(void* p, size_t size) {
+#if defined(_WIN32)
+            (void)size;
+            VirtualFree(p, 0, MEM_RELEASE);
+#else
+            munmap(p, size);
+#endif
+        }
+
+        int SmallClass(size_t size) {
+            int cls = 0;
+            while ((size_t(1) << (MIN_SLAB_SHIFT + cls)) < size) ++cls;
+            return cls;
+        }
+
+        void* AllocSmall(Arena& arena, size_t size) {
+            int cls = SmallClass(size);
+            size_t slabSize = size_t(1) << (MIN_SLAB_SHIFT + cls);
+            std::vector<void*>& list = arena.freeSmall[cls];
+            if (!list.empty()) {
+                ++arena.stats.reused;
+            }
+            else {
+                // 新区域整块切给这一类；小slab的区域不归还系统
+                PageKind kind;
+                uint8_t* region = static_cast<uint8_t*>(MapRegion(HUGE_PAGE_SIZE, kind));
+                if (region == nullptr) return nullptr;
+                CountMapped(arena.stats, kind, HUGE_PAGE_SIZE, true);
+                for (size_t off = HUGE_PAGE_SIZE; off > 0; off -= slabSize) list.push_back(region + off - slabSize);
+            }
+            void* p = list.back();
+            list.pop_back();
+            arena.live[p] = Slab{ slabSize, PageKind::Small, false };
+            return p;
+        }
+
+        void* AllocLarge(Arena& arena, size_t size) {
+            size_t rounded = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            // 复用不超过所需1.25倍的空闲映射
+            auto it = arena.idleLarge.lower_bound(rounded);
+            if (it != arena.idleLarge.end() && it->first <= rounded + rounded / 4) {
+                Slab slab{ it->first, it->second.second, true };
+                void* p = it->second.first;
+                arena.idleBytes -= it->first;
+                arena.idleLarge.erase(it);
+                arena.live[p] = slab;
+                ++arena.stats.reused;
+                return p;
+            }
+            PageKind kind;
+            void* p = MapRegion(rounded, kind);
+            if (p == nullptr) return nullptr;
+            CountMapped(arena.stats, kind, rounded, true);
+            arena.live[p] = Slab{ rounded, kind, true };
+            return p;
+        }
+
+        void DropIdle(Arena& arena, size_t keep) {
+            while (arena.idleBytes > keep && !arena.idleLarge.empty()) {
+                auto it = std::prev(arena.idleLarge.end());  // 先释放最大的
+                UnmapRegion(it->second.first, it->first);
+                CountMapped(arena.stats, it->second.second, it->first, false);
+                arena.idleBytes -= it->first;
+                arena.idleLarge.erase(it);
+            }
+        }
+
+    } // namespace
+
+} // namespace gmsm
+
+extern "C" {
+
+    void* gmsm_buffer_alloc(size_t size) {
+        if (size == 0) return nullptr;
+        gmsm::Arena& arena = gmsm::GetArena();
+        std::lock_guard<std::mutex> lock(arena.mutex);
+        void* p = size <= gmsm::MAX_SMALL_SLAB ? gmsm::AllocSmall(arena, size) : gmsm::AllocLarge(arena, size);
+        if (p != nullptr) arena.stats.in_use_bytes += arena.live[p].size;
+        return p;
+    }
+
+    void gmsm_buffer_free(void* p) {
+        if (p == nullptr) return;
+        gmsm::Arena& arena = gmsm::GetArena();
+        std::lock_guard<std::mutex> lock(arena.mutex);
+        auto it = arena.live.find(p);
+        if (it == arena.live.end()) return;
+        gmsm::Slab slab = it->second;
+        arena.live.erase(it);
+        arena.stats.in_use_bytes -= slab.size;
+        if (!slab.dedicated) {
+            arena.freeSmall[gmsm::SmallClass(slab.size)].push_back(p);
+            return;
+        }
+        arena.idleLarge.emplace(slab.size, std::make_pair(p, slab.kind));
+        arena.idleBytes += slab.size;
+        gmsm::DropIdle(arena, gmsm::MAX_IDLE_BYTES);
+    }
+
+    void gmsm_buffer_trim(void) {
+        gmsm::Arena& arena = gmsm::GetArena();
+        std::lock_guard<std::mutex> lock(arena.mutex);
+        gmsm::DropIdle(arena, 0);
+    }
+
+    void gmsm_buffer_get_stats(gmsm_buffer_stats* stats) {
+        gmsm::Arena& arena = gmsm::GetArena();
+        std::lock_guard<std::mutex> lock(arena.mutex);
+        *stats = arena.stats;
+    }
+
+} // extern "C"
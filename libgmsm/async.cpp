@@ -0,0 +1,386 @@
+﻿#include "gmsm_internal.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace gmsm {
+
+    namespace {
+
+        constexpr size_t WORKER_BATCH = 64;  // 每个工作线程一次最多取出的任务数
+        constexpr int SPIN_ROUNDS = 64;      // 睡眠前让出CPU的次数
+
+        /**
+         * @brief 有界多生产者多消费者无锁环形队列（Vyukov）：每个槽带序号，生产者和消费者各用一个CAS推进位置
+         */
+        class JobRing {
+        public:
+            explicit JobRing(size_t capacity) : slots(capacity), mask(capacity - 1) {
+                for (size_t i = 0; i < capacity; ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+            }
+
+            bool Push(gmsm_job* job) {
+                size_t pos = tail.load(std::memory_order_relaxed);
+                for (;;) {
+                    Slot& slot = slots[pos & mask];
+                    size_t seq = slot.seq.load(std::memory_order_acquire);
+                    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                    if (diff == 0) {
+                        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            slot.job = job;
+                            slot.seq.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    }
+                    else if (diff < 0) {
+                        return false;
+                    }
+                    else {
+                        pos = tail.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            gmsm_job* Pop() {
+                size_t pos = head.load(std::memory_order_relaxed);
+                for (;;) {
+                    Slot& slot = slots[pos & mask];
+                    size_t seq = slot.seq.load(std::memory_order_acquire);
+                    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                    if (diff == 0) {
+                        if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            gmsm_job* job = slot.job;
+                            slot.seq.store(pos + mask + 1, std::memory_order_release);
+                            return job;
+                        }
+                    }
+                    else if (diff < 0) {
+                        return nullptr;
+                    }
+                    else {
+                        pos = head.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            /**
+             * @brief 在已预留容量的前提下入队：槽位可能还没被刚出队的消费者交还，稍等即可
+             */
+            void PushReserved(gmsm_job* job) {
+                while (!Push(job)) std::this_thread::yield();
+            }
+
+        private:
+            struct Slot {
+                std::atomic<size_t> seq;
+                gmsm_job* job;
+            };
+            std::vector<Slot> slots;
+            size_t mask;
+            alignas(64) std::atomic<size_t> tail{ 0 };
+            alignas(64) std::atomic<size_t> head{ 0 };
+        };
+
+        // status是C结构中的普通int，用编译器的原子操作读写
+        void StoreStatus(gmsm_job* job, int status) {
+#if defined(_MSC_VER)
+            _InterlockedExchange(reinterpret_cast<volatile long*>(&job->status), status);
+#else
+            __atomic_store_n(&job->status, status, __ATOMIC_SEQ_CST);
+#endif
+        }
+
+        int LoadStatus(const gmsm_job* job) {
+#if defined(_MSC_VER)
+            return _InterlockedCompareExchange(reinterpret_cast<volatile long*>(const_cast<int*>(&job->status)), 0, 0);
+#else
+            return __atomic_load_n(&job->status, __ATOMIC_SEQ_CST);
+#endif
+        }
+
+        size_t RoundUpPow2(size_t n) {
+            size_t p = 1;
+            while (p < n) p <<= 1;
+            return p;
+        }
+
+    } // namespace
+
+} // namespace gmsm
+
+struct gmsm_async_queue {
+    explicit gmsm_async_queue(size_t cap) : submitted(cap), completed(cap), capacity(cap) {}
+
+    gmsm::JobRing submitted;
+    gmsm::JobRing completed;
+    const size_t capacity;
+    std::atomic<size_t> inFlight{ 0 };  // 已提交、尚未交还调用方的任务数，不超过capacity
+    std::atomic<size_t> queued{ 0 };    // 提交队列中的任务数（先计数后入队）
+    std::atomic<int> sleepers{ 0 };
+    std::atomic<int> waiters{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable jobDone;
+    std::vector<std::thread> workers;
+    int eventFd = -1;
+};
+
+namespace gmsm {
+
+    namespace {
+
+        /**
+         * @brief 一批任务：SM3整批走多缓冲，流式SM3逐个累加，SM4-GCM按（操作, 密钥）分组走批量接口
+         */
+        void RunBatch(const std::vector<gmsm_job*>& batch, std::vector<int>& status) {
+            status.assign(batch.size(), GMSM_OK);
+
+            std::vector<const void*> hashData;
+            std::vector<size_t> hashLens;
+            std::vector<size_t> hashIndex;
+            std::vector<size_t> gcmIndex;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const gmsm_job* job = batch[i];
+                if (job->op == GMSM_JOB_HASH) {
+                    if (job->out == nullptr || (job->in == nullptr && job->len != 0)) {
+                        status[i] = GMSM_ERR_PARAM;
+                        continue;
+                    }
+                    hashData.push_back(job->in);
+                    hashLens.push_back(job->len);
+                    hashIndex.push_back(i);
+                }
+                else if (job->op == GMSM_JOB_SM3_UPDATE) {
+                    if (job->sm3 == nullptr || (job->in == nullptr && job->len != 0)) {
+                        status[i] = GMSM_ERR_PARAM;
+                        continue;
+                    }
+                    gmsm_sm3_update(job->sm3, job->in, job->len);
+                }
+                else if ((job->op == GMSM_JOB_SEAL || job->op == GMSM_JOB_OPEN) && job->key != nullptr) {
+                    gcmIndex.push_back(i);
+                }
+                else {
+                    status[i] = GMSM_ERR_PARAM;
+                }
+            }
+
+            if (!hashIndex.empty()) {
+                std::vector<uint8_t> digests(hashIndex.size() * GMSM_SM3_DIGEST_SIZE);
+                gmsm_sm3_batch(hashData.data(), hashLens.data(), hashIndex.size(), digests.data());
+                for (size_t k = 0; k < hashIndex.size(); ++k) {
+                    std::copy_n(&digests[k * GMSM_SM3_DIGEST_SIZE], GMSM_SM3_DIGEST_SIZE, batch[hashIndex[k]]->out);
+                }
+            }
+
+            std::stable_sort(gcmIndex.begin(), gcmIndex.end(), [&](size_t a, size_t b) {
+                const gmsm_job* x = batch[a];
+                const gmsm_job* y = batch[b];
+                return x->op != y->op ? x->op < y->op : std::less<const gmsm_gcm_key*>()(x->key, y->key);
+            });
+            std::vector<gmsm_gcm_batch_item> items;
+            for (size_t begin = 0; begin < gcmIndex.size();) {
+                const gmsm_job* first = batch[gcmIndex[begin]];
+                size_t end = begin;
+                items.clear();
+                while (end < gcmIndex.size() && batch[gcmIndex[end]]->op == first->op &&
+                    batch[gcmIndex[end]]->key == first->key) {
+                    const gmsm_job* job = batch[gcmIndex[end++]];
+                    items.push_back(gmsm_gcm_batch_item{ job->iv, job->iv_len, job->aad, job->aad_len,
+                        job->in, job->len, job->out, job->tag, job->tag_len, GMSM_OK });
+                }
+                if (first->op == GMSM_JOB_SEAL) {
+                    gmsm_gcm_encrypt_batch(first->key, items.data(), items.size());
+                }
+                else {
+                    gmsm_gcm_decrypt_batch(first->key, items.data(), items.size());
+                }
+                for (size_t k = 0; k < items.size(); ++k) status[gcmIndex[begin + k]] = items[k].status;
+                begin = end;
+            }
+        }
+
+        /**
+         * @brief 按各任务的通知方式交还；写入status之后不再访问任务（等待方可能随即释放它）
+         */
+        void Complete(gmsm_async_queue* q, const std::vector<gmsm_job*>& batch, const std::vector<int>& status) {
+            uint64_t reaped = 0;
+            bool waitable = false;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                gmsm_job* job = batch[i];
+                if (job->callback != nullptr) {
+                    gmsm_job_callback callback = job->callback;
+                    StoreStatus(job, status[i]);
+                    q->inFlight.fetch_sub(1);  // 先交还容量，回调中可以重新提交
+                    callback(job);
+                }
+                else if (job->flags & GMSM_JOB_REAP) {
+                    StoreStatus(job, status[i]);
+                    q->completed.PushReserved(job);
+                    ++reaped;
+                    waitable = true;  // 也可以先gmsm_async_wait再取回
+                }
+                else {
+                    StoreStatus(job, status[i]);
+                    q->inFlight.fetch_sub(1);
+                    waitable = true;
+                }
+            }
+#if defined(__linux__)
+            if (reaped > 0 && q->eventFd >= 0) {
+                ssize_t n = write(q->eventFd, &reaped, sizeof(reaped));
+                (void)n;  // 计数器溢出前读端总会清除，失败可以忽略
+            }
+#else
+            (void)reaped;
+#endif
+            if (waitable && q->waiters.load() > 0) {
+                { std::lock_guard<std::mutex> lock(q->mutex); }
+                q->jobDone.notify_all();
+            }
+        }
+
+        /**
+         * @brief 提交队列为空时先让出CPU几轮，再睡到有任务或队列停止；返回false表示应退出
+         */
+        bool WaitForWork(gmsm_async_queue* q) {
+            for (int i = 0; i < SPIN_ROUNDS; ++i) {
+                if (q->queued.load() > 0) return true;
+                std::this_thread::yield();
+            }
+            std::unique_lock<std::mutex> lock(q->mutex);
+            q->sleepers.fetch_add(1);
+            q->workAvailable.wait(lock, [q] { return q->queued.load() > 0 || q->stopping.load(); });
+            q->sleepers.fetch_sub(1);
+            return q->queued.load() > 0;
+        }
+
+        void WorkerLoop(gmsm_async_queue* q) {
+            std::vector<gmsm_job*> batch;
+            std::vector<int> status;
+            batch.reserve(WORKER_BATCH);
+            for (;;) {
+                batch.clear();
+                while (batch.size() < WORKER_BATCH) {
+                    gmsm_job* job = q->submitted.Pop();
+                    if (job == nullptr) break;
+                    batch.push_back(job);
+                }
+                if (batch.empty()) {
+                    if (!WaitForWork(q)) return;
+                    continue;
+                }
+                q->queued.fetch_sub(batch.size());
+                RunBatch(batch, status);
+                Complete(q, batch, status);
+            }
+        }
+
+    } // namespace
+
+} // namespace gmsm
+
+extern "C" {
+
+    gmsm_async_queue* gmsm_async_create(unsigned workers, size_t capacity) {
+        if (capacity == 0) return nullptr;
+        if (workers == 0) workers = std::max(1u, std::thread::hardware_concurrency());
+        gmsm_async_queue* q = new (std::nothrow) gmsm_async_queue(gmsm::RoundUpPow2(capacity));
+        if (q == nullptr) return nullptr;
+#if defined(__linux__)
+        q->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+        try {
+            for (unsigned i = 0; i < workers; ++i) q->workers.emplace_back(gmsm::WorkerLoop, q);
+        }
+        catch (...) {
+            gmsm_async_destroy(q);
+            return nullptr;
+        }
+        return q;
+    }
+
+    void gmsm_async_destroy(gmsm_async_queue* queue) {
+        if (queue == nullptr) return;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->stopping.store(true);
+        }
+        queue->workAvailable.notify_all();
+        for (std::thread& t : queue->workers) t.join();
+#if defined(__linux__)
+        if (queue->eventFd >= 0) close(queue->eventFd);
+#endif
+        delete queue;
+    }
+
+    size_t gmsm_async_submit(gmsm_async_queue* queue, gmsm_job* const* jobs, size_t count) {
+        size_t accepted = 0;
+        while (accepted < count && queue->inFlight.fetch_add(1) < queue->capacity) ++accepted;
+        if (accepted < count) queue->inFlight.fetch_sub(1);
+        if (accepted == 0) return 0;
+
+        queue->queued.fetch_add(accepted);
+        for (size_t i = 0; i < accepted; ++i) {
+            jobs[i]->status = GMSM_PENDING;  // 入队的release存储使工作线程看到这一写入
+            queue->submitted.PushReserved(jobs[i]);
+        }
+        if (queue->sleepers.load() > 0) {
+            { std::lock_guard<std::mutex> lock(queue->mutex); }
+            if (accepted == 1) {
+                queue->workAvailable.notify_one();
+            }
+            else {
+                queue->workAvailable.notify_all();
+            }
+        }
+        return accepted;
+    }
+
+    size_t gmsm_async_reap(gmsm_async_queue* queue, gmsm_job** jobs, size_t max) {
+        size_t n = 0;
+        while (n < max) {
+            gmsm_job* job = queue->completed.Pop();
+            if (job == nullptr) break;
+            jobs[n++] = job;
+        }
+        if (n > 0) queue->inFlight.fetch_sub(n);
+        return n;
+    }
+
+    int gmsm_async_event_fd(gmsm_async_queue* queue) {
+        return queue->eventFd;
+    }
+
+    int gmsm_async_done(const gmsm_job* job) {
+        return gmsm::LoadStatus(job) != GMSM_PENDING;
+    }
+
+    int gmsm_async_wait(gmsm_async_queue* queue, gmsm_job* job) {
+        for (int i = 0; i < gmsm::SPIN_ROUNDS; ++i) {
+            int status = gmsm::LoadStatus(job);
+            if (status != GMSM_PENDING) return status;
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        queue->waiters.fetch_add(1);
+        queue->jobDone.wait(lock, [job] { return gmsm::LoadStatus(job) != GMSM_PENDING; });
+        queue->waiters.fetch_sub(1);
+        return gmsm::LoadStatus(job);
+    }
+
+} // extern "C"
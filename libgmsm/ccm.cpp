@@ -0,0 +1,57 @@
+﻿#include "gmsm_internal.h"
+#include "sm4_engine.h"
+
+namespace gmsm {
+
+    namespace {
+
+        // nonce 7~13字节，标签4~16之间的偶数；长度字段占q = 15 - nonce_len字节
+        bool ValidParams(const uint8_t* nonce, size_t nonceLen, size_t len, size_t tagLen) {
+            if (nonce == nullptr || nonceLen < 7 || nonceLen > 13) return false;
+            if (tagLen < 4 || tagLen > 16 || tagLen % 2 != 0) return false;
+            const size_t q = 15 - nonceLen;
+            return q >= 8 || (static_cast<uint64_t>(len) >> (8 * q)) == 0;
+        }
+
+        void ValidateItems(gmsm_ccm_batch_item* items, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                gmsm_ccm_batch_item& item = items[i];
+                item.status = ValidParams(item.nonce, item.nonce_len, item.len, item.tag_len) ? GMSM_OK : GMSM_ERR_PARAM;
+            }
+        }
+
+    } // namespace
+
+} // namespace gmsm
+
+extern "C" {
+
+    int gmsm_ccm_encrypt(const gmsm_sm4_key* key, const uint8_t* nonce, size_t nonce_len,
+        const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+        uint8_t* tag, size_t tag_len) {
+        gmsm_ccm_batch_item item = { nonce, nonce_len, aad, aad_len, in, len, out, tag, tag_len, GMSM_OK };
+        gmsm_ccm_encrypt_batch(key, &item, 1);
+        return item.status;
+    }
+
+    int gmsm_ccm_decrypt(const gmsm_sm4_key* key, const uint8_t* nonce, size_t nonce_len,
+        const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+        const uint8_t* tag, size_t tag_len) {
+        // 解密时标签只读
+        gmsm_ccm_batch_item item = { nonce, nonce_len, aad, aad_len, in, len, out,
+            const_cast<uint8_t*>(tag), tag_len, GMSM_OK };
+        gmsm_ccm_decrypt_batch(key, &item, 1);
+        return item.status;
+    }
+
+    void gmsm_ccm_encrypt_batch(const gmsm_sm4_key* key, gmsm_ccm_batch_item* items, size_t count) {
+        gmsm::ValidateItems(items, count);
+        gmsm::WithSm4Engine([&](auto engine) { engine.CcmBatch(key->rk, items, count, false); });
+    }
+
+    void gmsm_ccm_decrypt_batch(const gmsm_sm4_key* key, gmsm_ccm_batch_item* items, size_t count) {
+        gmsm::ValidateItems(items, count);
+        gmsm::WithSm4Engine([&](auto engine) { engine.CcmBatch(key->rk, items, count, true); });
+    }
+
+} // extern "C"
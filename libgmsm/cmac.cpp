@@ -0,0 +1,70 @@
+﻿#include "gmsm_internal.h"
+#include "sm4_engine.h"
+
+namespace gmsm {
+
+    namespace {
+
+        // GF(2^128)中乘x，大端字节序，约简多项式 x^128 + x^7 + x^2 + x + 1
+        void DoubleBlock(const uint8_t in[16], uint8_t out[16]) {
+            const uint8_t carry = static_cast<uint8_t>(in[0] >> 7);
+            for (int i = 0; i < 15; ++i) {
+                out[i] = static_cast<uint8_t>((in[i] << 1) | (in[i + 1] >> 7));
+            }
+            out[15] = static_cast<uint8_t>((in[15] << 1) ^ (0x87 & (0 - carry)));
+        }
+
+        bool ValidCbcMacLength(size_t len) {
+            return len > 0 && len % GMSM_SM4_BLOCK_SIZE == 0;
+        }
+
+    } // namespace
+
+} // namespace gmsm
+
+extern "C" {
+
+    void gmsm_cmac_init(gmsm_cmac_key* key, const uint8_t user_key[GMSM_SM4_KEY_SIZE]) {
+        gmsm::Sm4ExpandKey(user_key, key->sm4.rk, false);
+        // L = E(0^128)，K1 = L·x，K2 = K1·x
+        uint8_t L[16] = { 0 };
+        gmsm::Sm4Blocks()(key->sm4.rk, L, L, 1);
+        gmsm::DoubleBlock(L, key->k1);
+        gmsm::DoubleBlock(key->k1, key->k2);
+    }
+
+    void gmsm_cmac(const gmsm_cmac_key* key, const void* data, size_t len, uint8_t mac[GMSM_CMAC_SIZE]) {
+        gmsm_cmac_batch(key, &data, &len, 1, mac);
+    }
+
+    int gmsm_cmac_verify(const gmsm_cmac_key* key, const void* data, size_t len,
+        const uint8_t* mac, size_t mac_len) {
+        if (mac_len == 0 || mac_len > GMSM_CMAC_SIZE) return GMSM_ERR_PARAM;
+        uint8_t full[GMSM_CMAC_SIZE];
+        gmsm_cmac(key, data, len, full);
+        return gmsm::ConstantTimeEqual(full, mac, mac_len) ? GMSM_OK : GMSM_ERR_AUTH;
+    }
+
+    void gmsm_cmac_batch(const gmsm_cmac_key* key, const void* const* data, const size_t* lens,
+        size_t count, uint8_t* macs) {
+        gmsm::WithSm4Engine([&](auto engine) {
+            engine.CmacBatch(key->sm4.rk, key->k1, key->k2, nullptr, data, lens, count, macs);
+        });
+    }
+
+    int gmsm_sm4_cbc_mac(const gmsm_sm4_key* key, const void* data, size_t len, uint8_t mac[GMSM_SM4_BLOCK_SIZE]) {
+        return gmsm_sm4_cbc_mac_batch(key, &data, &len, 1, mac);
+    }
+
+    int gmsm_sm4_cbc_mac_batch(const gmsm_sm4_key* key, const void* const* data, const size_t* lens,
+        size_t count, uint8_t* macs) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!gmsm::ValidCbcMacLength(lens[i])) return GMSM_ERR_PARAM;
+        }
+        gmsm::WithSm4Engine([&](auto engine) {
+            engine.CmacBatch(key->rk, nullptr, nullptr, nullptr, data, lens, count, macs);
+        });
+        return GMSM_OK;
+    }
+
+} // extern "C"
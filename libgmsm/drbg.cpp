@@ -0,0 +1,345 @@
+﻿#include "gmsm_internal.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
+#endif
+
+namespace gmsm {
+
+    namespace {
+
+        constexpr size_t SEED_LEN = 32;       // seedlen = keylen + blocklen
+        constexpr size_t OS_ENTROPY_LEN = 32;
+        constexpr size_t OS_NONCE_LEN = 16;
+        constexpr size_t MIN_ENTROPY_LEN = 16;  // 128位安全强度
+        constexpr uint64_t MAX_RESEED_INTERVAL = 1ull << 48;
+        // 每线程缓冲区：一次生成16 KB，短请求不必每次都走一遍CTR_DRBG_Update
+        constexpr size_t RANDOM_BUFFER = 16384;
+
+        void Wipe(void* p, size_t len) {
+            volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+            for (size_t i = 0; i < len; ++i) v[i] = 0;
+        }
+
+        /**
+         * @brief 从操作系统取len字节随机数
+         */
+        bool OsEntropy(uint8_t* out, size_t len) {
+#if defined(_WIN32)
+            return BCryptGenRandom(nullptr, out, static_cast<ULONG>(len), BCRYPT_USE_SYSTEM_PREFERRED_RNG) == 0;
+#else
+#if defined(__linux__)
+            while (len > 0) {
+                ssize_t n = getrandom(out, len, 0);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    break;  // 内核过旧（ENOSYS）时改读/dev/urandom
+                }
+                out += n;
+                len -= static_cast<size_t>(n);
+            }
+            if (len == 0) return true;
+#endif
+            int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            while (len > 0) {
+                ssize_t n = read(fd, out, len);
+                if (n <= 0) {
+                    if (n < 0 && errno == EINTR) continue;
+                    close(fd);
+                    return false;
+                }
+                out += n;
+                len -= static_cast<size_t>(n);
+            }
+            close(fd);
+            return true;
+#endif
+        }
+
+        void StoreBE32(uint8_t* p, uint32_t v) {
+            p[0] = static_cast<uint8_t>(v >> 24);
+            p[1] = static_cast<uint8_t>(v >> 16);
+            p[2] = static_cast<uint8_t>(v >> 8);
+            p[3] = static_cast<uint8_t>(v);
+        }
+
+        void Increment(uint8_t v[16]) {
+            for (int i = 15; i >= 0 && ++v[i] == 0; --i) {}
+        }
+
+        void Decrement(uint8_t v[16]) {
+            for (int i = 15; i >= 0 && v[i]-- == 0; --i) {}
+        }
+
+        /**
+         * @brief 一段输入（Block_Cipher_df的输入由至多三段拼接而成）
+         */
+        struct Part {
+            const uint8_t* data;
+            size_t len;
+        };
+
+        /**
+         * @brief Block_Cipher_df：把各段输入的拼接压缩为seedlen位（SP 800-90A 10.3.2，BCC即CBC-MAC）
+         */
+        void DeriveSeed(const Part* parts, size_t count, uint8_t seed[SEED_LEN]) {
+            size_t total = 0;
+            for (size_t i = 0; i < count; ++i) total += parts[i].len;
+
+            // 前16字节留给每轮的 i || 0^96，之后是 L || N || input || 0x80 || 0填充
+            size_t sLen = (8 + total + 1 + 15) / 16 * 16;
+            std::vector<uint8_t> block(16 + sLen, 0);
+            StoreBE32(&block[16], static_cast<uint32_t>(total));
+            StoreBE32(&block[20], static_cast<uint32_t>(SEED_LEN));
+            size_t pos = 24;
+            for (size_t i = 0; i < count; ++i) {
+                if (parts[i].len > 0) std::memcpy(&block[pos], parts[i].data, parts[i].len);
+                pos += parts[i].len;
+            }
+            block[pos] = 0x80;
+
+            uint8_t k[16];
+            for (int i = 0; i < 16; ++i) k[i] = static_cast<uint8_t>(i);
+            gmsm_sm4_key key;
+            gmsm_sm4_set_encrypt_key(&key, k);
+
+            uint8_t temp[SEED_LEN];
+            for (uint32_t i = 0; i < SEED_LEN / 16; ++i) {
+                StoreBE32(&block[0], i);
+                uint8_t chain[16] = {};
+                for (size_t off = 0; off < block.size(); off += 16) {
+                    for (int j = 0; j < 16; ++j) chain[j] ^= block[off + j];
+                    gmsm_sm4_crypt_block(&key, chain, chain);
+                }
+                std::memcpy(temp + 16 * i, chain, 16);
+            }
+
+            gmsm_sm4_set_encrypt_key(&key, temp);
+            uint8_t x[16];
+            std::memcpy(x, temp + 16, 16);
+            for (size_t i = 0; i < SEED_LEN / 16; ++i) {
+                gmsm_sm4_crypt_block(&key, x, x);
+                std::memcpy(seed + 16 * i, x, 16);
+            }
+            Wipe(block.data(), block.size());
+            Wipe(temp, sizeof(temp));
+            Wipe(x, sizeof(x));
+            Wipe(&key, sizeof(key));
+        }
+
+        /**
+         * @brief CTR_DRBG_Update：用 E(K, V+1) || E(K, V+2) xor provided 替换 K 和 V
+         */
+        void Update(gmsm_drbg* drbg, const uint8_t provided[SEED_LEN]) {
+            uint8_t temp[SEED_LEN];
+            for (size_t i = 0; i < SEED_LEN / 16; ++i) {
+                Increment(drbg->v);
+                gmsm_sm4_crypt_block(&drbg->key, drbg->v, temp + 16 * i);
+            }
+            for (size_t i = 0; i < SEED_LEN; ++i) temp[i] ^= provided[i];
+            gmsm_sm4_set_encrypt_key(&drbg->key, temp);
+            std::memcpy(drbg->v, temp + 16, 16);
+            Wipe(temp, sizeof(temp));
+        }
+
+        bool ValidLength(size_t len) {
+            return static_cast<uint64_t>(len) <= 0xFFFFFFFFu;
+        }
+
+        // ---------------- 每线程实例 ----------------
+
+        struct ThreadRandom {
+            gmsm_drbg drbg;
+            uint8_t buffer[RANDOM_BUFFER];
+            size_t available = 0;     // 缓冲区末尾尚未取用的字节数
+            uint64_t generation = 0;  // 播种时的forkGeneration，0表示尚未播种
+
+            ~ThreadRandom() { Wipe(this, sizeof(*this)); }
+        };
+
+        std::atomic<uint64_t> forkGeneration{ 1 };
+        std::atomic<uint64_t> threadReseedInterval{ GMSM_DRBG_RESEED_INTERVAL };
+        std::once_flag forkHandlerOnce;
+
+        ThreadRandom& GetThreadRandom() {
+            thread_local std::unique_ptr<ThreadRandom> instance(new ThreadRandom());
+            return *instance;
+        }
+
+        /**
+         * @brief 首次使用或fork后重新实例化；fork前缓冲的字节与父进程相同，全部丢弃
+         */
+        bool EnsureSeeded(ThreadRandom& t) {
+#if !defined(_WIN32)
+            std::call_once(forkHandlerOnce, [] {
+                pthread_atfork(nullptr, nullptr, [] { forkGeneration.fetch_add(1, std::memory_order_relaxed); });
+            });
+#endif
+            uint64_t generation = forkGeneration.load(std::memory_order_relaxed);
+            if (t.generation == generation) return true;
+            Wipe(t.buffer, sizeof(t.buffer));
+            t.available = 0;
+            if (gmsm_drbg_instantiate(&t.drbg, nullptr, 0, nullptr, 0, nullptr, 0) != GMSM_OK) return false;
+            t.generation = generation;
+            return true;
+        }
+
+        /**
+         * @brief 生成len（不超过GMSM_DRBG_MAX_REQUEST）字节，到达间隔时先从系统重新播种
+         */
+        bool ThreadGenerate(ThreadRandom& t, uint8_t* out, size_t len) {
+            t.drbg.reseed_interval = threadReseedInterval.load(std::memory_order_relaxed);
+            int status = gmsm_drbg_generate(&t.drbg, out, len, nullptr, 0);
+            if (status == GMSM_ERR_RESEED) {
+                if (gmsm_drbg_reseed(&t.drbg, nullptr, 0, nullptr, 0) != GMSM_OK) return false;
+                status = gmsm_drbg_generate(&t.drbg, out, len, nullptr, 0);
+            }
+            return status == GMSM_OK;
+        }
+
+    } // namespace
+
+} // namespace gmsm
+
+extern "C" {
+
+    int gmsm_drbg_instantiate(gmsm_drbg* drbg, const uint8_t* entropy, size_t entropy_len,
+        const uint8_t* nonce, size_t nonce_len, const uint8_t* personal, size_t personal_len) {
+        uint8_t osInput[gmsm::OS_ENTROPY_LEN + gmsm::OS_NONCE_LEN];
+        if (entropy == nullptr) {
+            if (!gmsm::OsEntropy(osInput, sizeof(osInput))) return GMSM_ERR_UNSUPPORTED;
+            entropy = osInput;
+            entropy_len = gmsm::OS_ENTROPY_LEN;
+            nonce = osInput + gmsm::OS_ENTROPY_LEN;
+            nonce_len = gmsm::OS_NONCE_LEN;
+        }
+        if (entropy_len < gmsm::MIN_ENTROPY_LEN || (nonce == nullptr && nonce_len != 0) ||
+            (personal == nullptr && personal_len != 0) ||
+            !gmsm::ValidLength(entropy_len + nonce_len + personal_len)) {
+            return GMSM_ERR_PARAM;
+        }
+
+        const gmsm::Part parts[3] = { { entropy, entropy_len }, { nonce, nonce_len }, { personal, personal_len } };
+        uint8_t seed[gmsm::SEED_LEN];
+        gmsm::DeriveSeed(parts, 3, seed);
+        gmsm::Wipe(osInput, sizeof(osInput));
+
+        const uint8_t zero[16] = {};
+        gmsm_sm4_set_encrypt_key(&drbg->key, zero);
+        std::memset(drbg->v, 0, sizeof(drbg->v));
+        gmsm::Update(drbg, seed);
+        gmsm::Wipe(seed, sizeof(seed));
+        drbg->reseed_counter = 1;
+        drbg->reseed_interval = GMSM_DRBG_RESEED_INTERVAL;
+        return GMSM_OK;
+    }
+
+    int gmsm_drbg_reseed(gmsm_drbg* drbg, const uint8_t* entropy, size_t entropy_len,
+        const uint8_t* additional, size_t additional_len) {
+        uint8_t osEntropy[gmsm::OS_ENTROPY_LEN];
+        if (entropy == nullptr) {
+            if (!gmsm::OsEntropy(osEntropy, sizeof(osEntropy))) return GMSM_ERR_UNSUPPORTED;
+            entropy = osEntropy;
+            entropy_len = sizeof(osEntropy);
+        }
+        if (entropy_len < gmsm::MIN_ENTROPY_LEN || (additional == nullptr && additional_len != 0) ||
+            !gmsm::ValidLength(entropy_len + additional_len)) {
+            return GMSM_ERR_PARAM;
+        }
+
+        const gmsm::Part parts[2] = { { entropy, entropy_len }, { additional, additional_len } };
+        uint8_t seed[gmsm::SEED_LEN];
+        gmsm::DeriveSeed(parts, 2, seed);
+        gmsm::Wipe(osEntropy, sizeof(osEntropy));
+        gmsm::Update(drbg, seed);
+        gmsm::Wipe(seed, sizeof(seed));
+        drbg->reseed_counter = 1;
+        return GMSM_OK;
+    }
+
+    int gmsm_drbg_generate(gmsm_drbg* drbg, uint8_t* out, size_t len,
+        const uint8_t* additional, size_t additional_len) {
+        if (len > GMSM_DRBG_MAX_REQUEST || (out == nullptr && len != 0) ||
+            (additional == nullptr && additional_len != 0) || !gmsm::ValidLength(additional_len)) {
+            return GMSM_ERR_PARAM;
+        }
+        uint64_t interval = std::min<uint64_t>(drbg->reseed_interval, gmsm::MAX_RESEED_INTERVAL);
+        if (drbg->reseed_counter > interval) return GMSM_ERR_RESEED;
+
+        uint8_t add[gmsm::SEED_LEN] = {};
+        if (additional_len > 0) {
+            const gmsm::Part part = { additional, additional_len };
+            gmsm::DeriveSeed(&part, 1, add);
+            gmsm::Update(drbg, add);
+        }
+        if (len > 0) {
+            // 输出为 E(K, V+1) || E(K, V+2) || ...，即以V+1为初始计数器的CTR密钥流
+            uint8_t counter[16];
+            std::memcpy(counter, drbg->v, 16);
+            gmsm::Increment(counter);
+            std::memset(out, 0, len);
+            gmsm_sm4_ctr(&drbg->key, counter, out, out, len);
+            gmsm::Decrement(counter);  // gmsm_sm4_ctr返回时指向下一个未用的计数器
+            std::memcpy(drbg->v, counter, 16);
+        }
+        gmsm::Update(drbg, add);
+        gmsm::Wipe(add, sizeof(add));
+        ++drbg->reseed_counter;
+        return GMSM_OK;
+    }
+
+    void gmsm_drbg_uninstantiate(gmsm_drbg* drbg) {
+        gmsm::Wipe(drbg, sizeof(*drbg));
+    }
+
+    int gmsm_random_bytes(void* out, size_t len) {
+        gmsm::ThreadRandom& t = gmsm::GetThreadRandom();
+        if (!gmsm::EnsureSeeded(t)) return GMSM_ERR_UNSUPPORTED;
+        uint8_t* p = static_cast<uint8_t*>(out);
+        while (len > 0) {
+            if (t.available == 0 && len >= gmsm::RANDOM_BUFFER) {
+                // 大请求直接生成到调用方缓冲区
+                size_t chunk = std::min<size_t>(len, GMSM_DRBG_MAX_REQUEST);
+                if (!gmsm::ThreadGenerate(t, p, chunk)) return GMSM_ERR_UNSUPPORTED;
+                p += chunk;
+                len -= chunk;
+                continue;
+            }
+            if (t.available == 0) {
+                if (!gmsm::ThreadGenerate(t, t.buffer, gmsm::RANDOM_BUFFER)) return GMSM_ERR_UNSUPPORTED;
+                t.available = gmsm::RANDOM_BUFFER;
+            }
+            size_t take = std::min(len, t.available);
+            uint8_t* src = t.buffer + gmsm::RANDOM_BUFFER - t.available;
+            std::memcpy(p, src, take);
+            gmsm::Wipe(src, take);  // 已交出的字节不留在缓冲区
+            t.available -= take;
+            p += take;
+            len -= take;
+        }
+        return GMSM_OK;
+    }
+
+    void gmsm_random_set_reseed_interval(uint64_t generates) {
+        if (generates == 0) generates = GMSM_DRBG_RESEED_INTERVAL;
+        gmsm::threadReseedInterval.store(std::min<uint64_t>(generates, gmsm::MAX_RESEED_INTERVAL));
+    }
+
+} // extern "C"
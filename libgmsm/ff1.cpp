@@ -0,0 +1,350 @@
+﻿#include "gmsm_internal.h"
+#include "sm4_engine.h"
+#include <cstring>
+#include <vector>
+
+namespace gmsm {
+
+    namespace {
+
+        constexpr int FF1_ROUNDS = 10;
+        // v = len - floor(len / 2) 的上限
+        constexpr size_t FF1_HALF = GMSM_FF1_MAX_LEN - GMSM_FF1_MAX_LEN / 2;
+        // NUM_radix(B) 不超过 FF1_HALF * 16 位，即 b 不超过 FF1_HALF * 2 字节；d = 4 * ceil(b / 4) + 4
+        constexpr size_t FF1_MAX_D = FF1_HALF * 2 + 4;
+        constexpr size_t FF1_LIMBS = FF1_MAX_D / 4;
+        // 一组同时推进的值的个数
+        constexpr size_t FF1_GROUP = 64;
+
+        /**
+         * @brief 一个值在Feistel网络中的状态：两半轮流作为A和B，half[a]为A
+         */
+        struct Ff1State {
+            gmsm_ff1_batch_item* item;
+            uint16_t half[2][FF1_HALF];
+            size_t len[2];
+            int a;
+            size_t b, d;      // 步骤3的b与d
+            size_t qLen;      // Q的字节数，tweak、补零、轮号与NUM(B)合起来为16的倍数
+            size_t qOffset;   // Q在本组缓冲区中的位置
+        };
+
+        // 多精度整数：小端32位字，定长FF1_LIMBS
+        using Limbs = uint32_t[FF1_LIMBS];
+
+        // x = x * mul + add
+        void MulAdd(uint32_t* x, size_t n, uint32_t mul, uint32_t add) {
+            uint64_t carry = add;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t t = static_cast<uint64_t>(x[i]) * mul + carry;
+                x[i] = static_cast<uint32_t>(t);
+                carry = t >> 32;
+            }
+        }
+
+        /**
+         * @brief floor(t / div)，t < 2^48：双精度倒数估商误差不超过1，修正一次即可，不用整数除法指令
+         */
+        inline uint64_t DivEstimate(uint64_t t, uint32_t div, double inverse) {
+            uint64_t q = static_cast<uint64_t>(static_cast<double>(t) * inverse);
+            if (q * div > t) --q;
+            else if (t - q * div >= div) ++q;
+            return q;
+        }
+
+        // x = x / div，返回余数；按16位一段做长除法，使每段的被除数小于2^48
+        uint32_t DivSmall(uint32_t* x, size_t n, uint32_t div, double inverse) {
+            uint64_t rem = 0;
+            for (size_t i = n; i-- > 0;) {
+                uint64_t t = (rem << 16) | (x[i] >> 16);
+                uint64_t hi = DivEstimate(t, div, inverse);
+                rem = t - hi * div;
+                t = (rem << 16) | (x[i] & 0xFFFF);
+                uint64_t lo = DivEstimate(t, div, inverse);
+                rem = t - lo * div;
+                x[i] = static_cast<uint32_t>((hi << 16) | lo);
+            }
+            return static_cast<uint32_t>(rem);
+        }
+
+        /**
+         * @brief NUM_radix(X)：按chunk_digits个数字一组做Horner，每组一次多精度乘加
+         */
+        void FromNumerals(const gmsm_ff1_key& key, const uint16_t* x, size_t m, uint32_t* limbs, size_t n) {
+            std::memset(limbs, 0, n * sizeof(uint32_t));
+            for (size_t j = 0; j < m; j += key.chunk_digits) {
+                const size_t cnt = m - j < key.chunk_digits ? m - j : key.chunk_digits;
+                uint32_t value = 0;
+                for (size_t i = 0; i < cnt; ++i) value = value * key.radix + x[j + i];
+                MulAdd(limbs, n, key.powers[cnt], value);
+            }
+        }
+
+        void ToBytes(const uint32_t* limbs, uint8_t* out, size_t bytes) {
+            for (size_t i = 0; i < bytes; ++i) {
+                out[bytes - 1 - i] = static_cast<uint8_t>(limbs[i / 4] >> (8 * (i % 4)));
+            }
+        }
+
+        void FromBytes(const uint8_t* in, size_t bytes, uint32_t* limbs, size_t n) {
+            std::memset(limbs, 0, n * sizeof(uint32_t));
+            for (size_t i = 0; i < bytes; ++i) {
+                limbs[i / 4] |= static_cast<uint32_t>(in[bytes - 1 - i]) << (8 * (i % 4));
+            }
+        }
+
+        /**
+         * @brief y mod radix^m 的m个数字（低位在前）：只需反复除以radix^chunk_digits取余，不做多精度取模
+         */
+        void LowDigits(const gmsm_ff1_key& key, uint32_t* limbs, size_t n, size_t m, uint16_t* digits) {
+            const uint32_t chunk = key.powers[key.chunk_digits];
+            const double chunkInverse = 1.0 / chunk;
+            for (size_t pos = 0; pos < m;) {
+                uint32_t r = DivSmall(limbs, n, chunk, chunkInverse);
+                for (uint32_t i = 0; i < key.chunk_digits && pos < m; ++i) {
+                    // r / radix：乘以预先算好的倒数（Granlund-Montgomery），只用一次乘法和移位
+                    uint32_t q = static_cast<uint32_t>(((static_cast<uint64_t>(r) * key.radix_magic >> 32) + r) >> key.radix_shift);
+                    digits[pos++] = static_cast<uint16_t>(r - q * key.radix);
+                    r = q;
+                }
+            }
+        }
+
+        /**
+         * @brief 对v = 1 ~ GMSM_FF1_MAX_LEN / 2填好步骤3的b：radix^v - 1 的位数恰为 ceil(v * log2(radix))
+         */
+        void FillNumeralBytes(gmsm_ff1_key& key) {
+            Limbs power = { 1 };
+            for (size_t v = 1; v <= FF1_HALF; ++v) {
+                MulAdd(power, FF1_LIMBS, key.radix, 0);
+                Limbs x;
+                std::memcpy(x, power, sizeof(x));
+                // 减1：radix^v不为0，借位不会越过最高字
+                for (size_t i = 0; x[i]-- == 0; ++i) {
+                }
+                size_t bits = 0;
+                for (size_t i = FF1_LIMBS; i-- > 0;) {
+                    if (x[i] != 0) {
+                        bits = 32 * i;
+                        for (uint32_t w = x[i]; w != 0; w >>= 1) ++bits;
+                        break;
+                    }
+                }
+                key.numeral_bytes[v] = static_cast<uint8_t>((bits + 7) / 8);
+            }
+        }
+
+        bool ValidItem(const gmsm_ff1_key& key, const gmsm_ff1_batch_item& item) {
+            if (item.in == nullptr || item.out == nullptr || item.len < key.min_len || item.len > GMSM_FF1_MAX_LEN) return false;
+            if (item.tweak == nullptr && item.tweak_len != 0) return false;
+            if (static_cast<uint64_t>(item.tweak_len) > 0xFFFFFFFFull) return false;
+            for (size_t i = 0; i < item.len; ++i) {
+                if (item.in[i] >= key.radix) return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief 一组值的完整FF1：先一次ECB把各自的P原地加密为CIPH(P)，之后每一轮
+         *        1) 拼出所有值的Q，以CIPH(P)为起始链值交错计算CBC-MAC得到R；
+         *        2) d > 16时R异或[1]、[2]...的扩展分组合成一次ECB；
+         *        3) 逐值把S的低位换算成m个数字，与A（解密时为B）按位相加（相减）
+         */
+        template<class Engine>
+        void Ff1Group(Engine engine, const gmsm_ff1_key& key, Ff1State* states, size_t count, bool decrypt,
+            std::vector<uint8_t>& qbuf, std::vector<uint8_t>& ext) {
+            uint8_t eps[16 * FF1_GROUP] = { 0 }, R[16 * FF1_GROUP];
+            const void* qptrs[FF1_GROUP];
+            size_t qlens[FF1_GROUP];
+
+            size_t qTotal = 0, extBlocks = 0;
+            for (size_t k = 0; k < count; ++k) {
+                Ff1State& st = states[k];
+                const gmsm_ff1_batch_item& item = *st.item;
+                const size_t n = item.len, u = n / 2, v = n - u;
+                std::memcpy(st.half[0], item.in, u * sizeof(uint16_t));
+                std::memcpy(st.half[1], item.in + u, v * sizeof(uint16_t));
+                st.len[0] = u;
+                st.len[1] = v;
+                st.a = 0;
+                st.b = key.numeral_bytes[v];
+                st.d = 4 * ((st.b + 3) / 4) + 4;
+                st.qLen = (item.tweak_len + st.b + 1 + 15) / 16 * 16;
+                st.qOffset = qTotal;
+                qTotal += st.qLen;
+                extBlocks += (st.d + 15) / 16 - 1;
+
+                // P = [1]^1 || [2]^1 || [1]^1 || [radix]^3 || [10]^1 || [u mod 256]^1 || [n]^4 || [t]^4
+                uint8_t* p = eps + 16 * k;
+                p[0] = 1;
+                p[1] = 2;
+                p[2] = 1;
+                p[3] = static_cast<uint8_t>(key.radix >> 16);
+                p[4] = static_cast<uint8_t>(key.radix >> 8);
+                p[5] = static_cast<uint8_t>(key.radix);
+                p[6] = FF1_ROUNDS;
+                p[7] = static_cast<uint8_t>(u);
+                StoreBE32(p + 8, static_cast<uint32_t>(n));
+                StoreBE32(p + 12, static_cast<uint32_t>(item.tweak_len));
+            }
+            engine.Ecb(key.sm4.rk, eps, eps, count);
+            qbuf.assign(qTotal, 0);
+            ext.resize(16 * extBlocks);
+            for (size_t k = 0; k < count; ++k) {
+                // Q = T || [0]^((-t-b-1) mod 16) || [i]^1 || [NUM_radix(B)]^b，T与补零每轮不变
+                const gmsm_ff1_batch_item& item = *states[k].item;
+                if (item.tweak_len > 0) std::memcpy(&qbuf[states[k].qOffset], item.tweak, item.tweak_len);
+                qptrs[k] = &qbuf[states[k].qOffset];
+                qlens[k] = states[k].qLen;
+            }
+
+            for (int round = 0; round < FF1_ROUNDS; ++round) {
+                const int i = decrypt ? FF1_ROUNDS - 1 - round : round;
+                for (size_t k = 0; k < count; ++k) {
+                    Ff1State& st = states[k];
+                    // 加密时由B算轮函数，解密时由A算
+                    const int src = decrypt ? st.a : 1 - st.a;
+                    uint8_t* q = &qbuf[st.qOffset + st.qLen - st.b - 1];
+                    q[0] = static_cast<uint8_t>(i);
+                    Limbs x;
+                    FromNumerals(key, st.half[src], st.len[src], x, (st.b + 3) / 4);
+                    ToBytes(x, q + 1, st.b);
+                }
+                engine.CmacBatch(key.sm4.rk, nullptr, nullptr, eps, qptrs, qlens, count, R);
+
+                uint8_t* e = ext.data();
+                for (size_t k = 0; k < count; ++k) {
+                    for (size_t j = 1; j < (states[k].d + 15) / 16; ++j, e += 16) {
+                        std::memcpy(e, R + 16 * k, 16);
+                        e[12] ^= static_cast<uint8_t>(j >> 24);
+                        e[13] ^= static_cast<uint8_t>(j >> 16);
+                        e[14] ^= static_cast<uint8_t>(j >> 8);
+                        e[15] ^= static_cast<uint8_t>(j);
+                    }
+                }
+                if (extBlocks > 0) engine.Ecb(key.sm4.rk, ext.data(), ext.data(), extBlocks);
+
+                e = ext.data();
+                for (size_t k = 0; k < count; ++k) {
+                    Ff1State& st = states[k];
+                    uint8_t S[FF1_MAX_D + 16];
+                    const size_t more = (st.d + 15) / 16 - 1;
+                    std::memcpy(S, R + 16 * k, 16);
+                    if (more > 0) {
+                        std::memcpy(S + 16, e, 16 * more);
+                        e += 16 * more;
+                    }
+
+                    // 加密：C = A + y，写回A；解密：C = B - y，写回B。m为被改写一半的长度
+                    const int dst = decrypt ? 1 - st.a : st.a;
+                    const size_t m = st.len[dst];
+                    Limbs y;
+                    uint16_t yd[FF1_HALF];
+                    FromBytes(S, st.d, y, st.d / 4);
+                    LowDigits(key, y, (st.d + 3) / 4, m, yd);
+                    uint16_t* c = st.half[dst];
+                    uint32_t carry = 0;
+                    for (size_t j = 0; j < m; ++j) {
+                        uint32_t digit = c[m - 1 - j];
+                        uint32_t sub = yd[j] + carry;
+                        if (decrypt) {
+                            carry = digit < sub;
+                            digit = digit + (carry ? key.radix : 0) - sub;
+                        }
+                        else {
+                            digit += sub;
+                            carry = digit >= key.radix;
+                            digit -= carry ? key.radix : 0;
+                        }
+                        c[m - 1 - j] = static_cast<uint16_t>(digit);
+                    }
+                    st.a = 1 - st.a;
+                }
+            }
+
+            for (size_t k = 0; k < count; ++k) {
+                Ff1State& st = states[k];
+                std::memcpy(st.item->out, st.half[st.a], st.len[st.a] * sizeof(uint16_t));
+                std::memcpy(st.item->out + st.len[st.a], st.half[1 - st.a], st.len[1 - st.a] * sizeof(uint16_t));
+            }
+        }
+
+        void Ff1Batch(const gmsm_ff1_key& key, gmsm_ff1_batch_item* items, size_t count, bool decrypt) {
+            Ff1State states[FF1_GROUP];
+            std::vector<uint8_t> qbuf, ext;
+            WithSm4Engine([&](auto engine) {
+                size_t n = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    gmsm_ff1_batch_item& item = items[i];
+                    item.status = ValidItem(key, item) ? GMSM_OK : GMSM_ERR_PARAM;
+                    if (item.status != GMSM_OK) continue;
+                    states[n++].item = &item;
+                    if (n == FF1_GROUP) {
+                        Ff1Group(engine, key, states, n, decrypt, qbuf, ext);
+                        n = 0;
+                    }
+                }
+                if (n > 0) Ff1Group(engine, key, states, n, decrypt, qbuf, ext);
+            });
+        }
+
+        int Ff1One(const gmsm_ff1_key* key, const uint8_t* tweak, size_t tweak_len,
+            const uint16_t* in, uint16_t* out, size_t len, bool decrypt) {
+            gmsm_ff1_batch_item item = { tweak, tweak_len, in, out, len, GMSM_OK };
+            Ff1Batch(*key, &item, 1, decrypt);
+            return item.status;
+        }
+
+    } // namespace
+
+} // namespace gmsm
+
+extern "C" {
+
+    int gmsm_ff1_init(gmsm_ff1_key* key, const uint8_t user_key[GMSM_SM4_KEY_SIZE], uint32_t radix) {
+        if (radix < 2 || radix > 65536) return GMSM_ERR_PARAM;
+        gmsm::Sm4ExpandKey(user_key, key->sm4.rk, false);
+        key->radix = radix;
+        key->powers[0] = 1;
+        uint32_t k = 0;
+        while (static_cast<uint64_t>(key->powers[k]) * radix < (1ull << 32)) {
+            key->powers[k + 1] = key->powers[k] * radix;
+            ++k;
+        }
+        key->chunk_digits = k;
+        // 2^shift >= radix，magic = floor(2^(32 + shift) / radix) + 1 - 2^32
+        uint32_t shift = 0;
+        while ((1u << shift) < radix) ++shift;
+        key->radix_shift = shift;
+        key->radix_magic = static_cast<uint32_t>((1ull << (32 + shift)) / radix + 1 - (1ull << 32));
+        uint64_t domain = 1;
+        uint32_t minLen = 0;
+        while (domain < 1000000) {
+            domain *= radix;
+            ++minLen;
+        }
+        key->min_len = minLen < 2 ? 2 : minLen;
+        key->numeral_bytes[0] = 0;
+        gmsm::FillNumeralBytes(*key);
+        return GMSM_OK;
+    }
+
+    int gmsm_ff1_encrypt(const gmsm_ff1_key* key, const uint8_t* tweak, size_t tweak_len,
+        const uint16_t* in, uint16_t* out, size_t len) {
+        return gmsm::Ff1One(key, tweak, tweak_len, in, out, len, false);
+    }
+
+    int gmsm_ff1_decrypt(const gmsm_ff1_key* key, const uint8_t* tweak, size_t tweak_len,
+        const uint16_t* in, uint16_t* out, size_t len) {
+        return gmsm::Ff1One(key, tweak, tweak_len, in, out, len, true);
+    }
+
+    void gmsm_ff1_encrypt_batch(const gmsm_ff1_key* key, gmsm_ff1_batch_item* items, size_t count) {
+        gmsm::Ff1Batch(*key, items, count, false);
+    }
+
+    void gmsm_ff1_decrypt_batch(const gmsm_ff1_key* key, gmsm_ff1_batch_item* items, size_t count) {
+        gmsm::Ff1Batch(*key, items, count, true);
+    }
+
+} // extern "C"
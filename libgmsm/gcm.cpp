@@ -0,0 +1,71 @@
+﻿#include "gmsm_internal.h"
+#include "sm4_engine.h"
+#include <cstring>
+
+namespace gmsm {
+
+    namespace {
+
+        // NIST SP 800-38D：单条消息最多 2^32 - 2 个分组
+        constexpr uint64_t GCM_MAX_LENGTH = (1ULL << 36) - 32;
+
+        bool ValidParams(const uint8_t* iv, size_t ivLen, size_t len, size_t tagLen) {
+            return iv != nullptr && ivLen > 0 && tagLen >= 4 && tagLen <= GMSM_GCM_TAG_SIZE &&
+                static_cast<uint64_t>(len) <= GCM_MAX_LENGTH;
+        }
+
+    } // namespace
+
+} // namespace gmsm
+
+extern "C" {
+
+    void gmsm_gcm_init(gmsm_gcm_key* key, const uint8_t user_key[GMSM_SM4_KEY_SIZE]) {
+        gmsm::Sm4ExpandKey(user_key, key->sm4.rk, false);
+        // 哈希子密钥 H = E(0^128)
+        uint8_t H[16] = { 0 };
+        gmsm::Sm4Blocks()(key->sm4.rk, H, H, 1);
+        gmsm::GhashInit(key->ghash, H);
+    }
+
+    int gmsm_gcm_encrypt(const gmsm_gcm_key* key, const uint8_t* iv, size_t iv_len,
+        const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+        uint8_t* tag, size_t tag_len) {
+        if (!gmsm::ValidParams(iv, iv_len, len, tag_len)) return GMSM_ERR_PARAM;
+
+        uint8_t full[16];
+        gmsm::WithSm4Engine([&](auto engine) {
+            engine.GcmEncrypt(*key, iv, iv_len, aad, aad_len, in, len, out, full);
+        });
+        std::memcpy(tag, full, tag_len);
+        return GMSM_OK;
+    }
+
+    int gmsm_gcm_decrypt(const gmsm_gcm_key* key, const uint8_t* iv, size_t iv_len,
+        const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+        const uint8_t* tag, size_t tag_len) {
+        if (!gmsm::ValidParams(iv, iv_len, len, tag_len)) return GMSM_ERR_PARAM;
+
+        bool ok = gmsm::WithSm4Engine([&](auto engine) {
+            return engine.GcmDecrypt(*key, iv, iv_len, aad, aad_len, in, len, out, tag, tag_len);
+        });
+        return ok ? GMSM_OK : GMSM_ERR_AUTH;
+    }
+
+    void gmsm_gcm_encrypt_batch(const gmsm_gcm_key* key, gmsm_gcm_batch_item* items, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            gmsm_gcm_batch_item& item = items[i];
+            item.status = gmsm::ValidParams(item.iv, item.iv_len, item.len, item.tag_len) ? GMSM_OK : GMSM_ERR_PARAM;
+        }
+        gmsm::WithSm4Engine([&](auto engine) { engine.GcmBatch(*key, items, count, false); });
+    }
+
+    void gmsm_gcm_decrypt_batch(const gmsm_gcm_key* key, gmsm_gcm_batch_item* items, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            gmsm_gcm_batch_item& item = items[i];
+            item.status = gmsm::ValidParams(item.iv, item.iv_len, item.len, item.tag_len) ? GMSM_OK : GMSM_ERR_PARAM;
+        }
+        gmsm::WithSm4Engine([&](auto engine) { engine.GcmBatch(*key, items, count, true); });
+    }
+
+} // extern "C"
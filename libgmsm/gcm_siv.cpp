@@ -0,0 +1,44 @@
+﻿#include "gmsm_internal.h"
+#include "sm4_engine.h"
+
+namespace gmsm {
+
+    namespace {
+
+        // RFC 8452：明文与AAD均不超过2^36字节
+        constexpr uint64_t GCM_SIV_MAX_LENGTH = 1ULL << 36;
+
+        bool ValidParams(const uint8_t* nonce, size_t aadLen, size_t len) {
+            return nonce != nullptr && static_cast<uint64_t>(aadLen) <= GCM_SIV_MAX_LENGTH &&
+                static_cast<uint64_t>(len) <= GCM_SIV_MAX_LENGTH;
+        }
+
+    } // namespace
+
+} // namespace gmsm
+
+extern "C" {
+
+    int gmsm_gcm_siv_encrypt(const gmsm_sm4_key* key, const uint8_t nonce[GMSM_GCM_SIV_NONCE_SIZE],
+        const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+        uint8_t tag[GMSM_GCM_SIV_TAG_SIZE]) {
+        if (!gmsm::ValidParams(nonce, aad_len, len)) return GMSM_ERR_PARAM;
+
+        gmsm::WithSm4Engine([&](auto engine) {
+            engine.GcmSivEncrypt(key->rk, nonce, aad, aad_len, in, len, out, tag);
+        });
+        return GMSM_OK;
+    }
+
+    int gmsm_gcm_siv_decrypt(const gmsm_sm4_key* key, const uint8_t nonce[GMSM_GCM_SIV_NONCE_SIZE],
+        const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+        const uint8_t tag[GMSM_GCM_SIV_TAG_SIZE]) {
+        if (!gmsm::ValidParams(nonce, aad_len, len)) return GMSM_ERR_PARAM;
+
+        bool ok = gmsm::WithSm4Engine([&](auto engine) {
+            return engine.GcmSivDecrypt(key->rk, nonce, aad, aad_len, in, len, out, tag);
+        });
+        return ok ? GMSM_OK : GMSM_ERR_AUTH;
+    }
+
+} // extern "C"
@@ -0,0 +1,297 @@
+﻿#include "gmsm_internal.h"
+#include <cstring>
+
+#if defined(GMSM_X86)
+#include <immintrin.h>
+#endif
+
+namespace gmsm {
+
+    namespace {
+
+        // table布局：[0,16) 为HL，[16,32) 为HH（4位Shoup查表），[32,40) 为字节反序的 H、H^2、H^3、H^4
+        constexpr size_t TABLE_HL = 0;
+        constexpr size_t TABLE_HH = 16;
+        constexpr size_t TABLE_POWERS = 32;
+
+        // 右移4位时移出部分的约简值（x^128 + x^7 + x^2 + x + 1）
+        const uint16_t LAST4[16] = {
+            0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+            0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+        };
+
+        /**
+         * @brief X = X·H（GF(2^128)，GCM比特序），逐半字节查表
+         */
+        void MulTable(const uint64_t table[GHASH_TABLE_WORDS], uint8_t X[16]) {
+            const uint64_t* HL = table + TABLE_HL;
+            const uint64_t* HH = table + TABLE_HH;
+
+            uint8_t lo = X[15] & 0x0F;
+            uint64_t zh = HH[lo], zl = HL[lo];
+            for (int i = 15; i >= 0; --i) {
+                lo = X[i] & 0x0F;
+                uint8_t hi = X[i] >> 4;
+                if (i != 15) {
+                    uint8_t rem = zl & 0x0F;
+                    zl = (zh << 60) | (zl >> 4);
+                    zh = (zh >> 4) ^ (static_cast<uint64_t>(LAST4[rem]) << 48);
+                    zh ^= HH[lo];
+                    zl ^= HL[lo];
+                }
+                uint8_t rem = zl & 0x0F;
+                zl = (zh << 60) | (zl >> 4);
+                zh = (zh >> 4) ^ (static_cast<uint64_t>(LAST4[rem]) << 48);
+                zh ^= HH[hi];
+                zl ^= HL[hi];
+            }
+            StoreBE64(X, zh);
+            StoreBE64(X + 8, zl);
+        }
+
+        void GhashBlocksTable(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data,
+            size_t blocks) {
+            for (size_t b = 0; b < blocks; ++b) {
+                for (int i = 0; i < 16; ++i) Y[i] ^= data[16 * b + i];
+                MulTable(table, Y);
+            }
+        }
+
+        // POLYVAL的查表路径：状态与输入分组都按字节反序后走GHASH
+        void PolyvalBlocksTable(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data,
+            size_t blocks) {
+            uint8_t y[16];
+            for (int i = 0; i < 16; ++i) y[i] = Y[15 - i];
+            for (size_t b = 0; b < blocks; ++b) {
+                for (int i = 0; i < 16; ++i) y[i] ^= data[16 * b + 15 - i];
+                MulTable(table, y);
+            }
+            for (int i = 0; i < 16; ++i) Y[i] = y[15 - i];
+        }
+
+#if defined(GMSM_X86)
+        /**
+         * @brief 无约简的128×128位无进位乘法（四次64位乘法），结果为 hi:lo
+         */
+        GMSM_TARGET("pclmul,ssse3") inline void ClmulWide(__m128i a, __m128i b, __m128i& lo, __m128i& hi) {
+            __m128i t0 = _mm_clmulepi64_si128(a, b, 0x00);
+            __m128i t1 = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+            __m128i t2 = _mm_clmulepi64_si128(a, b, 0x11);
+            lo = _mm_xor_si128(t0, _mm_slli_si128(t1, 8));
+            hi = _mm_xor_si128(t2, _mm_srli_si128(t1, 8));
+        }
+
+        /**
+         * @brief 比特反射表示下的约简：先整体左移1位，再按 x^128 + x^7 + x^2 + x + 1 折叠（Intel CLMUL白皮书算法5）
+         */
+        GMSM_TARGET("pclmul,ssse3") inline __m128i Reduce(__m128i lo, __m128i hi) {
+            __m128i c0 = _mm_srli_epi32(lo, 31);
+            __m128i c1 = _mm_srli_epi32(hi, 31);
+            lo = _mm_slli_epi32(lo, 1);
+            hi = _mm_slli_epi32(hi, 1);
+            __m128i carry = _mm_srli_si128(c0, 12);
+            c1 = _mm_slli_si128(c1, 4);
+            c0 = _mm_slli_si128(c0, 4);
+            lo = _mm_or_si128(lo, c0);
+            hi = _mm_or_si128(_mm_or_si128(hi, c1), carry);
+
+            __m128i a = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)),
+                _mm_slli_epi32(lo, 25));
+            __m128i b = _mm_srli_si128(a, 4);
+            lo = _mm_xor_si128(lo, _mm_slli_si128(a, 12));
+            __m128i d = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)),
+                _mm_srli_epi32(lo, 7));
+            d = _mm_xor_si128(d, b);
+            lo = _mm_xor_si128(lo, d);
+            return _mm_xor_si128(hi, lo);
+        }
+
+        /**
+         * @brief 加载一个分组到CLMUL的内部表示：GHASH按字节反序，POLYVAL的字节序本身就是这一表示
+         */
+        template<bool Polyval>
+        GMSM_TARGET("pclmul,ssse3") inline __m128i LoadBlock(const void* p) {
+            const __m128i v = _mm_loadu_si128(static_cast<const __m128i*>(p));
+            if (Polyval) return v;
+            return _mm_shuffle_epi8(v, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+        }
+
+        template<bool Polyval>
+        GMSM_TARGET("pclmul,ssse3") inline void StoreBlock(void* p, __m128i v) {
+            if (!Polyval) v = _mm_shuffle_epi8(v, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+            _mm_storeu_si128(static_cast<__m128i*>(p), v);
+        }
+
+        template<bool Polyval>
+        GMSM_TARGET("pclmul,ssse3") void GhashBlocksClmul(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16],
+            const uint8_t* data, size_t blocks) {
+            const __m128i* powers = reinterpret_cast<const __m128i*>(table + TABLE_POWERS);
+            const __m128i H1 = _mm_loadu_si128(powers);
+            const __m128i H2 = _mm_loadu_si128(powers + 1);
+            const __m128i H3 = _mm_loadu_si128(powers + 2);
+            const __m128i H4 = _mm_loadu_si128(powers + 3);
+
+            __m128i y = LoadBlock<Polyval>(Y);
+            size_t b = 0;
+            // 每4个分组只约简一次：Y' = (Y^X1)·H^4 ^ X2·H^3 ^ X3·H^2 ^ X4·H
+            for (; b + 4 <= blocks; b += 4) {
+                const uint8_t* src = data + 16 * b;
+                __m128i x0 = _mm_xor_si128(y, LoadBlock<Polyval>(src));
+                __m128i x1 = LoadBlock<Polyval>(src + 16);
+                __m128i x2 = LoadBlock<Polyval>(src + 32);
+                __m128i x3 = LoadBlock<Polyval>(src + 48);
+
+                __m128i lo, hi, l, h;
+                ClmulWide(x0, H4, lo, hi);
+                ClmulWide(x1, H3, l, h);
+                lo = _mm_xor_si128(lo, l);
+                hi = _mm_xor_si128(hi, h);
+                ClmulWide(x2, H2, l, h);
+                lo = _mm_xor_si128(lo, l);
+                hi = _mm_xor_si128(hi, h);
+                ClmulWide(x3, H1, l, h);
+                lo = _mm_xor_si128(lo, l);
+                hi = _mm_xor_si128(hi, h);
+                y = Reduce(lo, hi);
+            }
+            for (; b < blocks; ++b) {
+                __m128i x = LoadBlock<Polyval>(data + 16 * b);
+                __m128i lo, hi;
+                ClmulWide(_mm_xor_si128(y, x), H1, lo, hi);
+                y = Reduce(lo, hi);
+            }
+            StoreBlock<Polyval>(Y, y);
+        }
+
+        /**
+         * @brief 只算CLMUL路径用的 H、H^2、H^3、H^4（不建4位表）。hx为CLMUL内部表示的H（见LoadBlock）
+         */
+        GMSM_TARGET("pclmul,ssse3") void ClmulPowers(uint64_t table[GHASH_TABLE_WORDS], const uint8_t hx[16]) {
+            __m128i* powers = reinterpret_cast<__m128i*>(table + TABLE_POWERS);
+            const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hx));
+            __m128i p = h;
+            _mm_storeu_si128(powers, p);
+            for (int k = 1; k < 4; ++k) {
+                __m128i lo, hi;
+                ClmulWide(p, h, lo, hi);
+                p = Reduce(lo, hi);
+                _mm_storeu_si128(powers + k, p);
+            }
+        }
+
+        bool UseClmul() {
+            const unsigned need = GMSM_CPU_PCLMUL | GMSM_CPU_SSSE3;
+            return (CpuFeatures() & need) == need;
+        }
+#endif
+
+    } // namespace
+
+    void GhashInit(uint64_t table[GHASH_TABLE_WORDS], const uint8_t H[16]) {
+        uint64_t* HL = table + TABLE_HL;
+        uint64_t* HH = table + TABLE_HH;
+
+        // HL/HH[i]为 i（4位，最高位对应x^0）与H的乘积：先求 H·x^k 再线性组合
+        uint64_t vh = LoadBE64(H), vl = LoadBE64(H + 8);
+        HL[8] = vl;
+        HH[8] = vh;
+        HL[0] = HH[0] = 0;
+        for (int i = 4; i > 0; i >>= 1) {
+            uint64_t t = (vl & 1) * 0xE1000000ULL;
+            vl = (vh << 63) | (vl >> 1);
+            vh = (vh >> 1) ^ (t << 32);
+            HL[i] = vl;
+            HH[i] = vh;
+        }
+        for (int i = 2; i <= 8; i *= 2) {
+            for (int j = 1; j < i; ++j) {
+                HH[i + j] = HH[i] ^ HH[j];
+                HL[i + j] = HL[i] ^ HL[j];
+            }
+        }
+
+        // H的1~4次幂，按字节反序存放供CLMUL路径直接加载
+        uint8_t power[16];
+        std::memcpy(power, H, 16);
+        for (int k = 0; k < 4; ++k) {
+            if (k > 0) MulTable(table, power);
+            uint8_t reversed[16];
+            for (int i = 0; i < 16; ++i) reversed[i] = power[15 - i];
+            std::memcpy(table + TABLE_POWERS + 2 * k, reversed, 16);
+        }
+    }
+
+    void GhashBlocks(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data, size_t blocks) {
+#if defined(GMSM_X86)
+        if (UseClmul()) {
+            GhashBlocksClmul<false>(table, Y, data, blocks);
+            return;
+        }
+#endif
+        GhashBlocksTable(table, Y, data, blocks);
+    }
+
+    void GhashUpdate(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data, size_t len) {
+        size_t blocks = len / 16;
+        GhashBlocks(table, Y, data, blocks);
+        size_t rest = len % 16;
+        if (rest > 0) {
+            uint8_t last[16] = { 0 };
+            std::memcpy(last, data + 16 * blocks, rest);
+            GhashBlocks(table, Y, last, 1);
+        }
+    }
+
+    void PolyvalInit(uint64_t table[GHASH_TABLE_WORDS], const uint8_t H[16]) {
+#if defined(GMSM_X86)
+        // GCM-SIV每条消息换一次H：有CLMUL时只算幂次。CLMUL内部表示是GCM字节序的反序，
+        // mulX_GHASH(ByteReverse(H))的内部表示即H按小端整数右移1位，移出1时最高字节异或0xE1
+        if (UseClmul()) {
+            uint64_t lo = 0, hi = 0;
+            for (int i = 7; i >= 0; --i) {
+                lo = (lo << 8) | H[i];
+                hi = (hi << 8) | H[8 + i];
+            }
+            const uint64_t carry = lo & 1;
+            lo = (lo >> 1) | (hi << 63);
+            hi = (hi >> 1) ^ (0xE100000000000000ULL & (0 - carry));
+            uint8_t hx[16];
+            for (int i = 0; i < 8; ++i) {
+                hx[i] = static_cast<uint8_t>(lo >> (8 * i));
+                hx[8 + i] = static_cast<uint8_t>(hi >> (8 * i));
+            }
+            ClmulPowers(table, hx);
+            return;
+        }
+#endif
+        // POLYVAL(H, X) = ByteReverse(GHASH(mulX_GHASH(ByteReverse(H)), ByteReverse(X)))（RFC 8452 附录A）
+        uint8_t h[16];
+        for (int i = 0; i < 16; ++i) h[i] = H[15 - i];
+        const uint8_t carry = h[15] & 1;
+        for (int i = 15; i > 0; --i) h[i] = static_cast<uint8_t>((h[i] >> 1) | (h[i - 1] << 7));
+        h[0] = static_cast<uint8_t>((h[0] >> 1) ^ (0xE1 & (0 - carry)));
+        GhashInit(table, h);
+    }
+
+    void PolyvalBlocks(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data, size_t blocks) {
+#if defined(GMSM_X86)
+        if (UseClmul()) {
+            GhashBlocksClmul<true>(table, Y, data, blocks);
+            return;
+        }
+#endif
+        PolyvalBlocksTable(table, Y, data, blocks);
+    }
+
+    void PolyvalUpdate(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data, size_t len) {
+        size_t blocks = len / 16;
+        PolyvalBlocks(table, Y, data, blocks);
+        size_t rest = len % 16;
+        if (rest > 0) {
+            uint8_t last[16] = { 0 };
+            std::memcpy(last, data + 16 * blocks, rest);
+            PolyvalBlocks(table, Y, last, 1);
+        }
+    }
+
+} // namespace gmsm
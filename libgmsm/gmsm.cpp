@@ -0,0 +1,114 @@
+﻿#include "gmsm_internal.h"
+#include <atomic>
+
+#if defined(GMSM_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace gmsm {
+
+    namespace {
+
+#if defined(GMSM_X86)
+        unsigned DetectCpu() {
+            unsigned features = 0;
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+            __cpuid(info, 1);
+            if ((info[2] >> 9) & 1) features |= GMSM_CPU_SSSE3;
+            if ((info[2] >> 1) & 1) features |= GMSM_CPU_PCLMUL;
+            bool ymm = ((info[2] >> 27) & 1) && (_xgetbv(0) & 6) == 6;
+            if (maxLeaf >= 7 && ymm) {
+                __cpuidex(info, 7, 0);
+                if ((info[1] >> 5) & 1) features |= GMSM_CPU_AVX2;
+            }
+#else
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("ssse3")) features |= GMSM_CPU_SSSE3;
+            if (__builtin_cpu_supports("pclmul")) features |= GMSM_CPU_PCLMUL;
+            if (__builtin_cpu_supports("avx2")) features |= GMSM_CPU_AVX2;
+#endif
+            return features;
+        }
+#else
+        unsigned DetectCpu() {
+            return 0;
+        }
+#endif
+
+        gmsm_sm4_impl AutoImpl() {
+            return (CpuFeatures() & GMSM_CPU_AVX2) ? GMSM_SM4_IMPL_AVX2 : GMSM_SM4_IMPL_TTABLE;
+        }
+
+        std::atomic<int> selectedImpl{ GMSM_SM4_IMPL_AUTO };
+
+    } // namespace
+
+    gmsm_sm4_impl CurrentSm4Impl() {
+        int impl = selectedImpl.load(std::memory_order_relaxed);
+        return impl == GMSM_SM4_IMPL_AUTO ? AutoImpl() : static_cast<gmsm_sm4_impl>(impl);
+    }
+
+    unsigned CpuFeatures() {
+        static const unsigned features = DetectCpu();
+        return features;
+    }
+
+    Sm4BlocksFn Sm4Blocks() {
+        switch (CurrentSm4Impl()) {
+        case GMSM_SM4_IMPL_REFERENCE:
+            return Sm4BlocksReference;
+#if defined(GMSM_X86)
+        case GMSM_SM4_IMPL_AVX2:
+            return Sm4BlocksAvx2;
+#endif
+        default:
+            return Sm4BlocksTTable;
+        }
+    }
+
+} // namespace gmsm
+
+extern "C" {
+
+    const char* gmsm_version(void) {
+        return "1.2";
+    }
+
+    unsigned gmsm_cpu_features(void) {
+        return gmsm::CpuFeatures();
+    }
+
+    int gmsm_sm4_set_impl(gmsm_sm4_impl impl) {
+        switch (impl) {
+        case GMSM_SM4_IMPL_AUTO:
+        case GMSM_SM4_IMPL_REFERENCE:
+        case GMSM_SM4_IMPL_TTABLE:
+            break;
+        case GMSM_SM4_IMPL_AVX2:
+#if defined(GMSM_X86)
+            if (gmsm::CpuFeatures() & GMSM_CPU_AVX2) break;
+#endif
+            return GMSM_ERR_UNSUPPORTED;
+        default:
+            return GMSM_ERR_PARAM;
+        }
+        gmsm::selectedImpl.store(impl, std::memory_order_relaxed);
+        return GMSM_OK;
+    }
+
+    const char* gmsm_sm4_impl_name(void) {
+        switch (gmsm::CurrentSm4Impl()) {
+        case GMSM_SM4_IMPL_REFERENCE:
+            return "reference";
+        case GMSM_SM4_IMPL_AVX2:
+            return "avx2";
+        default:
+            return "ttable";
+        }
+    }
+
+} // extern "C"
@@ -0,0 +1,530 @@
+﻿#ifndef GMSM_H
+#define GMSM_H
+
+/*
+ * libgmsm：SM3 / SM4 / SM4-GCM 的统一C接口
+ *
+ * 所有函数都是可重入的；上下文结构由调用方分配，其布局属于ABI的一部分，
+ * 但标注为“内部使用”的字段不应直接读写。CPU相关的实现（AVX2、PCLMULQDQ）在
+ * 首次调用时按运行时检测结果选择。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(GMSM_BUILD_DLL)
+#define GMSM_API __declspec(dllexport)
+#elif defined(GMSM_USE_DLL)
+#define GMSM_API __declspec(dllimport)
+#else
+#define GMSM_API
+#endif
+#else
+#define GMSM_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GMSM_VERSION_MAJOR 1
+#define GMSM_VERSION_MINOR 2
+
+/* 返回值 */
+#define GMSM_OK 0
+#define GMSM_ERR_PARAM (-1)        /* 参数不合法 */
+#define GMSM_ERR_AUTH (-2)         /* 认证标签不匹配 */
+#define GMSM_ERR_UNSUPPORTED (-3)  /* 当前CPU不支持所请求的实现 */
+#define GMSM_ERR_RESEED (-4)       /* DRBG已达到重新播种间隔，须先调用gmsm_drbg_reseed */
+
+/* gmsm_cpu_features() 的标志位 */
+#define GMSM_CPU_SSSE3 0x01u
+#define GMSM_CPU_PCLMUL 0x02u
+#define GMSM_CPU_AVX2 0x04u
+
+#define GMSM_SM3_BLOCK_SIZE 64
+#define GMSM_SM3_DIGEST_SIZE 32
+#define GMSM_SM4_BLOCK_SIZE 16
+#define GMSM_SM4_KEY_SIZE 16
+#define GMSM_GCM_IV_SIZE 12   /* 推荐的IV长度，其余长度按GHASH派生J0 */
+#define GMSM_GCM_TAG_SIZE 16
+
+/* 库版本字符串，如 "1.2" */
+GMSM_API const char* gmsm_version(void);
+
+/* 运行时检测到的CPU特性（GMSM_CPU_*的组合） */
+GMSM_API unsigned gmsm_cpu_features(void);
+
+/* ======================== 缓冲区 ======================== */
+
+/*
+ * 批量加解密与哈希用的缓冲区：至少64字节对齐（实际按4 KiB或2 MiB对齐），
+ * 来自2 MiB的区域，依次尝试显式大页（MAP_HUGETLB / MEM_LARGE_PAGES）、
+ * 2 MiB对齐并建议透明大页（MADV_HUGEPAGE）、普通页。
+ * 不超过1 MiB的请求按2的幂取整，从按大小分类的区域切出；更大的请求按2 MiB取整独占一个映射。
+ * 释放后留在空闲链表中供之后相同大小的请求复用（空闲的大块映射最多缓存256 MiB）。
+ * 释放时不清零，存放敏感数据的调用方应自行清除。线程安全
+ */
+GMSM_API void* gmsm_buffer_alloc(size_t size);  /* size为0或映射失败时返回NULL */
+GMSM_API void gmsm_buffer_free(void* p);        /* p必须来自gmsm_buffer_alloc，NULL时什么也不做 */
+GMSM_API void gmsm_buffer_trim(void);           /* 把空闲的大块映射归还系统 */
+
+typedef struct gmsm_buffer_stats {
+    uint64_t hugetlb_bytes;     /* 当前以显式大页映射的字节数 */
+    uint64_t thp_bytes;         /* 以透明大页建议映射的字节数 */
+    uint64_t small_page_bytes;  /* 普通页映射的字节数 */
+    uint64_t in_use_bytes;      /* 已分配未释放的字节数（按取整后的大小） */
+    uint64_t reused;            /* 从空闲链表复用的次数 */
+} gmsm_buffer_stats;
+
+GMSM_API void gmsm_buffer_get_stats(gmsm_buffer_stats* stats);
+
+/* ======================== SM3 ======================== */
+
+typedef struct gmsm_sm3_ctx {
+    uint32_t state[8];
+    uint64_t length;                      /* 已输入的字节数 */
+    uint8_t buffer[GMSM_SM3_BLOCK_SIZE];  /* 未满一个分组的输入 */
+    uint32_t used;
+} gmsm_sm3_ctx;
+
+GMSM_API void gmsm_sm3_init(gmsm_sm3_ctx* ctx);
+GMSM_API void gmsm_sm3_update(gmsm_sm3_ctx* ctx, const void* data, size_t len);
+GMSM_API void gmsm_sm3_final(gmsm_sm3_ctx* ctx, uint8_t digest[GMSM_SM3_DIGEST_SIZE]);
+
+/*
+ * 流式上下文的序列化，用于断点续算（进程退出后从检查点接着哈希）。固定GMSM_SM3_STATE_SIZE字节，
+ * 与平台字节序和结构体布局无关，多字节整数均为大端：
+ *   0   魔数 "SM3S"        4   版本号（1）        5   保留（3字节，0）
+ *   8   链接变量 8 x 32位   40  已输入字节数 64位   48  缓冲区字节数 32位   52  保留（4字节，0）
+ *   56  缓冲区 64字节（只有前 缓冲区字节数 个有效，其余为0）
+ *   120 前120字节SM3摘要的前8字节，检测截断或损坏的检查点
+ */
+#define GMSM_SM3_STATE_SIZE 128
+
+GMSM_API void gmsm_sm3_export(const gmsm_sm3_ctx* ctx, uint8_t out[GMSM_SM3_STATE_SIZE]);
+
+/* 恢复导出的上下文。魔数、版本或校验不符、字段自相矛盾时返回GMSM_ERR_PARAM且不修改ctx */
+GMSM_API int gmsm_sm3_import(gmsm_sm3_ctx* ctx, const uint8_t in[GMSM_SM3_STATE_SIZE]);
+
+/* 一次性计算SM3 */
+GMSM_API void gmsm_sm3(const void* data, size_t len, uint8_t digest[GMSM_SM3_DIGEST_SIZE]);
+
+/*
+ * 批量计算count条独立消息的SM3：第i条为data[i]的前lens[i]字节，摘要依次写入digests（count * 32字节）。
+ * 支持AVX2时8个通道同时压缩（多缓冲），某条消息算完后立即换入下一条，长度不同也能填满通道；
+ * 否则逐条计算
+ */
+GMSM_API void gmsm_sm3_batch(const void* const* data, const size_t* lens, size_t count, uint8_t* digests);
+
+/* 用 blocks 个完整的64字节分组更新压缩函数状态（不做填充，用于长度扩展等分析） */
+GMSM_API void gmsm_sm3_compress(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+/* ======================== SM4 ======================== */
+
+typedef enum gmsm_sm4_impl {
+    GMSM_SM4_IMPL_AUTO = 0,       /* 按CPU自动选择（默认） */
+    GMSM_SM4_IMPL_REFERENCE = 1,  /* 逐字节S盒 + 线性变换，对应标准文本 */
+    GMSM_SM4_IMPL_TTABLE = 2,     /* S盒与线性变换合并的4张T表 */
+    GMSM_SM4_IMPL_AVX2 = 3        /* T表 + AVX2 gather，8个分组并行 */
+} gmsm_sm4_impl;
+
+/* 选择全局SM4实现，CPU不支持时返回GMSM_ERR_UNSUPPORTED且不做修改 */
+GMSM_API int gmsm_sm4_set_impl(gmsm_sm4_impl impl);
+
+/* 当前实际使用的实现名称："reference" / "ttable" / "avx2" */
+GMSM_API const char* gmsm_sm4_impl_name(void);
+
+/* 扩展后的轮密钥；加密与解密只是轮密钥顺序不同 */
+typedef struct gmsm_sm4_key {
+    uint32_t rk[32];
+} gmsm_sm4_key;
+
+GMSM_API void gmsm_sm4_set_encrypt_key(gmsm_sm4_key* key, const uint8_t user_key[GMSM_SM4_KEY_SIZE]);
+GMSM_API void gmsm_sm4_set_decrypt_key(gmsm_sm4_key* key, const uint8_t user_key[GMSM_SM4_KEY_SIZE]);
+
+/* 按密钥方向加密或解密一个分组，in与out可以相同 */
+GMSM_API void gmsm_sm4_crypt_block(const gmsm_sm4_key* key, const uint8_t in[GMSM_SM4_BLOCK_SIZE],
+    uint8_t out[GMSM_SM4_BLOCK_SIZE]);
+
+/* ECB：连续处理 blocks 个分组，in与out可以相同 */
+GMSM_API void gmsm_sm4_ecb(const gmsm_sm4_key* key, const uint8_t* in, uint8_t* out, size_t blocks);
+
+/*
+ * CTR：out = in xor E(ctr) || E(ctr + 1) || ...，计数器按128位大端整数递增。
+ * key必须是加密密钥；返回时counter前进 ceil(len / 16) 个分组。in与out可以相同
+ */
+GMSM_API void gmsm_sm4_ctr(const gmsm_sm4_key* key, uint8_t counter[GMSM_SM4_BLOCK_SIZE],
+    const uint8_t* in, uint8_t* out, size_t len);
+
+/*
+ * 大缓冲区模式：gmsm_sm4_ecb、gmsm_sm4_ctr及对应的JIT接口单次处理不少于threshold字节、
+ * out按16字节对齐且CPU支持AVX2时，结果先写到L1中的临时缓冲区，再用非临时存储
+ * （_mm256_stream_si256）写出，不把输出带进缓存，避免挤掉T表等工作集；
+ * 同时以NTA提示提前prefetch_distance字节预取输入（0为不预取）。
+ * threshold为SIZE_MAX时关闭。默认关闭（threshold为SIZE_MAX），prefetch_distance为4 KB；
+ * 实测单线程下没有出现这一模式更快的数据量，需要时由调用方按自己的基准设置阈值。
+ * 全局设置，影响之后所有线程的调用
+ */
+GMSM_API void gmsm_sm4_set_streaming(size_t threshold, size_t prefetch_distance);
+
+/*
+ * CBC：处理 blocks 个分组，返回时iv为最后一个密文分组，可分段连续调用。
+ * 加密用加密密钥（逐分组串行），解密用解密密钥（多分组并行）。in与out可以相同
+ */
+GMSM_API void gmsm_sm4_cbc_encrypt(const gmsm_sm4_key* key, uint8_t iv[GMSM_SM4_BLOCK_SIZE],
+    const uint8_t* in, uint8_t* out, size_t blocks);
+GMSM_API void gmsm_sm4_cbc_decrypt(const gmsm_sm4_key* key, uint8_t iv[GMSM_SM4_BLOCK_SIZE],
+    const uint8_t* in, uint8_t* out, size_t blocks);
+
+/*
+ * XTS（IEEE P1619 的调整值乘法）：key1为数据密钥（加密时为加密密钥，解密时为解密密钥），
+ * key2为调整值密钥（始终为加密密钥），tweak通常为扇区号。len >= 16，
+ * 不是16的倍数时使用密文挪用。len过短返回GMSM_ERR_PARAM。in与out可以相同
+ */
+GMSM_API int gmsm_sm4_xts_encrypt(const gmsm_sm4_key* key1, const gmsm_sm4_key* key2,
+    const uint8_t tweak[GMSM_SM4_BLOCK_SIZE], const uint8_t* in, uint8_t* out, size_t len);
+GMSM_API int gmsm_sm4_xts_decrypt(const gmsm_sm4_key* key1, const gmsm_sm4_key* key2,
+    const uint8_t tweak[GMSM_SM4_BLOCK_SIZE], const uint8_t* in, uint8_t* out, size_t len);
+
+/*
+ * 密钥特化的JIT（x86-64 + AVX2）：为长期使用的密钥生成轮密钥为立即数、32轮完全展开的8路内核。
+ * 相同轮密钥共享缓存中的同一份代码（以轮密钥的SM3为键）；代码页写入时只读写，完成后改为只读执行。
+ * CPU不支持、系统禁止动态代码或以GMSM_NO_JIT编译时，句柄仍然可用，只是使用通用实现。
+ * 句柄可在多个线程间共享；不足8个的尾部分组走T表
+ */
+typedef struct gmsm_sm4_jit gmsm_sm4_jit;
+
+/* 取得key对应的内核（引用计数加一），内存不足时返回NULL */
+GMSM_API gmsm_sm4_jit* gmsm_sm4_jit_acquire(const gmsm_sm4_key* key);
+
+/* 引用计数减一；无人引用的内核留在缓存中，缓存超过16个时按最久未使用淘汰 */
+GMSM_API void gmsm_sm4_jit_release(gmsm_sm4_jit* jit);
+
+/* 清零并释放所有无人引用的内核（轮换密钥后调用） */
+GMSM_API void gmsm_sm4_jit_purge(void);
+
+/* 句柄是否使用生成的代码（0表示回退到通用实现） */
+GMSM_API int gmsm_sm4_jit_is_native(const gmsm_sm4_jit* jit);
+
+GMSM_API void gmsm_sm4_jit_ecb(const gmsm_sm4_jit* jit, const uint8_t* in, uint8_t* out, size_t blocks);
+GMSM_API void gmsm_sm4_jit_ctr(const gmsm_sm4_jit* jit, uint8_t counter[GMSM_SM4_BLOCK_SIZE],
+    const uint8_t* in, uint8_t* out, size_t len);
+
+/* ======================== SM4-GCM ======================== */
+
+typedef struct gmsm_gcm_key {
+    gmsm_sm4_key sm4;
+    uint64_t ghash[40];  /* 内部使用：GHASH查表与H的幂 */
+} gmsm_gcm_key;
+
+GMSM_API void gmsm_gcm_init(gmsm_gcm_key* key, const uint8_t user_key[GMSM_SM4_KEY_SIZE]);
+
+/*
+ * 加密并计算标签。iv_len >= 1，tag_len 在 4~16 之间；in与out可以相同
+ * 成功返回GMSM_OK
+ */
+GMSM_API int gmsm_gcm_encrypt(const gmsm_gcm_key* key, const uint8_t* iv, size_t iv_len,
+    const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+    uint8_t* tag, size_t tag_len);
+
+/*
+ * 先验证标签再解密。标签不匹配时返回GMSM_ERR_AUTH，out不被写入
+ */
+GMSM_API int gmsm_gcm_decrypt(const gmsm_gcm_key* key, const uint8_t* iv, size_t iv_len,
+    const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+    const uint8_t* tag, size_t tag_len);
+
+/* 批量接口中的一条消息，参数含义与gmsm_gcm_encrypt/decrypt相同 */
+typedef struct gmsm_gcm_batch_item {
+    const uint8_t* iv;
+    size_t iv_len;
+    const uint8_t* aad;
+    size_t aad_len;
+    const uint8_t* in;
+    size_t len;
+    uint8_t* out;
+    uint8_t* tag;       /* 加密时写入，解密时只读 */
+    size_t tag_len;
+    int status;         /* 返回：GMSM_OK、GMSM_ERR_PARAM或GMSM_ERR_AUTH（out不被写入） */
+} gmsm_gcm_batch_item;
+
+/*
+ * 同一密钥下批量加密/解密count条消息。各条消息的计数器分组拼在一起交给SM4的并行实现，
+ * 几十字节的短消息也能填满8路/16路通道；结果与逐条调用相同，每条的结果写在其status中
+ */
+GMSM_API void gmsm_gcm_encrypt_batch(const gmsm_gcm_key* key, gmsm_gcm_batch_item* items, size_t count);
+GMSM_API void gmsm_gcm_decrypt_batch(const gmsm_gcm_key* key, gmsm_gcm_batch_item* items, size_t count);
+
+/* ======================== SM4-GCM-SIV ======================== */
+
+#define GMSM_GCM_SIV_NONCE_SIZE 12
+#define GMSM_GCM_SIV_TAG_SIZE 16
+
+/*
+ * GCM-SIV（RFC 8452 的结构，分组密码换成SM4）：抗nonce重用的确定性AEAD，key为SM4加密密钥。
+ * 相同的(nonce, aad, 明文)总得到相同的密文和标签，nonce重复时只暴露两条消息是否相同，
+ * 适合去重存储。每条消息由nonce派生认证密钥与加密密钥，POLYVAL与GHASH共用同一个CLMUL内核。
+ * len、aad_len不超过2^36字节，否则返回GMSM_ERR_PARAM。in与out可以相同
+ */
+GMSM_API int gmsm_gcm_siv_encrypt(const gmsm_sm4_key* key, const uint8_t nonce[GMSM_GCM_SIV_NONCE_SIZE],
+    const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+    uint8_t tag[GMSM_GCM_SIV_TAG_SIZE]);
+
+/* 先解密再按明文验证标签，不匹配时返回GMSM_ERR_AUTH并把out清零 */
+GMSM_API int gmsm_gcm_siv_decrypt(const gmsm_sm4_key* key, const uint8_t nonce[GMSM_GCM_SIV_NONCE_SIZE],
+    const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+    const uint8_t tag[GMSM_GCM_SIV_TAG_SIZE]);
+
+/* ======================== SM4-CCM ======================== */
+
+/*
+ * CCM（NIST SP 800-38C / RFC 3610），密钥为SM4加密密钥。nonce_len 在 7~13 之间，
+ * tag_len 为 4~16 之间的偶数，len须小于 2^(8*(15-nonce_len))，否则返回GMSM_ERR_PARAM。
+ * CBC-MAC分组与CTR的计数器分组合在同一次SM4调用中计算。in与out可以相同
+ */
+GMSM_API int gmsm_ccm_encrypt(const gmsm_sm4_key* key, const uint8_t* nonce, size_t nonce_len,
+    const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+    uint8_t* tag, size_t tag_len);
+
+/*
+ * 解密并验证标签。CCM的MAC按明文计算，明文会先写入out；标签不匹配时返回GMSM_ERR_AUTH，
+ * 并把out的len字节清零
+ */
+GMSM_API int gmsm_ccm_decrypt(const gmsm_sm4_key* key, const uint8_t* nonce, size_t nonce_len,
+    const uint8_t* aad, size_t aad_len, const uint8_t* in, size_t len, uint8_t* out,
+    const uint8_t* tag, size_t tag_len);
+
+/* 批量接口中的一条消息，参数含义与gmsm_ccm_encrypt/decrypt相同 */
+typedef struct gmsm_ccm_batch_item {
+    const uint8_t* nonce;
+    size_t nonce_len;
+    const uint8_t* aad;
+    size_t aad_len;
+    const uint8_t* in;
+    size_t len;
+    uint8_t* out;
+    uint8_t* tag;       /* 加密时写入，解密时只读 */
+    size_t tag_len;
+    int status;         /* 返回：GMSM_OK、GMSM_ERR_PARAM（out不被写入）或GMSM_ERR_AUTH（out被清零） */
+} gmsm_ccm_batch_item;
+
+/*
+ * 同一密钥下批量加密/解密count条消息。最多8条消息（AVX2）的CBC-MAC链与计数器分组交错，
+ * 每步拼成一次16路并行的SM4调用；结果与逐条调用相同，每条的结果写在其status中
+ */
+GMSM_API void gmsm_ccm_encrypt_batch(const gmsm_sm4_key* key, gmsm_ccm_batch_item* items, size_t count);
+GMSM_API void gmsm_ccm_decrypt_batch(const gmsm_sm4_key* key, gmsm_ccm_batch_item* items, size_t count);
+
+/* ======================== SM4-CMAC ======================== */
+
+#define GMSM_CMAC_SIZE 16
+
+typedef struct gmsm_cmac_key {
+    gmsm_sm4_key sm4;
+    uint8_t k1[16];  /* 子密钥K1、K2（NIST SP 800-38B），gmsm_cmac_init时算好，之后每条消息直接使用 */
+    uint8_t k2[16];
+} gmsm_cmac_key;
+
+GMSM_API void gmsm_cmac_init(gmsm_cmac_key* key, const uint8_t user_key[GMSM_SM4_KEY_SIZE]);
+
+/* 计算data前len字节的16字节CMAC，len可以为0 */
+GMSM_API void gmsm_cmac(const gmsm_cmac_key* key, const void* data, size_t len, uint8_t mac[GMSM_CMAC_SIZE]);
+
+/* 常量时间比较前mac_len（1~16）字节，一致返回GMSM_OK，否则GMSM_ERR_AUTH；mac_len不合法返回GMSM_ERR_PARAM */
+GMSM_API int gmsm_cmac_verify(const gmsm_cmac_key* key, const void* data, size_t len,
+    const uint8_t* mac, size_t mac_len);
+
+/*
+ * 批量计算count条消息的CMAC：第i条为data[i]的前lens[i]字节，MAC依次写入macs（count * 16字节）。
+ * 每条消息的CBC链是串行的，批量时多条消息的链交错推进，每步拼成一次8路/16路并行的SM4调用；
+ * 结果与逐条调用相同
+ */
+GMSM_API void gmsm_cmac_batch(const gmsm_cmac_key* key, const void* const* data, const size_t* lens,
+    size_t count, uint8_t* macs);
+
+/*
+ * 原始CBC-MAC（IV为0，不填充，取最后一个密文分组）：len须为16的正整数倍，否则返回GMSM_ERR_PARAM。
+ * 只对定长消息安全，变长消息请用CMAC
+ */
+GMSM_API int gmsm_sm4_cbc_mac(const gmsm_sm4_key* key, const void* data, size_t len, uint8_t mac[GMSM_SM4_BLOCK_SIZE]);
+
+/* 批量CBC-MAC；任一条长度不合法时返回GMSM_ERR_PARAM且不计算 */
+GMSM_API int gmsm_sm4_cbc_mac_batch(const gmsm_sm4_key* key, const void* const* data, const size_t* lens,
+    size_t count, uint8_t* macs);
+
+/* ======================== SM4-FF1 ======================== */
+
+/*
+ * 保留格式加密FF1（NIST SP 800-38G），PRF为SM4的CBC-MAC。明文与密文都是len个基数为radix的数字，
+ * 每个数字存为一个uint16_t，数值小于radix。用于卡号、证件号等的令牌化
+ */
+
+#define GMSM_FF1_MAX_LEN 128  /* 本实现支持的最大长度（数字个数） */
+
+typedef struct gmsm_ff1_key {
+    gmsm_sm4_key sm4;
+    uint32_t radix;
+    uint32_t min_len;        /* 最短长度：满足radix^min_len >= 1000000且不小于2 */
+    uint32_t chunk_digits;   /* 内部使用：满足radix^k < 2^32的最大k */
+    uint32_t radix_magic;    /* 内部使用：除以radix时乘以的倒数与移位 */
+    uint32_t radix_shift;
+    uint32_t powers[32];     /* 内部使用：radix^0 ~ radix^chunk_digits，进制转换按k个数字一组进行 */
+    uint8_t numeral_bytes[GMSM_FF1_MAX_LEN / 2 + 1];  /* 内部使用：右半长度为v时NUM_radix(B)的字节数b */
+} gmsm_ff1_key;
+
+/* radix取2~65536，否则返回GMSM_ERR_PARAM */
+GMSM_API int gmsm_ff1_init(gmsm_ff1_key* key, const uint8_t user_key[GMSM_SM4_KEY_SIZE], uint32_t radix);
+
+/*
+ * 加密/解密len个数字，len在min_len~GMSM_FF1_MAX_LEN之间，tweak可以为空；in与out可以相同。
+ * 长度或数字不合法时返回GMSM_ERR_PARAM
+ */
+GMSM_API int gmsm_ff1_encrypt(const gmsm_ff1_key* key, const uint8_t* tweak, size_t tweak_len,
+    const uint16_t* in, uint16_t* out, size_t len);
+GMSM_API int gmsm_ff1_decrypt(const gmsm_ff1_key* key, const uint8_t* tweak, size_t tweak_len,
+    const uint16_t* in, uint16_t* out, size_t len);
+
+/* 批量接口中的一个值，参数含义与gmsm_ff1_encrypt/decrypt相同 */
+typedef struct gmsm_ff1_batch_item {
+    const uint8_t* tweak;
+    size_t tweak_len;
+    const uint16_t* in;
+    uint16_t* out;
+    size_t len;
+    int status;         /* 返回：GMSM_OK或GMSM_ERR_PARAM（out不被写入） */
+} gmsm_ff1_batch_item;
+
+/*
+ * 同一密钥下批量加密/解密count个值。各值的10轮Feistel同步推进：每一轮所有值的CBC-MAC链交错进
+ * SM4的8路/16路并行实现，扩展分组合成一次ECB调用；长度和tweak可以各不相同，结果与逐个调用相同
+ */
+GMSM_API void gmsm_ff1_encrypt_batch(const gmsm_ff1_key* key, gmsm_ff1_batch_item* items, size_t count);
+GMSM_API void gmsm_ff1_decrypt_batch(const gmsm_ff1_key* key, gmsm_ff1_batch_item* items, size_t count);
+
+/* ======================== 随机数 ======================== */
+
+/*
+ * SM4-CTR_DRBG：NIST SP 800-90A 的 CTR_DRBG 结构（使用派生函数），分组密码为 SM4，
+ * seedlen = 256 位。输出按 CTR 模式批量生成，走 SM4 的 8 路/16 路并行实现。
+ */
+
+#define GMSM_DRBG_MAX_REQUEST 65536              /* 单次生成的字节数上限（2^19 位） */
+#define GMSM_DRBG_RESEED_INTERVAL (1ull << 32)   /* 默认的重新播种间隔（生成次数） */
+
+typedef struct gmsm_drbg {
+    gmsm_sm4_key key;         /* 内部使用 */
+    uint8_t v[16];            /* 内部使用 */
+    uint64_t reseed_counter;  /* 内部使用 */
+    uint64_t reseed_interval; /* 生成这么多次后要求重新播种，不超过2^48 */
+} gmsm_drbg;
+
+/*
+ * 实例化：entropy至少16字节；entropy为NULL时从操作系统取32字节熵和16字节nonce（此时忽略nonce参数）。
+ * personal为可选的个性化串。从系统取熵失败时返回GMSM_ERR_UNSUPPORTED
+ */
+GMSM_API int gmsm_drbg_instantiate(gmsm_drbg* drbg, const uint8_t* entropy, size_t entropy_len,
+    const uint8_t* nonce, size_t nonce_len, const uint8_t* personal, size_t personal_len);
+
+/* 重新播种：entropy为NULL时从操作系统取32字节；additional可选 */
+GMSM_API int gmsm_drbg_reseed(gmsm_drbg* drbg, const uint8_t* entropy, size_t entropy_len,
+    const uint8_t* additional, size_t additional_len);
+
+/* 生成len（不超过GMSM_DRBG_MAX_REQUEST）字节；达到重新播种间隔时返回GMSM_ERR_RESEED，不输出 */
+GMSM_API int gmsm_drbg_generate(gmsm_drbg* drbg, uint8_t* out, size_t len,
+    const uint8_t* additional, size_t additional_len);
+
+/* 清除内部状态 */
+GMSM_API void gmsm_drbg_uninstantiate(gmsm_drbg* drbg);
+
+/*
+ * 进程级随机数：每个线程各有一个从操作系统播种的DRBG和一块输出缓冲区，不加锁，
+ * 短请求从缓冲区取，缓冲区空了才调用一次gmsm_drbg_generate；fork后子进程首次使用时重新播种。
+ * len不限。从系统取熵失败时返回GMSM_ERR_UNSUPPORTED
+ */
+GMSM_API int gmsm_random_bytes(void* out, size_t len);
+
+/* 设置各线程DRBG的重新播种间隔（生成次数，0恢复默认），下次生成时生效 */
+GMSM_API void gmsm_random_set_reseed_interval(uint64_t generates);
+
+/* ======================== 异步队列 ======================== */
+
+/*
+ * 进程内的异步加解密：提交任务后立即返回，由队列自带的工作线程完成。各工作线程每次从无锁
+ * 提交队列中取出一批任务，SM3按多缓冲、SM4-GCM按（操作, 密钥）分组调用上面的批量接口。
+ * 任务结构由调用方分配，提交后到完成前不得修改或释放，其中引用的缓冲区也一样。
+ * 完成通知三选一：
+ *   callback非空：在工作线程上调用（应尽快返回，不得在其中等待同一队列）
+ *   flags含GMSM_JOB_REAP：进入完成队列，用gmsm_async_reap取回，gmsm_async_event_fd可读表示有新完成
+ *   其余：用gmsm_async_wait等待，或轮询gmsm_async_done
+ */
+
+#define GMSM_JOB_SEAL 1   /* SM4-GCM加密：out写密文，tag写标签 */
+#define GMSM_JOB_OPEN 2   /* SM4-GCM解密：先验证tag，失败时out不被写入 */
+#define GMSM_JOB_HASH 3   /* SM3：out写32字节摘要，key/iv/aad/tag不使用 */
+#define GMSM_JOB_SM3_UPDATE 4  /* 把in累加进sm3上下文（流式SM3）；同一上下文同时只能有一个任务 */
+
+#define GMSM_JOB_REAP 0x01u
+
+#define GMSM_PENDING 1    /* 任务status：尚未完成 */
+
+typedef struct gmsm_job gmsm_job;
+typedef void (*gmsm_job_callback)(gmsm_job* job);
+
+struct gmsm_job {
+    int op;                      /* GMSM_JOB_* */
+    unsigned flags;              /* GMSM_JOB_REAP */
+    const gmsm_gcm_key* key;
+    const uint8_t* iv;
+    size_t iv_len;
+    const uint8_t* aad;
+    size_t aad_len;
+    const uint8_t* in;
+    size_t len;
+    uint8_t* out;
+    uint8_t* tag;
+    size_t tag_len;
+    gmsm_sm3_ctx* sm3;           /* GMSM_JOB_SM3_UPDATE使用 */
+    gmsm_job_callback callback;
+    void* user;                  /* 调用方自用 */
+    int status;                  /* 提交时置为GMSM_PENDING，完成后为GMSM_OK或错误码 */
+};
+
+typedef struct gmsm_async_queue gmsm_async_queue;
+
+/*
+ * 创建队列：workers个工作线程（0为CPU核数），最多capacity个未交还的任务（向上取到2的幂）。
+ * 失败返回NULL
+ */
+GMSM_API gmsm_async_queue* gmsm_async_create(unsigned workers, size_t capacity);
+
+/* 等已提交的任务全部完成后停止工作线程并释放队列；完成队列中未取回的任务不再通知 */
+GMSM_API void gmsm_async_destroy(gmsm_async_queue* queue);
+
+/*
+ * 提交count个任务，不阻塞。返回实际提交的个数：队列满时只提交前面的一部分，
+ * 其余任务未被修改，可以稍后重新提交
+ */
+GMSM_API size_t gmsm_async_submit(gmsm_async_queue* queue, gmsm_job* const* jobs, size_t count);
+
+/* 取回最多max个已完成的GMSM_JOB_REAP任务，不阻塞，返回取回的个数 */
+GMSM_API size_t gmsm_async_reap(gmsm_async_queue* queue, gmsm_job** jobs, size_t max);
+
+/*
+ * 有GMSM_JOB_REAP任务完成时变为可读的eventfd，可以直接放进epoll等事件循环；读出8字节即清除，
+ * 之后调用gmsm_async_reap直到返回0。不支持eventfd的平台返回-1
+ */
+GMSM_API int gmsm_async_event_fd(gmsm_async_queue* queue);
+
+/* 任务是否已完成 */
+GMSM_API int gmsm_async_done(const gmsm_job* job);
+
+/* 阻塞到任务完成，返回其status。只用于没有callback的任务；GMSM_JOB_REAP任务完成后仍要取回 */
+GMSM_API int gmsm_async_wait(gmsm_async_queue* queue, gmsm_job* job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GMSM_H */
@@ -0,0 +1,360 @@
+﻿#ifndef GMSM_CORO_H
+#define GMSM_CORO_H
+
+/*
+ * libgmsm 的 C++20 协程接口（仅头文件，建立在 gmsm_async_* 之上）
+ *
+ *   gmsm::LoopExecutor loop;
+ *   gmsm::AsyncGcm gcm(queue, loop, key);
+ *   gmsm::Task<int> Handle(...) {
+ *       int status = co_await gcm.SealAsync(iv, 12, aad, aadLen, in, len, out, tag);
+ *       co_return co_await gmsm::Sm3FileAsync(queue, loop, "data.bin", digest);
+ *   }
+ *
+ * 操作在创建时就提交给工作线程，co_await 时若尚未完成则挂起；完成后协程经创建操作时
+ * 传入的执行器恢复，不会在工作线程上继续执行。操作对象在完成前不得销毁（直接 co_await
+ * 临时对象总满足这一点；未被等待就销毁时析构函数会阻塞到完成）。
+ */
+
+#if !defined(__cpp_impl_coroutine)
+#error "gmsm_coro.h 需要 C++20 协程（如 g++ -std=c++20）"
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "gmsm.h"
+
+namespace gmsm {
+
+    /**
+     * @brief 协程恢复的去处；Post可能在工作线程上调用，必须线程安全
+     */
+    class Executor {
+    public:
+        virtual ~Executor() = default;
+        virtual void Post(std::coroutine_handle<> handle) = 0;
+    };
+
+    /**
+     * @brief 单线程事件循环：Post进来的协程由调用Run*的线程依次恢复
+     */
+    class LoopExecutor : public Executor {
+    public:
+        void Post(std::coroutine_handle<> handle) override {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready.push_back(handle);
+                pending.store(ready.size());
+            }
+            wake.notify_one();
+        }
+
+        /**
+         * @brief 恢复当前所有就绪的协程；没有时先让出CPU几轮，再阻塞等待
+         */
+        void RunReady() {
+            for (int i = 0; i < SPIN_ROUNDS && pending.load() == 0; ++i) std::this_thread::yield();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return !ready.empty(); });
+                running.swap(ready);
+                pending.store(0);
+            }
+            for (std::coroutine_handle<> handle : running) handle.resume();
+            running.clear();
+        }
+
+        template<class Done>
+        void RunUntil(Done done) {
+            while (!done()) RunReady();
+        }
+
+    private:
+        static constexpr int SPIN_ROUNDS = 64;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::vector<std::coroutine_handle<>> ready;
+        std::vector<std::coroutine_handle<>> running;  // 只由运行循环的线程使用
+        std::atomic<size_t> pending{ 0 };
+    };
+
+    /**
+     * @brief 在工作线程上直接恢复（省一次线程切换，协程剩余部分会占用工作线程）
+     */
+    class InlineExecutor : public Executor {
+    public:
+        void Post(std::coroutine_handle<> handle) override { handle.resume(); }
+    };
+
+    template<class T>
+    class Task;
+
+    namespace detail {
+
+        struct TaskPromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+                template<class Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> self) noexcept {
+                    std::coroutine_handle<> next = self.promise().continuation;
+                    return next ? next : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+
+            FinalAwaiter final_suspend() noexcept { return {}; }
+            void unhandled_exception() { error = std::current_exception(); }
+        };
+
+        template<class T>
+        struct TaskPromise : TaskPromiseBase {
+            std::optional<T> value;
+
+            Task<T> get_return_object();
+            void return_value(T v) { value.emplace(std::move(v)); }
+            T Result() {
+                if (error) std::rethrow_exception(error);
+                return std::move(*value);
+            }
+        };
+
+        template<>
+        struct TaskPromise<void> : TaskPromiseBase {
+            Task<void> get_return_object();
+            void return_void() {}
+            void Result() {
+                if (error) std::rethrow_exception(error);
+            }
+        };
+
+    } // namespace detail
+
+    /**
+     * @brief 惰性协程：被 co_await 或 Start 时才开始执行，结束后恢复等待它的协程
+     */
+    template<class T = void>
+    class Task {
+    public:
+        using promise_type = detail::TaskPromise<T>;
+
+        explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+        Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+        ~Task() {
+            if (handle) handle.destroy();
+        }
+
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+            handle.promise().continuation = caller;
+            return handle;
+        }
+        T await_resume() { return handle.promise().Result(); }
+
+        /**
+         * @brief 作为顶层协程交给执行器开始执行，之后用Done查询、Result取结果
+         */
+        void Start(Executor& executor) { executor.Post(handle); }
+        bool Done() const { return handle.done(); }
+        T Result() { return handle.promise().Result(); }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    namespace detail {
+
+        template<class T>
+        Task<T> TaskPromise<T>::get_return_object() {
+            return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() {
+            return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+        }
+
+    } // namespace detail
+
+    /**
+     * @brief 在loop上运行task直到完成并返回结果
+     */
+    template<class T>
+    T SyncWait(LoopExecutor& loop, Task<T> task) {
+        task.Start(loop);
+        loop.RunUntil([&] { return task.Done(); });
+        return task.Result();
+    }
+
+    /**
+     * @brief 一个已提交给异步队列的任务；co_await 得到其status（GMSM_OK或错误码）
+     */
+    class AsyncOp {
+    public:
+        AsyncOp(gmsm_async_queue* queue, Executor& executor, const gmsm_job& job) : executor(executor), job(job) {
+            this->job.flags = 0;
+            this->job.callback = &AsyncOp::OnDone;
+            this->job.user = this;
+            gmsm_job* p = &this->job;
+            if (gmsm_async_submit(queue, &p, 1) == 0) {
+                // 队列已满：在当前线程同步完成，不挂起
+                this->job.status = RunInline(this->job);
+                state.store(DONE);
+            }
+        }
+        AsyncOp(const AsyncOp&) = delete;
+        AsyncOp& operator=(const AsyncOp&) = delete;
+        ~AsyncOp() {
+            while (state.load() != DONE) std::this_thread::yield();
+        }
+
+        bool await_ready() const noexcept { return state.load() == DONE; }
+        bool await_suspend(std::coroutine_handle<> caller) noexcept {
+            waiter = caller;
+            int expected = SUBMITTED;
+            return state.compare_exchange_strong(expected, AWAITED);  // 失败说明刚好完成，不挂起
+        }
+        int await_resume() const noexcept { return job.status; }
+
+    private:
+        enum { SUBMITTED, AWAITED, DONE };
+
+        static void OnDone(gmsm_job* job) {
+            AsyncOp* self = static_cast<AsyncOp*>(job->user);
+            // 之前是SUBMITTED时，交换之后self随时可能被销毁；是AWAITED时协程挂起着，self在恢复前一直有效
+            if (self->state.exchange(DONE) == AWAITED) self->executor.Post(self->waiter);
+        }
+
+        static int RunInline(const gmsm_job& job) {
+            switch (job.op) {
+            case GMSM_JOB_SEAL:
+                return gmsm_gcm_encrypt(job.key, job.iv, job.iv_len, job.aad, job.aad_len, job.in, job.len,
+                    job.out, job.tag, job.tag_len);
+            case GMSM_JOB_OPEN:
+                return gmsm_gcm_decrypt(job.key, job.iv, job.iv_len, job.aad, job.aad_len, job.in, job.len,
+                    job.out, job.tag, job.tag_len);
+            case GMSM_JOB_HASH:
+                gmsm_sm3(job.in, job.len, job.out);
+                return GMSM_OK;
+            case GMSM_JOB_SM3_UPDATE:
+                gmsm_sm3_update(job.sm3, job.in, job.len);
+                return GMSM_OK;
+            default:
+                return GMSM_ERR_PARAM;
+            }
+        }
+
+        Executor& executor;
+        gmsm_job job;
+        std::coroutine_handle<> waiter;
+        std::atomic<int> state{ SUBMITTED };
+    };
+
+    /**
+     * @brief 绑定了密钥、队列和执行器的SM4-GCM
+     */
+    class AsyncGcm {
+    public:
+        AsyncGcm(gmsm_async_queue* queue, Executor& executor, const uint8_t key[GMSM_SM4_KEY_SIZE])
+            : queue(queue), executor(executor) {
+            gmsm_gcm_init(&this->key, key);
+        }
+
+        AsyncOp SealAsync(const uint8_t* iv, size_t ivLen, const uint8_t* aad, size_t aadLen,
+            const uint8_t* in, size_t len, uint8_t* out, uint8_t* tag, size_t tagLen = GMSM_GCM_TAG_SIZE) const {
+            return AsyncOp(queue, executor, MakeJob(GMSM_JOB_SEAL, iv, ivLen, aad, aadLen, in, len, out, tag, tagLen));
+        }
+
+        AsyncOp OpenAsync(const uint8_t* iv, size_t ivLen, const uint8_t* aad, size_t aadLen,
+            const uint8_t* in, size_t len, uint8_t* out, const uint8_t* tag, size_t tagLen = GMSM_GCM_TAG_SIZE) const {
+            return AsyncOp(queue, executor, MakeJob(GMSM_JOB_OPEN, iv, ivLen, aad, aadLen, in, len, out,
+                const_cast<uint8_t*>(tag), tagLen));
+        }
+
+    private:
+        gmsm_job MakeJob(int op, const uint8_t* iv, size_t ivLen, const uint8_t* aad, size_t aadLen,
+            const uint8_t* in, size_t len, uint8_t* out, uint8_t* tag, size_t tagLen) const {
+            gmsm_job job = {};
+            job.op = op;
+            job.key = &key;
+            job.iv = iv;
+            job.iv_len = ivLen;
+            job.aad = aad;
+            job.aad_len = aadLen;
+            job.in = in;
+            job.len = len;
+            job.out = out;
+            job.tag = tag;
+            job.tag_len = tagLen;
+            return job;
+        }
+
+        gmsm_async_queue* queue;
+        Executor& executor;
+        gmsm_gcm_key key;
+    };
+
+    inline AsyncOp Sm3Async(gmsm_async_queue* queue, Executor& executor, const void* data, size_t len,
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE]) {
+        gmsm_job job = {};
+        job.op = GMSM_JOB_HASH;
+        job.in = static_cast<const uint8_t*>(data);
+        job.len = len;
+        job.out = digest;
+        return AsyncOp(queue, executor, job);
+    }
+
+    inline AsyncOp Sm3UpdateAsync(gmsm_async_queue* queue, Executor& executor, gmsm_sm3_ctx* ctx,
+        const void* data, size_t len) {
+        gmsm_job job = {};
+        job.op = GMSM_JOB_SM3_UPDATE;
+        job.sm3 = ctx;
+        job.in = static_cast<const uint8_t*>(data);
+        job.len = len;
+        return AsyncOp(queue, executor, job);
+    }
+
+    /**
+     * @brief 文件的SM3：双缓冲，读下一块的同时由工作线程累加上一块。无法打开或读取时返回GMSM_ERR_PARAM
+     */
+    inline Task<int> Sm3FileAsync(gmsm_async_queue* queue, Executor& executor, std::string path,
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE], size_t chunk = size_t(1) << 20) {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) co_return GMSM_ERR_PARAM;
+
+        std::vector<uint8_t> buffers[2] = { std::vector<uint8_t>(chunk), std::vector<uint8_t>(chunk) };
+        gmsm_sm3_ctx ctx;
+        gmsm_sm3_init(&ctx);
+        int current = 0;
+        size_t n = std::fread(buffers[0].data(), 1, chunk, file);
+        while (n > 0) {
+            AsyncOp update = Sm3UpdateAsync(queue, executor, &ctx, buffers[current].data(), n);
+            current ^= 1;
+            n = std::fread(buffers[current].data(), 1, chunk, file);
+            co_await update;
+        }
+        bool failed = std::ferror(file) != 0;
+        std::fclose(file);
+        if (failed) co_return GMSM_ERR_PARAM;
+        gmsm_sm3_final(&ctx, digest);
+        co_return GMSM_OK;
+    }
+
+} // namespace gmsm
+
+#endif /* GMSM_CORO_H */
@@ -0,0 +1,151 @@
+﻿#ifndef GMSM_INTERNAL_H
+#define GMSM_INTERNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "gmsm.h"
+
+// 库内部各模块之间的接口（不导出）
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GMSM_X86 1
+#if defined(_MSC_VER)
+#define GMSM_TARGET(isa)
+#else
+#define GMSM_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace gmsm {
+
+    /**
+     * @brief 运行时检测的CPU特性（GMSM_CPU_*），只检测一次
+     */
+    unsigned CpuFeatures();
+
+    // ---------------- SM4 ----------------
+
+    /**
+     * @brief 批量处理分组的实现，in与out可以相同
+     */
+    using Sm4BlocksFn = void (*)(const uint32_t rk[32], const uint8_t* in, uint8_t* out, size_t blocks);
+
+    void Sm4ExpandKey(const uint8_t key[16], uint32_t rk[32], bool decrypt);
+
+    void Sm4BlocksReference(const uint32_t rk[32], const uint8_t* in, uint8_t* out, size_t blocks);
+    void Sm4BlocksTTable(const uint32_t rk[32], const uint8_t* in, uint8_t* out, size_t blocks);
+#if defined(GMSM_X86)
+    void Sm4BlocksAvx2(const uint32_t rk[32], const uint8_t* in, uint8_t* out, size_t blocks);
+#endif
+
+    /**
+     * @brief 连续存放的T0~T3（各256个字），供生成的代码按偏移查表
+     */
+    const uint32_t* Sm4TTables();
+
+    /**
+     * @brief 密钥特化的内核：处理groups组、每组8个分组，tables为Sm4TTables()
+     */
+    using Sm4JitKernel = void (*)(const uint8_t* in, uint8_t* out, size_t groups, const uint32_t* tables);
+
+    /**
+     * @brief 用JIT句柄处理blocks个分组：整8组走生成的内核，其余（或JIT不可用时全部）走通用实现
+     */
+    void Sm4JitBlocks(const gmsm_sm4_jit* jit, const uint8_t* in, uint8_t* out, size_t blocks);
+
+    /**
+     * @brief 这次调用是否走大缓冲区模式（gmsm_sm4_set_streaming）：数据量达到阈值、out按16字节对齐且有AVX2
+     */
+    bool Sm4UseStreaming(const uint8_t* out, size_t len);
+
+    /**
+     * @brief 输入的预取距离（字节），0为不预取
+     */
+    size_t Sm4PrefetchDistance();
+
+    /**
+     * @brief 以NTA提示预取[p, p + bytes)
+     */
+    void Sm4PrefetchNta(const uint8_t* p, size_t bytes);
+
+    /**
+     * @brief 非临时存储：dst按32字节对齐，bytes为32的倍数；全部写完后调用Sm4StreamFence
+     */
+    void Sm4StreamStore(uint8_t* dst, const uint8_t* src, size_t bytes);
+    void Sm4StreamFence();
+
+    /**
+     * @brief 当前实际使用的实现（AUTO已按CPU解析）
+     */
+    gmsm_sm4_impl CurrentSm4Impl();
+
+    /**
+     * @brief 当前选定的实现（gmsm_sm4_set_impl）；工作模式见 sm4_engine.h
+     */
+    Sm4BlocksFn Sm4Blocks();
+
+    // ---------------- GHASH ----------------
+
+    constexpr size_t GHASH_TABLE_WORDS = 40;
+
+    /**
+     * @brief 由哈希子密钥H预计算（4位查表和 H、H^2、H^3、H^4），写入table
+     */
+    void GhashInit(uint64_t table[GHASH_TABLE_WORDS], const uint8_t H[16]);
+
+    /**
+     * @brief Y = (...((Y xor X1)·H xor X2)·H ...)·H，blocks个完整分组
+     */
+    void GhashBlocks(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data, size_t blocks);
+
+    /**
+     * @brief 任意长度输入：末尾不足一个分组的部分补0
+     */
+    void GhashUpdate(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data, size_t len);
+
+    /**
+     * @brief POLYVAL（RFC 8452）：H与分组按小端字节序，与GHASH共用同一份表和CLMUL内核
+     */
+    void PolyvalInit(uint64_t table[GHASH_TABLE_WORDS], const uint8_t H[16]);
+    void PolyvalBlocks(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data, size_t blocks);
+    void PolyvalUpdate(const uint64_t table[GHASH_TABLE_WORDS], uint8_t Y[16], const uint8_t* data, size_t len);
+
+    // ---------------- 工具 ----------------
+
+    inline uint32_t LoadBE32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+            (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+
+    inline void StoreBE32(uint8_t* p, uint32_t v) {
+        p[0] = static_cast<uint8_t>(v >> 24);
+        p[1] = static_cast<uint8_t>(v >> 16);
+        p[2] = static_cast<uint8_t>(v >> 8);
+        p[3] = static_cast<uint8_t>(v);
+    }
+
+    inline uint64_t LoadBE64(const uint8_t* p) {
+        return (static_cast<uint64_t>(LoadBE32(p)) << 32) | LoadBE32(p + 4);
+    }
+
+    inline void StoreBE64(uint8_t* p, uint64_t v) {
+        StoreBE32(p, static_cast<uint32_t>(v >> 32));
+        StoreBE32(p + 4, static_cast<uint32_t>(v));
+    }
+
+    inline uint32_t RotateLeft(uint32_t x, int n) {
+        return (x << n) | (x >> ((32 - n) & 31));
+    }
+
+    /**
+     * @brief 常量时间比较前len字节，相等返回true
+     */
+    inline bool ConstantTimeEqual(const uint8_t* a, const uint8_t* b, size_t len) {
+        uint8_t diff = 0;
+        for (size_t i = 0; i < len; ++i) diff |= static_cast<uint8_t>(a[i] ^ b[i]);
+        return diff == 0;
+    }
+
+} // namespace gmsm
+
+#endif // GMSM_INTERNAL_H
@@ -0,0 +1,572 @@
+﻿// libgmsm 的 CPython 扩展模块（CPython C API）：SM3、SM4 ECB/CTR、SM4-GCM 与 SM4-CMAC
+// 编译：python setup.py build_ext --inplace（或 pip install .）
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pythread.h>
+#include <cstring>
+#include <vector>
+#include "gmsm.h"
+
+namespace {
+
+    // 输入不少于该长度时在计算期间释放GIL（与hashlib的阈值一致）
+    constexpr Py_ssize_t GIL_MINSIZE = 2048;
+
+    bool CheckKey(const Py_buffer& key) {
+        if (key.len != GMSM_SM4_KEY_SIZE) {
+            PyErr_SetString(PyExc_ValueError, "key必须为16字节");
+            return false;
+        }
+        return true;
+    }
+
+    // ---------------- SM3 ----------------
+
+    /**
+     * @brief sm3(data) -> bytes
+     */
+    PyObject* Sm3(PyObject*, PyObject* args) {
+        Py_buffer data;
+        if (!PyArg_ParseTuple(args, "y*", &data)) {
+            return nullptr;
+        }
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+        if (data.len >= GIL_MINSIZE) {
+            Py_BEGIN_ALLOW_THREADS
+            gmsm_sm3(data.buf, static_cast<size_t>(data.len), digest);
+            Py_END_ALLOW_THREADS
+        }
+        else {
+            gmsm_sm3(data.buf, static_cast<size_t>(data.len), digest);
+        }
+        PyBuffer_Release(&data);
+        return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(digest), GMSM_SM3_DIGEST_SIZE);
+    }
+
+    /**
+     * @brief sm3_many(data, item_size) -> bytes
+     * 把data切成长度为item_size的若干段，逐段求SM3，返回拼接的摘要（每段32字节）。
+     * 用于Merkle树逐层计算等大量短消息的场景，整批只跨越一次Python/C边界
+     */
+    PyObject* Sm3Many(PyObject*, PyObject* args) {
+        Py_buffer data;
+        Py_ssize_t itemSize;
+        if (!PyArg_ParseTuple(args, "y*n", &data, &itemSize)) {
+            return nullptr;
+        }
+        if (itemSize <= 0 || data.len % itemSize != 0) {
+            PyBuffer_Release(&data);
+            PyErr_SetString(PyExc_ValueError, "item_size必须为正数，且data长度为item_size的整数倍");
+            return nullptr;
+        }
+        Py_ssize_t count = data.len / itemSize;
+        PyObject* result = PyBytes_FromStringAndSize(nullptr, count * GMSM_SM3_DIGEST_SIZE);
+        if (result) {
+            const uint8_t* in = static_cast<const uint8_t*>(data.buf);
+            uint8_t* out = reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(result));
+            Py_BEGIN_ALLOW_THREADS
+            for (Py_ssize_t i = 0; i < count; ++i) {
+                gmsm_sm3(in + i * itemSize, static_cast<size_t>(itemSize), out + i * GMSM_SM3_DIGEST_SIZE);
+            }
+            Py_END_ALLOW_THREADS
+        }
+        PyBuffer_Release(&data);
+        return result;
+    }
+
+    /**
+     * 流式SM3对象，接口与hashlib一致。释放GIL更新期间用lock保护上下文，
+     * lock在第一次遇到大输入时才分配
+     */
+    struct Sm3Object {
+        PyObject_HEAD
+        gmsm_sm3_ctx ctx;
+        PyThread_type_lock lock;
+    };
+
+    void Sm3Update(Sm3Object* self, const Py_buffer& data) {
+        if (!self->lock && data.len >= GIL_MINSIZE) {
+            self->lock = PyThread_allocate_lock();  // 分配失败时持有GIL计算
+        }
+        if (self->lock) {
+            Py_BEGIN_ALLOW_THREADS
+            PyThread_acquire_lock(self->lock, WAIT_LOCK);
+            gmsm_sm3_update(&self->ctx, data.buf, static_cast<size_t>(data.len));
+            PyThread_release_lock(self->lock);
+            Py_END_ALLOW_THREADS
+        }
+        else {
+            gmsm_sm3_update(&self->ctx, data.buf, static_cast<size_t>(data.len));
+        }
+    }
+
+    // 复制当前上下文，digest()与copy()都不改变原对象
+    void Sm3Snapshot(Sm3Object* self, gmsm_sm3_ctx& out) {
+        if (self->lock) {
+            Py_BEGIN_ALLOW_THREADS
+            PyThread_acquire_lock(self->lock, WAIT_LOCK);
+            out = self->ctx;
+            PyThread_release_lock(self->lock);
+            Py_END_ALLOW_THREADS
+        }
+        else {
+            out = self->ctx;
+        }
+    }
+
+    PyObject* Sm3New(PyTypeObject* type, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = { "data", nullptr };
+        Py_buffer data = {};
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|y*:SM3", const_cast<char**>(keywords), &data)) {
+            return nullptr;
+        }
+        Sm3Object* self = reinterpret_cast<Sm3Object*>(type->tp_alloc(type, 0));
+        if (self) {
+            gmsm_sm3_init(&self->ctx);
+            self->lock = nullptr;
+            if (data.buf) {
+                Sm3Update(self, data);
+            }
+        }
+        if (data.buf) {
+            PyBuffer_Release(&data);
+        }
+        return reinterpret_cast<PyObject*>(self);
+    }
+
+    void Sm3Dealloc(Sm3Object* self) {
+        if (self->lock) {
+            PyThread_free_lock(self->lock);
+        }
+        Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+    }
+
+    /**
+     * @brief update(data) -> None
+     */
+    PyObject* Sm3ObjectUpdate(Sm3Object* self, PyObject* args) {
+        Py_buffer data;
+        if (!PyArg_ParseTuple(args, "y*", &data)) {
+            return nullptr;
+        }
+        Sm3Update(self, data);
+        PyBuffer_Release(&data);
+        Py_RETURN_NONE;
+    }
+
+    PyObject* Sm3ObjectDigest(Sm3Object* self, PyObject*) {
+        gmsm_sm3_ctx ctx;
+        Sm3Snapshot(self, ctx);
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+        gmsm_sm3_final(&ctx, digest);
+        return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(digest), GMSM_SM3_DIGEST_SIZE);
+    }
+
+    PyObject* Sm3ObjectHexDigest(Sm3Object* self, PyObject*) {
+        gmsm_sm3_ctx ctx;
+        Sm3Snapshot(self, ctx);
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+        gmsm_sm3_final(&ctx, digest);
+        static const char HEX[] = "0123456789abcdef";
+        char hex[2 * GMSM_SM3_DIGEST_SIZE];
+        for (int i = 0; i < GMSM_SM3_DIGEST_SIZE; ++i) {
+            hex[2 * i] = HEX[digest[i] >> 4];
+            hex[2 * i + 1] = HEX[digest[i] & 0x0F];
+        }
+        return PyUnicode_FromStringAndSize(hex, sizeof(hex));
+    }
+
+    PyObject* Sm3ObjectCopy(Sm3Object* self, PyObject*) {
+        Sm3Object* copy = PyObject_New(Sm3Object, Py_TYPE(self));
+        if (!copy) return nullptr;
+        copy->lock = nullptr;
+        Sm3Snapshot(self, copy->ctx);
+        return reinterpret_cast<PyObject*>(copy);
+    }
+
+    /**
+     * @brief state() -> bytes：gmsm_sm3_export的128字节检查点，可存盘后用sm3_from_state恢复
+     */
+    PyObject* Sm3ObjectState(Sm3Object* self, PyObject*) {
+        gmsm_sm3_ctx ctx;
+        Sm3Snapshot(self, ctx);
+        uint8_t state[GMSM_SM3_STATE_SIZE];
+        gmsm_sm3_export(&ctx, state);
+        return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(state), GMSM_SM3_STATE_SIZE);
+    }
+
+    PyObject* Sm3ObjectName(Sm3Object*, void*) {
+        return PyUnicode_FromString("sm3");
+    }
+
+    PyObject* Sm3ObjectDigestSize(Sm3Object*, void*) {
+        return PyLong_FromLong(GMSM_SM3_DIGEST_SIZE);
+    }
+
+    PyObject* Sm3ObjectBlockSize(Sm3Object*, void*) {
+        return PyLong_FromLong(GMSM_SM3_BLOCK_SIZE);
+    }
+
+    PyMethodDef sm3Methods[] = {
+        { "update", reinterpret_cast<PyCFunction>(Sm3ObjectUpdate), METH_VARARGS, "update(data) -> None" },
+        { "digest", reinterpret_cast<PyCFunction>(Sm3ObjectDigest), METH_NOARGS, "digest() -> bytes" },
+        { "hexdigest", reinterpret_cast<PyCFunction>(Sm3ObjectHexDigest), METH_NOARGS, "hexdigest() -> str" },
+        { "copy", reinterpret_cast<PyCFunction>(Sm3ObjectCopy), METH_NOARGS, "copy() -> SM3" },
+        { "state", reinterpret_cast<PyCFunction>(Sm3ObjectState), METH_NOARGS, "state() -> bytes" },
+        { nullptr, nullptr, 0, nullptr }
+    };
+
+    PyGetSetDef sm3GetSet[] = {
+        { "name", reinterpret_cast<getter>(Sm3ObjectName), nullptr, "算法名称", nullptr },
+        { "digest_size", reinterpret_cast<getter>(Sm3ObjectDigestSize), nullptr, "摘要字节数", nullptr },
+        { "block_size", reinterpret_cast<getter>(Sm3ObjectBlockSize), nullptr, "分组字节数", nullptr },
+        { nullptr, nullptr, nullptr, nullptr, nullptr }
+    };
+
+    PyTypeObject sm3Type = [] {
+        PyTypeObject t = { PyVarObject_HEAD_INIT(nullptr, 0) };
+        t.tp_name = "gmsm_native.SM3";
+        t.tp_basicsize = sizeof(Sm3Object);
+        t.tp_flags = Py_TPFLAGS_DEFAULT;
+        t.tp_doc = "SM3(data=None)：流式SM3，接口与hashlib对象相同";
+        t.tp_new = Sm3New;
+        t.tp_dealloc = reinterpret_cast<destructor>(Sm3Dealloc);
+        t.tp_methods = sm3Methods;
+        t.tp_getset = sm3GetSet;
+        return t;
+    }();
+
+    /**
+     * @brief sm3_from_state(state) -> SM3：从state()的结果恢复流式对象，格式或校验不符时抛出ValueError
+     */
+    PyObject* Sm3FromState(PyObject*, PyObject* args) {
+        Py_buffer state;
+        if (!PyArg_ParseTuple(args, "y*", &state)) {
+            return nullptr;
+        }
+        gmsm_sm3_ctx ctx;
+        const bool ok = state.len == GMSM_SM3_STATE_SIZE &&
+            gmsm_sm3_import(&ctx, static_cast<const uint8_t*>(state.buf)) == GMSM_OK;
+        PyBuffer_Release(&state);
+        if (!ok) {
+            PyErr_SetString(PyExc_ValueError, "不是有效的SM3检查点");
+            return nullptr;
+        }
+        Sm3Object* self = PyObject_New(Sm3Object, &sm3Type);
+        if (!self) return nullptr;
+        self->lock = nullptr;
+        self->ctx = ctx;
+        return reinterpret_cast<PyObject*>(self);
+    }
+
+    // ---------------- SM4 ----------------
+
+    /**
+     * @brief ECB加密/解密的公共部分，data长度必须为16的整数倍
+     */
+    PyObject* Sm4Ecb(PyObject* args, bool decrypt) {
+        Py_buffer key, data;
+        if (!PyArg_ParseTuple(args, "y*y*", &key, &data)) {
+            return nullptr;
+        }
+        PyObject* result = nullptr;
+        if (!CheckKey(key)) {
+            // 异常已设置
+        }
+        else if (data.len % GMSM_SM4_BLOCK_SIZE != 0) {
+            PyErr_SetString(PyExc_ValueError, "ECB模式的data长度必须为16的整数倍");
+        }
+        else if ((result = PyBytes_FromStringAndSize(nullptr, data.len)) != nullptr) {
+            gmsm_sm4_key rk;
+            if (decrypt) {
+                gmsm_sm4_set_decrypt_key(&rk, static_cast<const uint8_t*>(key.buf));
+            }
+            else {
+                gmsm_sm4_set_encrypt_key(&rk, static_cast<const uint8_t*>(key.buf));
+            }
+            const uint8_t* in = static_cast<const uint8_t*>(data.buf);
+            uint8_t* out = reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(result));
+            size_t blocks = static_cast<size_t>(data.len) / GMSM_SM4_BLOCK_SIZE;
+            Py_BEGIN_ALLOW_THREADS
+            gmsm_sm4_ecb(&rk, in, out, blocks);
+            Py_END_ALLOW_THREADS
+        }
+        PyBuffer_Release(&key);
+        PyBuffer_Release(&data);
+        return result;
+    }
+
+    /**
+     * @brief sm4_ecb_encrypt(key, data) -> bytes
+     */
+    PyObject* Sm4EcbEncrypt(PyObject*, PyObject* args) {
+        return Sm4Ecb(args, false);
+    }
+
+    /**
+     * @brief sm4_ecb_decrypt(key, data) -> bytes
+     */
+    PyObject* Sm4EcbDecrypt(PyObject*, PyObject* args) {
+        return Sm4Ecb(args, true);
+    }
+
+    /**
+     * @brief sm4_ctr(key, counter, data) -> bytes
+     * counter为16字节初始计数器（按128位大端整数递增），加密与解密是同一操作
+     */
+    PyObject* Sm4Ctr(PyObject*, PyObject* args) {
+        Py_buffer key, counter, data;
+        if (!PyArg_ParseTuple(args, "y*y*y*", &key, &counter, &data)) {
+            return nullptr;
+        }
+        PyObject* result = nullptr;
+        if (!CheckKey(key)) {
+            // 异常已设置
+        }
+        else if (counter.len != GMSM_SM4_BLOCK_SIZE) {
+            PyErr_SetString(PyExc_ValueError, "counter必须为16字节");
+        }
+        else if ((result = PyBytes_FromStringAndSize(nullptr, data.len)) != nullptr) {
+            gmsm_sm4_key rk;
+            gmsm_sm4_set_encrypt_key(&rk, static_cast<const uint8_t*>(key.buf));
+            uint8_t ctr[GMSM_SM4_BLOCK_SIZE];
+            std::memcpy(ctr, counter.buf, sizeof(ctr));
+            const uint8_t* in = static_cast<const uint8_t*>(data.buf);
+            uint8_t* out = reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(result));
+            size_t len = static_cast<size_t>(data.len);
+            Py_BEGIN_ALLOW_THREADS
+            gmsm_sm4_ctr(&rk, ctr, in, out, len);
+            Py_END_ALLOW_THREADS
+        }
+        PyBuffer_Release(&key);
+        PyBuffer_Release(&counter);
+        PyBuffer_Release(&data);
+        return result;
+    }
+
+    // ---------------- SM4-CMAC ----------------
+
+    /**
+     * @brief sm4_cmac(key, data) -> bytes，16字节MAC
+     */
+    PyObject* Sm4Cmac(PyObject*, PyObject* args) {
+        Py_buffer key, data;
+        if (!PyArg_ParseTuple(args, "y*y*", &key, &data)) {
+            return nullptr;
+        }
+        PyObject* result = nullptr;
+        if (CheckKey(key) && (result = PyBytes_FromStringAndSize(nullptr, GMSM_CMAC_SIZE)) != nullptr) {
+            gmsm_cmac_key ck;
+            gmsm_cmac_init(&ck, static_cast<const uint8_t*>(key.buf));
+            uint8_t* out = reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(result));
+            if (data.len >= GIL_MINSIZE) {
+                Py_BEGIN_ALLOW_THREADS
+                gmsm_cmac(&ck, data.buf, static_cast<size_t>(data.len), out);
+                Py_END_ALLOW_THREADS
+            }
+            else {
+                gmsm_cmac(&ck, data.buf, static_cast<size_t>(data.len), out);
+            }
+        }
+        PyBuffer_Release(&key);
+        PyBuffer_Release(&data);
+        return result;
+    }
+
+    /**
+     * @brief sm4_cmac_many(key, data, item_size) -> bytes
+     * 把data切成等长的item_size字节消息，返回拼接的MAC；一次调用走批量接口
+     */
+    PyObject* Sm4CmacMany(PyObject*, PyObject* args) {
+        Py_buffer key, data;
+        Py_ssize_t itemSize;
+        if (!PyArg_ParseTuple(args, "y*y*n", &key, &data, &itemSize)) {
+            return nullptr;
+        }
+        PyObject* result = nullptr;
+        if (!CheckKey(key)) {
+            // 异常已设置
+        }
+        else if (itemSize <= 0 || data.len % itemSize != 0) {
+            PyErr_SetString(PyExc_ValueError, "item_size必须为正数，且data长度为item_size的整数倍");
+        }
+        else {
+            const size_t count = static_cast<size_t>(data.len / itemSize);
+            std::vector<const void*> ptrs(count);
+            std::vector<size_t> lens(count, static_cast<size_t>(itemSize));
+            const uint8_t* in = static_cast<const uint8_t*>(data.buf);
+            for (size_t i = 0; i < count; ++i) ptrs[i] = in + i * static_cast<size_t>(itemSize);
+            if ((result = PyBytes_FromStringAndSize(nullptr, static_cast<Py_ssize_t>(count * GMSM_CMAC_SIZE))) != nullptr) {
+                gmsm_cmac_key ck;
+                gmsm_cmac_init(&ck, static_cast<const uint8_t*>(key.buf));
+                uint8_t* out = reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(result));
+                Py_BEGIN_ALLOW_THREADS
+                gmsm_cmac_batch(&ck, ptrs.data(), lens.data(), count, out);
+                Py_END_ALLOW_THREADS
+            }
+        }
+        PyBuffer_Release(&key);
+        PyBuffer_Release(&data);
+        return result;
+    }
+
+    // ---------------- SM4-GCM ----------------
+
+    /**
+     * @brief sm4_gcm_encrypt(key, iv, data, aad=b"", tag_len=16) -> (ciphertext, tag)
+     */
+    PyObject* Sm4GcmEncrypt(PyObject*, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = { "key", "iv", "data", "aad", "tag_len", nullptr };
+        Py_buffer key, iv, data, aad = {};
+        Py_ssize_t tagLen = GMSM_GCM_TAG_SIZE;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*y*y*|y*n", const_cast<char**>(keywords),
+            &key, &iv, &data, &aad, &tagLen)) {
+            return nullptr;
+        }
+        PyObject* result = nullptr;
+        PyObject* ciphertext = nullptr;
+        if (!CheckKey(key)) {
+            // 异常已设置
+        }
+        else if (iv.len == 0 || tagLen < 4 || tagLen > GMSM_GCM_TAG_SIZE) {
+            PyErr_SetString(PyExc_ValueError, "iv不能为空，tag_len必须在4~16之间");
+        }
+        else if ((ciphertext = PyBytes_FromStringAndSize(nullptr, data.len)) != nullptr) {
+            uint8_t tag[GMSM_GCM_TAG_SIZE];
+            int rc;
+            Py_BEGIN_ALLOW_THREADS
+            gmsm_gcm_key gk;
+            gmsm_gcm_init(&gk, static_cast<const uint8_t*>(key.buf));
+            rc = gmsm_gcm_encrypt(&gk, static_cast<const uint8_t*>(iv.buf), static_cast<size_t>(iv.len),
+                static_cast<const uint8_t*>(aad.buf), static_cast<size_t>(aad.len),
+                static_cast<const uint8_t*>(data.buf), static_cast<size_t>(data.len),
+                reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(ciphertext)), tag, static_cast<size_t>(tagLen));
+            Py_END_ALLOW_THREADS
+            if (rc != GMSM_OK) {
+                Py_DECREF(ciphertext);
+                PyErr_SetString(PyExc_ValueError, "SM4-GCM参数不合法（消息过长）");
+            }
+            else {
+                result = Py_BuildValue("(Ny#)", ciphertext, reinterpret_cast<const char*>(tag), tagLen);
+            }
+        }
+        PyBuffer_Release(&key);
+        PyBuffer_Release(&iv);
+        PyBuffer_Release(&data);
+        if (aad.buf) {
+            PyBuffer_Release(&aad);
+        }
+        return result;
+    }
+
+    /**
+     * @brief sm4_gcm_decrypt(key, iv, data, tag, aad=b"") -> bytes
+     * 标签不匹配时抛出ValueError，不返回任何明文
+     */
+    PyObject* Sm4GcmDecrypt(PyObject*, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = { "key", "iv", "data", "tag", "aad", nullptr };
+        Py_buffer key, iv, data, tag, aad = {};
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*y*y*y*|y*", const_cast<char**>(keywords),
+            &key, &iv, &data, &tag, &aad)) {
+            return nullptr;
+        }
+        PyObject* plaintext = nullptr;
+        if (!CheckKey(key)) {
+            // 异常已设置
+        }
+        else if (iv.len == 0 || tag.len < 4 || tag.len > GMSM_GCM_TAG_SIZE) {
+            PyErr_SetString(PyExc_ValueError, "iv不能为空，tag长度必须在4~16之间");
+        }
+        else if ((plaintext = PyBytes_FromStringAndSize(nullptr, data.len)) != nullptr) {
+            int rc;
+            Py_BEGIN_ALLOW_THREADS
+            gmsm_gcm_key gk;
+            gmsm_gcm_init(&gk, static_cast<const uint8_t*>(key.buf));
+            rc = gmsm_gcm_decrypt(&gk, static_cast<const uint8_t*>(iv.buf), static_cast<size_t>(iv.len),
+                static_cast<const uint8_t*>(aad.buf), static_cast<size_t>(aad.len),
+                static_cast<const uint8_t*>(data.buf), static_cast<size_t>(data.len),
+                reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(plaintext)),
+                static_cast<const uint8_t*>(tag.buf), static_cast<size_t>(tag.len));
+            Py_END_ALLOW_THREADS
+            if (rc != GMSM_OK) {
+                Py_CLEAR(plaintext);
+                PyErr_SetString(PyExc_ValueError,
+                    rc == GMSM_ERR_AUTH ? "SM4-GCM认证标签不匹配" : "SM4-GCM参数不合法（消息过长）");
+            }
+        }
+        PyBuffer_Release(&key);
+        PyBuffer_Release(&iv);
+        PyBuffer_Release(&data);
+        PyBuffer_Release(&tag);
+        if (aad.buf) {
+            PyBuffer_Release(&aad);
+        }
+        return plaintext;
+    }
+
+    /**
+     * @brief random_bytes(n) -> bytes：取自libgmsm的每线程SM4-CTR_DRBG（从操作系统播种）
+     */
+    PyObject* RandomBytes(PyObject*, PyObject* args) {
+        Py_ssize_t n;
+        if (!PyArg_ParseTuple(args, "n", &n)) {
+            return nullptr;
+        }
+        if (n < 0) {
+            PyErr_SetString(PyExc_ValueError, "n不能为负数");
+            return nullptr;
+        }
+        PyObject* result = PyBytes_FromStringAndSize(nullptr, n);
+        if (result && gmsm_random_bytes(PyBytes_AS_STRING(result), static_cast<size_t>(n)) != GMSM_OK) {
+            Py_DECREF(result);
+            PyErr_SetString(PyExc_OSError, "无法从操作系统获取熵");
+            return nullptr;
+        }
+        return result;
+    }
+
+    PyObject* Backend(PyObject*, PyObject*) {
+        return PyUnicode_FromString(gmsm_sm4_impl_name());
+    }
+
+    PyMethodDef methods[] = {
+        { "sm3", Sm3, METH_VARARGS, "sm3(data) -> bytes" },
+        { "sm3_many", Sm3Many, METH_VARARGS, "sm3_many(data, item_size) -> bytes" },
+        { "sm3_from_state", Sm3FromState, METH_VARARGS, "sm3_from_state(state) -> SM3" },
+        { "sm4_ecb_encrypt", Sm4EcbEncrypt, METH_VARARGS, "sm4_ecb_encrypt(key, data) -> bytes" },
+        { "sm4_ecb_decrypt", Sm4EcbDecrypt, METH_VARARGS, "sm4_ecb_decrypt(key, data) -> bytes" },
+        { "sm4_ctr", Sm4Ctr, METH_VARARGS, "sm4_ctr(key, counter, data) -> bytes" },
+        { "sm4_cmac", Sm4Cmac, METH_VARARGS, "sm4_cmac(key, data) -> bytes" },
+        { "sm4_cmac_many", Sm4CmacMany, METH_VARARGS, "sm4_cmac_many(key, data, item_size) -> bytes" },
+        { "sm4_gcm_encrypt", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(Sm4GcmEncrypt)),
+            METH_VARARGS | METH_KEYWORDS, "sm4_gcm_encrypt(key, iv, data, aad=b'', tag_len=16) -> (ciphertext, tag)" },
+        { "sm4_gcm_decrypt", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(Sm4GcmDecrypt)),
+            METH_VARARGS | METH_KEYWORDS, "sm4_gcm_decrypt(key, iv, data, tag, aad=b'') -> bytes" },
+        { "random_bytes", RandomBytes, METH_VARARGS, "random_bytes(n) -> bytes" },
+        { "backend", Backend, METH_NOARGS, "backend() -> str" },
+        { nullptr, nullptr, 0, nullptr }
+    };
+
+    PyModuleDef moduleDef = {
+        PyModuleDef_HEAD_INIT, "gmsm_native", "libgmsm的SM3、SM4、SM4-GCM与SM4-CMAC原生实现", -1, methods
+    };
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_gmsm_native() {
+    if (PyType_Ready(&sm3Type) < 0) {
+        return nullptr;
+    }
+    PyObject* module = PyModule_Create(&moduleDef);
+    if (!module) {
+        return nullptr;
+    }
+    Py_INCREF(&sm3Type);
+    if (PyModule_AddObject(module, "SM3", reinterpret_cast<PyObject*>(&sm3Type)) < 0) {
+        Py_DECREF(&sm3Type);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+libgmsm 的 Python 扩展模块 gmsm_native 的编译脚本
+用法: python setup.py build_ext --inplace
+  或: pip install .（安装后各项目的Python脚本可直接 import gmsm_native）
+"""
+
+import sys
+from setuptools import setup, Extension
+
+if sys.platform == 'win32':
+    extra_compile_args = ['/O2', '/std:c++17']
+else:
+    extra_compile_args = ['-O3', '-std=c++17']
+
+setup(
+    name='gmsm_native',
+    version='1.0',
+    description='SM3/SM4/SM4-GCM/SM4-CMAC原生实现（libgmsm，运行时按CPU选择AVX2与PCLMULQDQ）',
+    ext_modules=[
+        Extension(
+            'gmsm_native',
+            sources=['gmsm_native.cpp', 'gmsm.cpp', 'sm4.cpp', 'sm3.cpp', 'ghash.cpp', 'gcm.cpp',
+                     'gcm_siv.cpp', 'cmac.cpp', 'ccm.cpp', 'ff1.cpp', 'sm4_jit.cpp', 'arena.cpp',
+                     'async.cpp', 'drbg.cpp'],
+            language='c++',
+            extra_compile_args=extra_compile_args,
+        )
+    ],
+)
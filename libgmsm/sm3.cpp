@@ -0,0 +1,370 @@
+﻿#include "gmsm_internal.h"
+#include "gmsm_consts.h"
+#include <cstring>
+
+#if defined(GMSM_X86)
+#include <immintrin.h>
+#endif
+
+namespace gmsm {
+
+    namespace {
+
+        constexpr uint32_t RotlConst(uint32_t x, int n) {
+            return n == 0 ? x : (x << n) | (x >> (32 - n));
+        }
+
+        // 预先循环移位的轮常量 T_j <<< (j mod 32)
+        struct RoundConstants {
+            uint32_t T[64];
+
+            constexpr RoundConstants() : T() {
+                for (int j = 0; j < 64; ++j) {
+                    T[j] = RotlConst(j < 16 ? SM3_T1 : SM3_T2, j % 32);
+                }
+            }
+        };
+
+        constexpr RoundConstants TJ;
+
+        /**
+         * @brief 一轮压缩。不移动8个寄存器，只写回B、D、F、H，
+         * 下一轮以 (D, A, B, C, H, E, F, G) 的顺序调用即可
+         * @tparam EARLY 前16轮使用异或形式的布尔函数
+         */
+        template<bool EARLY>
+        inline void Round(uint32_t A, uint32_t& B, uint32_t C, uint32_t& D, uint32_t E, uint32_t& F, uint32_t G,
+            uint32_t& H, uint32_t Tj, uint32_t Wj, uint32_t W1j) {
+            uint32_t A12 = RotateLeft(A, 12);
+            uint32_t SS1 = RotateLeft(A12 + E + Tj, 7);
+            uint32_t SS2 = SS1 ^ A12;
+            uint32_t FF = EARLY ? (A ^ B ^ C) : ((A & B) | (A & C) | (B & C));
+            uint32_t GG = EARLY ? (E ^ F ^ G) : ((E & F) | (~E & G));
+            uint32_t TT1 = FF + D + SS2 + W1j;
+            uint32_t TT2 = GG + H + SS1 + Wj;
+            B = RotateLeft(B, 9);
+            D = TT1;
+            F = RotateLeft(F, 19);
+            H = TT2 ^ RotateLeft(TT2, 9) ^ RotateLeft(TT2, 17);  // P0置换
+        }
+
+        template<bool EARLY>
+        inline void FourRounds(uint32_t& A, uint32_t& B, uint32_t& C, uint32_t& D, uint32_t& E, uint32_t& F,
+            uint32_t& G, uint32_t& H, const uint32_t W[68], int j) {
+            Round<EARLY>(A, B, C, D, E, F, G, H, TJ.T[j], W[j], W[j] ^ W[j + 4]);
+            Round<EARLY>(D, A, B, C, H, E, F, G, TJ.T[j + 1], W[j + 1], W[j + 1] ^ W[j + 5]);
+            Round<EARLY>(C, D, A, B, G, H, E, F, TJ.T[j + 2], W[j + 2], W[j + 2] ^ W[j + 6]);
+            Round<EARLY>(B, C, D, A, F, G, H, E, TJ.T[j + 3], W[j + 3], W[j + 3] ^ W[j + 7]);
+        }
+
+        /**
+         * @brief SM3单块压缩函数（GM/T 0004-2012 第5.3节）
+         * @param h 8个32位状态寄存器（输入/输出）
+         * @param data 512位输入消息块
+         */
+        void Sm3CompressBlock(uint32_t h[8], const uint8_t* data) {
+            uint32_t W[68];  // 扩展消息字（W0-W67），W'_j = W_j ^ W_{j+4} 在轮中现算
+
+            for (int i = 0; i < 16; ++i) {
+                W[i] = LoadBE32(data + 4 * i);
+            }
+            // P1置换生成W16-W67
+            for (int i = 16; i < 68; ++i) {
+                uint32_t tmp = W[i - 16] ^ W[i - 9] ^ RotateLeft(W[i - 3], 15);
+                W[i] = tmp ^ RotateLeft(tmp, 15) ^ RotateLeft(tmp, 23) ^ RotateLeft(W[i - 13], 7) ^ W[i - 6];
+            }
+
+            uint32_t A = h[0], B = h[1], C = h[2], D = h[3];
+            uint32_t E = h[4], F = h[5], G = h[6], H = h[7];
+
+            // 每4轮寄存器的角色恰好转回原位
+            for (int j = 0; j < 16; j += 4) {
+                FourRounds<true>(A, B, C, D, E, F, G, H, W, j);
+            }
+            for (int j = 16; j < 64; j += 4) {
+                FourRounds<false>(A, B, C, D, E, F, G, H, W, j);
+            }
+
+            h[0] ^= A; h[1] ^= B; h[2] ^= C; h[3] ^= D;
+            h[4] ^= E; h[5] ^= F; h[6] ^= G; h[7] ^= H;
+        }
+
+#if defined(GMSM_X86)
+        template<int N>
+        GMSM_TARGET("avx2") inline __m256i Rotl8(__m256i x) {
+            return _mm256_or_si256(_mm256_slli_epi32(x, N), _mm256_srli_epi32(x, 32 - N));
+        }
+
+        /**
+         * @brief 8个通道各压缩一个分组（多缓冲）：S[i][lane]为第lane条消息的第i个状态字
+         */
+        GMSM_TARGET("avx2") void Sm3CompressAvx2x8(uint32_t S[8][8], const uint8_t* const blocks[8]) {
+            const __m256i BSWAP = _mm256_setr_epi8(
+                3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            __m256i W[68];
+
+            // 每个通道一次载入8个字，8x8转置成W[i]为各通道的第i个字
+            for (int half = 0; half < 2; ++half) {
+                __m256i r[8], t[8], u[8];
+                for (int k = 0; k < 8; ++k) {
+                    r[k] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blocks[k] + 32 * half));
+                }
+                for (int k = 0; k < 8; k += 2) {
+                    t[k] = _mm256_unpacklo_epi32(r[k], r[k + 1]);
+                    t[k + 1] = _mm256_unpackhi_epi32(r[k], r[k + 1]);
+                }
+                for (int k = 0; k < 8; k += 4) {
+                    u[k] = _mm256_unpacklo_epi64(t[k], t[k + 2]);
+                    u[k + 1] = _mm256_unpackhi_epi64(t[k], t[k + 2]);
+                    u[k + 2] = _mm256_unpacklo_epi64(t[k + 1], t[k + 3]);
+                    u[k + 3] = _mm256_unpackhi_epi64(t[k + 1], t[k + 3]);
+                }
+                __m256i* w = W + 8 * half;
+                for (int k = 0; k < 4; ++k) {
+                    w[k] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[k], u[k + 4], 0x20), BSWAP);
+                    w[k + 4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(u[k], u[k + 4], 0x31), BSWAP);
+                }
+            }
+            for (int i = 16; i < 68; ++i) {
+                __m256i tmp = _mm256_xor_si256(_mm256_xor_si256(W[i - 16], W[i - 9]), Rotl8<15>(W[i - 3]));
+                tmp = _mm256_xor_si256(_mm256_xor_si256(tmp, Rotl8<15>(tmp)), Rotl8<23>(tmp));
+                W[i] = _mm256_xor_si256(_mm256_xor_si256(tmp, Rotl8<7>(W[i - 13])), W[i - 6]);
+            }
+
+            __m256i V[8];
+            for (int i = 0; i < 8; ++i) V[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(S[i]));
+            __m256i A = V[0], B = V[1], C = V[2], D = V[3], E = V[4], F = V[5], G = V[6], H = V[7];
+            for (int j = 0; j < 64; ++j) {
+                __m256i A12 = Rotl8<12>(A);
+                __m256i SS1 = Rotl8<7>(_mm256_add_epi32(_mm256_add_epi32(A12, E),
+                    _mm256_set1_epi32(static_cast<int>(TJ.T[j]))));
+                __m256i SS2 = _mm256_xor_si256(SS1, A12);
+                __m256i FF, GG;
+                if (j < 16) {
+                    FF = _mm256_xor_si256(_mm256_xor_si256(A, B), C);
+                    GG = _mm256_xor_si256(_mm256_xor_si256(E, F), G);
+                }
+                else {
+                    FF = _mm256_or_si256(_mm256_and_si256(A, B), _mm256_and_si256(C, _mm256_or_si256(A, B)));
+                    GG = _mm256_or_si256(_mm256_and_si256(E, F), _mm256_andnot_si256(E, G));
+                }
+                __m256i TT1 = _mm256_add_epi32(_mm256_add_epi32(FF, D),
+                    _mm256_add_epi32(SS2, _mm256_xor_si256(W[j], W[j + 4])));
+                __m256i TT2 = _mm256_add_epi32(_mm256_add_epi32(GG, H), _mm256_add_epi32(SS1, W[j]));
+                D = C;
+                C = Rotl8<9>(B);
+                B = A;
+                A = TT1;
+                H = G;
+                G = Rotl8<19>(F);
+                F = E;
+                E = _mm256_xor_si256(_mm256_xor_si256(TT2, Rotl8<9>(TT2)), Rotl8<17>(TT2));
+            }
+            __m256i R[8] = { A, B, C, D, E, F, G, H };
+            for (int i = 0; i < 8; ++i) {
+                _mm256_store_si256(reinterpret_cast<__m256i*>(S[i]), _mm256_xor_si256(V[i], R[i]));
+            }
+        }
+
+        /**
+         * @brief 一个通道上正在处理的消息：先直接读完整分组，再读填充后的1~2个尾部分组
+         */
+        struct Sm3Lane {
+            const uint8_t* data;
+            size_t direct;      // 剩余的完整分组数
+            size_t tailBlocks;  // 剩余的尾部分组数
+            size_t tailPos;
+            size_t job;
+            bool active;
+            uint8_t tail[2 * GMSM_SM3_BLOCK_SIZE];
+        };
+
+        void StartLane(Sm3Lane& lane, uint32_t S[8][8], int k, const void* data, size_t len, size_t job) {
+            lane.data = static_cast<const uint8_t*>(data);
+            lane.direct = len / GMSM_SM3_BLOCK_SIZE;
+            size_t rem = len % GMSM_SM3_BLOCK_SIZE;
+            lane.tailBlocks = rem + 9 <= GMSM_SM3_BLOCK_SIZE ? 1 : 2;
+            lane.tailPos = 0;
+            std::memset(lane.tail, 0, sizeof(lane.tail));
+            if (rem > 0) std::memcpy(lane.tail, lane.data + lane.direct * GMSM_SM3_BLOCK_SIZE, rem);
+            lane.tail[rem] = 0x80;
+            StoreBE64(lane.tail + lane.tailBlocks * GMSM_SM3_BLOCK_SIZE - 8, static_cast<uint64_t>(len) * 8);
+            lane.job = job;
+            lane.active = true;
+            for (int i = 0; i < 8; ++i) S[i][k] = SM3_IV[i];
+        }
+
+        void Sm3BatchAvx2(const void* const* data, const size_t* lens, size_t count, uint8_t* digests) {
+            static const uint8_t ZERO_BLOCK[GMSM_SM3_BLOCK_SIZE] = { 0 };
+            alignas(32) uint32_t S[8][8];
+            Sm3Lane lanes[8];
+            size_t next = 0;
+            int active = 0;
+            for (int k = 0; k < 8; ++k) {
+                lanes[k].active = false;
+                if (next < count) {
+                    StartLane(lanes[k], S, k, data[next], lens[next], next);
+                    ++next;
+                    ++active;
+                }
+            }
+            while (active > 0) {
+                const uint8_t* blocks[8];
+                for (int k = 0; k < 8; ++k) {
+                    Sm3Lane& lane = lanes[k];
+                    if (!lane.active) blocks[k] = ZERO_BLOCK;  // 空通道的结果丢弃
+                    else if (lane.direct > 0) blocks[k] = lane.data;
+                    else blocks[k] = lane.tail + lane.tailPos;
+                }
+                Sm3CompressAvx2x8(S, blocks);
+                for (int k = 0; k < 8; ++k) {
+                    Sm3Lane& lane = lanes[k];
+                    if (!lane.active) continue;
+                    if (lane.direct > 0) {
+                        lane.data += GMSM_SM3_BLOCK_SIZE;
+                        --lane.direct;
+                        continue;
+                    }
+                    lane.tailPos += GMSM_SM3_BLOCK_SIZE;
+                    if (--lane.tailBlocks > 0) continue;
+                    for (int i = 0; i < 8; ++i) StoreBE32(digests + lane.job * GMSM_SM3_DIGEST_SIZE + 4 * i, S[i][k]);
+                    if (next < count) {
+                        StartLane(lane, S, k, data[next], lens[next], next);
+                        ++next;
+                    }
+                    else {
+                        lane.active = false;
+                        --active;
+                    }
+                }
+            }
+        }
+#endif
+
+        // gmsm_sm3_export的格式，见gmsm.h
+        constexpr char SM3_STATE_MAGIC[4] = { 'S', 'M', '3', 'S' };
+        constexpr uint8_t SM3_STATE_VERSION = 1;
+        constexpr size_t SM3_STATE_CHECKED = 120;  // 校验覆盖的前缀长度
+
+    } // namespace
+
+} // namespace gmsm
+
+extern "C" {
+
+    void gmsm_sm3_compress(uint32_t state[8], const uint8_t* data, size_t blocks) {
+        for (size_t i = 0; i < blocks; ++i) {
+            gmsm::Sm3CompressBlock(state, data + i * GMSM_SM3_BLOCK_SIZE);
+        }
+    }
+
+    void gmsm_sm3_init(gmsm_sm3_ctx* ctx) {
+        std::memcpy(ctx->state, gmsm::SM3_IV, sizeof(ctx->state));
+        ctx->length = 0;
+        ctx->used = 0;
+    }
+
+    void gmsm_sm3_update(gmsm_sm3_ctx* ctx, const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        ctx->length += len;
+
+        // 先补满缓冲区中的残留分组
+        if (ctx->used > 0) {
+            size_t take = GMSM_SM3_BLOCK_SIZE - ctx->used;
+            if (take > len) take = len;
+            std::memcpy(ctx->buffer + ctx->used, p, take);
+            ctx->used += static_cast<uint32_t>(take);
+            p += take;
+            len -= take;
+            if (ctx->used < GMSM_SM3_BLOCK_SIZE) return;
+            gmsm_sm3_compress(ctx->state, ctx->buffer, 1);
+            ctx->used = 0;
+        }
+
+        size_t blocks = len / GMSM_SM3_BLOCK_SIZE;
+        gmsm_sm3_compress(ctx->state, p, blocks);
+        p += blocks * GMSM_SM3_BLOCK_SIZE;
+        len -= blocks * GMSM_SM3_BLOCK_SIZE;
+
+        std::memcpy(ctx->buffer, p, len);
+        ctx->used = static_cast<uint32_t>(len);
+    }
+
+    void gmsm_sm3_final(gmsm_sm3_ctx* ctx, uint8_t digest[GMSM_SM3_DIGEST_SIZE]) {
+        // 填充：0x80，补0至56 mod 64字节，最后是64位大端比特长度
+        const uint64_t bitLen = ctx->length * 8;
+        ctx->buffer[ctx->used++] = 0x80;
+        if (ctx->used > GMSM_SM3_BLOCK_SIZE - 8) {
+            std::memset(ctx->buffer + ctx->used, 0, GMSM_SM3_BLOCK_SIZE - ctx->used);
+            gmsm_sm3_compress(ctx->state, ctx->buffer, 1);
+            ctx->used = 0;
+        }
+        std::memset(ctx->buffer + ctx->used, 0, GMSM_SM3_BLOCK_SIZE - 8 - ctx->used);
+        gmsm::StoreBE64(ctx->buffer + GMSM_SM3_BLOCK_SIZE - 8, bitLen);
+        gmsm_sm3_compress(ctx->state, ctx->buffer, 1);
+
+        for (int i = 0; i < 8; ++i) {
+            gmsm::StoreBE32(digest + 4 * i, ctx->state[i]);
+        }
+        gmsm_sm3_init(ctx);
+    }
+
+    void gmsm_sm3_export(const gmsm_sm3_ctx* ctx, uint8_t out[GMSM_SM3_STATE_SIZE]) {
+        std::memset(out, 0, GMSM_SM3_STATE_SIZE);
+        std::memcpy(out, gmsm::SM3_STATE_MAGIC, sizeof(gmsm::SM3_STATE_MAGIC));
+        out[4] = gmsm::SM3_STATE_VERSION;
+        for (int i = 0; i < 8; ++i) {
+            gmsm::StoreBE32(out + 8 + 4 * i, ctx->state[i]);
+        }
+        gmsm::StoreBE64(out + 40, ctx->length);
+        gmsm::StoreBE32(out + 48, ctx->used);
+        std::memcpy(out + 56, ctx->buffer, ctx->used);
+
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+        gmsm_sm3(out, gmsm::SM3_STATE_CHECKED, digest);
+        std::memcpy(out + gmsm::SM3_STATE_CHECKED, digest, GMSM_SM3_STATE_SIZE - gmsm::SM3_STATE_CHECKED);
+    }
+
+    int gmsm_sm3_import(gmsm_sm3_ctx* ctx, const uint8_t in[GMSM_SM3_STATE_SIZE]) {
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+        gmsm_sm3(in, gmsm::SM3_STATE_CHECKED, digest);
+        if (std::memcmp(in, gmsm::SM3_STATE_MAGIC, sizeof(gmsm::SM3_STATE_MAGIC)) != 0 || in[4] != gmsm::SM3_STATE_VERSION ||
+            std::memcmp(in + gmsm::SM3_STATE_CHECKED, digest, GMSM_SM3_STATE_SIZE - gmsm::SM3_STATE_CHECKED) != 0) {
+            return GMSM_ERR_PARAM;
+        }
+        // 缓冲区字节数必须等于总长度除以分组长度的余数
+        const uint64_t length = gmsm::LoadBE64(in + 40);
+        const uint32_t used = gmsm::LoadBE32(in + 48);
+        if (used >= GMSM_SM3_BLOCK_SIZE || length % GMSM_SM3_BLOCK_SIZE != used) {
+            return GMSM_ERR_PARAM;
+        }
+        for (int i = 0; i < 8; ++i) {
+            ctx->state[i] = gmsm::LoadBE32(in + 8 + 4 * i);
+        }
+        ctx->length = length;
+        ctx->used = used;
+        std::memcpy(ctx->buffer, in + 56, used);
+        return GMSM_OK;
+    }
+
+    void gmsm_sm3(const void* data, size_t len, uint8_t digest[GMSM_SM3_DIGEST_SIZE]) {
+        gmsm_sm3_ctx ctx;
+        gmsm_sm3_init(&ctx);
+        gmsm_sm3_update(&ctx, data, len);
+        gmsm_sm3_final(&ctx, digest);
+    }
+
+    void gmsm_sm3_batch(const void* const* data, const size_t* lens, size_t count, uint8_t* digests) {
+#if defined(GMSM_X86)
+        if (count > 1 && (gmsm::CpuFeatures() & GMSM_CPU_AVX2)) {
+            gmsm::Sm3BatchAvx2(data, lens, count, digests);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; ++i) {
+            gmsm_sm3(data[i], lens[i], digests + i * GMSM_SM3_DIGEST_SIZE);
+        }
+    }
+
+} // extern "C"
@@ -0,0 +1,757 @@
+﻿#ifndef GMSM_SM4_ENGINE_H
+#define GMSM_SM4_ENGINE_H
+
+#include "gmsm_internal.h"
+#include <algorithm>
+#include <cstring>
+
+// SM4工作模式的编译期组合：模式只写一次，按后端实例化（库内部使用）
+
+namespace gmsm {
+
+    /*
+     * 后端约定：
+     *   using Key;                      轮密钥的表示（通常为const uint32_t*）
+     *   static constexpr size_t LANES;  一次调用最适合处理的分组数（并行宽度）
+     *   static void Blocks(Key rk, const uint8_t* in, uint8_t* out, size_t blocks);
+     * Blocks为直接调用，in与out可以相同。GCM需要轮密钥本身，只适用于Key为const uint32_t*的后端
+     */
+
+    struct Sm4ReferenceBackend {
+        using Key = const uint32_t*;
+        static constexpr size_t LANES = 1;
+        static void Blocks(const uint32_t rk[32], const uint8_t* in, uint8_t* out, size_t blocks) {
+            Sm4BlocksReference(rk, in, out, blocks);
+        }
+    };
+
+    struct Sm4TTableBackend {
+        using Key = const uint32_t*;
+        static constexpr size_t LANES = 4;
+        static void Blocks(const uint32_t rk[32], const uint8_t* in, uint8_t* out, size_t blocks) {
+            Sm4BlocksTTable(rk, in, out, blocks);
+        }
+    };
+
+#if defined(GMSM_X86)
+    struct Sm4Avx2Backend {
+        using Key = const uint32_t*;
+        // 每次两组8路：摊薄每次调用准备常量与转置的开销
+        static constexpr size_t LANES = 16;
+        static void Blocks(const uint32_t rk[32], const uint8_t* in, uint8_t* out, size_t blocks) {
+            Sm4BlocksAvx2(rk, in, out, blocks);
+        }
+    };
+#endif
+
+    /**
+     * @brief 密钥特化的JIT内核（sm4_jit.cpp），Key为gmsm_sm4_jit_acquire返回的句柄
+     */
+    struct Sm4JitBackend {
+        using Key = const gmsm_sm4_jit*;
+        static constexpr size_t LANES = 16;
+        static void Blocks(Key jit, const uint8_t* in, uint8_t* out, size_t blocks) {
+            Sm4JitBlocks(jit, in, out, blocks);
+        }
+    };
+
+    /**
+     * @brief SM4工作模式
+     * @tparam Backend 分组变换的后端
+     * @tparam Lanes 每次交给后端的分组数；主循环按这个编译期常量展开，尾部不足Lanes的分组单独处理
+     */
+    template<class Backend, size_t Lanes = Backend::LANES>
+    class Sm4Engine {
+        static_assert(Lanes > 0, "Lanes必须大于0");
+        static constexpr size_t CHUNK = Lanes * 16;
+        // GcmBatch每次交给后端的分组数上限
+        static constexpr size_t BATCH_BLOCKS = 256;
+        // CcmBatch同时推进的消息数：每条消息每步送一个MAC分组和至多一个计数器分组
+        static constexpr size_t CCM_CHAINS = Lanes > 1 ? Lanes / 2 : 1;
+        static constexpr size_t CCM_NONE = SIZE_MAX;
+
+    public:
+        using Key = typename Backend::Key;
+
+        static void Ecb(Key rk, const uint8_t* in, uint8_t* out, size_t blocks) {
+            Backend::Blocks(rk, in, out, blocks);
+        }
+
+        /**
+         * @brief 计数器模式，in与out可以相同
+         * @param inc32 为true时只递增计数器的低32位（GCM的inc32），否则按128位递增
+         */
+        static void Ctr(Key rk, uint8_t counter[16], const uint8_t* in, uint8_t* out, size_t len,
+            bool inc32) {
+            uint64_t hi = LoadBE64(counter), lo = LoadBE64(counter + 8);
+            for (; len >= CHUNK; in += CHUNK, out += CHUNK, len -= CHUNK) {
+                CtrRun(rk, hi, lo, inc32, in, out, Lanes, CHUNK);
+            }
+            if (len > 0) {
+                CtrRun(rk, hi, lo, inc32, in, out, (len + 15) / 16, len);
+            }
+            StoreBE64(counter, hi);
+            StoreBE64(counter + 8, lo);
+        }
+
+        /**
+         * @brief CBC加密（逐分组串行），iv返回时为最后一个密文分组
+         */
+        static void CbcEncrypt(Key rk, uint8_t iv[16], const uint8_t* in, uint8_t* out,
+            size_t blocks) {
+            uint8_t x[16];
+            for (size_t b = 0; b < blocks; ++b, in += 16, out += 16) {
+                for (int i = 0; i < 16; ++i) x[i] = static_cast<uint8_t>(in[i] ^ iv[i]);
+                Backend::Blocks(rk, x, out, 1);
+                std::memcpy(iv, out, 16);
+            }
+        }
+
+        /**
+         * @brief CBC解密（Lanes个分组并行），rk为解密轮密钥，in与out可以相同
+         */
+        static void CbcDecrypt(Key rk, uint8_t iv[16], const uint8_t* in, uint8_t* out,
+            size_t blocks) {
+            for (; blocks >= Lanes; in += CHUNK, out += CHUNK, blocks -= Lanes) {
+                CbcDecryptRun(rk, iv, in, out, Lanes);
+            }
+            if (blocks > 0) {
+                CbcDecryptRun(rk, iv, in, out, blocks);
+            }
+        }
+
+        /**
+         * @brief XTS（IEEE P1619），len >= 16，不是16的倍数时用密文挪用
+         * @param dataRk 数据密钥的轮密钥（加密时为加密轮密钥，解密时为解密轮密钥）
+         * @param tweakRk 调整值密钥的加密轮密钥
+         * @param decrypt 解密时最后两个分组的调整值使用顺序相反
+         */
+        static void Xts(Key dataRk, Key tweakRk, const uint8_t iv[16],
+            const uint8_t* in, uint8_t* out, size_t len, bool decrypt) {
+            uint8_t T[16];
+            Backend::Blocks(tweakRk, iv, T, 1);
+
+            const size_t full = len / 16, rem = len % 16;
+            const size_t bulk = rem == 0 ? full : full - 1;
+            size_t b = 0;
+            for (; b + Lanes <= bulk; b += Lanes) {
+                XtsRun(dataRk, T, in + 16 * b, out + 16 * b, Lanes);
+            }
+            if (b < bulk) {
+                XtsRun(dataRk, T, in + 16 * b, out + 16 * b, bulk - b);
+            }
+            if (rem == 0) return;
+
+            // 密文挪用：最后一个完整分组与末尾的rem字节
+            const uint8_t* lastIn = in + 16 * bulk;
+            uint8_t* lastOut = out + 16 * bulk;
+            uint8_t Tm[16], cc[16], pp[16];
+            std::memcpy(Tm, T, 16);
+            MulAlpha(Tm);
+            XtsRun(dataRk, decrypt ? Tm : T, lastIn, cc, 1);
+            std::memcpy(pp, lastIn + 16, rem);
+            std::memcpy(pp + rem, cc + rem, 16 - rem);
+            std::memcpy(lastOut + 16, cc, rem);
+            XtsRun(dataRk, decrypt ? T : Tm, pp, lastOut, 1);
+        }
+
+        /**
+         * @brief GCM加密：CTR加密后计算完整的16字节标签
+         */
+        static void GcmEncrypt(const gmsm_gcm_key& key, const uint8_t* iv, size_t ivLen,
+            const uint8_t* aad, size_t aadLen, const uint8_t* in, size_t len, uint8_t* out, uint8_t tag[16]) {
+            uint8_t J0[16], counter[16];
+            DeriveJ0(key, iv, ivLen, J0);
+            FirstCounter(J0, counter);
+            Ctr(key.sm4.rk, counter, in, out, len, true);
+            ComputeTag(key, J0, aad, aadLen, out, len, tag);
+        }
+
+        /**
+         * @brief GCM解密：先验证前tagLen字节的标签，失败时返回false且不写out
+         */
+        static bool GcmDecrypt(const gmsm_gcm_key& key, const uint8_t* iv, size_t ivLen,
+            const uint8_t* aad, size_t aadLen, const uint8_t* in, size_t len, uint8_t* out,
+            const uint8_t* tag, size_t tagLen) {
+            uint8_t J0[16], counter[16], full[16];
+            DeriveJ0(key, iv, ivLen, J0);
+            ComputeTag(key, J0, aad, aadLen, in, len, full);
+            if (!ConstantTimeEqual(full, tag, tagLen)) return false;
+
+            FirstCounter(J0, counter);
+            Ctr(key.sm4.rk, counter, in, out, len, true);
+            return true;
+        }
+
+        /**
+         * @brief GCM-SIV加密（RFC 8452的结构，分组密码为SM4）：由主密钥与nonce派生本条消息的认证密钥和加密密钥，
+         *        标签（合成IV）= E(POLYVAL(AAD, 明文, 长度) xor nonce)，再以标签为初始计数器做CTR。in与out可以相同
+         */
+        static void GcmSivEncrypt(Key rk, const uint8_t nonce[12], const uint8_t* aad, size_t aadLen,
+            const uint8_t* in, size_t len, uint8_t* out, uint8_t tag[16]) {
+            uint64_t polyval[GHASH_TABLE_WORDS];
+            uint32_t encRk[32];
+            GcmSivDeriveKeys(rk, nonce, polyval, encRk);
+            GcmSivTag(polyval, encRk, nonce, aad, aadLen, in, len, tag);
+            GcmSivCtr(encRk, tag, in, out, len);
+        }
+
+        /**
+         * @brief GCM-SIV解密：先解密再按明文重算标签，不匹配时把out清零并返回false
+         */
+        static bool GcmSivDecrypt(Key rk, const uint8_t nonce[12], const uint8_t* aad, size_t aadLen,
+            const uint8_t* in, size_t len, uint8_t* out, const uint8_t tag[16]) {
+            uint64_t polyval[GHASH_TABLE_WORDS];
+            uint32_t encRk[32];
+            uint8_t counter[16], expected[16];
+            std::memcpy(counter, tag, 16);  // tag可能与out重叠
+            GcmSivDeriveKeys(rk, nonce, polyval, encRk);
+            GcmSivCtr(encRk, counter, in, out, len);
+            GcmSivTag(polyval, encRk, nonce, aad, aadLen, out, len, expected);
+            if (ConstantTimeEqual(expected, counter, 16)) return true;
+            if (len > 0) std::memset(out, 0, len);
+            return false;
+        }
+
+        /**
+         * @brief 同一密钥下的一批消息：各条消息的J0与计数器分组拼在一起，攒满BATCH_BLOCKS个分组
+         *        调用一次后端，再逐条异或并计算标签。短消息因此也能填满并行通道。
+         *        只处理status为GMSM_OK的条目；超过BATCH_BLOCKS / 2个分组的消息单独处理
+         */
+        static void GcmBatch(const gmsm_gcm_key& key, gmsm_gcm_batch_item* items, size_t count, bool decrypt) {
+            uint8_t stream[16 * BATCH_BLOCKS];
+            gmsm_gcm_batch_item* pending[BATCH_BLOCKS];
+            size_t np = 0, used = 0;
+            for (size_t i = 0; i < count; ++i) {
+                gmsm_gcm_batch_item& item = items[i];
+                if (item.status != GMSM_OK) continue;
+                const size_t need = 1 + (item.len + 15) / 16;
+                if (need > BATCH_BLOCKS / 2) {
+                    GcmOne(key, item, decrypt);
+                    continue;
+                }
+                if (used + need > BATCH_BLOCKS) {
+                    GcmFlush(key, stream, used, pending, np, decrypt);
+                    np = used = 0;
+                }
+                uint8_t* s = stream + 16 * used;
+                DeriveJ0(key, item.iv, item.iv_len, s);
+                const uint32_t j0 = LoadBE32(s + 12);
+                for (size_t b = 1; b < need; ++b) {
+                    std::memcpy(s + 16 * b, s, 12);
+                    StoreBE32(s + 16 * b + 12, j0 + static_cast<uint32_t>(b));
+                }
+                pending[np++] = &item;
+                used += need;
+            }
+            if (np > 0) GcmFlush(key, stream, used, pending, np, decrypt);
+        }
+
+        /**
+         * @brief 同一密钥下count条消息的CMAC（NIST SP 800-38B）或CBC-MAC，MAC依次写入macs（count * 16字节）。
+         *        CBC链在一条消息内只能串行，这里让最多Lanes条消息的链交错推进：每步各取一个分组拼在一起
+         *        调用一次后端，某条消息算完后立即换入下一条，长度不同也能填满并行通道
+         * @param k1 k2 CMAC子密钥；均为nullptr时计算原始CBC-MAC，此时各消息长度须为16的正整数倍（由调用方检查）
+         * @param ivs 各消息的起始链值（count * 16字节），nullptr为全0；CBC-MAC(X || M)即以CIPH(X)为起始链值算M
+         */
+        static void CmacBatch(Key rk, const uint8_t* k1, const uint8_t* k2, const uint8_t* ivs,
+            const void* const* data, const size_t* lens, size_t count, uint8_t* macs) {
+            CmacChain chains[Lanes];
+            uint8_t state[CHUNK], x[CHUNK];
+            size_t next = 0, active = 0;
+            for (; active < Lanes && next < count; ++active, ++next) {
+                CmacStart(chains[active], state + 16 * active, k1, k2, ivs, data[next], lens[next], next);
+            }
+            while (active > 0) {
+                for (size_t k = 0; k < active; ++k) {
+                    const uint8_t* m = chains[k].direct > 0 ? chains[k].data : chains[k].last;
+                    for (int i = 0; i < 16; ++i) x[16 * k + i] = static_cast<uint8_t>(state[16 * k + i] ^ m[i]);
+                }
+                Backend::Blocks(rk, x, state, active);
+                for (size_t k = 0; k < active;) {
+                    CmacChain& c = chains[k];
+                    if (c.direct > 0) {
+                        c.data += 16;
+                        --c.direct;
+                        ++k;
+                        continue;
+                    }
+                    std::memcpy(macs + 16 * c.job, state + 16 * k, 16);
+                    if (next < count) {
+                        CmacStart(c, state + 16 * k, k1, k2, ivs, data[next], lens[next], next);
+                        ++next;
+                        ++k;
+                        continue;
+                    }
+                    // 没有新消息：把最后一条链挪到这里，保持活动的链连续；挪来的链本轮尚未推进，k不变
+                    if (k != --active) {
+                        c = chains[active];
+                        std::memmove(state + 16 * k, state + 16 * active, 16);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief 同一密钥下一批消息的CCM（NIST SP 800-38C）。CBC-MAC链在一条消息内只能串行，这里把它与
+         *        CTR放进同一次后端调用：每条消息每步送一个MAC分组和至多一个计数器分组，最多CCM_CHAINS条
+         *        消息交错推进，CTR的分组填在MAC链留下的空位里。加密时数据分组的计数器与它的MAC分组在同一步
+         *        （先读明文再写密文，支持原地）；解密时计数器提前一步以上，MAC读到的总是已写好的明文。
+         *        只处理status为GMSM_OK的条目；解密标签不匹配时把out清零并置GMSM_ERR_AUTH
+         */
+        static void CcmBatch(Key rk, gmsm_ccm_batch_item* items, size_t count, bool decrypt) {
+            CcmChain chains[CCM_CHAINS];
+            uint8_t x[32 * CCM_CHAINS];
+            size_t next = NextCcmItem(items, count, 0), active = 0;
+            for (; active < CCM_CHAINS && next < count; ++active) {
+                CcmStart(chains[active], items[next]);
+                next = NextCcmItem(items, count, next + 1);
+            }
+            while (active > 0) {
+                size_t n = 0;
+                for (size_t k = 0; k < active; ++k) {
+                    CcmChain& c = chains[k];
+                    c.slot = n++;
+                    uint8_t* m = x + 16 * c.slot;
+                    CcmMacBlock(c, decrypt, m);
+                    for (int i = 0; i < 16; ++i) m[i] ^= c.Y[i];
+                    c.ctr = CcmCounterAt(c, decrypt);
+                    if (c.ctr != CCM_NONE) CcmCounter(c, c.ctr, x + 16 * n++);
+                }
+                Backend::Blocks(rk, x, x, n);
+                for (size_t k = 0; k < active;) {
+                    CcmChain& c = chains[k];
+                    CcmAdvance(c, x + 16 * c.slot);
+                    if (++c.step < c.steps) {
+                        ++k;
+                        continue;
+                    }
+                    CcmFinish(c, decrypt);
+                    if (next < count) {
+                        CcmStart(c, items[next]);
+                        next = NextCcmItem(items, count, next + 1);
+                        ++k;
+                        continue;
+                    }
+                    // 没有新消息：把最后一条链挪到这里；挪来的链本步的输出还没取，k不变
+                    if (k != --active) c = chains[active];
+                }
+            }
+        }
+
+    private:
+        /**
+         * @brief 一条正在计算的CMAC链：先直接读最后一个分组之前的分组，再读已处理好的最后一个分组
+         */
+        struct CmacChain {
+            const uint8_t* data;
+            size_t direct;      // 最后一个分组之前剩余的分组数
+            size_t job;
+            uint8_t last[16];   // CMAC：完整时异或K1，否则补10...0后异或K2；CBC-MAC：原样
+        };
+
+        static void CmacStart(CmacChain& c, uint8_t state[16], const uint8_t* k1, const uint8_t* k2,
+            const uint8_t* ivs, const void* data, size_t len, size_t job) {
+            const size_t blocks = len == 0 ? 1 : (len + 15) / 16;
+            const size_t rem = len - 16 * (blocks - 1);
+            c.data = static_cast<const uint8_t*>(data);
+            c.direct = blocks - 1;
+            c.job = job;
+            std::memset(c.last, 0, 16);
+            if (rem > 0) std::memcpy(c.last, c.data + 16 * (blocks - 1), rem);
+            if (k1 != nullptr) {
+                const uint8_t* k = rem == 16 ? k1 : k2;
+                if (rem < 16) c.last[rem] = 0x80;
+                for (int i = 0; i < 16; ++i) c.last[i] ^= k[i];
+            }
+            if (ivs != nullptr) std::memcpy(state, ivs + 16 * job, 16);
+            else std::memset(state, 0, 16);
+        }
+
+        /**
+         * @brief 一条正在计算的CCM消息。MAC的输入依次为B0、AAD部分（长度编码 || AAD，补0到整分组）、
+         *        明文（补0到整分组），共steps个分组，第step步处理第step个
+         */
+        struct CcmChain {
+            gmsm_ccm_batch_item* item;
+            size_t step, steps;
+            size_t aadBlocks, payloadBlocks;
+            size_t slot;            // 本步MAC分组在拼接缓冲区中的位置，计数器分组（若有）紧随其后
+            size_t ctr;             // 本步的计数器序号，CCM_NONE为本步没有
+            size_t prefixLen;
+            uint8_t prefix[10];     // AAD长度的编码：2、6或10字节
+            uint8_t Y[16];          // CBC-MAC链值
+            uint8_t S0[16];         // E(Ctr0)，与最终链值异或得到标签
+            uint8_t counter[16];    // 计数器分组的模板：flags || nonce || 0
+        };
+
+        static size_t NextCcmItem(const gmsm_ccm_batch_item* items, size_t count, size_t from) {
+            while (from < count && items[from].status != GMSM_OK) ++from;
+            return from;
+        }
+
+        static void CcmStart(CcmChain& c, gmsm_ccm_batch_item& item) {
+            const size_t q = 15 - item.nonce_len;
+            c.item = &item;
+            c.step = 0;
+            c.payloadBlocks = (item.len + 15) / 16;
+            c.prefixLen = 0;
+            c.aadBlocks = 0;
+            if (item.aad_len > 0) {
+                const uint64_t a = item.aad_len;
+                if (a < 0xFF00) {
+                    c.prefix[0] = static_cast<uint8_t>(a >> 8);
+                    c.prefix[1] = static_cast<uint8_t>(a);
+                    c.prefixLen = 2;
+                }
+                else if (a <= 0xFFFFFFFFULL) {
+                    c.prefix[0] = 0xFF;
+                    c.prefix[1] = 0xFE;
+                    StoreBE32(c.prefix + 2, static_cast<uint32_t>(a));
+                    c.prefixLen = 6;
+                }
+                else {
+                    c.prefix[0] = 0xFF;
+                    c.prefix[1] = 0xFF;
+                    StoreBE64(c.prefix + 2, a);
+                    c.prefixLen = 10;
+                }
+                c.aadBlocks = (c.prefixLen + item.aad_len + 15) / 16;
+            }
+            c.steps = 1 + c.aadBlocks + c.payloadBlocks;
+            std::memset(c.Y, 0, 16);
+            std::memset(c.counter, 0, 16);
+            c.counter[0] = static_cast<uint8_t>(q - 1);
+            std::memcpy(c.counter + 1, item.nonce, item.nonce_len);
+        }
+
+        // 第step个MAC输入分组写入m
+        static void CcmMacBlock(const CcmChain& c, bool decrypt, uint8_t m[16]) {
+            const gmsm_ccm_batch_item& item = *c.item;
+            std::memset(m, 0, 16);
+            if (c.step == 0) {
+                // B0 = flags || nonce || [len]_q，flags = Adata·64 + ((t-2)/2)·8 + (q-1)
+                const size_t q = 15 - item.nonce_len;
+                m[0] = static_cast<uint8_t>((item.aad_len > 0 ? 0x40 : 0) | ((item.tag_len - 2) / 2) << 3 | (q - 1));
+                std::memcpy(m + 1, item.nonce, item.nonce_len);
+                uint64_t len = item.len;
+                for (size_t i = 15; i > item.nonce_len; --i, len >>= 8) m[i] = static_cast<uint8_t>(len);
+                return;
+            }
+            if (c.step <= c.aadBlocks) {
+                size_t pos = 16 * (c.step - 1), i = 0;
+                for (; i < 16 && pos < c.prefixLen; ++i, ++pos) m[i] = c.prefix[pos];
+                const size_t offset = pos - c.prefixLen;
+                const size_t n = offset < item.aad_len ? std::min<size_t>(16 - i, item.aad_len - offset) : 0;
+                if (n > 0) std::memcpy(m + i, item.aad + offset, n);
+                return;
+            }
+            const size_t offset = 16 * (c.step - 1 - c.aadBlocks);
+            std::memcpy(m, (decrypt ? item.out : item.in) + offset, std::min<size_t>(16, item.len - offset));
+        }
+
+        // 本步送入的计数器序号：加密时与对应数据分组的MAC同步，Ctr0放在第一步；
+        // 解密时第j步处理Ctr(j+1)，Ctr0放在最后一步
+        static size_t CcmCounterAt(const CcmChain& c, bool decrypt) {
+            if (decrypt) {
+                if (c.step < c.payloadBlocks) return c.step + 1;
+                return c.step + 1 == c.steps ? 0 : CCM_NONE;
+            }
+            if (c.step == 0) return 0;
+            return c.step > c.aadBlocks ? c.step - c.aadBlocks : CCM_NONE;
+        }
+
+        // Ctr_i = flags || nonce || [i]_q
+        static void CcmCounter(const CcmChain& c, size_t i, uint8_t block[16]) {
+            std::memcpy(block, c.counter, 16);
+            for (size_t b = 15; b > c.item->nonce_len; --b, i >>= 8) block[b] = static_cast<uint8_t>(i);
+        }
+
+        // 取回本步的输出：新的链值，以及计数器分组加密后的密钥流
+        static void CcmAdvance(CcmChain& c, const uint8_t* y) {
+            std::memcpy(c.Y, y, 16);
+            if (c.ctr == CCM_NONE) return;
+            const uint8_t* ks = y + 16;
+            if (c.ctr == 0) {
+                std::memcpy(c.S0, ks, 16);
+                return;
+            }
+            const gmsm_ccm_batch_item& item = *c.item;
+            const size_t offset = 16 * (c.ctr - 1);
+            const size_t n = std::min<size_t>(16, item.len - offset);
+            for (size_t i = 0; i < n; ++i) item.out[offset + i] = static_cast<uint8_t>(item.in[offset + i] ^ ks[i]);
+        }
+
+        static void CcmFinish(const CcmChain& c, bool decrypt) {
+            gmsm_ccm_batch_item& item = *c.item;
+            uint8_t full[16];
+            for (int i = 0; i < 16; ++i) full[i] = static_cast<uint8_t>(c.Y[i] ^ c.S0[i]);
+            if (!decrypt) {
+                std::memcpy(item.tag, full, item.tag_len);
+            }
+            else if (!ConstantTimeEqual(full, item.tag, item.tag_len)) {
+                if (item.len > 0) std::memset(item.out, 0, item.len);
+                item.status = GMSM_ERR_AUTH;
+            }
+        }
+
+        static void GcmOne(const gmsm_gcm_key& key, gmsm_gcm_batch_item& item, bool decrypt) {
+            if (decrypt) {
+                bool ok = GcmDecrypt(key, item.iv, item.iv_len, item.aad, item.aad_len, item.in, item.len,
+                    item.out, item.tag, item.tag_len);
+                item.status = ok ? GMSM_OK : GMSM_ERR_AUTH;
+                return;
+            }
+            uint8_t full[16];
+            GcmEncrypt(key, item.iv, item.iv_len, item.aad, item.aad_len, item.in, item.len, item.out, full);
+            std::memcpy(item.tag, full, item.tag_len);
+        }
+
+        /**
+         * @brief 第i个派生分组为 E(K, [i]_32小端 || nonce)，取前8字节：0、1拼成认证密钥，2、3拼成加密密钥
+         */
+        static void GcmSivDeriveKeys(Key rk, const uint8_t nonce[12], uint64_t polyval[GHASH_TABLE_WORDS],
+            uint32_t encRk[32]) {
+            uint8_t blocks[64] = { 0 };
+            for (int i = 0; i < 4; ++i) {
+                blocks[16 * i] = static_cast<uint8_t>(i);
+                std::memcpy(blocks + 16 * i + 4, nonce, 12);
+            }
+            Backend::Blocks(rk, blocks, blocks, 4);
+            uint8_t authKey[16], encKey[16];
+            std::memcpy(authKey, blocks, 8);
+            std::memcpy(authKey + 8, blocks + 16, 8);
+            std::memcpy(encKey, blocks + 32, 8);
+            std::memcpy(encKey + 8, blocks + 48, 8);
+            PolyvalInit(polyval, authKey);
+            Sm4ExpandKey(encKey, encRk, false);
+        }
+
+        // 标签 = E(encKey, S)，S为POLYVAL(AAD || 明文 || 长度分组)与nonce异或后清掉最高位
+        static void GcmSivTag(const uint64_t polyval[GHASH_TABLE_WORDS], const uint32_t encRk[32],
+            const uint8_t nonce[12], const uint8_t* aad, size_t aadLen, const uint8_t* plain, size_t len,
+            uint8_t tag[16]) {
+            uint8_t S[16] = { 0 };
+            PolyvalUpdate(polyval, S, aad, aadLen);
+            PolyvalUpdate(polyval, S, plain, len);
+            uint8_t lengths[16];
+            uint64_t aadBits = static_cast<uint64_t>(aadLen) * 8, bits = static_cast<uint64_t>(len) * 8;
+            for (int i = 0; i < 8; ++i, aadBits >>= 8, bits >>= 8) {
+                lengths[i] = static_cast<uint8_t>(aadBits);
+                lengths[8 + i] = static_cast<uint8_t>(bits);
+            }
+            PolyvalBlocks(polyval, S, lengths, 1);
+            for (int i = 0; i < 12; ++i) S[i] ^= nonce[i];
+            S[15] &= 0x7F;
+            Backend::Blocks(encRk, S, tag, 1);
+        }
+
+        // GCM-SIV的CTR：初始计数器为标签最高位置1，前4字节按32位小端递增（模2^32）
+        static void GcmSivCtr(const uint32_t encRk[32], const uint8_t tag[16], const uint8_t* in, uint8_t* out,
+            size_t len) {
+            uint8_t stream[CHUNK];
+            uint32_t c = static_cast<uint32_t>(tag[0]) | static_cast<uint32_t>(tag[1]) << 8 |
+                static_cast<uint32_t>(tag[2]) << 16 | static_cast<uint32_t>(tag[3]) << 24;
+            while (len > 0) {
+                const size_t bytes = len < CHUNK ? len : CHUNK;
+                const size_t n = (bytes + 15) / 16;
+                for (size_t b = 0; b < n; ++b, ++c) {
+                    uint8_t* s = stream + 16 * b;
+                    std::memcpy(s, tag, 16);
+                    s[0] = static_cast<uint8_t>(c);
+                    s[1] = static_cast<uint8_t>(c >> 8);
+                    s[2] = static_cast<uint8_t>(c >> 16);
+                    s[3] = static_cast<uint8_t>(c >> 24);
+                    s[15] |= 0x80;
+                }
+                Backend::Blocks(encRk, stream, stream, n);
+                for (size_t i = 0; i < bytes; ++i) out[i] = static_cast<uint8_t>(in[i] ^ stream[i]);
+                in += bytes;
+                out += bytes;
+                len -= bytes;
+            }
+        }
+
+        // stream中依次是每条消息的J0与计数器分组；加密后每条的第一个分组为E(J0)
+        static void GcmFlush(const gmsm_gcm_key& key, uint8_t* stream, size_t used,
+            gmsm_gcm_batch_item* const* pending, size_t np, bool decrypt) {
+            Backend::Blocks(key.sm4.rk, stream, stream, used);
+            const uint8_t* ks = stream;
+            for (size_t i = 0; i < np; ++i) {
+                gmsm_gcm_batch_item& item = *pending[i];
+                uint8_t full[16];
+                if (decrypt) {
+                    GhashAll(key, item.aad, item.aad_len, item.in, item.len, full);
+                    for (int j = 0; j < 16; ++j) full[j] ^= ks[j];
+                    if (!ConstantTimeEqual(full, item.tag, item.tag_len)) {
+                        item.status = GMSM_ERR_AUTH;
+                    }
+                    else {
+                        for (size_t j = 0; j < item.len; ++j) item.out[j] = static_cast<uint8_t>(item.in[j] ^ ks[16 + j]);
+                    }
+                }
+                else {
+                    for (size_t j = 0; j < item.len; ++j) item.out[j] = static_cast<uint8_t>(item.in[j] ^ ks[16 + j]);
+                    GhashAll(key, item.aad, item.aad_len, item.out, item.len, full);
+                    for (size_t j = 0; j < item.tag_len; ++j) item.tag[j] = static_cast<uint8_t>(full[j] ^ ks[j]);
+                }
+                ks += 16 * (1 + (item.len + 15) / 16);
+            }
+        }
+
+        // n个计数器分组一次加密，与in的前bytes字节异或
+        static void CtrRun(Key rk, uint64_t& hi, uint64_t& lo, bool inc32,
+            const uint8_t* in, uint8_t* out, size_t n, size_t bytes) {
+            uint8_t stream[CHUNK];
+            for (size_t b = 0; b < n; ++b) {
+                StoreBE64(stream + 16 * b, hi);
+                StoreBE64(stream + 16 * b + 8, lo);
+                if (inc32) {
+                    lo = (lo & 0xFFFFFFFF00000000ULL) | static_cast<uint32_t>(lo + 1);
+                }
+                else if (++lo == 0) {
+                    ++hi;
+                }
+            }
+            Backend::Blocks(rk, stream, stream, n);
+            for (size_t i = 0; i < bytes; ++i) {
+                out[i] = static_cast<uint8_t>(in[i] ^ stream[i]);
+            }
+        }
+
+        // 先保存密文再解密，支持原地处理
+        static void CbcDecryptRun(Key rk, uint8_t iv[16], const uint8_t* in, uint8_t* out,
+            size_t n) {
+            uint8_t c[CHUNK], p[CHUNK];
+            std::memcpy(c, in, 16 * n);
+            Backend::Blocks(rk, c, p, n);
+            for (int i = 0; i < 16; ++i) out[i] = static_cast<uint8_t>(p[i] ^ iv[i]);
+            for (size_t i = 16; i < 16 * n; ++i) out[i] = static_cast<uint8_t>(p[i] ^ c[i - 16]);
+            std::memcpy(iv, c + 16 * (n - 1), 16);
+        }
+
+        // n个分组：C = E(P xor T) xor T，T每个分组乘一次α
+        static void XtsRun(Key rk, uint8_t T[16], const uint8_t* in, uint8_t* out, size_t n) {
+            uint8_t tweaks[CHUNK], x[CHUNK];
+            for (size_t b = 0; b < n; ++b) {
+                std::memcpy(tweaks + 16 * b, T, 16);
+                MulAlpha(T);
+            }
+            for (size_t i = 0; i < 16 * n; ++i) x[i] = static_cast<uint8_t>(in[i] ^ tweaks[i]);
+            Backend::Blocks(rk, x, x, n);
+            for (size_t i = 0; i < 16 * n; ++i) out[i] = static_cast<uint8_t>(x[i] ^ tweaks[i]);
+        }
+
+        // GF(2^128)中乘α，小端字节序，约简多项式 x^128 + x^7 + x^2 + x + 1
+        static void MulAlpha(uint8_t T[16]) {
+            uint8_t carry = static_cast<uint8_t>(T[15] >> 7);
+            for (int i = 15; i > 0; --i) {
+                T[i] = static_cast<uint8_t>((T[i] << 1) | (T[i - 1] >> 7));
+            }
+            T[0] = static_cast<uint8_t>((T[0] << 1) ^ (0x87 & (0 - carry)));
+        }
+
+        /**
+         * @brief 预计数器块J0：96位IV直接拼接 0^31||1，其余长度取GHASH(IV || 0 || [len(IV)]_64)
+         */
+        static void DeriveJ0(const gmsm_gcm_key& key, const uint8_t* iv, size_t ivLen, uint8_t J0[16]) {
+            if (ivLen == GMSM_GCM_IV_SIZE) {
+                std::memcpy(J0, iv, GMSM_GCM_IV_SIZE);
+                StoreBE32(J0 + 12, 1);
+                return;
+            }
+            std::memset(J0, 0, 16);
+            GhashUpdate(key.ghash, J0, iv, ivLen);
+            uint8_t lengths[16] = { 0 };
+            StoreBE64(lengths + 8, static_cast<uint64_t>(ivLen) * 8);
+            GhashBlocks(key.ghash, J0, lengths, 1);
+        }
+
+        /**
+         * @brief 标签 = E(J0) xor GHASH(A || C || [len(A)]_64 || [len(C)]_64)
+         */
+        static void ComputeTag(const gmsm_gcm_key& key, const uint8_t J0[16], const uint8_t* aad, size_t aadLen,
+            const uint8_t* ciphertext, size_t len, uint8_t tag[16]) {
+            uint8_t S[16];
+            GhashAll(key, aad, aadLen, ciphertext, len, S);
+
+            uint8_t ekj0[16];
+            Backend::Blocks(key.sm4.rk, J0, ekj0, 1);
+            for (int i = 0; i < 16; ++i) tag[i] = static_cast<uint8_t>(S[i] ^ ekj0[i]);
+        }
+
+        // S = GHASH(A || C || [len(A)]_64 || [len(C)]_64)
+        static void GhashAll(const gmsm_gcm_key& key, const uint8_t* aad, size_t aadLen,
+            const uint8_t* ciphertext, size_t len, uint8_t S[16]) {
+            std::memset(S, 0, 16);
+            GhashUpdate(key.ghash, S, aad, aadLen);
+            GhashUpdate(key.ghash, S, ciphertext, len);
+            uint8_t lengths[16];
+            StoreBE64(lengths, static_cast<uint64_t>(aadLen) * 8);
+            StoreBE64(lengths + 8, static_cast<uint64_t>(len) * 8);
+            GhashBlocks(key.ghash, S, lengths, 1);
+        }
+
+        // 第一个数据分组的计数器：inc32(J0)
+        static void FirstCounter(const uint8_t J0[16], uint8_t counter[16]) {
+            std::memcpy(counter, J0, 16);
+            StoreBE32(counter + 12, LoadBE32(J0 + 12) + 1);
+        }
+    };
+
+    constexpr size_t SM4_STREAM_CHUNK = 2048;
+
+    /**
+     * @brief 大缓冲区模式：按SM4_STREAM_CHUNK字节分段，run(src, dst, n)把一段处理到栈上的临时缓冲区
+     *        （始终在L1中），再以非临时存储写到out。out须按16字节对齐（见Sm4UseStreaming）；
+     *        除最后一段外每段都是16的倍数，CTR的计数器因此可以逐段连续
+     */
+    template<class Run>
+    void Sm4Streamed(const uint8_t* in, uint8_t* out, size_t len, Run run) {
+        if ((reinterpret_cast<uintptr_t>(out) & 31) != 0) {
+            // 先普通处理一个分组，使之后的输出按32字节对齐
+            size_t head = len < 16 ? len : 16;
+            run(in, out, head);
+            in += head;
+            out += head;
+            len -= head;
+        }
+        const size_t distance = Sm4PrefetchDistance();
+        alignas(32) uint8_t buf[SM4_STREAM_CHUNK];
+        while (len > 0) {
+            size_t n = len < SM4_STREAM_CHUNK ? len : SM4_STREAM_CHUNK;
+            if (distance != 0 && distance < len) {
+                Sm4PrefetchNta(in + distance, len - distance < n ? len - distance : n);
+            }
+            run(in, buf, n);
+            size_t whole = n & ~size_t(31);
+            Sm4StreamStore(out, buf, whole);
+            std::memcpy(out + whole, buf + whole, n - whole);
+            in += n;
+            out += n;
+            len -= n;
+        }
+        Sm4StreamFence();
+    }
+
+    /**
+     * @brief 按当前选定的实现（gmsm_sm4_set_impl）选择引擎，调用 f(engine)
+     * 分派只发生在这一次switch，模式内部对后端都是直接调用
+     */
+    template<class F>
+    decltype(auto) WithSm4Engine(F&& f) {
+        switch (CurrentSm4Impl()) {
+        case GMSM_SM4_IMPL_REFERENCE:
+            return f(Sm4Engine<Sm4ReferenceBackend>());
+#if defined(GMSM_X86)
+        case GMSM_SM4_IMPL_AVX2:
+            return f(Sm4Engine<Sm4Avx2Backend>());
+#endif
+        default:
+            return f(Sm4Engine<Sm4TTableBackend>());
+        }
+    }
+
+} // namespace gmsm
+
+#endif // GMSM_SM4_ENGINE_H
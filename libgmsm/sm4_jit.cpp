@@ -0,0 +1,479 @@
+﻿#include "gmsm_internal.h"
+#include "gmsm_consts.h"
+#include "sm4_engine.h"
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(GMSM_X86) && !defined(GMSM_NO_JIT)
+#define GMSM_JIT 1
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#endif
+
+/**
+ * @brief JIT句柄：轮密钥、其SM3摘要（缓存键）和生成的内核
+ */
+struct gmsm_sm4_jit {
+    uint32_t rk[32];
+    uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+    gmsm::Sm4JitKernel kernel;  // nullptr时使用通用实现
+    void* code;
+    size_t codeSize;
+    size_t refs;
+    uint64_t lastUse;
+};
+
+namespace gmsm {
+
+    namespace {
+
+#if defined(GMSM_JIT)
+
+        // 寄存器编号（与指令编码一致）
+        enum Gpr { RAX = 0, RCX = 1, RDX = 2, RSP = 4, R8 = 8, R9 = 9, R10 = 10, R11 = 11 };
+
+        /**
+         * @brief 只含本内核用到的指令的x86-64编码器，VEX一律用三字节形式
+         */
+        class Emitter {
+        public:
+            std::vector<uint8_t> code;
+
+            size_t Size() const { return code.size(); }
+
+            void Byte(uint8_t b) { code.push_back(b); }
+
+            void Dword(uint32_t v) {
+                for (int i = 0; i < 4; ++i) Byte(static_cast<uint8_t>(v >> (8 * i)));
+            }
+
+            void PatchDword(size_t pos, uint32_t v) {
+                for (int i = 0; i < 4; ++i) code[pos + i] = static_cast<uint8_t>(v >> (8 * i));
+            }
+
+            // ---------------- 通用寄存器 ----------------
+
+            void MovRR(int dst, int src) {  // mov dst, src（64位）
+                Byte(static_cast<uint8_t>(0x48 | ((src >> 3) << 2) | (dst >> 3)));
+                Byte(0x89);
+                Byte(static_cast<uint8_t>(0xC0 | ((src & 7) << 3) | (dst & 7)));
+            }
+
+            void MovEaxImm(uint32_t imm) {
+                Byte(0xB8);
+                Dword(imm);
+            }
+
+            void AluImm(int ext, int reg, uint32_t imm) {  // add(/0) / sub(/5) reg, imm32
+                Byte(static_cast<uint8_t>(0x48 | (reg >> 3)));
+                Byte(0x81);
+                Byte(static_cast<uint8_t>(0xC0 | (ext << 3) | (reg & 7)));
+                Dword(imm);
+            }
+
+            void Dec(int reg) {
+                Byte(static_cast<uint8_t>(0x48 | (reg >> 3)));
+                Byte(0xFF);
+                Byte(static_cast<uint8_t>(0xC8 | (reg & 7)));
+            }
+
+            void Test(int reg) {
+                Byte(static_cast<uint8_t>(0x48 | ((reg >> 3) << 2) | (reg >> 3)));
+                Byte(0x85);
+                Byte(static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (reg & 7)));
+            }
+
+            size_t Jcc(uint8_t cc) {  // 返回rel32的位置，由Bind回填
+                Byte(0x0F);
+                Byte(cc);
+                Dword(0);
+                return Size() - 4;
+            }
+
+            void Bind(size_t rel, size_t target) {
+                PatchDword(rel, static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(rel + 4)));
+            }
+
+            // ---------------- VEX ----------------
+
+            void Vex(int map, int pp, int L, int reg, int index, int base, int vvvv) {
+                Byte(0xC4);
+                Byte(static_cast<uint8_t>((((~reg >> 3) & 1) << 7) | (((~index >> 3) & 1) << 6) |
+                    (((~base >> 3) & 1) << 5) | map));
+                Byte(static_cast<uint8_t>(((~vvvv & 15) << 3) | (L << 2) | pp));
+            }
+
+            void VexRR(int map, int pp, int L, uint8_t op, int reg, int vvvv, int rm) {
+                Vex(map, pp, L, reg, 0, rm, vvvv);
+                Byte(op);
+                Byte(static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+            }
+
+            void VexMem(int map, int pp, int L, uint8_t op, int reg, int vvvv, int base, int32_t disp) {
+                Vex(map, pp, L, reg, 0, base, vvvv);
+                Byte(op);
+                Byte(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+                if ((base & 7) == RSP) Byte(0x24);
+                Dword(static_cast<uint32_t>(disp));
+            }
+
+            // [rip + disp32]，返回disp32的位置
+            size_t VexRip(int map, int pp, int L, uint8_t op, int reg, int vvvv) {
+                Vex(map, pp, L, reg, 0, 0, vvvv);
+                Byte(op);
+                Byte(static_cast<uint8_t>(((reg & 7) << 3) | 5));
+                Dword(0);
+                return Size() - 4;
+            }
+
+            // 三操作数整数运算：vpxor(EF) vpand(DB) vpcmpeqd(76) vpunpck*(62/6A/6C/6D)
+            void Op3(uint8_t op, int dst, int a, int b) { VexRR(1, 1, 1, op, dst, a, b); }
+
+            void Psrld(int dst, int src, uint8_t imm) {  // VEX.256.66.0F 72 /2 ib
+                VexRR(1, 1, 1, 0x72, 2, dst, src);
+                Byte(imm);
+            }
+
+            void Perm2i128(int dst, int a, int b, uint8_t imm) {
+                VexRR(3, 1, 1, 0x46, dst, a, b);
+                Byte(imm);
+            }
+
+            void MovdXmmEax(int dst) { VexRR(1, 1, 0, 0x6E, dst, 0, RAX); }
+
+            void Broadcastd(int dst, int src) { VexRR(2, 1, 1, 0x58, dst, 0, src); }
+
+            void LoadU(int dst, int base, int32_t disp, int L = 1) { VexMem(1, 2, L, 0x6F, dst, 0, base, disp); }
+
+            void StoreU(int src, int base, int32_t disp, int L = 1) { VexMem(1, 2, L, 0x7F, src, 0, base, disp); }
+
+            // vpgatherdd dst, [base + idx*4 + disp32], mask
+            void Gatherdd(int dst, int base, int idx, int32_t disp, int mask) {
+                Vex(2, 1, 1, dst, idx, base, mask);
+                Byte(0x90);
+                Byte(static_cast<uint8_t>(0x80 | ((dst & 7) << 3) | 4));
+                Byte(static_cast<uint8_t>((2 << 6) | ((idx & 7) << 3) | (base & 7)));
+                Dword(static_cast<uint32_t>(disp));
+            }
+
+            void Vzeroupper() {
+                Byte(0xC5);
+                Byte(0xF8);
+                Byte(0x77);
+            }
+
+            void Ret() { Byte(0xC3); }
+        };
+
+        constexpr uint8_t VPXOR = 0xEF, VPAND = 0xDB, VPCMPEQD = 0x76;
+        constexpr uint8_t UNPCKLDQ = 0x62, UNPCKHDQ = 0x6A, UNPCKLQDQ = 0x6C, UNPCKHQDQ = 0x6D;
+
+#if defined(_WIN32)
+        constexpr bool WIN64_ABI = true;
+#else
+        constexpr bool WIN64_ABI = false;
+#endif
+        // Win64下xmm6~xmm15为被调用者保存
+        constexpr int32_t WIN64_FRAME = 10 * 16 + 8;
+
+        /**
+         * @brief 生成密钥特化的内核 void(in, out, groups, tables)，每组8个分组
+         *
+         * 寄存器：r8=in r9=out r10=groups r11=T表；ymm0~3为状态字（每轮只改变编号，不移动数据），
+         * ymm4为轮函数输入，ymm5为0xFF，ymm6~9为4个字节下标，ymm10~13为gather结果，
+         * ymm14为gather掩码，ymm15为广播的轮密钥。32轮完全展开，轮密钥为 mov eax, imm32
+         */
+        std::vector<uint8_t> GenerateKernel(const uint32_t rk[32]) {
+            Emitter e;
+            if (WIN64_ABI) {
+                e.AluImm(5, RSP, WIN64_FRAME);
+                for (int i = 0; i < 10; ++i) e.StoreU(6 + i, RSP, 16 * i, 0);
+                e.MovRR(R10, R8);
+                e.MovRR(R11, R9);
+                e.MovRR(R8, RCX);
+                e.MovRR(R9, RDX);
+            }
+            else {
+                e.MovRR(R8, 7);   // rdi
+                e.MovRR(R9, 6);   // rsi
+                e.MovRR(R10, RDX);
+                e.MovRR(R11, RCX);
+            }
+            e.Op3(VPCMPEQD, 5, 5, 5);
+            e.Psrld(5, 5, 24);
+
+            std::vector<size_t> bswapRefs;
+            e.Test(R10);
+            size_t toDone = e.Jcc(0x84);
+            size_t loop = e.Size();
+
+            // 载入8个分组并转置为按字排列：Xi的第j个元素为第j个分组（高128位为分组4~7）的第i个字
+            for (int i = 0; i < 4; ++i) e.LoadU(6 + i, R8, 32 * i);
+            for (int i = 0; i < 4; ++i) bswapRefs.push_back(e.VexRip(2, 1, 1, 0x00, 6 + i, 6 + i));
+            e.Perm2i128(10, 6, 8, 0x20);
+            e.Perm2i128(11, 6, 8, 0x31);
+            e.Perm2i128(12, 7, 9, 0x20);
+            e.Perm2i128(13, 7, 9, 0x31);
+            e.Op3(UNPCKLDQ, 6, 10, 11);
+            e.Op3(UNPCKHDQ, 7, 10, 11);
+            e.Op3(UNPCKLDQ, 8, 12, 13);
+            e.Op3(UNPCKHDQ, 9, 12, 13);
+            e.Op3(UNPCKLQDQ, 0, 6, 8);
+            e.Op3(UNPCKHQDQ, 1, 6, 8);
+            e.Op3(UNPCKLQDQ, 2, 7, 9);
+            e.Op3(UNPCKHQDQ, 3, 7, 9);
+
+            int X[4] = { 0, 1, 2, 3 };
+            for (int r = 0; r < SM4_ROUNDS; ++r) {
+                e.MovEaxImm(rk[r]);
+                e.MovdXmmEax(15);
+                e.Broadcastd(15, 15);
+                e.Op3(VPXOR, 4, X[1], X[2]);
+                e.Op3(VPXOR, 4, 4, X[3]);
+                e.Op3(VPXOR, 4, 4, 15);
+                e.Psrld(6, 4, 24);
+                e.Psrld(7, 4, 16);
+                e.Op3(VPAND, 7, 7, 5);
+                e.Psrld(8, 4, 8);
+                e.Op3(VPAND, 8, 8, 5);
+                e.Op3(VPAND, 9, 4, 5);
+                for (int t = 0; t < 4; ++t) {
+                    e.Op3(VPXOR, 10 + t, 10 + t, 10 + t);  // 清零，切断与上一轮结果的依赖
+                    e.Op3(VPCMPEQD, 14, 14, 14);
+                    e.Gatherdd(10 + t, R11, 6 + t, 1024 * t, 14);
+                }
+                e.Op3(VPXOR, 10, 10, 11);
+                e.Op3(VPXOR, 12, 12, 13);
+                e.Op3(VPXOR, X[0], X[0], 10);
+                e.Op3(VPXOR, X[0], X[0], 12);
+                int x0 = X[0];
+                X[0] = X[1];
+                X[1] = X[2];
+                X[2] = X[3];
+                X[3] = x0;
+            }
+
+            // 反序输出 (X35, X34, X33, X32) 并转置回按分组排列
+            e.Op3(UNPCKLDQ, 6, X[3], X[2]);
+            e.Op3(UNPCKHDQ, 7, X[3], X[2]);
+            e.Op3(UNPCKLDQ, 8, X[1], X[0]);
+            e.Op3(UNPCKHDQ, 9, X[1], X[0]);
+            e.Op3(UNPCKLQDQ, 10, 6, 8);
+            e.Op3(UNPCKHQDQ, 11, 6, 8);
+            e.Op3(UNPCKLQDQ, 12, 7, 9);
+            e.Op3(UNPCKHQDQ, 13, 7, 9);
+            e.Perm2i128(6, 10, 11, 0x20);
+            e.Perm2i128(7, 12, 13, 0x20);
+            e.Perm2i128(8, 10, 11, 0x31);
+            e.Perm2i128(9, 12, 13, 0x31);
+            for (int i = 0; i < 4; ++i) bswapRefs.push_back(e.VexRip(2, 1, 1, 0x00, 6 + i, 6 + i));
+            for (int i = 0; i < 4; ++i) e.StoreU(6 + i, R9, 32 * i);
+
+            e.AluImm(0, R8, 128);
+            e.AluImm(0, R9, 128);
+            e.Dec(R10);
+            e.Bind(e.Jcc(0x85), loop);
+
+            e.Bind(toDone, e.Size());
+            e.Vzeroupper();
+            if (WIN64_ABI) {
+                for (int i = 0; i < 10; ++i) e.LoadU(6 + i, RSP, 16 * i, 0);
+                e.AluImm(0, RSP, WIN64_FRAME);
+            }
+            e.Ret();
+
+            // 常量：每个32位字内的字节反转
+            while (e.Size() % 32 != 0) e.Byte(0xCC);
+            size_t bswap = e.Size();
+            for (int i = 0; i < 32; ++i) e.Byte(static_cast<uint8_t>((i & ~3) + 3 - (i & 3)));
+            for (size_t ref : bswapRefs) e.Bind(ref, bswap);
+            return std::move(e.code);
+        }
+
+        // ---------------- 可执行内存（W^X：写入时只读写，执行时只读执行） ----------------
+
+        size_t PageSize() {
+#if defined(_WIN32)
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwPageSize;
+#else
+            return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        }
+
+        void* MapWritable(size_t size) {
+#if defined(_WIN32)
+            return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            return p == MAP_FAILED ? nullptr : p;
+#endif
+        }
+
+        bool ProtectExecutable(void* p, size_t size) {
+#if defined(_WIN32)
+            DWORD old;
+            if (!VirtualProtect(p, size, PAGE_EXECUTE_READ, &old)) return false;
+            return FlushInstructionCache(GetCurrentProcess(), p, size) != 0;
+#else
+            return mprotect(p, size, PROT_READ | PROT_EXEC) == 0;
+#endif
+        }
+
+        // 代码中含有轮密钥：先恢复可写并清零再释放
+        void Unmap(void* p, size_t size) {
+#if defined(_WIN32)
+            DWORD old;
+            if (VirtualProtect(p, size, PAGE_READWRITE, &old)) SecureZeroMemory(p, size);
+            VirtualFree(p, 0, MEM_RELEASE);
+#else
+            if (mprotect(p, size, PROT_READ | PROT_WRITE) == 0) {
+                volatile uint8_t* v = static_cast<volatile uint8_t*>(p);
+                for (size_t i = 0; i < size; ++i) v[i] = 0;
+            }
+            munmap(p, size);
+#endif
+        }
+
+        void Compile(gmsm_sm4_jit* jit) {
+            if (!(CpuFeatures() & GMSM_CPU_AVX2)) return;
+            std::vector<uint8_t> code = GenerateKernel(jit->rk);
+            size_t page = PageSize();
+            size_t size = (code.size() + page - 1) / page * page;
+            void* p = MapWritable(size);
+            if (p == nullptr) return;
+            std::memcpy(p, code.data(), code.size());
+            volatile uint8_t* v = code.data();
+            for (size_t i = 0; i < code.size(); ++i) v[i] = 0;
+            if (!ProtectExecutable(p, size)) {  // 系统禁止动态代码时回退到通用实现
+                Unmap(p, size);
+                return;
+            }
+            jit->code = p;
+            jit->codeSize = size;
+            jit->kernel = reinterpret_cast<Sm4JitKernel>(p);
+        }
+
+#endif // GMSM_JIT
+
+        // ---------------- 代码缓存 ----------------
+
+        // 超过容量时淘汰最久未使用且无人引用的内核
+        constexpr size_t JIT_CACHE_CAPACITY = 16;
+
+        std::mutex cacheMutex;
+        std::vector<gmsm_sm4_jit*> cache;
+        uint64_t useClock = 0;
+
+        void Destroy(gmsm_sm4_jit* jit) {
+#if defined(GMSM_JIT)
+            if (jit->code != nullptr) Unmap(jit->code, jit->codeSize);
+#endif
+            volatile uint8_t* v = reinterpret_cast<volatile uint8_t*>(jit);
+            for (size_t i = 0; i < sizeof(gmsm_sm4_jit); ++i) v[i] = 0;
+            delete jit;
+        }
+
+        void EvictUnused(size_t keep) {
+            while (cache.size() > keep) {
+                size_t victim = cache.size();
+                for (size_t i = 0; i < cache.size(); ++i) {
+                    if (cache[i]->refs == 0 && (victim == cache.size() || cache[i]->lastUse < cache[victim]->lastUse)) {
+                        victim = i;
+                    }
+                }
+                if (victim == cache.size()) return;  // 全部在使用中
+                Destroy(cache[victim]);
+                cache.erase(cache.begin() + static_cast<std::ptrdiff_t>(victim));
+            }
+        }
+
+    } // namespace
+
+    void Sm4JitBlocks(const gmsm_sm4_jit* jit, const uint8_t* in, uint8_t* out, size_t blocks) {
+        if (jit->kernel == nullptr) {
+            Sm4Blocks()(jit->rk, in, out, blocks);
+            return;
+        }
+        size_t groups = blocks / 8;
+        jit->kernel(in, out, groups, Sm4TTables());
+        Sm4BlocksTTable(jit->rk, in + 128 * groups, out + 128 * groups, blocks - 8 * groups);
+    }
+
+} // namespace gmsm
+
+extern "C" {
+
+    gmsm_sm4_jit* gmsm_sm4_jit_acquire(const gmsm_sm4_key* key) {
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+        gmsm_sm3(key->rk, sizeof(key->rk), digest);
+
+        std::lock_guard<std::mutex> lock(gmsm::cacheMutex);
+        for (gmsm_sm4_jit* jit : gmsm::cache) {
+            if (std::memcmp(jit->digest, digest, sizeof(digest)) == 0) {
+                ++jit->refs;
+                jit->lastUse = ++gmsm::useClock;
+                return jit;
+            }
+        }
+
+        gmsm_sm4_jit* jit = new (std::nothrow) gmsm_sm4_jit();
+        if (jit == nullptr) return nullptr;
+        std::memcpy(jit->rk, key->rk, sizeof(jit->rk));
+        std::memcpy(jit->digest, digest, sizeof(digest));
+#if defined(GMSM_JIT)
+        gmsm::Compile(jit);
+#endif
+        jit->refs = 1;
+        jit->lastUse = ++gmsm::useClock;
+        gmsm::EvictUnused(gmsm::JIT_CACHE_CAPACITY - 1);
+        gmsm::cache.push_back(jit);
+        return jit;
+    }
+
+    void gmsm_sm4_jit_release(gmsm_sm4_jit* jit) {
+        if (jit == nullptr) return;
+        std::lock_guard<std::mutex> lock(gmsm::cacheMutex);
+        if (jit->refs > 0) --jit->refs;
+        gmsm::EvictUnused(gmsm::JIT_CACHE_CAPACITY);
+    }
+
+    void gmsm_sm4_jit_purge(void) {
+        std::lock_guard<std::mutex> lock(gmsm::cacheMutex);
+        gmsm::EvictUnused(0);
+    }
+
+    int gmsm_sm4_jit_is_native(const gmsm_sm4_jit* jit) {
+        return jit->kernel != nullptr;
+    }
+
+    void gmsm_sm4_jit_ecb(const gmsm_sm4_jit* jit, const uint8_t* in, uint8_t* out, size_t blocks) {
+        if (gmsm::Sm4UseStreaming(out, blocks * GMSM_SM4_BLOCK_SIZE)) {
+            gmsm::Sm4Streamed(in, out, blocks * GMSM_SM4_BLOCK_SIZE, [&](const uint8_t* src, uint8_t* dst, size_t n) {
+                gmsm::Sm4JitBlocks(jit, src, dst, n / GMSM_SM4_BLOCK_SIZE);
+            });
+            return;
+        }
+        gmsm::Sm4JitBlocks(jit, in, out, blocks);
+    }
+
+    void gmsm_sm4_jit_ctr(const gmsm_sm4_jit* jit, uint8_t counter[GMSM_SM4_BLOCK_SIZE],
+        const uint8_t* in, uint8_t* out, size_t len) {
+        using Engine = gmsm::Sm4Engine<gmsm::Sm4JitBackend>;
+        if (gmsm::Sm4UseStreaming(out, len)) {
+            gmsm::Sm4Streamed(in, out, len, [&](const uint8_t* src, uint8_t* dst, size_t n) {
+                Engine::Ctr(jit, counter, src, dst, n, false);
+            });
+            return;
+        }
+        Engine::Ctr(jit, counter, in, out, len, false);
+    }
+
+} // extern "C"
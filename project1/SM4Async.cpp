@@ -0,0 +1,247 @@
+﻿#include <cstdint>      // 标准整数类型
+#include <algorithm>    // 比较结果
+#include <atomic>       // 回调完成计数
+#include <chrono>       // 时间测量
+#include <cstdlib>      // 命令行参数
+#include <cstring>      // 内存操作
+#include <future>       // 等待超时检查
+#include <iomanip>      // 格式化输出
+#include <iostream>     // 输入输出
+#include <thread>       // 让出CPU
+#include <vector>       // 动态数组
+#include "../libgmsm/gmsm.h"  // SM4-GCM（同步接口与异步队列）
+
+#if defined(__linux__)
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t kBurst = 256;  // 事件循环每轮“收到”的请求数
+
+    struct Workload {
+        size_t size;
+        size_t count;
+        std::vector<uint8_t> plain;
+        std::vector<uint8_t> iv;
+        gmsm_gcm_key key;
+    };
+
+    struct Output {
+        std::vector<uint8_t> cipher;
+        std::vector<uint8_t> tag;
+
+        Output(size_t size, size_t count) : cipher(size * count), tag(GMSM_GCM_TAG_SIZE * count) {}
+    };
+
+    struct Result {
+        double seconds;     // 全部完成的墙钟时间
+        double stallUs;     // 事件循环线程花在加密调用（或提交）上的时间，平均每条
+    };
+
+    void FillJob(gmsm_job& job, const Workload& w, Output& out, size_t i) {
+        std::memset(&job, 0, sizeof(job));
+        job.op = GMSM_JOB_SEAL;
+        job.key = &w.key;
+        job.iv = &w.iv[i * GMSM_GCM_IV_SIZE];
+        job.iv_len = GMSM_GCM_IV_SIZE;
+        job.in = &w.plain[i * w.size];
+        job.len = w.size;
+        job.out = &out.cipher[i * w.size];
+        job.tag = &out.tag[i * GMSM_GCM_TAG_SIZE];
+        job.tag_len = GMSM_GCM_TAG_SIZE;
+    }
+
+    /**
+     * @brief 同步：事件循环线程自己逐条加密，加密期间不能处理其他事件
+     */
+    Result RunBlocking(const Workload& w, Output& out) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < w.count; ++i) {
+            gmsm_gcm_encrypt(&w.key, &w.iv[i * GMSM_GCM_IV_SIZE], GMSM_GCM_IV_SIZE, nullptr, 0,
+                &w.plain[i * w.size], w.size, &out.cipher[i * w.size], &out.tag[i * GMSM_GCM_TAG_SIZE], GMSM_GCM_TAG_SIZE);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return Result{ seconds, seconds * 1e6 / w.count };
+    }
+
+    /**
+     * @brief 异步 + 完成队列：每轮提交一批，在eventfd上等待，取回已完成的任务
+     */
+    Result RunReap(gmsm_async_queue* queue, const Workload& w, Output& out) {
+        std::vector<gmsm_job> jobs(w.count);
+        std::vector<gmsm_job*> ptrs(w.count);
+        for (size_t i = 0; i < w.count; ++i) {
+            FillJob(jobs[i], w, out, i);
+            jobs[i].flags = GMSM_JOB_REAP;
+            ptrs[i] = &jobs[i];
+        }
+        std::vector<gmsm_job*> done(kBurst);
+        double stall = 0;
+        size_t submitted = 0, reaped = 0;
+        auto start = Clock::now();
+        while (reaped < w.count) {
+            if (submitted < w.count) {
+                auto t = Clock::now();
+                size_t n = submitted + kBurst <= w.count ? kBurst : w.count - submitted;
+                submitted += gmsm_async_submit(queue, &ptrs[submitted], n);
+                stall += std::chrono::duration<double>(Clock::now() - t).count();
+            }
+#if defined(__linux__)
+            pollfd pfd = { gmsm_async_event_fd(queue), POLLIN, 0 };
+            if (poll(&pfd, 1, submitted < w.count ? 0 : -1) > 0) {
+                uint64_t value;
+                ssize_t n = read(pfd.fd, &value, sizeof(value));
+                (void)n;
+            }
+#endif
+            auto t = Clock::now();
+            size_t n;
+            while ((n = gmsm_async_reap(queue, done.data(), done.size())) > 0) reaped += n;
+            stall += std::chrono::duration<double>(Clock::now() - t).count();
+            if (submitted == w.count && reaped < w.count) std::this_thread::yield();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return Result{ seconds, stall * 1e6 / w.count };
+    }
+
+    std::atomic<size_t> callbacksDone{ 0 };
+
+    void OnSealed(gmsm_job*) {
+        callbacksDone.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 异步 + 回调：回调在工作线程上执行
+     */
+    Result RunCallback(gmsm_async_queue* queue, const Workload& w, Output& out) {
+        std::vector<gmsm_job> jobs(w.count);
+        std::vector<gmsm_job*> ptrs(w.count);
+        for (size_t i = 0; i < w.count; ++i) {
+            FillJob(jobs[i], w, out, i);
+            jobs[i].callback = OnSealed;
+            ptrs[i] = &jobs[i];
+        }
+        callbacksDone = 0;
+        double stall = 0;
+        size_t submitted = 0;
+        auto start = Clock::now();
+        while (submitted < w.count) {
+            auto t = Clock::now();
+            size_t n = submitted + kBurst <= w.count ? kBurst : w.count - submitted;
+            submitted += gmsm_async_submit(queue, &ptrs[submitted], n);
+            stall += std::chrono::duration<double>(Clock::now() - t).count();
+            std::this_thread::yield();
+        }
+        while (callbacksDone.load() < w.count) std::this_thread::yield();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return Result{ seconds, stall * 1e6 / w.count };
+    }
+
+    std::atomic<bool> gateOpen{ false };
+
+    void HoldWorker(gmsm_job*) {
+        while (!gateOpen.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    /**
+     * @brief gmsm_async_wait也要能等GMSM_JOB_REAP任务（之后仍要取回）。单工作线程的队列先被一个回调任务卡住，
+     *        等待方自旋结束、睡到条件变量上之后才放行，REAP任务完成时必须唤醒它；10秒内没有返回视为失败
+     */
+    bool CheckWaitOnReap(const Workload& w, const Output& expected) {
+        gmsm_async_queue* queue = gmsm_async_create(1, 16);
+        if (queue == nullptr) return false;
+        Output gateOut(w.size, 1), out(w.size, 1);
+        gmsm_job gate, job;
+        FillJob(gate, w, gateOut, 0);
+        gate.callback = HoldWorker;
+        FillJob(job, w, out, 0);
+        job.flags = GMSM_JOB_REAP;
+        gmsm_job* ptrs[2] = { &gate, &job };
+        gateOpen = false;
+        if (gmsm_async_submit(queue, ptrs, 2) != 2) {
+            gateOpen = true;
+            gmsm_async_destroy(queue);
+            return false;
+        }
+
+        auto waited = std::async(std::launch::async, [&] { return gmsm_async_wait(queue, &job); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        gateOpen = true;
+        if (waited.wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+            std::cerr << "gmsm_async_wait 等待GMSM_JOB_REAP任务10秒未返回" << std::endl;
+            std::_Exit(1);  // 等待线程卡在库里，无法正常析构
+        }
+        int status = waited.get();
+        gmsm_job* done = nullptr;
+        size_t reaped = 0;
+        for (int i = 0; i < 1000 && reaped == 0; ++i) {  // status先于入完成队列写入，可能要稍等
+            reaped = gmsm_async_reap(queue, &done, 1);
+            if (reaped == 0) std::this_thread::yield();
+        }
+        gmsm_async_destroy(queue);
+        return status == GMSM_OK && reaped == 1 && done == &job &&
+            std::equal(out.cipher.begin(), out.cipher.end(), expected.cipher.begin()) &&
+            std::equal(out.tag.begin(), out.tag.end(), expected.tag.begin());
+    }
+
+    void Report(const char* name, const Workload& w, const Result& r, bool match) {
+        std::cout << "  " << std::left << std::setw(16) << name << std::right << std::fixed
+            << std::setw(10) << std::setprecision(1) << w.count / r.seconds / 1e4 << " 万条/秒"
+            << std::setw(10) << std::setprecision(3) << r.stallUs << " us/条"
+            << (match ? "" : "    结果不一致!") << "\n";
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Workload w;
+    w.size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    w.count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+    unsigned workers = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 0;
+
+    const uint8_t userKey[16] = {
+        0x01,0x23,0x45,0x67,0x89,0xab,0xcd,0xef,
+        0xfe,0xdc,0xba,0x98,0x76,0x54,0x32,0x10
+    };
+    gmsm_gcm_init(&w.key, userKey);
+    w.plain.resize(w.size * w.count);
+    w.iv.resize(GMSM_GCM_IV_SIZE * w.count);
+    for (size_t i = 0; i < w.plain.size(); ++i) w.plain[i] = static_cast<uint8_t>(i * 131 + (i >> 9));
+    for (size_t i = 0; i < w.iv.size(); ++i) w.iv[i] = static_cast<uint8_t>(i * 7 + 3);
+
+    gmsm_async_queue* queue = gmsm_async_create(workers, 4096);
+    if (queue == nullptr) {
+        std::cerr << "无法创建异步队列" << std::endl;
+        return 1;
+    }
+
+    std::cout << "SM4-GCM加密 " << w.count << " 条 " << w.size << " 字节消息，实现: " << gmsm_sm4_impl_name()
+        << "，工作线程 " << (workers == 0 ? std::thread::hardware_concurrency() : workers) << "\n";
+    std::cout << "  方式                  吞吐量     事件循环线程占用\n";
+
+    Output expected(w.size, w.count);
+    Result blocking = RunBlocking(w, expected);
+    Report("同步逐条", w, blocking, true);
+
+    Output reap(w.size, w.count);
+    Result reaped = RunReap(queue, w, reap);
+    Report("异步+完成队列", w, reaped, reap.cipher == expected.cipher && reap.tag == expected.tag);
+
+    Output callback(w.size, w.count);
+    Result called = RunCallback(queue, w, callback);
+    Report("异步+回调", w, called, callback.cipher == expected.cipher && callback.tag == expected.tag);
+
+    bool waitOnReap = CheckWaitOnReap(w, expected);
+    std::cout << "  等待完成队列任务: " << (waitOnReap ? "通过" : "失败") << "\n";
+    if (!waitOnReap) {
+        gmsm_async_destroy(queue);
+        return 1;
+    }
+
+    gmsm_async_destroy(queue);
+    return 0;
+}
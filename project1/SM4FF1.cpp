@@ -0,0 +1,102 @@
+﻿#include <cstdint>      // 标准整数类型
+#include <chrono>       // 时间测量
+#include <cstdlib>      // 命令行参数
+#include <cstring>      // 内存操作
+#include <iomanip>      // 格式化输出
+#include <iostream>     // 输入输出
+#include <string>       // 令牌的字符串形式
+#include <vector>       // 动态数组
+#include "../libgmsm/gmsm.h"  // SM4-FF1（保留格式加密）
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t kCardDigits = 16;
+    constexpr size_t kIdDigits = 18;
+    constexpr size_t kBatch = 256;  // 每次批量调用的值的个数
+
+    /**
+     * @brief count个len位十进制数，连续存放；tweak取每个值所属机构的编号
+     */
+    struct Values {
+        size_t len;
+        std::vector<uint16_t> digits;
+        std::vector<uint8_t> tweaks;
+
+        Values(size_t len, size_t count) : len(len), digits(len * count), tweaks(4 * count) {
+            uint64_t x = 0x9E3779B97F4A7C15ull;
+            for (size_t i = 0; i < digits.size(); ++i) {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                digits[i] = static_cast<uint16_t>(x % 10);
+            }
+            for (size_t i = 0; i < count; ++i) {
+                for (int j = 0; j < 4; ++j) tweaks[4 * i + j] = static_cast<uint8_t>('0' + (i / 1000 + j) % 10);
+            }
+        }
+
+        size_t Count() const { return digits.size() / len; }
+    };
+
+    double RunSingle(const gmsm_ff1_key& key, const Values& v, uint16_t* out) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < v.Count(); ++i) {
+            gmsm_ff1_encrypt(&key, &v.tweaks[4 * i], 4, &v.digits[i * v.len], out + i * v.len, v.len);
+        }
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    double RunBatch(const gmsm_ff1_key& key, const Values& v, const uint16_t* in, uint16_t* out, bool decrypt) {
+        std::vector<gmsm_ff1_batch_item> items(kBatch);
+        auto start = Clock::now();
+        for (size_t i = 0; i < v.Count(); i += kBatch) {
+            size_t n = i + kBatch <= v.Count() ? kBatch : v.Count() - i;
+            for (size_t k = 0; k < n; ++k) {
+                items[k] = { &v.tweaks[4 * (i + k)], 4, in + (i + k) * v.len, out + (i + k) * v.len, v.len, GMSM_OK };
+            }
+            if (decrypt) gmsm_ff1_decrypt_batch(&key, items.data(), n);
+            else gmsm_ff1_encrypt_batch(&key, items.data(), n);
+        }
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    std::string ToString(const uint16_t* digits, size_t len) {
+        std::string s;
+        for (size_t i = 0; i < len; ++i) s += static_cast<char>('0' + digits[i]);
+        return s;
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+    const uint8_t userKey[16] = {
+        0x01,0x23,0x45,0x67,0x89,0xab,0xcd,0xef,
+        0xfe,0xdc,0xba,0x98,0x76,0x54,0x32,0x10
+    };
+    gmsm_ff1_key key;
+    gmsm_ff1_init(&key, userKey, 10);
+
+    std::cout << "SM4-FF1 令牌化 " << count << " 个十进制数，实现: " << gmsm_sm4_impl_name()
+        << "，批量每次 " << kBatch << " 个\n";
+    std::cout << "  长度      逐个(万个/秒)   批量(万个/秒)   加速比\n";
+    for (size_t len : { kCardDigits, kIdDigits }) {
+        Values v(len, count);
+        std::vector<uint16_t> single(v.digits.size()), batch(v.digits.size()), back(v.digits.size());
+        double ts = RunSingle(key, v, single.data());
+        double tb = RunBatch(key, v, v.digits.data(), batch.data(), false);
+        RunBatch(key, v, batch.data(), back.data(), true);
+        bool ok = single == batch && back == v.digits;
+        std::cout << "  " << std::setw(4) << len << " 位" << std::fixed << std::setprecision(1)
+            << std::setw(16) << count / ts / 1e4 << std::setw(16) << count / tb / 1e4
+            << std::setw(10) << std::setprecision(2) << ts / tb << "x"
+            << (ok ? "" : "    结果不一致!") << "\n";
+        if (len == kCardDigits) {
+            std::cout << "        例: " << ToString(&v.digits[0], len) << " -> " << ToString(&batch[0], len) << "\n";
+        }
+    }
+    return 0;
+}
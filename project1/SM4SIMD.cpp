@@ -1,220 +1,28 @@
-#include <immintrin.h>  // AVX2ָͷļ
 #include <cstdint>      // ׼
-#include <array>        // 
+#include <algorithm>    // std::max
 #include <cstring>      // ڴ
 #include <iostream>     // 
 #include <iomanip>      // ʽ
 #include <chrono>       // ʱ
 #include <thread>       // ֧߳
 #include <vector>       // ̬
-
-// ʹñ׼ռ򻯴
-using std::array;
-using std::uint32_t;
-
-// SM4㷨
-namespace SM4Core {
-
-    // Sûұ׼壩
-    constexpr uint8_t SBOX[256] = {
-      0xd6,0x90,0xe9,0xfe,0xcc,0xe1,0x3d,0xb7,0x16,0xb6,0x14,0xc2,0x28,0xfb,0x2c,0x05,
-      // ...Sݣ
-    };
-
-    // Ԥұ
-    array<uint32_t, 256> T0, T1, T2, T3;  // T
-
-    /**
-     * @brief 32λѭ
-     * @param x ֵ
-     * @param n λλ
-     * @return ѭƽ
-     */
-    inline uint32_t RotateLeft(uint32_t x, int n) {
-        return (x << n) | (x >> (32 - n));
-    }
-
-    /**
-     * @brief SûԱ任ӣ
-     * @param a 
-     * @return û
-     */
-    uint32_t SboxSubstitution(uint32_t a) {
-        return (static_cast<uint32_t>(SBOX[(a >> 24) & 0xFF]) << 24) |
-            (static_cast<uint32_t>(SBOX[(a >> 16) & 0xFF]) << 16) |
-            (static_cast<uint32_t>(SBOX[(a >> 8) & 0xFF]) << 8) |
-            static_cast<uint32_t>(SBOX[a & 0xFF]);
-    }
-
-    /**
-     * @brief Ա任L
-     * @param b 
-     * @return 任
-     */
-    uint32_t LinearTransform(uint32_t b) {
-        return b ^ RotateLeft(b, 2) ^ RotateLeft(b, 10) ^ RotateLeft(b, 18) ^ RotateLeft(b, 24);
-    }
-
-    /**
-     * @brief ϳɱ任T
-     * @param x 
-     * @return 任
-     */
-    uint32_t CompositeTransform(uint32_t x) {
-        return LinearTransform(SboxSubstitution(x));
-    }
-
-    /**
-     * @brief ԤT
-     */
-    void GenerateLookupTables() {
-        for (int i = 0; i < 256; ++i) {
-            uint32_t t = SboxSubstitution(i << 24);
-            T0[i] = LinearTransform(t);
-            T1[i] = RotateLeft(T0[i], 8);   // Ԥת8λ
-            T2[i] = RotateLeft(T0[i], 16);  // Ԥת16λ
-            T3[i] = RotateLeft(T0[i], 24);  // Ԥת24λ
-        }
-    }
-
-    /**
-     * @brief Կչ㷨
-     * @param MK Կ
-     * @return Կ
-     */
-    array<uint32_t, 32> KeyExpansion(const uint8_t MK[16]) {
-        array<uint32_t, 32> roundKeys;
-        const uint32_t FK[4] = { 0xA3B1BAC6, 0x56AA3350, 0x677D9197, 0xB27022DC };
-        const uint32_t CK[32] = {
-            0x00070E15,0x1C232A31,0x383F464D,0x545B6269,
-            // ...CK飩
-        };
-
-        uint32_t K[36];
-        // ʼԿ
-        for (int i = 0; i < 4; ++i) {
-            K[i] = (MK[4 * i] << 24) | (MK[4 * i + 1] << 16) | (MK[4 * i + 2] << 8) | MK[4 * i + 3];
-            K[i] ^= FK[i];
-        }
-
-        // Կ
-        for (int i = 0; i < 32; ++i) {
-            uint32_t tmp = K[i + 1] ^ K[i + 2] ^ K[i + 3] ^ CK[i];
-            tmp = CompositeTransform(tmp);
-            K[i + 4] = K[i] ^ tmp;
-            roundKeys[i] = K[i + 4];
-        }
-        return roundKeys;
-    }
-
-} // namespace SM4Core
-
-// SIMDŻʵ
-namespace SM4SIMD {
-
-    using namespace SM4Core;
-
-    /**
-     * @brief AVX2ָʵֵĺϳɱ任T
-     * @param x 
-     * @return 任
-     */
-    __m256i TransformAVX(__m256i x) {
-        const __m256i MASK = _mm256_set1_epi32(0xFF);
-
-        // ֽ
-        __m256i i0 = _mm256_srli_epi32(x, 24);
-        __m256i i1 = _mm256_srli_epi32(x, 16);
-        __m256i i2 = _mm256_srli_epi32(x, 8);
-        __m256i i3 = x;
-        i0 = _mm256_and_si256(i0, MASK);
-        i1 = _mm256_and_si256(i1, MASK);
-        i2 = _mm256_and_si256(i2, MASK);
-        i3 = _mm256_and_si256(i3, MASK);
-
-        // 
-        __m256i v0 = _mm256_i32gather_epi32((const int*)T0.data(), i0, 4);
-        __m256i v1 = _mm256_i32gather_epi32((const int*)T1.data(), i1, 4);
-        __m256i v2 = _mm256_i32gather_epi32((const int*)T2.data(), i2, 4);
-        __m256i v3 = _mm256_i32gather_epi32((const int*)T3.data(), i3, 4);
-
-        // ϲ
-        return _mm256_xor_si256(_mm256_xor_si256(v0, v1),
-            _mm256_xor_si256(v2, v3));
-    }
-
-    /**
-     * @brief м8ݿ
-     * @param input ݿ
-     * @param output ݿ
-     * @param roundKeys Կ
-     */
-    void ParallelEncrypt(const uint8_t input[8][16],
-        uint8_t output[8][16],
-        const array<uint32_t, 32>& roundKeys) {
-        // ݵAVXĴ
-        __m256i X[4];
-        uint32_t tmp[8];
-
-        for (int i = 0; i < 4; ++i) {
-            for (int b = 0; b < 8; ++b) {
-                tmp[b] = (input[b][4 * i] << 24) | (input[b][4 * i + 1] << 16) |
-                    (input[b][4 * i + 2] << 8) | input[b][4 * i + 3];
-            }
-            X[i] = _mm256_loadu_si256((__m256i*)tmp);
-        }
-
-        // 32ֵ
-        for (int r = 0; r < 32; ++r) {
-            __m256i rk = _mm256_set1_epi32(roundKeys[r]);
-            __m256i tmp = _mm256_xor_si256(_mm256_xor_si256(X[1], X[2]),
-                _mm256_xor_si256(X[3], rk));
-            __m256i Xn = _mm256_xor_si256(X[0], TransformAVX(tmp));
-
-            // ¼Ĵ
-            X[0] = X[1];
-            X[1] = X[2];
-            X[2] = X[3];
-            X[3] = Xn;
-        }
-
-        // 洢
-        for (int i = 0; i < 4; ++i) {
-            _mm256_storeu_si256((__m256i*)tmp, X[3 - i]);
-            for (int b = 0; b < 8; ++b) {
-                uint32_t val = tmp[b];
-                output[b][4 * i] = val >> 24;
-                output[b][4 * i + 1] = val >> 16;
-                output[b][4 * i + 2] = val >> 8;
-                output[b][4 * i + 3] = val;
-            }
-        }
-    }
-
-} // namespace SM4SIMD
+#include "../libgmsm/gmsm.h"  // SM4AVX2 8·ʵɿڰCPUԶѡ
 
 // ַ߳
 namespace ParallelExecutor {
 
-    using namespace SM4SIMD;
-
     /**
      * @brief 
      * @param input ָ
      * @param output ָ
-     * @param roundKeys Կ
-     * @param batchCount 
+     * @param key չԿ
+     * @param blockCount 
      */
     void EncryptionTask(const uint8_t* input,
         uint8_t* output,
-        const array<uint32_t, 32>& roundKeys,
-        int batchCount) {
-        for (int i = 0; i < batchCount; ++i) {
-            ParallelEncrypt(
-                reinterpret_cast<const uint8_t(*)[16]>(input + i * 8 * 16),
-                reinterpret_cast<uint8_t(*)[16]>(output + i * 8 * 16),
-                roundKeys);
-        }
+        const gmsm_sm4_key* key,
+        size_t blockCount) {
+        gmsm_sm4_ecb(key, input, output, blockCount);
     }
 
     /**
@@ -223,19 +31,19 @@ namespace ParallelExecutor {
      * @param func 
      * @param input 
      * @param output 
-     * @param roundKeys Կ
+     * @param key չԿ
      * @param totalBlocks ܿ
-     * @param batchSize ÿ
+     * @param batchSize ÿ̼߳䰴֣֤8·в𿪣
      */
     template<typename Func>
     void ExecuteParallel(Func func,
-        const std::vector<uint8_t>& input,
-        std::vector<uint8_t>& output,
-        const array<uint32_t, 32>& roundKeys,
+        const uint8_t* input,
+        uint8_t* output,
+        const gmsm_sm4_key& key,
         int totalBlocks,
         int batchSize = 8) {
         // κ̷߳
-        int totalBatches = totalBlocks / batchSize;
+        int totalBatches = (totalBlocks + batchSize - 1) / batchSize;
         int threadCount = std::max(1, (int)std::thread::hardware_concurrency());
         int batchesPerThread = totalBatches / threadCount;
         int remaining = totalBatches % threadCount;
@@ -248,11 +56,13 @@ namespace ParallelExecutor {
             int count = batchesPerThread + (i < remaining ? 1 : 0);
             if (count == 0) continue;
 
+            int first = offset * batchSize;
+            int blocks = std::min(count * batchSize, totalBlocks - first);
             workers.emplace_back(func,
-                input.data() + offset * batchSize * 16,
-                output.data() + offset * batchSize * 16,
-                std::ref(roundKeys),
-                count);
+                input + first * 16,
+                output + first * 16,
+                &key,
+                static_cast<size_t>(blocks));
 
             offset += count;
         }
@@ -267,9 +77,6 @@ namespace ParallelExecutor {
 
 // ܲԺʾ
 int main() {
-    // ʼSM4㷨
-    SM4Core::GenerateLookupTables();
-
     // Կ
     const uint8_t key[16] = {
         0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,
@@ -281,14 +88,19 @@ int main() {
     };
 
     // Կչ
-    auto roundKeys = SM4Core::KeyExpansion(key);
+    gmsm_sm4_key roundKeys;
+    gmsm_sm4_set_encrypt_key(&roundKeys, key);
 
     // ׼
     constexpr int totalBlocks = 80000;  // ݿ
     constexpr int batchSize = 8;        // SIMDÿ
-    std::vector<uint8_t> plainData(totalBlocks * 16);
-    std::vector<uint8_t> cipherData(totalBlocks * 16);
-    std::vector<uint8_t> decryptedData(totalBlocks * 16);
+    // libgmsmĴҳ򣨲ʱ˵ͨҳ64ֽڶ
+    uint8_t* plainData = static_cast<uint8_t*>(gmsm_buffer_alloc(totalBlocks * 16));
+    uint8_t* cipherData = static_cast<uint8_t*>(gmsm_buffer_alloc(totalBlocks * 16));
+    if (plainData == nullptr || cipherData == nullptr) {
+        std::cerr << "ڴ治" << std::endl;
+        return 1;
+    }
 
     // 
     for (int i = 0; i < totalBlocks; ++i) {
@@ -310,12 +122,17 @@ int main() {
     double encryptTime = std::chrono::duration<double, std::milli>(end - start).count();
     double throughput = (totalBlocks * 16) / (encryptTime / 1000) / (1024 * 1024);  // MB/s
 
-    std::cout << "ܲ:\n";
+    std::cout << "ܲԣ" << gmsm_sm4_impl_name() << ":\n";
     std::cout << "  : " << totalBlocks << "  ("
         << (totalBlocks * 16 / 1024) << " KB)\n";
     std::cout << "  ʱ: " << encryptTime << " \n";
     std::cout << "  : " << throughput << " MB/s\n";
 
+    gmsm_buffer_stats stats;
+    gmsm_buffer_get_stats(&stats);
+    std::cout << "  ҳ: ʽҳ " << (stats.hugetlb_bytes >> 20) << " MB͸ҳ "
+        << (stats.thp_bytes >> 20) << " MBͨҳ " << (stats.small_page_bytes >> 20) << " MB\n";
+
     // ֤һ
     std::cout << "\nһܽ:\n";
     for (int i = 0; i < 16; ++i) {
@@ -324,5 +141,7 @@ int main() {
     }
     std::cout << std::endl;
 
+    gmsm_buffer_free(plainData);
+    gmsm_buffer_free(cipherData);
     return 0;
-}
\ No newline at end of file
+}
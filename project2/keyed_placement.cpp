@@ -0,0 +1,184 @@
+﻿#include "keyed_placement.h"
+#include "../libgmsm/gmsm.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace LSB {
+
+    namespace {
+
+        // 每次生成的位置数
+        constexpr size_t CHUNK = 4096;
+
+        // 计数器分组第三个字的高位，区分本用途与同一密钥下的其他CTR用途
+        constexpr uint32_t DOMAIN_TAG = 0x4C534200;  // "LSB\0"
+
+        inline uint64_t LowMask64(int bits) {
+            return bits >= 64 ? ~0ULL : ((1ULL << bits) - 1);
+        }
+
+    } // namespace
+
+    KeyedPermutation::KeyedPermutation(const uint8_t key[16], uint64_t domain) : domain_(domain) {
+        if (domain > MAX_DOMAIN) {
+            throw std::invalid_argument("KeyedPermutation: 定义域过大");
+        }
+        // 取最小的 2^k >= domain（k至少为2），循环行走的期望次数小于2
+        int k = 2;
+        while ((1ULL << k) < domain) ++k;
+        leftBits_ = k / 2;
+        rightBits_ = k - leftBits_;
+
+        // 第r张表 = 计数器 (domain || tag|r || 0) 起的密钥流，每个32位大端字为一项
+        const size_t entries = size_t(1) << rightBits_;
+        const size_t blocks = (entries + 3) / 4;
+        std::vector<uint8_t> stream(blocks * 16);
+        gmsm_sm4_key roundKeys;
+        gmsm_sm4_set_encrypt_key(&roundKeys, key);
+        table_.resize(ROUNDS * entries);
+        for (int r = 0; r < ROUNDS; ++r) {
+            uint8_t counter[16] = { 0 };
+            for (int i = 0; i < 8; ++i) counter[i] = static_cast<uint8_t>(domain >> (56 - 8 * i));
+            uint32_t tag = DOMAIN_TAG | static_cast<uint32_t>(r);
+            for (int i = 0; i < 4; ++i) counter[8 + i] = static_cast<uint8_t>(tag >> (24 - 8 * i));
+            std::fill(stream.begin(), stream.end(), 0);
+            gmsm_sm4_ctr(&roundKeys, counter, stream.data(), stream.data(), stream.size());
+
+            uint32_t* t = table_.data() + r * entries;
+            for (size_t i = 0; i < entries; ++i) {
+                const uint8_t* p = stream.data() + 4 * i;
+                t[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+            }
+        }
+    }
+
+    template<size_t LANES>
+    void KeyedPermutation::Permute(uint64_t x[LANES]) const {
+        const size_t entries = size_t(1) << rightBits_;
+        int lb = leftBits_, rb = rightBits_;
+        uint32_t left[LANES], right[LANES];
+        for (size_t i = 0; i < LANES; ++i) {
+            left[i] = static_cast<uint32_t>(x[i] >> rb);
+            right[i] = static_cast<uint32_t>(x[i] & LowMask64(rb));
+        }
+        for (int r = 0; r < ROUNDS; ++r) {
+            // (L, R) -> (R, L xor F_r(R))，左右位宽随之交换；多路交错以隐藏查表延迟
+            const uint32_t* t = table_.data() + r * entries;
+            const uint32_t mask = static_cast<uint32_t>(LowMask64(lb));
+            for (size_t i = 0; i < LANES; ++i) {
+                uint32_t newRight = left[i] ^ (t[right[i]] & mask);
+                left[i] = right[i];
+                right[i] = newRight;
+            }
+            std::swap(lb, rb);
+        }
+        for (size_t i = 0; i < LANES; ++i) {
+            x[i] = (static_cast<uint64_t>(left[i]) << rb) | right[i];
+        }
+    }
+
+    void KeyedPermutation::Map(uint64_t start, size_t count, uint64_t* out) const {
+        // 结果落在定义域外的下标继续置换（cycle walking），仍是定义域上的双射
+        std::vector<size_t> pending(count);
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = start + i;
+            pending[i] = i;
+        }
+        while (!pending.empty()) {
+            size_t kept = 0, i = 0;
+            uint64_t x[8];
+            for (; i + 8 <= pending.size(); i += 8) {
+                for (size_t j = 0; j < 8; ++j) x[j] = out[pending[i + j]];
+                Permute<8>(x);
+                for (size_t j = 0; j < 8; ++j) {
+                    out[pending[i + j]] = x[j];
+                    if (x[j] >= domain_) pending[kept++] = pending[i + j];
+                }
+            }
+            for (; i < pending.size(); ++i) {
+                Permute<1>(out + pending[i]);
+                if (out[pending[i]] >= domain_) pending[kept++] = pending[i];
+            }
+            pending.resize(kept);
+        }
+    }
+
+    namespace {
+
+        /**
+         * @brief 把 [0, slots) 的载荷块按分片映射到像素位置后交给func处理，
+         * 分片在多个线程间均分（各线程写入的像素位置互不相同）
+         */
+        template<typename Func>
+        void ForEachSlot(const KeyedPermutation& perm, size_t slots, Func func) {
+            size_t chunks = (slots + CHUNK - 1) / CHUNK;
+            unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+            threads = static_cast<unsigned>(std::min<size_t>(threads, chunks));
+
+            auto worker = [&](size_t firstChunk, size_t endChunk) {
+                std::vector<uint64_t> pos(CHUNK);
+                for (size_t c = firstChunk; c < endChunk; ++c) {
+                    size_t begin = c * CHUNK, n = std::min(CHUNK, slots - begin);
+                    perm.Map(begin, n, pos.data());
+                    for (size_t i = 0; i < n; ++i) func(begin + i, static_cast<size_t>(pos[i]));
+                }
+            };
+            if (threads <= 1) {
+                worker(0, chunks);
+                return;
+            }
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; ++t) {
+                workers.emplace_back(worker, chunks * t / threads, chunks * (t + 1) / threads);
+            }
+            for (auto& w : workers) w.join();
+        }
+
+    } // namespace
+
+    size_t EmbedKeyed(uint8_t* pixels, size_t size, int bitDepth, const uint8_t* bits, size_t bitCount,
+        const uint8_t key[16]) {
+        if (bitDepth < 1 || bitDepth > 8 || size == 0 || size > KeyedPermutation::MAX_DOMAIN) return 0;
+        if (bitCount > size * bitDepth) bitCount = size * bitDepth;
+        const size_t d = static_cast<size_t>(bitDepth);
+        const uint32_t mask = (1u << bitDepth) - 1;
+
+        KeyedPermutation perm(key, size);
+        ForEachSlot(perm, (bitCount + d - 1) / d, [&](size_t slot, size_t px) {
+            // 与Embed一致：末尾不足bitDepth位的一段按数值写入最低位
+            uint32_t value = 0;
+            for (size_t i = slot * d; i < slot * d + d && i < bitCount; ++i) {
+                value = (value << 1) | ((bits[i >> 3] >> (7 - (i & 7))) & 1);
+            }
+            pixels[px] = static_cast<uint8_t>((pixels[px] & ~mask) | value);
+        });
+        return bitCount;
+    }
+
+    size_t ExtractKeyed(const uint8_t* pixels, size_t size, int bitDepth, uint8_t* out, size_t bitCount,
+        const uint8_t key[16]) {
+        if (bitDepth < 1 || bitDepth > 8 || size == 0 || size > KeyedPermutation::MAX_DOMAIN) return 0;
+        if (bitCount > size * bitDepth) bitCount = size * bitDepth;
+        const size_t d = static_cast<size_t>(bitDepth);
+        const size_t slots = (bitCount + d - 1) / d;
+
+        // 先按载荷块顺序收集像素低位，再单线程打包，避免多线程写同一输出字节
+        std::vector<uint8_t> values(slots);
+        KeyedPermutation perm(key, size);
+        ForEachSlot(perm, slots, [&](size_t slot, size_t px) {
+            values[slot] = static_cast<uint8_t>(pixels[px] & ((1u << bitDepth) - 1));
+        });
+
+        std::memset(out, 0, (bitCount + 7) / 8);
+        for (size_t slot = 0, i = 0; slot < slots; ++slot) {
+            for (int b = bitDepth - 1; b >= 0 && i < bitCount; --b, ++i) {
+                if ((values[slot] >> b) & 1) out[i >> 3] |= static_cast<uint8_t>(0x80 >> (i & 7));
+            }
+        }
+        return bitCount;
+    }
+
+} // namespace LSB
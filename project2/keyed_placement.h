@@ -0,0 +1,60 @@
+﻿#ifndef LSB_KEYED_PLACEMENT_H
+#define LSB_KEYED_PLACEMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 带密钥的伪随机嵌入位置：第j个载荷块（bitDepth位）写入像素字节 π(j)，
+// π 是 [0, 像素字节数) 上的Feistel置换（循环行走限制到定义域内），
+// 第r轮的轮函数表就是计数器 (domain, r, 0) 起的一段SM4-CTR密钥流（libgmsm按CPU选择8路AVX2实现生成）。
+// π(j) 逐点计算，嵌入与提取都按分片流式生成位置，不构造完整的下标数组
+
+namespace LSB {
+
+    class KeyedPermutation {
+    public:
+        static constexpr int ROUNDS = 6;
+
+        // 定义域上限，轮函数表最多 2^20 项
+        static constexpr uint64_t MAX_DOMAIN = 1ULL << 40;
+
+        /**
+         * @param key 16字节SM4密钥
+         * @param domain 定义域大小（像素字节数），不超过MAX_DOMAIN，否则抛出std::invalid_argument
+         */
+        KeyedPermutation(const uint8_t key[16], uint64_t domain);
+
+        uint64_t Domain() const { return domain_; }
+
+        /**
+         * @brief 计算 π(start) ... π(start + count - 1)，可多线程并发调用
+         */
+        void Map(uint64_t start, size_t count, uint64_t* out) const;
+
+    private:
+        template<size_t LANES>
+        void Permute(uint64_t x[LANES]) const;
+
+        std::vector<uint32_t> table_;  // ROUNDS张轮函数表，每张 2^rightBits_ 项（左右位宽交替，取较大者）
+        uint64_t domain_;
+        int leftBits_;
+        int rightBits_;
+    };
+
+    /**
+     * @brief 按密钥置换后的位置嵌入比特流（语义同Embed，仅位置不同）
+     * @return 实际嵌入的比特数
+     */
+    size_t EmbedKeyed(uint8_t* pixels, size_t size, int bitDepth, const uint8_t* bits, size_t bitCount,
+        const uint8_t key[16]);
+
+    /**
+     * @brief 按密钥置换后的位置提取比特流（语义同Extract）
+     */
+    size_t ExtractKeyed(const uint8_t* pixels, size_t size, int bitDepth, uint8_t* out, size_t bitCount,
+        const uint8_t key[16]);
+
+} // namespace LSB
+
+#endif // LSB_KEYED_PLACEMENT_H
@@ -0,0 +1,265 @@
+﻿#include "leak_index.h"
+#include "../libgmsm/gmsm.h"
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LSB_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LSB_TARGET_POPCNT
+#else
+#define LSB_TARGET_POPCNT __attribute__((target("popcnt")))
+#endif
+#endif
+
+namespace LSB {
+
+    namespace {
+
+        // 文件格式：文件头(16字节) + 记录若干
+        // 记录：接收方长度(2) || 接收方 || 指纹(32) || 载荷(ceil(payloadBits / 8))
+        constexpr char INDEX_MAGIC[8] = { 'L', 'S', 'B', 'L', 'E', 'A', 'K', '\0' };
+        constexpr uint32_t INDEX_VERSION = 1;
+        constexpr size_t INDEX_HEADER_SIZE = 16;
+        constexpr size_t MAX_RECIPIENT = 0xFFFF;
+
+        void PutU32(uint8_t* p, uint32_t v) {
+            for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+
+        uint32_t GetU32(const uint8_t* p) {
+            return p[0] | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+        }
+
+        /**
+         * @brief 两个载荷的汉明距离；超过bound后提前返回（此时返回值只保证大于bound）
+         */
+        size_t DistanceGeneric(const uint64_t* a, const uint64_t* b, size_t words, size_t bound) {
+            size_t d = 0;
+            for (size_t w = 0; w < words && d <= bound; ++w) {
+                d += std::bitset<64>(a[w] ^ b[w]).count();
+            }
+            return d;
+        }
+
+#if defined(LSB_X86)
+        LSB_TARGET_POPCNT size_t DistancePopcnt(const uint64_t* a, const uint64_t* b, size_t words, size_t bound) {
+            size_t d = 0;
+            for (size_t w = 0; w < words && d <= bound; ++w) {
+#if defined(_MSC_VER)
+                d += static_cast<size_t>(__popcnt64(a[w] ^ b[w]));
+#else
+                d += static_cast<size_t>(__builtin_popcountll(a[w] ^ b[w]));
+#endif
+            }
+            return d;
+        }
+
+        bool HasPopcnt() {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] >> 23) & 1;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("popcnt");
+#endif
+        }
+#endif
+
+        /**
+         * @brief 扫描全部载荷，维护距离最小的topK个（按距离、序号升序）；
+         * 已满topK后，距离上界收紧为第K名的距离，超过上界的行提前放弃
+         */
+        template<size_t (*Distance)(const uint64_t*, const uint64_t*, size_t, size_t)>
+        std::vector<LeakMatch> Scan(const uint64_t* payloads, size_t rows, size_t words, const uint64_t* query,
+            size_t topK, size_t maxDistance) {
+            std::vector<LeakMatch> best;
+            if (topK == 0) return best;
+            best.reserve(topK + 1);
+            size_t bound = maxDistance;
+            for (size_t r = 0; r < rows; ++r) {
+                size_t d = Distance(payloads + r * words, query, words, bound);
+                if (d > bound) continue;
+
+                auto pos = std::upper_bound(best.begin(), best.end(), d,
+                    [](size_t v, const LeakMatch& m) { return v < m.distance; });
+                best.insert(pos, LeakMatch{ r, d });
+                if (best.size() > topK) best.pop_back();
+                if (best.size() == topK) bound = std::min(bound, best.back().distance);
+            }
+            return best;
+        }
+
+    } // namespace
+
+    Fingerprint FingerprintPixels(const uint8_t* pixels, size_t size) {
+        Fingerprint f;
+        gmsm_sm3(pixels, size, f.data());
+        return f;
+    }
+
+    size_t LeakIndex::FingerprintHash::operator()(const Fingerprint& f) const {
+        uint64_t h;
+        std::memcpy(&h, f.data(), sizeof(h));  // 指纹本身是SM3输出，直接截取
+        return static_cast<size_t>(h);
+    }
+
+    LeakIndex::LeakIndex(size_t payloadBits, const std::string& path)
+        : payloadBits_(payloadBits), words_((payloadBits + 63) / 64), path_(path) {
+        if (path_.empty()) {
+            return;
+        }
+        FILE* fp = std::fopen(path_.c_str(), "rb");
+        if (!fp) {
+            return;
+        }
+
+        std::vector<uint8_t> data;
+        uint8_t buf[65536];
+        size_t got;
+        while ((got = std::fread(buf, 1, sizeof(buf), fp)) > 0) {
+            data.insert(data.end(), buf, buf + got);
+        }
+        std::fclose(fp);
+
+        if (data.size() < INDEX_HEADER_SIZE ||
+            std::memcmp(data.data(), INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+            GetU32(data.data() + 8) != INDEX_VERSION ||
+            GetU32(data.data() + 12) != static_cast<uint32_t>(payloadBits_)) {
+            foreign_ = !data.empty();  // 空文件可以当作新文件写入
+            return;
+        }
+
+        // 逐条读入；末尾不完整的记录（写入中途崩溃）被忽略，下次Flush时截断
+        const size_t payloadBytes = (payloadBits_ + 7) / 8;
+        size_t pos = INDEX_HEADER_SIZE;
+        while (pos + 2 <= data.size()) {
+            size_t len = data[pos] | (size_t(data[pos + 1]) << 8);
+            size_t end = pos + 2 + len + 32 + payloadBytes;
+            if (end > data.size()) break;
+            std::string recipient(reinterpret_cast<const char*>(data.data() + pos + 2), len);
+            Fingerprint f;
+            std::memcpy(f.data(), data.data() + pos + 2 + len, f.size());
+            if (byFingerprint_.count(f) == 0) {
+                Append(recipient, data.data() + pos + 2 + len + 32, f);
+            }
+            pos = end;
+        }
+        validBytes_ = pos;
+        flushed_ = recipients_.size();
+    }
+
+    LeakIndex::~LeakIndex() {
+        Flush();
+    }
+
+    void LeakIndex::PackWords(const uint8_t* bytes, uint64_t* words) const {
+        // 第i位（MSB优先）放在第 i/64 个字的第 63 - i%64 位，末尾多余的位清零
+        const size_t payloadBytes = (payloadBits_ + 7) / 8;
+        std::memset(words, 0, words_ * sizeof(uint64_t));
+        for (size_t i = 0; i < payloadBytes; ++i) {
+            words[i / 8] |= static_cast<uint64_t>(bytes[i]) << (56 - 8 * (i % 8));
+        }
+        if (payloadBits_ % 64) {
+            words[words_ - 1] &= ~0ULL << (64 - payloadBits_ % 64);
+        }
+    }
+
+    void LeakIndex::Append(const std::string& recipient, const uint8_t* payload, const Fingerprint& fingerprint) {
+        size_t index = recipients_.size();
+        payloads_.resize((index + 1) * words_);
+        PackWords(payload, payloads_.data() + index * words_);
+        recipients_.push_back(recipient);
+        fingerprints_.push_back(fingerprint);
+        byFingerprint_.emplace(fingerprint, index);
+    }
+
+    bool LeakIndex::Add(const std::string& recipient, const uint8_t* payload, const Fingerprint& fingerprint) {
+        if (byFingerprint_.count(fingerprint)) {
+            return false;
+        }
+        Append(recipient.size() > MAX_RECIPIENT ? recipient.substr(0, MAX_RECIPIENT) : recipient, payload, fingerprint);
+        return true;
+    }
+
+    bool LeakIndex::FindFingerprint(const Fingerprint& fingerprint, size_t& index) const {
+        auto it = byFingerprint_.find(fingerprint);
+        if (it == byFingerprint_.end()) {
+            return false;
+        }
+        index = it->second;
+        return true;
+    }
+
+    std::vector<LeakMatch> LeakIndex::Search(const uint8_t* bits, size_t topK, size_t maxDistance) const {
+        std::vector<uint64_t> query(words_);
+        PackWords(bits, query.data());
+#if defined(LSB_X86)
+        static const bool popcnt = HasPopcnt();
+        if (popcnt) {
+            return Scan<DistancePopcnt>(payloads_.data(), Size(), words_, query.data(), topK, maxDistance);
+        }
+#endif
+        return Scan<DistanceGeneric>(payloads_.data(), Size(), words_, query.data(), topK, maxDistance);
+    }
+
+    bool LeakIndex::Flush() {
+        if (foreign_) {
+            return false;  // 不能用"wb"重写：那会清掉别的索引或载荷位数不同的旧索引
+        }
+        if (path_.empty() || flushed_ == recipients_.size()) {
+            return true;
+        }
+
+        std::error_code ec;
+        FILE* fp = nullptr;
+        if (validBytes_ == 0) {
+            // 新文件（或空文件）：写文件头
+            fp = std::fopen(path_.c_str(), "wb");
+            if (!fp) return false;
+            uint8_t header[INDEX_HEADER_SIZE] = { 0 };
+            std::memcpy(header, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+            PutU32(header + 8, INDEX_VERSION);
+            PutU32(header + 12, static_cast<uint32_t>(payloadBits_));
+            if (std::fwrite(header, 1, INDEX_HEADER_SIZE, fp) != INDEX_HEADER_SIZE) {
+                std::fclose(fp);
+                return false;
+            }
+            validBytes_ = INDEX_HEADER_SIZE;
+        }
+        else {
+            if (std::filesystem::file_size(path_, ec) != validBytes_ && !ec) {
+                std::filesystem::resize_file(path_, validBytes_, ec);  // 去掉不完整的尾部记录
+            }
+            fp = std::fopen(path_.c_str(), "ab");
+            if (!fp) return false;
+        }
+
+        std::vector<uint8_t> buf;
+        const size_t payloadBytes = (payloadBits_ + 7) / 8;
+        for (size_t i = flushed_; i < recipients_.size(); ++i) {
+            const std::string& r = recipients_[i];
+            buf.push_back(static_cast<uint8_t>(r.size()));
+            buf.push_back(static_cast<uint8_t>(r.size() >> 8));
+            buf.insert(buf.end(), r.begin(), r.end());
+            buf.insert(buf.end(), fingerprints_[i].begin(), fingerprints_[i].end());
+            const uint64_t* words = payloads_.data() + i * words_;
+            for (size_t b = 0; b < payloadBytes; ++b) {
+                buf.push_back(static_cast<uint8_t>(words[b / 8] >> (56 - 8 * (b % 8))));
+            }
+        }
+        bool ok = std::fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+        ok = (std::fclose(fp) == 0) && ok;
+        if (ok) {
+            validBytes_ += buf.size();
+            flushed_ = recipients_.size();
+        }
+        return ok;
+    }
+
+} // namespace LSB
@@ -0,0 +1,94 @@
+﻿#ifndef LSB_LEAK_INDEX_H
+#define LSB_LEAK_INDEX_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 泄露溯源索引：记录每个接收方副本的水印载荷（定长比特串）和副本像素的SM3指纹。
+// 可疑图像先按指纹精确查找（未被修改的原副本），否则把提取出的载荷与全部接收方
+// 一次扫描比较汉明距离（载荷按64位字紧密排列，popcount计数）
+
+namespace LSB {
+
+    using Fingerprint = std::array<uint8_t, 32>;
+
+    struct LeakMatch {
+        size_t index;      // 接收方序号（添加顺序）
+        size_t distance;   // 汉明距离
+    };
+
+    /**
+     * @brief 计算像素缓冲区的SM3指纹
+     */
+    Fingerprint FingerprintPixels(const uint8_t* pixels, size_t size);
+
+    class LeakIndex {
+    public:
+        /**
+         * @brief 创建索引；path非空时从文件载入，新记录在Flush时追加写入
+         * @param payloadBits 每个接收方载荷的比特数（文件头不符或记录的值不一致时不载入，也不写入，见Writable）
+         */
+        LeakIndex(size_t payloadBits, const std::string& path = std::string());
+        ~LeakIndex();
+
+        size_t PayloadBits() const { return payloadBits_; }
+        size_t Size() const { return recipients_.size(); }
+
+        /**
+         * @brief 文件不是本格式或payloadBits不同时为false，此时Flush失败，不覆盖已有文件
+         */
+        bool Writable() const { return !foreign_; }
+        const std::string& Recipient(size_t index) const { return recipients_[index]; }
+
+        /**
+         * @brief 登记一个已发放的副本
+         * @param payload MSB优先打包的载荷，至少 ceil(payloadBits / 8) 字节
+         * @return 指纹已存在时返回false，不重复登记
+         */
+        bool Add(const std::string& recipient, const uint8_t* payload, const Fingerprint& fingerprint);
+
+        /**
+         * @brief 按指纹精确查找
+         * @return 找到返回true，index为接收方序号
+         */
+        bool FindFingerprint(const Fingerprint& fingerprint, size_t& index) const;
+
+        /**
+         * @brief 汉明距离最近的topK个接收方，按距离升序
+         * @param bits MSB优先打包的提取结果，至少 ceil(payloadBits / 8) 字节
+         * @param maxDistance 只返回距离不超过该值的接收方
+         */
+        std::vector<LeakMatch> Search(const uint8_t* bits, size_t topK, size_t maxDistance) const;
+
+        /**
+         * @brief 把新登记的记录追加写入文件（未指定路径时直接返回true，!Writable()时返回false）
+         */
+        bool Flush();
+
+    private:
+        struct FingerprintHash {
+            size_t operator()(const Fingerprint& f) const;
+        };
+
+        void Append(const std::string& recipient, const uint8_t* payload, const Fingerprint& fingerprint);
+        void PackWords(const uint8_t* bytes, uint64_t* words) const;
+
+        size_t payloadBits_;
+        size_t words_;                        // 每个载荷占用的64位字数
+        std::string path_;
+        std::vector<uint64_t> payloads_;      // Size() x words_，末字多余的位为0
+        std::vector<std::string> recipients_;
+        std::vector<Fingerprint> fingerprints_;
+        std::unordered_map<Fingerprint, size_t, FingerprintHash> byFingerprint_;
+        size_t flushed_ = 0;                  // 已写盘的记录数
+        uint64_t validBytes_ = 0;             // 文件中有效内容的长度
+        bool foreign_ = false;                // 文件已存在但文件头不符
+    };
+
+} // namespace LSB
+
+#endif // LSB_LEAK_INDEX_H
@@ -0,0 +1,282 @@
+﻿#include "lsb_kernel.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LSB_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LSB_TARGET_AVX2
+#define LSB_TARGET_BMI2
+#else
+#define LSB_TARGET_AVX2 __attribute__((target("avx2,bmi2")))
+#define LSB_TARGET_BMI2 __attribute__((target("bmi2")))
+#endif
+#endif
+
+namespace LSB {
+
+    namespace {
+
+        enum class Isa { Scalar, Bmi2, Avx2Bmi2 };
+
+        inline uint32_t LowMask(int d) {
+            return (1u << d) - 1;
+        }
+
+        inline uint32_t GetBit(const uint8_t* bits, size_t i) {
+            return (bits[i >> 3] >> (7 - (i & 7))) & 1;
+        }
+
+        inline uint64_t Bswap64(uint64_t v) {
+#if defined(_MSC_VER)
+            return _byteswap_uint64(v);
+#else
+            return __builtin_bswap64(v);
+#endif
+        }
+
+        // 每个字节低d位为1的64位掩码
+        inline uint64_t LaneMask(int d) {
+            return 0x0101010101010101ULL * LowMask(d);
+        }
+
+        // 8个像素承载 8*d 位 = d 字节，按大端读写
+        inline uint64_t LoadGroupBits(const uint8_t* p, int d) {
+            uint64_t r = 0;
+            for (int i = 0; i < d; ++i) r = (r << 8) | p[i];
+            return r;
+        }
+
+        inline void StoreGroupBits(uint8_t* p, int d, uint64_t r) {
+            for (int i = d - 1; i >= 0; --i) {
+                p[i] = static_cast<uint8_t>(r);
+                r >>= 8;
+            }
+        }
+
+        /**
+         * @brief 从像素start开始逐字节嵌入，start*d必须是8的倍数
+         */
+        void EmbedTail(uint8_t* pixels, int d, const uint8_t* bits, size_t bitCount, size_t start) {
+            const uint32_t mask = LowMask(d);
+            for (size_t px = start, i = start * d; i < bitCount; ++px) {
+                uint32_t value = 0;
+                for (int b = 0; b < d && i < bitCount; ++b, ++i) {
+                    value = (value << 1) | GetBit(bits, i);
+                }
+                pixels[px] = static_cast<uint8_t>((pixels[px] & ~mask) | value);
+            }
+        }
+
+        void ExtractTail(const uint8_t* pixels, int d, uint8_t* out, size_t bitCount, size_t start) {
+            size_t first = start * d;
+            std::memset(out + first / 8, 0, (bitCount + 7) / 8 - first / 8);
+            for (size_t px = start, i = first; i < bitCount; ++px) {
+                uint32_t value = pixels[px];
+                for (int b = d - 1; b >= 0 && i < bitCount; --b, ++i) {
+                    if ((value >> b) & 1) out[i >> 3] |= static_cast<uint8_t>(0x80 >> (i & 7));
+                }
+            }
+        }
+
+#if defined(LSB_X86)
+        Isa DetectIsa() {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) return Isa::Scalar;
+            __cpuidex(info, 7, 0);
+            bool bmi2 = (info[1] >> 8) & 1;
+            bool avx2 = (info[1] >> 5) & 1;
+            __cpuid(info, 1);
+            bool osxsave = (info[2] >> 27) & 1;
+            bool ymm = osxsave && ((_xgetbv(0) & 6) == 6);
+#else
+            __builtin_cpu_init();
+            bool bmi2 = __builtin_cpu_supports("bmi2");
+            bool avx2 = __builtin_cpu_supports("avx2");
+            bool ymm = true;  // __builtin_cpu_supports已检查操作系统对YMM状态的支持
+#endif
+            if (avx2 && bmi2 && ymm) return Isa::Avx2Bmi2;
+            if (bmi2) return Isa::Bmi2;
+            return Isa::Scalar;
+        }
+
+        /**
+         * @brief BMI2：每8个像素一次pdep/pext
+         * 64位小端读入后字节反转，使像素0位于最高字节，pdep/pext保持位序，正好对应MSB优先的比特流
+         */
+        LSB_TARGET_BMI2 void EmbedGroupsBmi2(uint8_t* pixels, int d, const uint8_t* bits, size_t groups) {
+            const uint64_t mask = LaneMask(d);
+            for (size_t g = 0; g < groups; ++g) {
+                uint64_t dep = _pdep_u64(LoadGroupBits(bits + g * d, d), mask);
+                uint64_t pix;
+                std::memcpy(&pix, pixels + g * 8, 8);
+                pix = (pix & ~mask) | Bswap64(dep);
+                std::memcpy(pixels + g * 8, &pix, 8);
+            }
+        }
+
+        LSB_TARGET_BMI2 void ExtractGroupsBmi2(const uint8_t* pixels, int d, uint8_t* out, size_t groups) {
+            const uint64_t mask = LaneMask(d);
+            for (size_t g = 0; g < groups; ++g) {
+                uint64_t pix;
+                std::memcpy(&pix, pixels + g * 8, 8);
+                StoreGroupBits(out + g * d, d, _pext_u64(Bswap64(pix), mask));
+            }
+        }
+
+        // 每个64位通道内的字节反转
+        LSB_TARGET_AVX2 inline __m256i ReverseLanes(__m256i v) {
+            const __m256i idx = _mm256_setr_epi8(
+                7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+            return _mm256_shuffle_epi8(v, idx);
+        }
+
+        /**
+         * @brief AVX2：每次处理32个像素字节（4组），掩码清位与合并在向量寄存器中完成；
+         * bitDepth = 1 时直接用字节比较/movemask展开与收集比特，不需要pdep/pext
+         */
+        LSB_TARGET_AVX2 void EmbedGroupsAvx2(uint8_t* pixels, int d, const uint8_t* bits, size_t groups) {
+            const __m256i keep = _mm256_set1_epi8(static_cast<char>(~LowMask(d)));
+            size_t g = 0;
+            if (d == 1) {
+                // 比特流第j/8字节的第(7 - j%8)位 -> 像素j
+                const __m256i spread = _mm256_setr_epi8(
+                    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                    2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+                const __m256i select = _mm256_setr_epi8(
+                    -128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1,
+                    -128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+                const __m256i one = _mm256_set1_epi8(1);
+                for (; g + 4 <= groups; g += 4) {
+                    uint32_t word;
+                    std::memcpy(&word, bits + g, 4);
+                    __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(static_cast<int>(word)), spread);
+                    v = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(v, select), select), one);
+                    __m256i pix = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + g * 8));
+                    pix = _mm256_or_si256(_mm256_and_si256(pix, keep), v);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + g * 8), pix);
+                }
+            }
+            else {
+                const uint64_t mask = LaneMask(d);
+                for (; g + 4 <= groups; g += 4) {
+                    const uint8_t* src = bits + g * d;
+                    __m256i dep = _mm256_setr_epi64x(
+                        static_cast<long long>(_pdep_u64(LoadGroupBits(src, d), mask)),
+                        static_cast<long long>(_pdep_u64(LoadGroupBits(src + d, d), mask)),
+                        static_cast<long long>(_pdep_u64(LoadGroupBits(src + 2 * d, d), mask)),
+                        static_cast<long long>(_pdep_u64(LoadGroupBits(src + 3 * d, d), mask)));
+                    __m256i pix = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + g * 8));
+                    pix = _mm256_or_si256(_mm256_and_si256(pix, keep), ReverseLanes(dep));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + g * 8), pix);
+                }
+            }
+            EmbedGroupsBmi2(pixels + g * 8, d, bits + g * d, groups - g);
+        }
+
+        LSB_TARGET_AVX2 void ExtractGroupsAvx2(const uint8_t* pixels, int d, uint8_t* out, size_t groups) {
+            size_t g = 0;
+            if (d == 1) {
+                for (; g + 4 <= groups; g += 4) {
+                    __m256i pix = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + g * 8));
+                    // 字节反转后把每字节的最低位移到最高位，movemask的第g字节即比特流第g字节
+                    uint32_t word = static_cast<uint32_t>(
+                        _mm256_movemask_epi8(_mm256_slli_epi16(ReverseLanes(pix), 7)));
+                    std::memcpy(out + g, &word, 4);
+                }
+            }
+            else {
+                const __m256i low = _mm256_set1_epi8(static_cast<char>(LowMask(d)));
+                const uint64_t mask = LaneMask(d);
+                for (; g + 4 <= groups; g += 4) {
+                    __m256i pix = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + g * 8));
+                    pix = ReverseLanes(_mm256_and_si256(pix, low));
+                    uint8_t* dst = out + g * d;
+                    StoreGroupBits(dst, d, _pext_u64(static_cast<uint64_t>(_mm256_extract_epi64(pix, 0)), mask));
+                    StoreGroupBits(dst + d, d, _pext_u64(static_cast<uint64_t>(_mm256_extract_epi64(pix, 1)), mask));
+                    StoreGroupBits(dst + 2 * d, d, _pext_u64(static_cast<uint64_t>(_mm256_extract_epi64(pix, 2)), mask));
+                    StoreGroupBits(dst + 3 * d, d, _pext_u64(static_cast<uint64_t>(_mm256_extract_epi64(pix, 3)), mask));
+                }
+            }
+            ExtractGroupsBmi2(pixels + g * 8, d, out + g * d, groups - g);
+        }
+#else
+        Isa DetectIsa() {
+            return Isa::Scalar;
+        }
+#endif
+
+        Isa CurrentIsa() {
+            static const Isa isa = DetectIsa();
+            return isa;
+        }
+
+    } // namespace
+
+    size_t Embed(uint8_t* pixels, size_t size, int bitDepth, const uint8_t* bits, size_t bitCount) {
+        if (bitDepth < 1 || bitDepth > 8) return 0;
+        if (bitCount > size * bitDepth) bitCount = size * bitDepth;
+
+        // 完整的8像素组走向量/BMI2路径，剩余部分逐字节处理
+        size_t groups = bitCount / (8 * static_cast<size_t>(bitDepth));
+        size_t start = 0;
+#if defined(LSB_X86)
+        switch (CurrentIsa()) {
+        case Isa::Avx2Bmi2:
+            EmbedGroupsAvx2(pixels, bitDepth, bits, groups);
+            start = groups * 8;
+            break;
+        case Isa::Bmi2:
+            EmbedGroupsBmi2(pixels, bitDepth, bits, groups);
+            start = groups * 8;
+            break;
+        default:
+            break;
+        }
+#else
+        (void)groups;
+#endif
+        EmbedTail(pixels, bitDepth, bits, bitCount, start);
+        return bitCount;
+    }
+
+    size_t Extract(const uint8_t* pixels, size_t size, int bitDepth, uint8_t* out, size_t bitCount) {
+        if (bitDepth < 1 || bitDepth > 8) return 0;
+        if (bitCount > size * bitDepth) bitCount = size * bitDepth;
+
+        size_t groups = bitCount / (8 * static_cast<size_t>(bitDepth));
+        size_t start = 0;
+#if defined(LSB_X86)
+        switch (CurrentIsa()) {
+        case Isa::Avx2Bmi2:
+            ExtractGroupsAvx2(pixels, bitDepth, out, groups);
+            start = groups * 8;
+            break;
+        case Isa::Bmi2:
+            ExtractGroupsBmi2(pixels, bitDepth, out, groups);
+            start = groups * 8;
+            break;
+        default:
+            break;
+        }
+#else
+        (void)groups;
+#endif
+        ExtractTail(pixels, bitDepth, out, bitCount, start);
+        return bitCount;
+    }
+
+    const char* Backend() {
+        switch (CurrentIsa()) {
+        case Isa::Avx2Bmi2: return "avx2+bmi2";
+        case Isa::Bmi2: return "bmi2";
+        default: return "scalar";
+        }
+    }
+
+} // namespace LSB
@@ -0,0 +1,40 @@
+﻿#ifndef LSB_KERNEL_H
+#define LSB_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// LSB水印嵌入/提取内核
+// 像素缓冲区为连续存放的原始像素字节（按行、按通道的光栅顺序，与cv2读入的数组相同），
+// 每个字节承载bitDepth位；比特流为MSB优先的紧凑字节串，与lsb_watermark_system.py中的'0'/'1'字符串顺序一致
+
+namespace LSB {
+
+    /**
+     * @brief 把比特流嵌入像素的低bitDepth位（原地修改）
+     * @param pixels 像素字节
+     * @param size 像素字节数
+     * @param bitDepth 每字节使用的低位数（1~8）
+     * @param bits MSB优先打包的比特流
+     * @param bitCount 比特数；超过容量size*bitDepth的部分被截断
+     * @return 实际嵌入的比特数；bitDepth非法时返回0
+     * 与Python实现一致：比特流末尾不足bitDepth位的一段按数值写入最低位
+     */
+    size_t Embed(uint8_t* pixels, size_t size, int bitDepth, const uint8_t* bits, size_t bitCount);
+
+    /**
+     * @brief 从像素的低bitDepth位提取比特流
+     * @param out 输出缓冲区，至少 (bitCount + 7) / 8 字节；最后一个字节未用到的低位补零
+     * @param bitCount 要提取的比特数；超过容量的部分被截断
+     * @return 实际提取的比特数
+     */
+    size_t Extract(const uint8_t* pixels, size_t size, int bitDepth, uint8_t* out, size_t bitCount);
+
+    /**
+     * @brief 当前CPU上使用的实现："avx2+bmi2"、"bmi2" 或 "scalar"
+     */
+    const char* Backend();
+
+} // namespace LSB
+
+#endif // LSB_KERNEL_H
@@ -0,0 +1,500 @@
+﻿// lsb_watermark_system.py 使用的原生扩展模块（CPython C API）
+// 编译：python setup.py build_ext --inplace
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "keyed_placement.h"
+#include "leak_index.h"
+#include "lsb_kernel.h"
+#include "robustness.h"
+
+namespace {
+
+    /**
+     * @brief embed(pixels, bits, bit_count, bit_depth) -> int
+     * pixels: 可写、C连续的像素缓冲区（如np.uint8数组），原地修改
+     * bits: MSB优先打包的比特流
+     * 返回实际嵌入的比特数
+     */
+    PyObject* Embed(PyObject*, PyObject* args) {
+        PyObject* pixelsObj;
+        Py_buffer bits;
+        Py_ssize_t bitCount;
+        int bitDepth;
+        if (!PyArg_ParseTuple(args, "Oy*ni", &pixelsObj, &bits, &bitCount, &bitDepth)) {
+            return nullptr;
+        }
+        Py_buffer pixels;
+        if (PyObject_GetBuffer(pixelsObj, &pixels, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) != 0) {
+            PyBuffer_Release(&bits);
+            return nullptr;
+        }
+        if (bitDepth < 1 || bitDepth > 8 || bitCount < 0 || (bitCount + 7) / 8 > bits.len) {
+            PyBuffer_Release(&pixels);
+            PyBuffer_Release(&bits);
+            PyErr_SetString(PyExc_ValueError, "bit_depth必须在1~8之间，且bits至少包含bit_count位");
+            return nullptr;
+        }
+
+        size_t embedded;
+        Py_BEGIN_ALLOW_THREADS
+        embedded = LSB::Embed(static_cast<uint8_t*>(pixels.buf), static_cast<size_t>(pixels.len), bitDepth,
+            static_cast<const uint8_t*>(bits.buf), static_cast<size_t>(bitCount));
+        Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&pixels);
+        PyBuffer_Release(&bits);
+        return PyLong_FromSize_t(embedded);
+    }
+
+    /**
+     * @brief extract(pixels, bit_depth, bit_count) -> bytes
+     * 返回MSB优先打包的比特流，长度为 ceil(min(bit_count, 容量) / 8)
+     */
+    PyObject* Extract(PyObject*, PyObject* args) {
+        Py_buffer pixels;
+        int bitDepth;
+        Py_ssize_t bitCount;
+        if (!PyArg_ParseTuple(args, "y*in", &pixels, &bitDepth, &bitCount)) {
+            return nullptr;
+        }
+        if (bitDepth < 1 || bitDepth > 8 || bitCount < 0) {
+            PyBuffer_Release(&pixels);
+            PyErr_SetString(PyExc_ValueError, "bit_depth必须在1~8之间");
+            return nullptr;
+        }
+        Py_ssize_t capacity = pixels.len * bitDepth;
+        if (bitCount > capacity) bitCount = capacity;
+
+        PyObject* result = PyBytes_FromStringAndSize(nullptr, (bitCount + 7) / 8);
+        if (result) {
+            uint8_t* out = reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(result));
+            Py_BEGIN_ALLOW_THREADS
+            LSB::Extract(static_cast<const uint8_t*>(pixels.buf), static_cast<size_t>(pixels.len), bitDepth,
+                out, static_cast<size_t>(bitCount));
+            Py_END_ALLOW_THREADS
+        }
+        PyBuffer_Release(&pixels);
+        return result;
+    }
+
+    /**
+     * @brief embed_keyed(pixels, bits, bit_count, bit_depth, key) -> int
+     * 同embed，但第j个载荷块写入由16字节SM4密钥决定的伪随机像素位置
+     */
+    PyObject* EmbedKeyed(PyObject*, PyObject* args) {
+        PyObject* pixelsObj;
+        Py_buffer bits, key;
+        Py_ssize_t bitCount;
+        int bitDepth;
+        if (!PyArg_ParseTuple(args, "Oy*niy*", &pixelsObj, &bits, &bitCount, &bitDepth, &key)) {
+            return nullptr;
+        }
+        Py_buffer pixels;
+        if (PyObject_GetBuffer(pixelsObj, &pixels, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) != 0) {
+            PyBuffer_Release(&bits);
+            PyBuffer_Release(&key);
+            return nullptr;
+        }
+        if (bitDepth < 1 || bitDepth > 8 || bitCount < 0 || (bitCount + 7) / 8 > bits.len || key.len != 16) {
+            PyBuffer_Release(&pixels);
+            PyBuffer_Release(&bits);
+            PyBuffer_Release(&key);
+            PyErr_SetString(PyExc_ValueError, "bit_depth必须在1~8之间，bits至少包含bit_count位，key必须为16字节");
+            return nullptr;
+        }
+
+        size_t embedded;
+        Py_BEGIN_ALLOW_THREADS
+        embedded = LSB::EmbedKeyed(static_cast<uint8_t*>(pixels.buf), static_cast<size_t>(pixels.len), bitDepth,
+            static_cast<const uint8_t*>(bits.buf), static_cast<size_t>(bitCount), static_cast<const uint8_t*>(key.buf));
+        Py_END_ALLOW_THREADS
+
+        PyBuffer_Release(&pixels);
+        PyBuffer_Release(&bits);
+        PyBuffer_Release(&key);
+        return PyLong_FromSize_t(embedded);
+    }
+
+    /**
+     * @brief extract_keyed(pixels, bit_depth, bit_count, key) -> bytes
+     */
+    PyObject* ExtractKeyed(PyObject*, PyObject* args) {
+        Py_buffer pixels, key;
+        int bitDepth;
+        Py_ssize_t bitCount;
+        if (!PyArg_ParseTuple(args, "y*iny*", &pixels, &bitDepth, &bitCount, &key)) {
+            return nullptr;
+        }
+        if (bitDepth < 1 || bitDepth > 8 || bitCount < 0 || key.len != 16) {
+            PyBuffer_Release(&pixels);
+            PyBuffer_Release(&key);
+            PyErr_SetString(PyExc_ValueError, "bit_depth必须在1~8之间，key必须为16字节");
+            return nullptr;
+        }
+        Py_ssize_t capacity = pixels.len * bitDepth;
+        if (bitCount > capacity) bitCount = capacity;
+
+        PyObject* result = PyBytes_FromStringAndSize(nullptr, (bitCount + 7) / 8);
+        if (result) {
+            uint8_t* out = reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(result));
+            Py_BEGIN_ALLOW_THREADS
+            LSB::ExtractKeyed(static_cast<const uint8_t*>(pixels.buf), static_cast<size_t>(pixels.len), bitDepth,
+                out, static_cast<size_t>(bitCount), static_cast<const uint8_t*>(key.buf));
+            Py_END_ALLOW_THREADS
+        }
+        PyBuffer_Release(&pixels);
+        PyBuffer_Release(&key);
+        return result;
+    }
+
+    bool ParseAttackType(const char* name, LSB::AttackType& type) {
+        static const struct { const char* name; LSB::AttackType type; } table[] = {
+            { "rotation", LSB::AttackType::Rotation },
+            { "scaling", LSB::AttackType::Scaling },
+            { "brightness", LSB::AttackType::Brightness },
+            { "noise", LSB::AttackType::Noise },
+            { "blur", LSB::AttackType::Blur },
+        };
+        for (const auto& entry : table) {
+            if (std::strcmp(entry.name, name) == 0) {
+                type = entry.type;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief test_robustness(pixels, height, width, channels, bit_depth, watermark, attacks,
+     *                        keep_images=False, threads=0) -> list[dict]
+     * attacks: [(攻击类型, 参数), ...]，类型为 rotation/scaling/brightness/noise/blur
+     * 每个结果包含 extracted_watermark、similarity、attack_ms、extract_ms、image（bytes或None）
+     */
+    PyObject* TestRobustness(PyObject*, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = { "pixels", "height", "width", "channels", "bit_depth", "watermark",
+            "attacks", "keep_images", "threads", nullptr };
+        Py_buffer pixels;
+        int height, width, channels, bitDepth, keepImages = 0;
+        unsigned threads = 0;
+        PyObject* watermarkObj;
+        PyObject* attacksObj;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "y*iiiiUO|pI", const_cast<char**>(keywords),
+            &pixels, &height, &width, &channels, &bitDepth, &watermarkObj, &attacksObj, &keepImages, &threads)) {
+            return nullptr;
+        }
+
+        LSB::Image image;
+        image.height = height;
+        image.width = width;
+        image.channels = channels;
+        if (height <= 0 || width <= 0 || channels <= 0 || bitDepth < 1 || bitDepth > 8 ||
+            static_cast<Py_ssize_t>(height) * width * channels != pixels.len) {
+            PyBuffer_Release(&pixels);
+            PyErr_SetString(PyExc_ValueError, "图像尺寸与缓冲区长度不符，或bit_depth不在1~8之间");
+            return nullptr;
+        }
+        image.data.assign(static_cast<const uint8_t*>(pixels.buf), static_cast<const uint8_t*>(pixels.buf) + pixels.len);
+        PyBuffer_Release(&pixels);
+
+        Py_UCS4* ucs4 = PyUnicode_AsUCS4Copy(watermarkObj);
+        if (!ucs4) return nullptr;
+        std::u32string watermark(ucs4, ucs4 + PyUnicode_GET_LENGTH(watermarkObj));
+        PyMem_Free(ucs4);
+
+        PyObject* seq = PySequence_Fast(attacksObj, "attacks必须是序列");
+        if (!seq) return nullptr;
+        std::vector<LSB::Attack> attacks;
+        for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+            const char* name;
+            double param;
+            LSB::Attack attack;
+            if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(seq, i), "sd", &name, &param)) {
+                Py_DECREF(seq);
+                return nullptr;
+            }
+            if (!ParseAttackType(name, attack.type)) {
+                Py_DECREF(seq);
+                PyErr_Format(PyExc_ValueError, "未知的攻击类型: %s", name);
+                return nullptr;
+            }
+            attack.param = param;
+            attacks.push_back(attack);
+        }
+        Py_DECREF(seq);
+
+        std::vector<LSB::AttackResult> results;
+        Py_BEGIN_ALLOW_THREADS
+        results = LSB::RunRobustness(image, bitDepth, watermark, attacks, keepImages != 0, threads);
+        Py_END_ALLOW_THREADS
+
+        PyObject* list = PyList_New(static_cast<Py_ssize_t>(results.size()));
+        if (!list) return nullptr;
+        for (size_t i = 0; i < results.size(); ++i) {
+            const LSB::AttackResult& r = results[i];
+            PyObject* imageObj = r.image.data.empty()
+                ? (Py_INCREF(Py_None), Py_None)
+                : PyBytes_FromStringAndSize(reinterpret_cast<const char*>(r.image.data.data()),
+                    static_cast<Py_ssize_t>(r.image.data.size()));
+            PyObject* item = imageObj ? Py_BuildValue("{s:s#,s:d,s:d,s:d,s:N}",
+                "extracted_watermark", r.extracted.data(), static_cast<Py_ssize_t>(r.extracted.size()),
+                "similarity", r.similarity, "attack_ms", r.attackMs, "extract_ms", r.extractMs,
+                "image", imageObj) : nullptr;
+            if (!item) {
+                Py_DECREF(list);
+                return nullptr;
+            }
+            PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), item);
+        }
+        return list;
+    }
+
+    /**
+     * @brief fingerprint(pixels) -> bytes，像素缓冲区的32字节SM3指纹
+     */
+    PyObject* Fingerprint(PyObject*, PyObject* args) {
+        Py_buffer pixels;
+        if (!PyArg_ParseTuple(args, "y*", &pixels)) {
+            return nullptr;
+        }
+        LSB::Fingerprint f;
+        Py_BEGIN_ALLOW_THREADS
+        f = LSB::FingerprintPixels(static_cast<const uint8_t*>(pixels.buf), static_cast<size_t>(pixels.len));
+        Py_END_ALLOW_THREADS
+        PyBuffer_Release(&pixels);
+        return PyBytes_FromStringAndSize(reinterpret_cast<const char*>(f.data()), static_cast<Py_ssize_t>(f.size()));
+    }
+
+    // LeakIndex(payload_bits, path=None)：泄露溯源索引的Python包装
+    struct LeakIndexObject {
+        PyObject_HEAD
+        LSB::LeakIndex* index;
+    };
+
+    bool ParseFingerprint(const Py_buffer& buffer, LSB::Fingerprint& f) {
+        if (buffer.len != static_cast<Py_ssize_t>(f.size())) {
+            PyErr_SetString(PyExc_ValueError, "fingerprint必须为32字节");
+            return false;
+        }
+        std::memcpy(f.data(), buffer.buf, f.size());
+        return true;
+    }
+
+    int LeakIndexInit(LeakIndexObject* self, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = { "payload_bits", "path", nullptr };
+        Py_ssize_t payloadBits;
+        const char* path = nullptr;
+        if (!PyArg_ParseTupleAndKeywords(args, kwargs, "n|z", const_cast<char**>(keywords), &payloadBits, &path)) {
+            return -1;
+        }
+        if (payloadBits <= 0) {
+            PyErr_SetString(PyExc_ValueError, "payload_bits必须为正数");
+            return -1;
+        }
+        delete self->index;
+        self->index = nullptr;
+        Py_BEGIN_ALLOW_THREADS
+        self->index = new LSB::LeakIndex(static_cast<size_t>(payloadBits), path ? path : "");
+        Py_END_ALLOW_THREADS
+        if (!self->index->Writable()) {
+            PyErr_SetString(PyExc_ValueError, "索引文件不是泄露溯源索引，或payload_bits与文件头不一致");
+            return -1;
+        }
+        return 0;
+    }
+
+    void LeakIndexDealloc(LeakIndexObject* self) {
+        delete self->index;  // 析构时把未写盘的记录追加写入文件
+        Py_TYPE(self)->tp_free(reinterpret_cast<PyObject*>(self));
+    }
+
+    bool CheckIndex(LeakIndexObject* self) {
+        if (!self->index) {
+            PyErr_SetString(PyExc_RuntimeError, "LeakIndex未初始化");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief add(recipient, payload, fingerprint) -> bool
+     * payload: MSB优先打包的载荷，至少 ceil(payload_bits / 8) 字节；指纹已登记时返回False
+     */
+    PyObject* LeakIndexAdd(LeakIndexObject* self, PyObject* args) {
+        const char* recipient;
+        Py_ssize_t recipientLen;
+        Py_buffer payload, fingerprint;
+        if (!CheckIndex(self) ||
+            !PyArg_ParseTuple(args, "s#y*y*", &recipient, &recipientLen, &payload, &fingerprint)) {
+            return nullptr;
+        }
+        LSB::Fingerprint f;
+        bool valid = ParseFingerprint(fingerprint, f);
+        if (valid && static_cast<size_t>(payload.len) * 8 < self->index->PayloadBits()) {
+            PyErr_SetString(PyExc_ValueError, "payload长度不足payload_bits");
+            valid = false;
+        }
+        bool added = valid && self->index->Add(std::string(recipient, static_cast<size_t>(recipientLen)),
+            static_cast<const uint8_t*>(payload.buf), f);
+        PyBuffer_Release(&payload);
+        PyBuffer_Release(&fingerprint);
+        if (!valid) {
+            return nullptr;
+        }
+        return PyBool_FromLong(added);
+    }
+
+    /**
+     * @brief find_fingerprint(fingerprint) -> str | None
+     */
+    PyObject* LeakIndexFindFingerprint(LeakIndexObject* self, PyObject* args) {
+        Py_buffer fingerprint;
+        if (!CheckIndex(self) || !PyArg_ParseTuple(args, "y*", &fingerprint)) {
+            return nullptr;
+        }
+        LSB::Fingerprint f;
+        bool valid = ParseFingerprint(fingerprint, f);
+        PyBuffer_Release(&fingerprint);
+        if (!valid) {
+            return nullptr;
+        }
+        size_t index;
+        if (!self->index->FindFingerprint(f, index)) {
+            Py_RETURN_NONE;
+        }
+        const std::string& r = self->index->Recipient(index);
+        return PyUnicode_DecodeUTF8(r.data(), static_cast<Py_ssize_t>(r.size()), "replace");
+    }
+
+    /**
+     * @brief search(bits, top_k=5, max_distance=-1) -> list[(recipient, distance)]
+     * bits: MSB优先打包的提取结果；max_distance为负时不限制距离
+     */
+    PyObject* LeakIndexSearch(LeakIndexObject* self, PyObject* args, PyObject* kwargs) {
+        static const char* keywords[] = { "bits", "top_k", "max_distance", nullptr };
+        Py_buffer bits;
+        Py_ssize_t topK = 5, maxDistance = -1;
+        if (!CheckIndex(self) ||
+            !PyArg_ParseTupleAndKeywords(args, kwargs, "y*|nn", const_cast<char**>(keywords), &bits, &topK, &maxDistance)) {
+            return nullptr;
+        }
+        if (static_cast<size_t>(bits.len) * 8 < self->index->PayloadBits() || topK < 0) {
+            PyBuffer_Release(&bits);
+            PyErr_SetString(PyExc_ValueError, "bits长度不足payload_bits，或top_k为负");
+            return nullptr;
+        }
+
+        std::vector<LSB::LeakMatch> matches;
+        Py_BEGIN_ALLOW_THREADS
+        matches = self->index->Search(static_cast<const uint8_t*>(bits.buf), static_cast<size_t>(topK),
+            maxDistance < 0 ? self->index->PayloadBits() : static_cast<size_t>(maxDistance));
+        Py_END_ALLOW_THREADS
+        PyBuffer_Release(&bits);
+
+        PyObject* list = PyList_New(static_cast<Py_ssize_t>(matches.size()));
+        if (!list) return nullptr;
+        for (size_t i = 0; i < matches.size(); ++i) {
+            const std::string& r = self->index->Recipient(matches[i].index);
+            PyObject* item = Py_BuildValue("(Nn)",
+                PyUnicode_DecodeUTF8(r.data(), static_cast<Py_ssize_t>(r.size()), "replace"),
+                static_cast<Py_ssize_t>(matches[i].distance));
+            if (!item) {
+                Py_DECREF(list);
+                return nullptr;
+            }
+            PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), item);
+        }
+        return list;
+    }
+
+    PyObject* LeakIndexFlush(LeakIndexObject* self, PyObject*) {
+        if (!CheckIndex(self)) return nullptr;
+        return PyBool_FromLong(self->index->Flush());
+    }
+
+    PyObject* LeakIndexPayloadBits(LeakIndexObject* self, void*) {
+        if (!CheckIndex(self)) return nullptr;
+        return PyLong_FromSize_t(self->index->PayloadBits());
+    }
+
+    Py_ssize_t LeakIndexLength(LeakIndexObject* self) {
+        return self->index ? static_cast<Py_ssize_t>(self->index->Size()) : 0;
+    }
+
+    PyMethodDef leakIndexMethods[] = {
+        { "add", reinterpret_cast<PyCFunction>(LeakIndexAdd), METH_VARARGS,
+            "add(recipient, payload, fingerprint) -> bool" },
+        { "find_fingerprint", reinterpret_cast<PyCFunction>(LeakIndexFindFingerprint), METH_VARARGS,
+            "find_fingerprint(fingerprint) -> str | None" },
+        { "search", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(LeakIndexSearch)),
+            METH_VARARGS | METH_KEYWORDS, "search(bits, top_k=5, max_distance=-1) -> list[(recipient, distance)]" },
+        { "flush", reinterpret_cast<PyCFunction>(LeakIndexFlush), METH_NOARGS, "flush() -> bool" },
+        { nullptr, nullptr, 0, nullptr }
+    };
+
+    PyGetSetDef leakIndexGetSet[] = {
+        { "payload_bits", reinterpret_cast<getter>(LeakIndexPayloadBits), nullptr, "每个载荷的比特数", nullptr },
+        { nullptr, nullptr, nullptr, nullptr, nullptr }
+    };
+
+    PySequenceMethods leakIndexSequence = {
+        reinterpret_cast<lenfunc>(LeakIndexLength),
+    };
+
+    PyTypeObject leakIndexType = [] {
+        PyTypeObject t = { PyVarObject_HEAD_INIT(nullptr, 0) };
+        t.tp_name = "lsb_native.LeakIndex";
+        t.tp_basicsize = sizeof(LeakIndexObject);
+        t.tp_flags = Py_TPFLAGS_DEFAULT;
+        t.tp_doc = "LeakIndex(payload_bits, path=None)：按SM3指纹与汉明距离查找泄露副本的接收方";
+        t.tp_new = PyType_GenericNew;
+        t.tp_init = reinterpret_cast<initproc>(LeakIndexInit);
+        t.tp_dealloc = reinterpret_cast<destructor>(LeakIndexDealloc);
+        t.tp_methods = leakIndexMethods;
+        t.tp_getset = leakIndexGetSet;
+        t.tp_as_sequence = &leakIndexSequence;
+        return t;
+    }();
+
+    PyObject* Backend(PyObject*, PyObject*) {
+        return PyUnicode_FromString(LSB::Backend());
+    }
+
+    PyMethodDef methods[] = {
+        { "embed", Embed, METH_VARARGS, "embed(pixels, bits, bit_count, bit_depth) -> int" },
+        { "extract", Extract, METH_VARARGS, "extract(pixels, bit_depth, bit_count) -> bytes" },
+        { "embed_keyed", EmbedKeyed, METH_VARARGS, "embed_keyed(pixels, bits, bit_count, bit_depth, key) -> int" },
+        { "extract_keyed", ExtractKeyed, METH_VARARGS, "extract_keyed(pixels, bit_depth, bit_count, key) -> bytes" },
+        { "test_robustness", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)(void)>(TestRobustness)),
+            METH_VARARGS | METH_KEYWORDS,
+            "test_robustness(pixels, height, width, channels, bit_depth, watermark, attacks, keep_images=False, threads=0) -> list" },
+        { "fingerprint", Fingerprint, METH_VARARGS, "fingerprint(pixels) -> bytes" },
+        { "backend", Backend, METH_NOARGS, "backend() -> str" },
+        { nullptr, nullptr, 0, nullptr }
+    };
+
+    PyModuleDef moduleDef = {
+        PyModuleDef_HEAD_INIT, "lsb_native", "LSB水印嵌入/提取、鲁棒性测试与泄露溯源原生内核", -1, methods
+    };
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_lsb_native() {
+    if (PyType_Ready(&leakIndexType) < 0) {
+        return nullptr;
+    }
+    PyObject* module = PyModule_Create(&moduleDef);
+    if (!module) {
+        return nullptr;
+    }
+    Py_INCREF(&leakIndexType);
+    if (PyModule_AddObject(module, "LeakIndex", reinterpret_cast<PyObject*>(&leakIndexType)) < 0) {
+        Py_DECREF(&leakIndexType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
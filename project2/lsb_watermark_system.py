@@ -11,27 +11,65 @@ import os
 import json
 from datetime import datetime
 
+try:
+    # 原生LSB内核（python setup.py build_ext --inplace 编译），不可用时回退到纯Python实现
+    import lsb_native
+except ImportError:
+    lsb_native = None
+
 
 class LSBWatermarkSystem:
     """基于LSB隐写术的数字水印系统"""
     
-    def __init__(self, bit_depth=2):
+    def __init__(self, bit_depth=2, key=None):
         """
         初始化LSB水印系统
         
         Args:
             bit_depth (int): 使用的最低有效位数，默认为2位
+            key (bytes|str): 可选的16字节SM4密钥（或32位十六进制串）。给定时按密钥生成的
+                伪随机位置嵌入/提取，而不是按光栅顺序；需要原生内核
         """
         self.bit_depth = bit_depth
+        self.key = self._parse_key(key)
         self.test_results = {}
         self.original_watermark = None
         self.embedded_image_path = None
         
+    @staticmethod
+    def _parse_key(key):
+        """把密钥规范化为16字节（None表示不使用密钥）"""
+        if key is None:
+            return None
+        if isinstance(key, str):
+            key = bytes.fromhex(key)
+        key = bytes(key)
+        if len(key) != 16:
+            raise ValueError('密钥必须为16字节（或32位十六进制串）')
+        if lsb_native is None:
+            raise RuntimeError('带密钥的嵌入模式需要原生内核，请先执行 python setup.py build_ext --inplace')
+        return key
+    
     def _text_to_binary(self, text):
         """将文本转换为二进制字符串"""
         binary = ''.join(format(ord(char), '08b') for char in text)
         return binary
     
+    @staticmethod
+    def _pack_binary(binary):
+        """将'0'/'1'字符串按MSB优先打包为字节串"""
+        if not binary:
+            return b''
+        padding = (-len(binary)) % 8
+        return int(binary + '0' * padding, 2).to_bytes((len(binary) + padding) // 8, 'big')
+    
+    @staticmethod
+    def _unpack_binary(data, bit_count):
+        """将MSB优先打包的字节串还原为'0'/'1'字符串"""
+        if bit_count == 0:
+            return ''
+        return format(int.from_bytes(data, 'big'), f'0{len(data) * 8}b')[:bit_count]
+    
     def _binary_to_text(self, binary):
         """将二进制字符串转换为文本"""
         if len(binary) % 8 != 0:
@@ -85,6 +123,16 @@ class LSBWatermarkSystem:
     
     def _embed_binary_lsb(self, img, binary):
         """使用LSB方法嵌入二进制数据"""
+        if self.key is not None:
+            embedded_img = np.ascontiguousarray(img, dtype=np.uint8).copy()
+            lsb_native.embed_keyed(embedded_img, self._pack_binary(binary), len(binary), self.bit_depth, self.key)
+            return embedded_img
+        
+        if lsb_native is not None and img.dtype == np.uint8:
+            embedded_img = np.ascontiguousarray(img).copy()
+            lsb_native.embed(embedded_img, self._pack_binary(binary), len(binary), self.bit_depth)
+            return embedded_img
+        
         embedded_img = img.copy()
         binary_index = 0
         
@@ -112,13 +160,12 @@ class LSBWatermarkSystem:
                 return {'status': 'error', 'message': f'无法读取图像: {image_path}'}
             
             if watermark_type == "text":
-                extracted_binary = self._extract_binary_lsb(img)
-                
                 # 提取长度信息（前32位）
-                length_binary = extracted_binary[:32]
+                length_binary = self._extract_binary_lsb(img, 32)
                 watermark_length = int(length_binary, 2)
                 
-                # 提取水印内容
+                # 提取水印内容（只读取需要的位）
+                extracted_binary = self._extract_binary_lsb(img, 32 + watermark_length)
                 watermark_binary = extracted_binary[32:32+watermark_length]
                 extracted_text = self._binary_to_text(watermark_binary)
                 
@@ -132,18 +179,32 @@ class LSBWatermarkSystem:
         except Exception as e:
             return {'status': 'error', 'message': f'水印提取失败: {str(e)}'}
     
-    def _extract_binary_lsb(self, img):
-        """从图像中提取二进制数据"""
-        binary = ""
+    def _extract_binary_lsb(self, img, max_bits=None):
+        """从图像中提取二进制数据（max_bits为None时提取全部）"""
+        capacity = img.size * self.bit_depth
+        bit_count = capacity if max_bits is None else min(max_bits, capacity)
+        
+        if self.key is not None:
+            data = lsb_native.extract_keyed(np.ascontiguousarray(img, dtype=np.uint8), self.bit_depth, bit_count, self.key)
+            return self._unpack_binary(data, bit_count)
+        
+        if lsb_native is not None and img.dtype == np.uint8:
+            data = lsb_native.extract(np.ascontiguousarray(img), self.bit_depth, bit_count)
+            return self._unpack_binary(data, bit_count)
+        
+        bits = []
+        collected = 0
         
         for i in range(img.shape[0]):
             for j in range(img.shape[1]):
                 for k in range(img.shape[2]):
+                    if collected >= bit_count:
+                        return ''.join(bits)[:bit_count]
                     pixel_value = img[i, j, k]
-                    bits = format(pixel_value & ((1 << self.bit_depth) - 1), f'0{self.bit_depth}b')
-                    binary += bits
+                    bits.append(format(pixel_value & ((1 << self.bit_depth) - 1), f'0{self.bit_depth}b'))
+                    collected += self.bit_depth
         
-        return binary
+        return ''.join(bits)[:bit_count]
     
     def apply_attack(self, image_path, attack_type, output_path, **params):
         """应用攻击"""
@@ -194,11 +255,14 @@ class LSBWatermarkSystem:
         except Exception as e:
             return {'status': 'error', 'message': f'攻击应用失败: {str(e)}'}
     
-    def test_robustness(self, image_path, watermark_shape, watermark_type="text"):
-        """测试鲁棒性"""
-        print("开始鲁棒性测试...")
+    def test_robustness(self, image_path, watermark_shape, watermark_type="text", save_images=False):
+        """
+        测试鲁棒性
         
-        os.makedirs("output/attacks", exist_ok=True)
+        Args:
+            save_images (bool): 是否把攻击后的图像写入output/attacks（原生引擎下默认只在内存中处理）
+        """
+        print("开始鲁棒性测试...")
         
         attacks = [
             ("rotation", {"angle": 15}),
@@ -212,6 +276,10 @@ class LSBWatermarkSystem:
             ("blur", {"kernel_size": 5})
         ]
         
+        if lsb_native is not None and self.key is None and watermark_type == "text":
+            return self._test_robustness_native(image_path, attacks, save_images)
+        
+        os.makedirs("output/attacks", exist_ok=True)
         test_results = {}
         
         for i, (attack_type, params) in enumerate(attacks):
@@ -257,6 +325,69 @@ class LSBWatermarkSystem:
         self.test_results = test_results
         return test_results
     
+    # 各攻击的参数名与默认值，与apply_attack保持一致
+    _ATTACK_PARAMS = {
+        'rotation': ('angle', 30),
+        'scaling': ('scale', 0.8),
+        'brightness': ('factor', 1.5),
+        'noise': ('sigma', 25),
+        'blur': ('kernel_size', 5),
+    }
+    
+    def _test_robustness_native(self, image_path, attacks, save_images):
+        """用原生引擎在内存中并行执行全部攻击并立即提取水印"""
+        img = cv2.imread(image_path)
+        if img is None:
+            return {
+                f"{attack_type}_{i}": {
+                    'attack_type': attack_type,
+                    'params': params,
+                    'status': 'attack_failed',
+                    'error': f'无法读取图像: {image_path}'
+                }
+                for i, (attack_type, params) in enumerate(attacks)
+            }
+        
+        img = np.ascontiguousarray(img)
+        height, width = img.shape[:2]
+        channels = img.shape[2] if img.ndim == 3 else 1
+        native_attacks = []
+        for attack_type, params in attacks:
+            name, default = self._ATTACK_PARAMS[attack_type]
+            native_attacks.append((attack_type, float(params.get(name, default))))
+        
+        results = lsb_native.test_robustness(
+            img, height, width, channels, self.bit_depth,
+            self.original_watermark or '', native_attacks, keep_images=save_images
+        )
+        
+        if save_images:
+            os.makedirs("output/attacks", exist_ok=True)
+        
+        test_results = {}
+        for i, ((attack_type, params), result) in enumerate(zip(attacks, results)):
+            print(f"测试攻击 {i+1}/{len(attacks)}: {attack_type} "
+                  f"(攻击 {result['attack_ms']:.1f} ms, 提取 {result['extract_ms']:.1f} ms, "
+                  f"相似度 {result['similarity']:.3f})")
+            entry = {
+                'attack_type': attack_type,
+                'params': params,
+                'status': 'success',
+                'similarity': result['similarity'],
+                'extracted_watermark': result['extracted_watermark'],
+                'attack_ms': result['attack_ms'],
+                'extract_ms': result['extract_ms']
+            }
+            if save_images:
+                attack_output = f"output/attacks/attacked_{attack_type}_{i}.png"
+                attacked = np.frombuffer(result['image'], dtype=np.uint8).reshape(img.shape)
+                cv2.imwrite(attack_output, attacked)
+                entry['attack_output'] = attack_output
+            test_results[f"{attack_type}_{i}"] = entry
+        
+        self.test_results = test_results
+        return test_results
+    
     def _calculate_text_similarity(self, original, extracted):
         """计算文本相似度"""
         if not original or not extracted:
@@ -344,6 +475,112 @@ class LSBWatermarkSystem:
                 'confidence': 0.0
             }
     
+    def create_leak_index(self, max_recipient_length=32, index_path=None):
+        """
+        创建（或从文件载入）泄露溯源索引
+        
+        Args:
+            max_recipient_length (int): 接收方标识的最大字符数，决定载荷长度（32位长度 + 8位/字符）
+            index_path (str): 索引文件路径，为None时只保存在内存中
+        """
+        if lsb_native is None:
+            raise RuntimeError('泄露溯源索引需要原生内核，请先执行 python setup.py build_ext --inplace')
+        return lsb_native.LeakIndex(32 + 8 * max_recipient_length, index_path)
+    
+    def _recipient_binary(self, recipient, payload_bits):
+        """
+        接收方载荷：与嵌入格式相同的 32位长度 + 文本比特，其余位用SM3(接收方)的迭代输出填满，
+        使不同接收方的载荷在填充部分也相互远离
+        """
+        watermark_binary = self._text_to_binary(recipient)
+        full_binary = format(len(watermark_binary), '032b') + watermark_binary
+        if len(full_binary) > payload_bits:
+            return None
+        digest = recipient.encode('utf-8')
+        while len(full_binary) < payload_bits:
+            digest = lsb_native.fingerprint(digest)
+            full_binary += self._unpack_binary(digest, len(digest) * 8)
+        return full_binary[:payload_bits]
+    
+    def issue_copy(self, image_path, recipient, output_path, leak_index):
+        """为一个接收方生成带水印的副本，并把载荷与副本指纹登记到索引中"""
+        payload_binary = self._recipient_binary(recipient, leak_index.payload_bits)
+        if payload_binary is None:
+            return {'status': 'error', 'message': f'接收方标识过长: {recipient}'}
+        
+        img = cv2.imread(image_path)
+        if img is None:
+            return {'status': 'error', 'message': f'无法读取图像: {image_path}'}
+        if len(payload_binary) > img.size * self.bit_depth:
+            return {'status': 'error', 'message': '图像容量不足以容纳载荷'}
+        
+        # 整个载荷都嵌入图像，extract_watermark 仍按长度字段读出接收方标识
+        cv2.imwrite(output_path, self._embed_binary_lsb(img, payload_binary))
+        
+        # 指纹按解码后的像素计算，与图像文件的编码方式无关
+        issued_img = cv2.imread(output_path)
+        if issued_img is None:
+            return {'status': 'error', 'message': f'无法读取生成的副本: {output_path}'}
+        fingerprint = lsb_native.fingerprint(np.ascontiguousarray(issued_img))
+        if not leak_index.add(recipient, self._pack_binary(payload_binary), fingerprint):
+            return {'status': 'error', 'message': '相同的副本已登记过'}
+        
+        return {
+            'status': 'success',
+            'message': f'已为 {recipient} 生成副本并登记',
+            'output_path': output_path,
+            'fingerprint': fingerprint.hex()
+        }
+    
+    def trace_leak(self, suspected_image_path, leak_index, top_k=5, threshold=0.85):
+        """
+        在索引中查找泄露图像的来源
+        
+        先按SM3指纹精确匹配未被修改的副本；否则提取载荷位，与全部接收方一次扫描比较汉明距离，
+        相似度 = 1 - 汉明距离 / 载荷位数
+        """
+        try:
+            img = cv2.imread(suspected_image_path)
+            if img is None:
+                return {'status': 'error', 'message': f'无法读取图像: {suspected_image_path}'}
+            
+            recipient = leak_index.find_fingerprint(lsb_native.fingerprint(np.ascontiguousarray(img)))
+            if recipient is not None:
+                return {
+                    'status': 'success',
+                    'message': f'与 {recipient} 的副本完全一致',
+                    'recipient': recipient,
+                    'exact_copy': True,
+                    'similarity': 1.0,
+                    'candidates': [{'recipient': recipient, 'distance': 0, 'similarity': 1.0}]
+                }
+            
+            payload_bits = leak_index.payload_bits
+            extracted = self._pack_binary(self._extract_binary_lsb(img, payload_bits).ljust(payload_bits, '0'))
+            candidates = [
+                {'recipient': name, 'distance': distance, 'similarity': 1.0 - distance / payload_bits}
+                for name, distance in leak_index.search(extracted, top_k)
+            ]
+            
+            best = candidates[0] if candidates else None
+            if best is not None and best['similarity'] >= threshold:
+                message = f"最可能的泄露来源: {best['recipient']}，相似度: {best['similarity']:.3f}"
+                recipient = best['recipient']
+            else:
+                message = '未找到相似度足够高的接收方'
+            
+            return {
+                'status': 'success',
+                'message': message,
+                'recipient': recipient,
+                'exact_copy': False,
+                'similarity': best['similarity'] if best else 0.0,
+                'candidates': candidates
+            }
+            
+        except Exception as e:
+            return {'status': 'error', 'message': f'泄露溯源失败: {str(e)}'}
+    
     def save_results(self, output_path):
         """保存测试结果到JSON文件"""
         try:
@@ -104,7 +104,8 @@ def main():
         test_results = system.test_robustness(
             image_path="output/embedded_lsb.png",
             watermark_shape=watermark_length,
-            watermark_type="text"
+            watermark_type="text",
+            save_images=True
         )
         
         print(f"\n✅ 鲁棒性测试完成！共测试了 {len(test_results)} 种攻击")
@@ -0,0 +1,298 @@
+﻿#include "robustness.h"
+#include "lsb_kernel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace LSB {
+
+    namespace {
+
+        const double PI = 3.14159265358979323846;
+
+        inline uint8_t SaturateRound(double v) {
+            double r = std::nearbyint(v);  // 与cvRound一致：四舍六入五取偶
+            return static_cast<uint8_t>(r < 0 ? 0 : (r > 255 ? 255 : r));
+        }
+
+        // BORDER_REFLECT_101
+        inline int Reflect101(int i, int n) {
+            if (n == 1) return 0;
+            while (i < 0 || i >= n) {
+                i = i < 0 ? -i : 2 * n - 2 - i;
+            }
+            return i;
+        }
+
+        Image Rotate(const Image& src, double angle) {
+            // cv2.getRotationMatrix2D((w // 2, h // 2), angle, 1.0)
+            const double cx = src.width / 2, cy = src.height / 2;
+            const double a = std::cos(angle * PI / 180.0), b = std::sin(angle * PI / 180.0);
+            const double m[6] = { a, b, (1 - a) * cx - b * cy, -b, a, b * cx + (1 - a) * cy };
+
+            // warpAffine按逆映射采样：dst(x, y) = src(M^(-1) * (x, y))
+            const double det = m[0] * m[4] - m[1] * m[3];
+            const double i00 = m[4] / det, i01 = -m[1] / det, i10 = -m[3] / det, i11 = m[0] / det;
+            const double i02 = -(i00 * m[2] + i01 * m[5]), i12 = -(i10 * m[2] + i11 * m[5]);
+
+            Image dst = src;
+            const int w = src.width, h = src.height, c = src.channels;
+            auto at = [&](int x, int y, int ch) -> double {
+                if (x < 0 || y < 0 || x >= w || y >= h) return 0.0;  // BORDER_CONSTANT
+                return src.data[(static_cast<size_t>(y) * w + x) * c + ch];
+            };
+            for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    double sx = i00 * x + i01 * y + i02;
+                    double sy = i10 * x + i11 * y + i12;
+                    int x0 = static_cast<int>(std::floor(sx)), y0 = static_cast<int>(std::floor(sy));
+                    double fx = sx - x0, fy = sy - y0;
+                    uint8_t* out = &dst.data[(static_cast<size_t>(y) * w + x) * c];
+                    for (int ch = 0; ch < c; ++ch) {
+                        double v = (1 - fy) * ((1 - fx) * at(x0, y0, ch) + fx * at(x0 + 1, y0, ch))
+                            + fy * ((1 - fx) * at(x0, y0 + 1, ch) + fx * at(x0 + 1, y0 + 1, ch));
+                        out[ch] = SaturateRound(v);
+                    }
+                }
+            }
+            return dst;
+        }
+
+        // cv2.resize(INTER_LINEAR)的采样坐标：像素中心对齐，越界时钳位到边缘
+        void LinearTable(int srcSize, int dstSize, std::vector<int>& index, std::vector<double>& frac) {
+            index.resize(dstSize);
+            frac.resize(dstSize);
+            const double scale = static_cast<double>(srcSize) / dstSize;
+            for (int i = 0; i < dstSize; ++i) {
+                double f = (i + 0.5) * scale - 0.5;
+                int s = static_cast<int>(std::floor(f));
+                f -= s;
+                if (s < 0) {
+                    s = 0;
+                    f = 0;
+                }
+                if (s >= srcSize - 1) {
+                    s = srcSize - 1;
+                    f = 0;
+                }
+                index[i] = s;
+                frac[i] = f;
+            }
+        }
+
+        Image Resize(const Image& src, int width, int height) {
+            Image dst;
+            dst.width = width;
+            dst.height = height;
+            dst.channels = src.channels;
+            dst.data.resize(static_cast<size_t>(width) * height * src.channels);
+
+            std::vector<int> xs, ys;
+            std::vector<double> fxs, fys;
+            LinearTable(src.width, width, xs, fxs);
+            LinearTable(src.height, height, ys, fys);
+            const int c = src.channels;
+            for (int y = 0; y < height; ++y) {
+                int y0 = ys[y], y1 = std::min(y0 + 1, src.height - 1);
+                const uint8_t* r0 = &src.data[static_cast<size_t>(y0) * src.width * c];
+                const uint8_t* r1 = &src.data[static_cast<size_t>(y1) * src.width * c];
+                for (int x = 0; x < width; ++x) {
+                    int x0 = xs[x], x1 = std::min(x0 + 1, src.width - 1);
+                    double fx = fxs[x], fy = fys[y];
+                    uint8_t* out = &dst.data[(static_cast<size_t>(y) * width + x) * c];
+                    for (int ch = 0; ch < c; ++ch) {
+                        double v = (1 - fy) * ((1 - fx) * r0[x0 * c + ch] + fx * r0[x1 * c + ch])
+                            + fy * ((1 - fx) * r1[x0 * c + ch] + fx * r1[x1 * c + ch]);
+                        out[ch] = SaturateRound(v);
+                    }
+                }
+            }
+            return dst;
+        }
+
+        Image Scale(const Image& src, double scale) {
+            int w = std::max(1, static_cast<int>(src.width * scale));
+            int h = std::max(1, static_cast<int>(src.height * scale));
+            return Resize(Resize(src, w, h), src.width, src.height);
+        }
+
+        Image Brightness(const Image& src, double factor) {
+            // cv2.convertScaleAbs(img, alpha=factor, beta=0)
+            Image dst = src;
+            for (uint8_t& v : dst.data) {
+                v = SaturateRound(std::fabs(v * factor));
+            }
+            return dst;
+        }
+
+        Image Noise(const Image& src, double sigma, uint64_t seed) {
+            // np.random.normal(0, sigma).astype(np.uint8) 对负数按模256回绕，cv2.add饱和相加
+            Image dst = src;
+            std::mt19937_64 rng(seed);
+            std::normal_distribution<double> normal(0.0, sigma);
+            for (uint8_t& v : dst.data) {
+                uint8_t n = static_cast<uint8_t>(static_cast<int64_t>(normal(rng)) & 0xFF);
+                v = static_cast<uint8_t>(std::min(255, v + n));
+            }
+            return dst;
+        }
+
+        std::vector<double> GaussianKernel(int size) {
+            // sigma <= 0 时OpenCV对小核使用固定系数表
+            static const double small[4][7] = {
+                { 1 },
+                { 0.25, 0.5, 0.25 },
+                { 0.0625, 0.25, 0.375, 0.25, 0.0625 },
+                { 0.03125, 0.109375, 0.21875, 0.28125, 0.21875, 0.109375, 0.03125 },
+            };
+            if (size <= 7) {
+                return std::vector<double>(small[size / 2], small[size / 2] + size);
+            }
+            double sigma = 0.3 * ((size - 1) * 0.5 - 1) + 0.8;
+            std::vector<double> k(size);
+            double sum = 0;
+            for (int i = 0; i < size; ++i) {
+                double x = i - (size - 1) * 0.5;
+                k[i] = std::exp(-x * x / (2 * sigma * sigma));
+                sum += k[i];
+            }
+            for (double& v : k) v /= sum;
+            return k;
+        }
+
+        Image Blur(const Image& src, int size) {
+            size = std::max(1, size | 1);
+            std::vector<double> k = GaussianKernel(size);
+            const int r = size / 2, w = src.width, h = src.height, c = src.channels;
+
+            // 可分离卷积：先水平后垂直
+            std::vector<double> tmp(src.data.size());
+            for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    for (int ch = 0; ch < c; ++ch) {
+                        double s = 0;
+                        for (int i = -r; i <= r; ++i) {
+                            s += k[i + r] * src.data[(static_cast<size_t>(y) * w + Reflect101(x + i, w)) * c + ch];
+                        }
+                        tmp[(static_cast<size_t>(y) * w + x) * c + ch] = s;
+                    }
+                }
+            }
+            Image dst = src;
+            for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    for (int ch = 0; ch < c; ++ch) {
+                        double s = 0;
+                        for (int i = -r; i <= r; ++i) {
+                            s += k[i + r] * tmp[(static_cast<size_t>(Reflect101(y + i, h)) * w + x) * c + ch];
+                        }
+                        dst.data[(static_cast<size_t>(y) * w + x) * c + ch] = SaturateRound(s);
+                    }
+                }
+            }
+            return dst;
+        }
+
+        double Milliseconds(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+            return std::chrono::duration<double, std::milli>(b - a).count();
+        }
+
+    } // namespace
+
+    Image ApplyAttack(const Image& src, const Attack& attack, uint64_t seed) {
+        switch (attack.type) {
+        case AttackType::Rotation: return Rotate(src, attack.param);
+        case AttackType::Scaling: return Scale(src, attack.param);
+        case AttackType::Brightness: return Brightness(src, attack.param);
+        case AttackType::Noise: return Noise(src, attack.param, seed);
+        case AttackType::Blur: return Blur(src, static_cast<int>(attack.param));
+        }
+        return src;
+    }
+
+    std::string ExtractText(const uint8_t* pixels, size_t size, int bitDepth) {
+        uint8_t header[4];
+        if (Extract(pixels, size, bitDepth, header, 32) < 32) {
+            return std::string();
+        }
+        uint64_t length = (static_cast<uint64_t>(header[0]) << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+
+        // 长度来自被攻击的图像，不可信；与_extract_binary_lsb的min(max_bits, capacity)一致，先截到载体容量
+        uint64_t total = std::min<uint64_t>(32 + length, static_cast<uint64_t>(size) * bitDepth);
+        std::vector<uint8_t> bits(static_cast<size_t>((total + 7) / 8));
+        size_t got = Extract(pixels, size, bitDepth, bits.data(), static_cast<size_t>(total));
+
+        // 与_binary_to_text一致：按字节解码，只保留可打印ASCII
+        std::string text;
+        for (size_t i = 0; (i + 1) * 8 <= got - 32; ++i) {
+            uint8_t ch = bits[4 + i];
+            if (ch >= 32 && ch <= 126) text.push_back(static_cast<char>(ch));
+        }
+        return text;
+    }
+
+    double TextSimilarity(const std::u32string& original, const std::u32string& extracted) {
+        if (original.empty() || extracted.empty()) {
+            return 0.0;
+        }
+        const std::u32string& a = original.size() >= extracted.size() ? original : extracted;
+        const std::u32string& b = original.size() >= extracted.size() ? extracted : original;
+
+        std::vector<size_t> prev(b.size() + 1), cur(b.size() + 1);
+        for (size_t j = 0; j <= b.size(); ++j) prev[j] = j;
+        for (size_t i = 0; i < a.size(); ++i) {
+            cur[0] = i + 1;
+            for (size_t j = 0; j < b.size(); ++j) {
+                cur[j + 1] = std::min({ prev[j + 1] + 1, cur[j] + 1, prev[j] + (a[i] != b[j]) });
+            }
+            std::swap(prev, cur);
+        }
+        double similarity = 1.0 - static_cast<double>(prev[b.size()]) / a.size();
+        return std::max(0.0, similarity);
+    }
+
+    std::vector<AttackResult> RunRobustness(const Image& image, int bitDepth, const std::u32string& watermark,
+        const std::vector<Attack>& attacks, bool keepImages, unsigned threads) {
+        std::vector<AttackResult> results(attacks.size());
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = static_cast<unsigned>(std::min<size_t>(threads, attacks.size()));
+
+        std::random_device rd;
+        const uint64_t seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+
+        // 每个线程循环领取下一个攻击，攻击之间耗时差异大，动态分配比均分更均衡
+        std::atomic<size_t> next{ 0 };
+        auto worker = [&] {
+            for (size_t i = next++; i < attacks.size(); i = next++) {
+                AttackResult& r = results[i];
+                auto t0 = std::chrono::steady_clock::now();
+                Image attacked = ApplyAttack(image, attacks[i], seed + i);
+                auto t1 = std::chrono::steady_clock::now();
+                r.extracted = ExtractText(attacked.data.data(), attacked.data.size(), bitDepth);
+                r.similarity = TextSimilarity(watermark, std::u32string(r.extracted.begin(), r.extracted.end()));
+                auto t2 = std::chrono::steady_clock::now();
+                r.attackMs = Milliseconds(t0, t1);
+                r.extractMs = Milliseconds(t1, t2);
+                if (keepImages) {
+                    r.image = std::move(attacked);
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads; ++t) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : workers) {
+            t.join();
+        }
+        return results;
+    }
+
+} // namespace LSB
@@ -0,0 +1,74 @@
+﻿#ifndef LSB_ROBUSTNESS_H
+#define LSB_ROBUSTNESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 内存中的并行鲁棒性测试：对同一幅含水印图像并行施加各种攻击，攻击结果直接在内存中提取水印，
+// 不经过PNG编码/解码和磁盘读写。攻击的几何与取整规则与lsb_watermark_system.py中使用的OpenCV函数一致
+
+namespace LSB {
+
+    enum class AttackType {
+        Rotation,    // 参数：角度（度），绕中心旋转，双线性插值，边界补0
+        Scaling,     // 参数：缩放比例，缩放后再缩放回原尺寸（双线性）
+        Brightness,  // 参数：亮度系数，saturate(|x * factor|)
+        Noise,       // 参数：高斯噪声标准差，噪声按uint8回绕后饱和相加
+        Blur,        // 参数：高斯核大小（奇数），sigma由核大小推导
+    };
+
+    struct Attack {
+        AttackType type;
+        double param;
+    };
+
+    // 连续存放的 height x width x channels 8位图像
+    struct Image {
+        int height = 0;
+        int width = 0;
+        int channels = 0;
+        std::vector<uint8_t> data;
+    };
+
+    struct AttackResult {
+        std::string extracted;        // 提取出的水印文本（只保留可打印ASCII，与Python实现一致）
+        double similarity = 0.0;      // 基于编辑距离的相似度
+        double attackMs = 0.0;        // 施加攻击耗时
+        double extractMs = 0.0;       // 提取与比较耗时
+        Image image;                  // 攻击后的图像（仅在keepImages时保留）
+    };
+
+    /**
+     * @brief 对图像施加一种攻击
+     * @param seed 噪声攻击的随机种子
+     */
+    Image ApplyAttack(const Image& src, const Attack& attack, uint64_t seed);
+
+    /**
+     * @brief 按 32位长度 + 文本比特 的格式提取文本水印
+     */
+    std::string ExtractText(const uint8_t* pixels, size_t size, int bitDepth);
+
+    /**
+     * @brief 1 - 编辑距离 / 较长文本长度（任一为空时为0）
+     */
+    double TextSimilarity(const std::u32string& original, const std::u32string& extracted);
+
+    /**
+     * @brief 并行执行一组攻击并提取水印
+     * @param image 含水印图像
+     * @param bitDepth LSB位数
+     * @param watermark 原始水印文本（Unicode码点）
+     * @param attacks 攻击列表
+     * @param keepImages 是否在结果中保留攻击后的图像（需要写盘时使用）
+     * @param threads 线程数，0表示硬件并发数
+     * @return 与attacks一一对应的结果
+     */
+    std::vector<AttackResult> RunRobustness(const Image& image, int bitDepth, const std::u32string& watermark,
+        const std::vector<Attack>& attacks, bool keepImages, unsigned threads = 0);
+
+} // namespace LSB
+
+#endif // LSB_ROBUSTNESS_H
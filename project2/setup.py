@@ -0,0 +1,30 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""
+LSB水印原生内核的编译脚本
+用法: python setup.py build_ext --inplace
+"""
+
+import sys
+from setuptools import setup, Extension
+
+if sys.platform == 'win32':
+    extra_compile_args = ['/O2', '/std:c++17']
+else:
+    extra_compile_args = ['-O3', '-std=c++17']
+
+setup(
+    name='lsb_native',
+    version='1.0',
+    description='LSB水印嵌入/提取原生内核（AVX2 + BMI2 pdep/pext）',
+    ext_modules=[
+        Extension(
+            'lsb_native',
+            sources=['lsb_native.cpp', 'lsb_kernel.cpp', 'robustness.cpp', 'keyed_placement.cpp',
+                     'leak_index.cpp', '../libgmsm/gmsm.cpp', '../libgmsm/sm4.cpp',
+                     '../libgmsm/sm3.cpp'],
+            language='c++',
+            extra_compile_args=extra_compile_args,
+        )
+    ],
+)
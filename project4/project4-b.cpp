@@ -3,44 +3,13 @@
 #include <iomanip>
 #include <vector>
 #include <string>
+#include "../libgmsm/gmsm.h"
 
-// SM3 ʵ
+// SM3 ʵࣺѹϣ ../libgmsm ṩֻҪ
 class SM3 {
 public:
-    // 
-    static constexpr uint32_t IV[8] = {
-        0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600,
-        0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
-    };
-    static constexpr size_t BLOCK_SIZE = 64; // 512 bits
-    static constexpr size_t DIGEST_SIZE = 32; // 256 bits
-
-    // ѭ
-    static uint32_t RotL(uint32_t x, uint8_t n) {
-        return (x << n) | (x >> (32 - n));
-    }
-
-    //  FF
-    static uint32_t FF(uint32_t x, uint32_t y, uint32_t z, int j) {
-        if (j < 16) return x ^ y ^ z;
-        return (x & y) | (x & z) | (y & z);
-    }
-
-    //  GG
-    static uint32_t GG(uint32_t x, uint32_t y, uint32_t z, int j) {
-        if (j < 16) return x ^ y ^ z;
-        return (x & y) | (~x & z);
-    }
-
-    // û P0
-    static uint32_t P0(uint32_t x) {
-        return x ^ RotL(x, 9) ^ RotL(x, 17);
-    }
-
-    // û P1
-    static uint32_t P1(uint32_t x) {
-        return x ^ RotL(x, 15) ^ RotL(x, 23);
-    }
+    static constexpr size_t BLOCK_SIZE = GMSM_SM3_BLOCK_SIZE; // 512 bits
+    static constexpr size_t DIGEST_SIZE = GMSM_SM3_DIGEST_SIZE; // 256 bits
 
     // Ϣ
     static std::vector<uint8_t> PadMessage(const uint8_t* input, size_t len) {
@@ -62,73 +31,15 @@ public:
         return padded;
     }
 
-    // ѹ
+    // ѹ״̬Ϊֵһ
     static void Compress(const uint8_t block[BLOCK_SIZE], uint32_t state[8]) {
-        uint32_t W[68] = { 0 };
-        uint32_t W1[64] = { 0 };
-
-        // Ϣչ
-        for (int i = 0; i < 16; ++i) {
-            W[i] = (block[i * 4] << 24) |
-                (block[i * 4 + 1] << 16) |
-                (block[i * 4 + 2] << 8) |
-                block[i * 4 + 3];
-        }
-
-        for (int i = 16; i < 68; ++i) {
-            W[i] = P1(W[i - 16] ^ W[i - 9] ^ RotL(W[i - 3], 15)) ^
-                RotL(W[i - 13], 7) ^ W[i - 6];
-        }
-
-        for (int i = 0; i < 64; ++i) {
-            W1[i] = W[i] ^ W[i + 4];
-        }
-
-        // Ĵʼ
-        uint32_t A = state[0], B = state[1], C = state[2], D = state[3];
-        uint32_t E = state[4], F = state[5], G = state[6], H = state[7];
-
-        // 64 ֵ
-        for (int j = 0; j < 64; ++j) {
-            uint32_t Tj = (j < 16) ? 0x79CC4519 : 0x7A879D8A;
-            uint32_t SS1 = RotL(RotL(A, 12) + E + RotL(Tj, j), 7);
-            uint32_t SS2 = SS1 ^ RotL(A, 12);
-            uint32_t TT1 = FF(A, B, C, j) + D + SS2 + W1[j];
-            uint32_t TT2 = GG(E, F, G, j) + H + SS1 + W[j];
-            D = C;
-            C = RotL(B, 9);
-            B = A;
-            A = TT1;
-            H = G;
-            G = RotL(F, 19);
-            F = E;
-            E = P0(TT2);
-        }
-
-        // ״̬
-        state[0] ^= A; state[1] ^= B; state[2] ^= C; state[3] ^= D;
-        state[4] ^= E; state[5] ^= F; state[6] ^= G; state[7] ^= H;
+        gmsm_sm3_compress(state, block, 1);
     }
 
     // ϣ
     static std::vector<uint8_t> Hash(const uint8_t* input, size_t len) {
-        std::vector<uint8_t> padded = PadMessage(input, len);
-        uint32_t state[8];
-        memcpy(state, IV, sizeof(state));
-
-        // ÿ
-        for (size_t i = 0; i < padded.size(); i += BLOCK_SIZE) {
-            Compress(&padded[i], state);
-        }
-
-        // ϣֵ
         std::vector<uint8_t> digest(DIGEST_SIZE);
-        for (int i = 0; i < 8; ++i) {
-            digest[i * 4] = (state[i] >> 24) & 0xFF;
-            digest[i * 4 + 1] = (state[i] >> 16) & 0xFF;
-            digest[i * 4 + 2] = (state[i] >> 8) & 0xFF;
-            digest[i * 4 + 3] = state[i] & 0xFF;
-        }
+        gmsm_sm3(input, len, digest.data());
         return digest;
     }
 };
@@ -1,9 +1,24 @@
 import hashlib
-from typing import List, Optional, Tuple, Any
+import time
+from typing import Callable, List, Optional, Tuple, Any
+
+try:
+    import gmsm_native  # ../libgmsm 的原生 SM3/SM4 扩展
+except ImportError:
+    gmsm_native = None
+
+
+def get_hash_func(hash_name: str) -> Callable[[bytes], bytes]:
+    """返回 bytes -> digest 的哈希函数；SM3 优先使用原生扩展"""
+    if hash_name == 'sm3' and gmsm_native is not None:
+        return gmsm_native.sm3
+    return lambda data: hashlib.new(hash_name, data).digest()
 
 
 class MerkleTree:
-    def __init__(self, leaves: List[bytes]):
+    def __init__(self, leaves: List[bytes], hash_name: str = 'sha256'):
+        self.hash_name = hash_name
+        self._hash = get_hash_func(hash_name)
         # 存储完整的树结构（每一层的节点）
         self.tree = self._build_tree(leaves)
         # 根哈希
@@ -20,17 +35,28 @@ class MerkleTree:
 
         tree = [leaves.copy()]
         current_level = leaves.copy()
+        # 原生SM3可用且节点均为32字节时，每层的所有父节点一次调用批量计算
+        batch = (self.hash_name == 'sm3' and gmsm_native is not None
+                 and all(len(node) == 32 for node in leaves))
 
         # 构建直到根节点
         while len(current_level) > 1:
+            if batch:
+                # 奇数时最后一个节点与自身合并
+                padded = current_level + current_level[-1:] if len(current_level) % 2 else current_level
+                digests = gmsm_native.sm3_many(b''.join(padded), 64)
+                next_level = [digests[i:i + 32] for i in range(0, len(digests), 32)]
+                tree.append(next_level)
+                current_level = next_level
+                continue
             next_level = []
             # 处理当前层节点，两两合并
             for i in range(0, len(current_level), 2):
                 left = current_level[i]
                 # 若为奇数，最后一个节点与自身合并
                 right = current_level[i + 1] if i + 1 < len(current_level) else left
-                # 父节点哈希：SHA256(左哈希 + 右哈希)
-                parent = hashlib.sha256(left + right).digest()
+                # 父节点哈希：H(左哈希 + 右哈希)
+                parent = self._hash(left + right)
                 next_level.append(parent)
             tree.append(next_level)
             current_level = next_level
@@ -68,22 +94,24 @@ class MerkleTree:
             leaf_hash: bytes,
             index: int,
             proof: List[Tuple[bytes, bool]],
-            root_hash: bytes
+            root_hash: bytes,
+            hash_name: str = 'sha256'
     ) -> bool:
         """验证存在性证明"""
         if not proof and root_hash == leaf_hash:
             return True  # 只有一个节点的情况
 
+        hash_func = get_hash_func(hash_name)
         current_hash = leaf_hash
         current_index = index
 
         for sibling_hash, is_sibling_left in proof:
             if is_sibling_left:
                 # 兄弟在左，当前节点在右：parent = hash(sibling + current)
-                current_hash = hashlib.sha256(sibling_hash + current_hash).digest()
+                current_hash = hash_func(sibling_hash + current_hash)
             else:
                 # 兄弟在右，当前节点在左：parent = hash(current + sibling)
-                current_hash = hashlib.sha256(current_hash + sibling_hash).digest()
+                current_hash = hash_func(current_hash + sibling_hash)
             current_index = current_index // 2
 
         return current_hash == root_hash
@@ -131,7 +159,8 @@ class MerkleTree:
             left_proof: Optional[Tuple[int, List[Tuple[bytes, bool]]]],
             right_proof: Optional[Tuple[int, List[Tuple[bytes, bool]]]],
             leaves: List[bytes],
-            root_hash: bytes
+            root_hash: bytes,
+            hash_name: str = 'sha256'
     ) -> bool:
         """验证不存在性证明"""
         # 目标索引必须超出范围
@@ -148,7 +177,7 @@ class MerkleTree:
                 return False
             # 验证左邻居的存在性证明
             left_valid = MerkleTree.verify_inclusion(
-                leaves[left_index], left_index, proof, root_hash
+                leaves[left_index], left_index, proof, root_hash, hash_name
             )
             # 左邻居必须在目标左侧
             if left_index >= target_index:
@@ -163,7 +192,7 @@ class MerkleTree:
                 return False
             # 验证右邻居的存在性证明
             right_valid = MerkleTree.verify_inclusion(
-                leaves[right_index], right_index, proof, root_hash
+                leaves[right_index], right_index, proof, root_hash, hash_name
             )
             # 右邻居必须在目标右侧
             if right_index <= target_index:
@@ -181,26 +210,33 @@ class MerkleTree:
 
 
 # 生成10万个叶子节点（每个叶子为哈希值）
-def generate_large_leaves(count: int) -> List[bytes]:
+def generate_large_leaves(count: int, hash_name: str = 'sha256') -> List[bytes]:
+    hash_func = get_hash_func(hash_name)
     leaves = []
     for i in range(count):
         # 叶子原始值：b"Leaf_1", b"Leaf_2"...
         leaf_value = f"Leaf_{i + 1}".encode()
-        # 叶子哈希：SHA256(原始值)
-        leaf_hash = hashlib.sha256(leaf_value).digest()
+        # 叶子哈希：H(原始值)
+        leaf_hash = hash_func(leaf_value)
         leaves.append(leaf_hash)
     return leaves
 
 
 if __name__ == "__main__":
+    # 原生扩展可用时使用SM3（RFC 6962 的哈希函数可替换），否则保持SHA256
+    hash_name = 'sm3' if gmsm_native is not None else 'sha256'
+    print(f"哈希函数: {hash_name}" + (f" (gmsm_native, {gmsm_native.backend()})" if gmsm_native else ""))
+
     # 生成10万个叶子节点
     print("生成10万个叶子节点...")
-    leaves = generate_large_leaves(100000)
+    leaves = generate_large_leaves(100000, hash_name)
     print(f"叶子节点数量: {len(leaves)}")
 
     # 构建Merkle树
     print("构建Merkle树...")
-    merkle_tree = MerkleTree(leaves)
+    start = time.perf_counter()
+    merkle_tree = MerkleTree(leaves, hash_name)
+    print(f"构建耗时: {(time.perf_counter() - start) * 1000:.1f} ms")
     print(f"Merkle树根哈希: {merkle_tree.root.hex()}\n")
 
     # 测试存在性证明（正常索引）
@@ -211,7 +247,7 @@ if __name__ == "__main__":
         print(f"  证明长度: {len(proof)}")
         # 验证证明
         is_valid = MerkleTree.verify_inclusion(
-            leaves[idx], idx, proof, merkle_tree.root
+            leaves[idx], idx, proof, merkle_tree.root, hash_name
         )
         print(f"  验证结果: {'有效' if is_valid else '无效'}\n")
 
@@ -225,6 +261,6 @@ if __name__ == "__main__":
         print(f"  右邻居索引: {right_proof[0]}, 证明长度: {len(right_proof[1])}")
     # 验证不存在性证明
     ex_valid = MerkleTree.verify_exclusion(
-        ex_index, left_proof, right_proof, leaves, merkle_tree.root
+        ex_index, left_proof, right_proof, leaves, merkle_tree.root, hash_name
     )
     print(f"  验证结果: {'有效' if ex_valid else '无效'}")
@@ -0,0 +1,217 @@
+﻿#include <algorithm>     // std::min、std::max
+#include <cerrno>        // errno
+#include <chrono>        // 时间测量
+#include <cstdio>        // 输出
+#include <cstdlib>       // 命令行参数
+#include <cstring>       // 内存操作
+#include <string>        // 路径
+#include <vector>        // 读缓冲区
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../libgmsm/gmsm.h"
+
+// 可断点续算的大文件SM3：每处理N GB把流式上下文写成检查点，进程中断后从最后一个检查点继续
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    constexpr char CHECKPOINT_MAGIC[8] = { 'S', 'M', '3', 'C', 'K', 'P', 'T', '1' };
+    constexpr size_t CHECKPOINT_SIZE = 8 + 8 + 8 + GMSM_SM3_STATE_SIZE;
+    constexpr size_t READ_SIZE = 8 << 20;
+    constexpr double GB = 1024.0 * 1024.0 * 1024.0;
+
+    struct Options {
+        double intervalGb = 1;       // 检查点间隔
+        double stopGb = -1;          // 模拟中断的位置，负数表示不中断
+        std::string checkpoint;      // 默认为 <文件>.sm3ckpt
+    };
+
+    /**
+     * @brief 文件身份：大小与修改时间，检查点只对同一个文件的同一个版本有效
+     */
+    struct FileId {
+        uint64_t size;
+        uint64_t mtimeNs;
+    };
+
+    void StoreBE64(uint8_t* p, uint64_t v) {
+        for (int i = 7; i >= 0; --i, v >>= 8) p[i] = static_cast<uint8_t>(v);
+    }
+
+    uint64_t LoadBE64(const uint8_t* p) {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    bool WriteAll(int fd, const uint8_t* p, size_t len) {
+        while (len > 0) {
+            const ssize_t n = ::write(fd, p, len);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            p += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 检查点文件：魔数、文件大小、修改时间（纳秒，均为大端）加gmsm_sm3_export的128字节。
+     *        先写临时文件并fsync，再rename覆盖旧检查点并同步目录，任何时刻磁盘上都有一个完整的检查点
+     */
+    bool SaveCheckpoint(const std::string& path, const FileId& id, const gmsm_sm3_ctx& ctx) {
+        uint8_t record[CHECKPOINT_SIZE];
+        std::memcpy(record, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        StoreBE64(record + 8, id.size);
+        StoreBE64(record + 16, id.mtimeNs);
+        gmsm_sm3_export(&ctx, record + 24);
+
+        const std::string tmp = path + ".tmp";
+        const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        const bool ok = WriteAll(fd, record, sizeof(record)) && ::fsync(fd) == 0;
+        if (::close(fd) != 0 || !ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        const size_t slash = path.find_last_of('/');
+        const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        const int dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd >= 0) {
+            ::fsync(dirFd);
+            ::close(dirFd);
+        }
+        return true;
+    }
+
+    /**
+     * @brief 读取检查点：不存在、格式不对或属于别的文件版本时返回false，从头开始
+     */
+    bool LoadCheckpoint(const std::string& path, const FileId& id, gmsm_sm3_ctx* ctx) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        uint8_t record[CHECKPOINT_SIZE];
+        const bool read = ::read(fd, record, sizeof(record)) == static_cast<ssize_t>(sizeof(record));
+        ::close(fd);
+        if (!read || std::memcmp(record, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+            std::fprintf(stderr, "%s: 不是检查点文件，忽略\n", path.c_str());
+            return false;
+        }
+        if (LoadBE64(record + 8) != id.size || LoadBE64(record + 16) != id.mtimeNs) {
+            std::fprintf(stderr, "%s: 文件已改变，检查点作废\n", path.c_str());
+            return false;
+        }
+        if (gmsm_sm3_import(ctx, record + 24) != GMSM_OK || ctx->length > id.size) {
+            std::fprintf(stderr, "%s: 检查点损坏，忽略\n", path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void Usage(const char* prog) {
+        std::fprintf(stderr,
+            "用法: %s [-n 检查点间隔(GB)] [-c 检查点文件] [-s 模拟中断位置(GB)] <文件>\n"
+            "默认: -n 1 -c <文件>.sm3ckpt；间隔和位置可以是小数\n", prog);
+    }
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    int i = 1;
+    for (; i + 1 < argc && argv[i][0] == '-'; ++i) {
+        const char* arg = argv[i];
+        if (arg[2] != '\0') {
+            Usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        switch (arg[1]) {
+        case 'n': opt.intervalGb = std::strtod(value, nullptr); break;
+        case 'c': opt.checkpoint = value; break;
+        case 's': opt.stopGb = std::strtod(value, nullptr); break;
+        default:
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (i + 1 != argc || opt.intervalGb <= 0) {
+        Usage(argv[0]);
+        return 1;
+    }
+    const char* path = argv[i];
+    if (opt.checkpoint.empty()) opt.checkpoint = std::string(path) + ".sm3ckpt";
+
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+        std::perror(path);
+        return 1;
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    const FileId id = { static_cast<uint64_t>(st.st_size),
+        static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ULL + static_cast<uint64_t>(st.st_mtim.tv_nsec) };
+
+    gmsm_sm3_ctx ctx;
+    if (LoadCheckpoint(opt.checkpoint, id, &ctx)) {
+        std::printf("从检查点继续：已完成 %.2f GB / %.2f GB\n", ctx.length / GB, id.size / GB);
+    }
+    else {
+        gmsm_sm3_init(&ctx);
+    }
+
+    // 检查点落在间隔的整数倍上；续算时下一个检查点是当前位置之后的第一个整数倍
+    const uint64_t interval = std::max<uint64_t>(static_cast<uint64_t>(opt.intervalGb * GB), READ_SIZE);
+    const uint64_t stopAt = opt.stopGb < 0 ? UINT64_MAX : static_cast<uint64_t>(opt.stopGb * GB);
+    uint64_t nextCheckpoint = (ctx.length / interval + 1) * interval;
+    const uint64_t resumedFrom = ctx.length;
+    std::vector<uint8_t> buf(READ_SIZE);
+    const auto t0 = Clock::now();
+
+    while (ctx.length < id.size) {
+        // 读到下一个检查点或中断位置为止，检查点恰好落在整数倍上
+        uint64_t want = std::min<uint64_t>(READ_SIZE, id.size - ctx.length);
+        want = std::min(want, nextCheckpoint - ctx.length);
+        if (stopAt > ctx.length) want = std::min(want, stopAt - ctx.length);
+        const ssize_t n = ::pread(fd, buf.data(), static_cast<size_t>(want), static_cast<off_t>(ctx.length));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (n == 0) errno = EIO;  // 文件在计算过程中被截短
+            std::perror(path);
+            return 1;
+        }
+        gmsm_sm3_update(&ctx, buf.data(), static_cast<size_t>(n));
+
+        if (ctx.length == nextCheckpoint && ctx.length < id.size) {
+            if (!SaveCheckpoint(opt.checkpoint, id, ctx)) {
+                std::perror(opt.checkpoint.c_str());
+                return 1;
+            }
+            const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+            std::printf("检查点 %.2f GB（%.0f MB/s）\n", ctx.length / GB, (ctx.length - resumedFrom) / s / 1e6);
+            std::fflush(stdout);
+            nextCheckpoint += interval;
+        }
+        if (ctx.length == stopAt) {
+            std::printf("模拟中断于 %.2f GB，重新运行即可从 %s 继续\n", ctx.length / GB, opt.checkpoint.c_str());
+            return 2;
+        }
+    }
+    ::close(fd);
+
+    const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+    uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+    gmsm_sm3_final(&ctx, digest);
+    ::unlink(opt.checkpoint.c_str());
+    for (uint8_t b : digest) std::printf("%02x", b);
+    std::printf("  %s\n", path);
+    std::fprintf(stderr, "本次处理 %.2f GB，%.2f s，%.0f MB/s\n", (id.size - resumedFrom) / GB, s,
+        s > 0 ? (id.size - resumedFrom) / s / 1e6 : 0);
+    return 0;
+}
@@ -2,6 +2,11 @@ import random
 import hashlib
 from hashlib import sha256
 
+try:
+    import gmsm_native  # ../libgmsm 的原生 SM3/SM4 扩展
+except ImportError:
+    gmsm_native = None
+
 # SM2推荐曲线参数（GB/T 32918.1-2016标准）
 P = 0xFFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF00000000FFFFFFFFFFFFFFFF
 A = 0xFFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF00000000FFFFFFFFFFFFFFFC
@@ -161,6 +166,8 @@ class SM2SignatureMisusePOC:
     # ------------------------------
     def _hash(self, data):
         """哈希函数（优先SM3， fallback到SHA256）"""
+        if gmsm_native is not None:
+            return gmsm_native.sm3(data)
         try:
             h = hashlib.new('sm3')
         except:
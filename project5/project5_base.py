@@ -3,6 +3,11 @@ import hashlib
 import time
 import binascii
 
+try:
+    import gmsm_native  # ../libgmsm 的原生 SM3/SM4 扩展
+except ImportError:
+    gmsm_native = None
+
 # 基于GB/T 32918.1-2016标准定义
 CURVE_P = 0xFFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF00000000FFFFFFFFFFFFFFFF
 CURVE_A = 0xFFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF00000000FFFFFFFFFFFFFFFC
@@ -102,6 +107,8 @@ class SM2Crypto:
         :param data: 输入数据
         :return: 哈希结果
         """
+        if gmsm_native is not None:
+            return gmsm_native.sm3(data)
         try:
             hash_obj = hashlib.new('sm3')
         except ValueError:
@@ -1,8 +1,13 @@
-import random
+import secrets
 import hashlib
 import time
 import binascii
 
+try:
+    import gmsm_native  # ../libgmsm 的原生 SM3/SM4 扩展
+except ImportError:
+    gmsm_native = None
+
 # SM2推荐曲线参数（sm2p256v1）
 P = 0xFFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF00000000FFFFFFFFFFFFFFFF
 A = 0xFFFFFFFEFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF00000000FFFFFFFFFFFFFFFC
@@ -53,6 +58,8 @@ class SM2Basic:
         return result
 
     def _hash(self, data):
+        if gmsm_native is not None:
+            return gmsm_native.sm3(data)
         try:
             h = hashlib.new('sm3')
         except:
@@ -68,8 +75,17 @@ class SM2Basic:
             ct += 1
         return output[:klen]
 
+    def _random_scalar(self):
+        """[1, n-1] 中均匀的随机数：有 gmsm_native 时取自其 SM4-CTR_DRBG，否则用 secrets"""
+        if gmsm_native is None:
+            return secrets.randbelow(self.n - 1) + 1
+        while True:
+            k = int.from_bytes(gmsm_native.random_bytes(32), 'big')
+            if 1 <= k < self.n:
+                return k
+
     def generate_keypair(self):
-        d = random.randint(1, self.n - 1)
+        d = self._random_scalar()
         P = self._point_mul(d, self.G)
         return d, P
 
@@ -80,7 +96,7 @@ class SM2Basic:
         if isinstance(msg, str):
             msg = msg.encode()
         klen = len(msg)
-        k = random.randint(1, self.n - 1)
+        k = self._random_scalar()
 
         C1 = self._point_mul(k, self.G)
         C1_bytes = self.serialize_public_key(C1)
@@ -126,7 +142,7 @@ class SM2Basic:
             msg = msg.encode()
         e = int.from_bytes(self._hash(msg), 'big')
         while True:
-            k = random.randint(1, self.n - 1)
+            k = self._random_scalar()
             x1, y1 = self._point_mul(k, self.G)
             r = (e + x1) % self.n
             if r == 0 or r + k == self.n:
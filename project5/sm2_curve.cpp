@@ -0,0 +1,450 @@
+﻿#include "sm2_curve.h"
+#include "../libgmsm/gmsm.h"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace SM2Curve {
+
+    // SM2曲线参数（sm2p256v1），小端limb
+    const U256 P = { { 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFF00000000ULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFEFFFFFFFFULL } };
+    const U256 B = { { 0xDDBCBD414D940E93ULL, 0xF39789F515AB8F92ULL, 0x4D5A9E4BCF6509A7ULL, 0x28E9FA9E9D9F5E34ULL } };
+    const U256 N = { { 0x53BBF40939D54123ULL, 0x7203DF6B21C6052BULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFEFFFFFFFFULL } };
+    const AffinePoint G = {
+        { { 0x715A4589334C74C7ULL, 0x8FE30BBFF2660BE1ULL, 0x5F9904466A39C994ULL, 0x32C4AE2C1F198119ULL } },
+        { { 0x02DF32E52139F0A0ULL, 0xD0A9877CC62A4740ULL, 0x59BDCEE36B692153ULL, 0xBC3736A2F4F6779CULL } },
+        false
+    };
+
+    namespace {
+
+        // 蒙哥马利域预计算常量（R = 2^256）
+        const U256 MONT_ONE = { { 0x0000000000000001ULL, 0x00000000FFFFFFFFULL, 0x0000000000000000ULL, 0x0000000100000000ULL } };  // R mod p
+        const U256 MONT_RR = { { 0x0000000200000003ULL, 0x00000002FFFFFFFFULL, 0x0000000100000001ULL, 0x0000000400000002ULL } };   // R^2 mod p
+        const U256 MONT_B = { { 0x90D230632BC0DD42ULL, 0x71CF379AE9B537ABULL, 0x527981505EA51C3CULL, 0x240FE188BA20E2C8ULL } };    // b*R mod p
+        const U256 EXP_INV = { { 0xFFFFFFFFFFFFFFFDULL, 0xFFFFFFFF00000000ULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFEFFFFFFFFULL } };  // p - 2
+        const U256 EXP_SQRT = { { 0x4000000000000000ULL, 0xFFFFFFFFC0000000ULL, 0xFFFFFFFFFFFFFFFFULL, 0x3FFFFFFFBFFFFFFFULL } }; // (p + 1) / 4
+        constexpr uint64_t P_INV = 1;  // -p^(-1) mod 2^64（p的最低limb为全1）
+
+        /**
+         * @brief 64x64->128位乘法，返回低64位，高64位写入hi
+         */
+        inline uint64_t MulWide(uint64_t a, uint64_t b, uint64_t& hi) {
+#if defined(_MSC_VER)
+            return _umul128(a, b, &hi);
+#else
+            unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+            hi = static_cast<uint64_t>(r >> 64);
+            return static_cast<uint64_t>(r);
+#endif
+        }
+
+        // 计算 a*b + c + d，结果不会溢出128位
+        inline uint64_t MulAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t& hi) {
+            uint64_t lo = MulWide(a, b, hi);
+            lo += c;
+            hi += (lo < c);
+            lo += d;
+            hi += (lo < d);
+            return lo;
+        }
+
+        inline uint64_t AddCarry(uint64_t a, uint64_t b, uint64_t& carry) {
+            uint64_t s = a + carry;
+            uint64_t c = (s < carry);
+            s += b;
+            c += (s < b);
+            carry = c;
+            return s;
+        }
+
+        inline uint64_t SubBorrow(uint64_t a, uint64_t b, uint64_t& borrow) {
+            uint64_t d = a - b;
+            uint64_t br = (a < b);
+            uint64_t r = d - borrow;
+            br += (d < borrow);
+            borrow = br;
+            return r;
+        }
+
+        // 按掩码选择：mask全1时取b，全0时取a
+        inline U256 Select(const U256& a, const U256& b, uint64_t mask) {
+            U256 r;
+            for (int i = 0; i < 4; ++i) {
+                r.v[i] = (a.v[i] & ~mask) | (b.v[i] & mask);
+            }
+            return r;
+        }
+
+        /**
+         * @brief r = t - p（若 t >= p 或存在进位），否则 r = t
+         */
+        inline U256 ConditionalSubP(const U256& t, uint64_t carry) {
+            U256 d;
+            uint64_t borrow = 0;
+            for (int i = 0; i < 4; ++i) {
+                d.v[i] = SubBorrow(t.v[i], P.v[i], borrow);
+            }
+            // carry=1 或 borrow=0 时采用差值
+            uint64_t useDiff = carry | (borrow ^ 1);
+            return Select(t, d, 0 - useDiff);
+        }
+
+        /**
+         * @brief 固定指数的模幂（指数为公开常量，按位平方-乘）
+         */
+        U256 FpPow(const U256& a, const U256& e) {
+            U256 r = MONT_ONE;
+            for (int i = 255; i >= 0; --i) {
+                r = FpSqr(r);
+                if ((e.v[i / 64] >> (i % 64)) & 1) {
+                    r = FpMul(r, a);
+                }
+            }
+            return r;
+        }
+
+        inline JacobianPoint Infinity() {
+            JacobianPoint R;
+            R.X = MONT_ONE;
+            R.Y = MONT_ONE;
+            std::memset(&R.Z, 0, sizeof(R.Z));
+            return R;
+        }
+
+    } // namespace
+
+    U256 FromBytes(const uint8_t in[FIELD_BYTES]) {
+        U256 r;
+        for (int i = 0; i < 4; ++i) {
+            uint64_t w = 0;
+            for (int j = 0; j < 8; ++j) {
+                w = (w << 8) | in[(3 - i) * 8 + j];
+            }
+            r.v[i] = w;
+        }
+        return r;
+    }
+
+    void ToBytes(const U256& a, uint8_t out[FIELD_BYTES]) {
+        for (int i = 0; i < 4; ++i) {
+            uint64_t w = a.v[3 - i];
+            for (int j = 7; j >= 0; --j) {
+                out[i * 8 + j] = static_cast<uint8_t>(w);
+                w >>= 8;
+            }
+        }
+    }
+
+    int Compare(const U256& a, const U256& b) {
+        for (int i = 3; i >= 0; --i) {
+            if (a.v[i] != b.v[i]) {
+                return a.v[i] < b.v[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    bool IsZero(const U256& a) {
+        return (a.v[0] | a.v[1] | a.v[2] | a.v[3]) == 0;
+    }
+
+    U256 FpAdd(const U256& a, const U256& b) {
+        U256 t;
+        uint64_t carry = 0;
+        for (int i = 0; i < 4; ++i) {
+            t.v[i] = AddCarry(a.v[i], b.v[i], carry);
+        }
+        return ConditionalSubP(t, carry);
+    }
+
+    U256 FpSub(const U256& a, const U256& b) {
+        U256 t;
+        uint64_t borrow = 0;
+        for (int i = 0; i < 4; ++i) {
+            t.v[i] = SubBorrow(a.v[i], b.v[i], borrow);
+        }
+        // 有借位时加回p
+        uint64_t mask = 0 - borrow;
+        uint64_t carry = 0;
+        for (int i = 0; i < 4; ++i) {
+            t.v[i] = AddCarry(t.v[i], P.v[i] & mask, carry);
+        }
+        return t;
+    }
+
+    /**
+     * @brief 蒙哥马利乘法（CIOS），返回 a*b*R^(-1) mod p
+     */
+    U256 FpMul(const U256& a, const U256& b) {
+        uint64_t t[6] = { 0 };
+        for (int i = 0; i < 4; ++i) {
+            // t += a * b[i]
+            uint64_t c = 0;
+            for (int j = 0; j < 4; ++j) {
+                t[j] = MulAdd(a.v[j], b.v[i], t[j], c, c);
+            }
+            uint64_t carry = 0;
+            t[4] = AddCarry(t[4], c, carry);
+            t[5] = carry;
+
+            // t = (t + m*p) / 2^64
+            uint64_t m = t[0] * P_INV;
+            MulAdd(m, P.v[0], t[0], 0, c);
+            for (int j = 1; j < 4; ++j) {
+                t[j - 1] = MulAdd(m, P.v[j], t[j], c, c);
+            }
+            carry = 0;
+            t[3] = AddCarry(t[4], c, carry);
+            t[4] = t[5] + carry;
+        }
+        U256 r = { { t[0], t[1], t[2], t[3] } };
+        return ConditionalSubP(r, t[4]);
+    }
+
+    U256 FpSqr(const U256& a) {
+        return FpMul(a, a);
+    }
+
+    U256 FpToMont(const U256& a) {
+        return FpMul(FpReduce(a), MONT_RR);
+    }
+
+    U256 FpFromMont(const U256& a) {
+        const U256 one = { { 1, 0, 0, 0 } };
+        return FpMul(a, one);
+    }
+
+    U256 FpInv(const U256& a) {
+        return FpPow(a, EXP_INV);
+    }
+
+    bool FpSqrt(const U256& a, U256& root) {
+        root = FpPow(a, EXP_SQRT);
+        return Compare(FpSqr(root), a) == 0;
+    }
+
+    U256 FpReduce(const U256& a) {
+        return ConditionalSubP(a, 0);
+    }
+
+    U256 CurveRhs(const U256& xMont) {
+        U256 x3 = FpMul(FpSqr(xMont), xMont);
+        U256 x3t = FpAdd(FpAdd(xMont, xMont), xMont);
+        return FpAdd(FpSub(x3, x3t), MONT_B);
+    }
+
+    JacobianPoint ToJacobian(const AffinePoint& P) {
+        if (P.infinity) {
+            return Infinity();
+        }
+        JacobianPoint R;
+        R.X = FpToMont(P.x);
+        R.Y = FpToMont(P.y);
+        R.Z = MONT_ONE;
+        return R;
+    }
+
+    AffinePoint ToAffine(const JacobianPoint& P) {
+        AffinePoint R;
+        BatchToAffine(&P, &R, 1);
+        return R;
+    }
+
+    void BatchToAffine(const JacobianPoint* in, AffinePoint* out, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        // 前缀积：prefix[i] = Z0 * Z1 * ... * Zi（跳过无穷远点）
+        std::vector<U256> prefix(count);
+        U256 acc = MONT_ONE;
+        for (size_t i = 0; i < count; ++i) {
+            if (!IsZero(in[i].Z)) {
+                acc = FpMul(acc, in[i].Z);
+            }
+            prefix[i] = acc;
+        }
+
+        // 只做一次模逆，再倒序拆出每个Z^(-1)
+        U256 inv = FpInv(acc);
+        for (size_t i = count; i-- > 0;) {
+            if (IsZero(in[i].Z)) {
+                std::memset(&out[i], 0, sizeof(AffinePoint));
+                out[i].infinity = true;
+                continue;
+            }
+            U256 zInv = (i > 0) ? FpMul(inv, prefix[i - 1]) : inv;
+            inv = FpMul(inv, in[i].Z);
+
+            U256 zInv2 = FpSqr(zInv);
+            U256 zInv3 = FpMul(zInv2, zInv);
+            out[i].x = FpFromMont(FpMul(in[i].X, zInv2));
+            out[i].y = FpFromMont(FpMul(in[i].Y, zInv3));
+            out[i].infinity = false;
+        }
+    }
+
+    /**
+     * @brief 点倍乘（dbl-2001-b，a = -3）
+     */
+    JacobianPoint PointDouble(const JacobianPoint& P) {
+        U256 delta = FpSqr(P.Z);
+        U256 gamma = FpSqr(P.Y);
+        U256 beta = FpMul(P.X, gamma);
+        U256 t = FpMul(FpSub(P.X, delta), FpAdd(P.X, delta));
+        U256 alpha = FpAdd(FpAdd(t, t), t);
+
+        U256 beta4 = FpAdd(beta, beta);
+        beta4 = FpAdd(beta4, beta4);
+        U256 beta8 = FpAdd(beta4, beta4);
+
+        JacobianPoint R;
+        R.X = FpSub(FpSqr(alpha), beta8);
+        R.Z = FpSub(FpSub(FpSqr(FpAdd(P.Y, P.Z)), gamma), delta);
+        U256 gamma2 = FpSqr(gamma);
+        U256 gamma8 = FpAdd(gamma2, gamma2);
+        gamma8 = FpAdd(gamma8, gamma8);
+        gamma8 = FpAdd(gamma8, gamma8);
+        R.Y = FpSub(FpMul(alpha, FpSub(beta4, R.X)), gamma8);
+        return R;
+    }
+
+    /**
+     * @brief 点加（add-2007-bl）
+     */
+    JacobianPoint PointAdd(const JacobianPoint& P, const JacobianPoint& Q) {
+        if (IsZero(P.Z)) {
+            return Q;
+        }
+        if (IsZero(Q.Z)) {
+            return P;
+        }
+
+        U256 z1z1 = FpSqr(P.Z);
+        U256 z2z2 = FpSqr(Q.Z);
+        U256 u1 = FpMul(P.X, z2z2);
+        U256 u2 = FpMul(Q.X, z1z1);
+        U256 s1 = FpMul(FpMul(P.Y, Q.Z), z2z2);
+        U256 s2 = FpMul(FpMul(Q.Y, P.Z), z1z1);
+
+        U256 h = FpSub(u2, u1);
+        U256 r = FpSub(s2, s1);
+        if (IsZero(h)) {
+            if (IsZero(r)) {
+                return PointDouble(P);  // P == Q
+            }
+            return Infinity();          // P == -Q
+        }
+        r = FpAdd(r, r);
+
+        U256 i = FpAdd(h, h);
+        i = FpSqr(i);
+        U256 j = FpMul(h, i);
+        U256 v = FpMul(u1, i);
+
+        JacobianPoint R;
+        R.X = FpSub(FpSub(FpSub(FpSqr(r), j), v), v);
+        U256 s1j = FpMul(s1, j);
+        R.Y = FpSub(FpMul(r, FpSub(v, R.X)), FpAdd(s1j, s1j));
+        R.Z = FpMul(FpSub(FpSub(FpSqr(FpAdd(P.Z, Q.Z)), z1z1), z2z2), h);
+        return R;
+    }
+
+    JacobianPoint ScalarMul(const U256& k, const AffinePoint& P) {
+        // 预计算 T[i] = i*P, i = 0..15
+        JacobianPoint table[16];
+        table[0] = Infinity();
+        table[1] = ToJacobian(P);
+        for (int i = 2; i < 16; ++i) {
+            table[i] = (i % 2 == 0) ? PointDouble(table[i / 2]) : PointAdd(table[i - 1], table[1]);
+        }
+
+        JacobianPoint R = Infinity();
+        for (int w = 63; w >= 0; --w) {
+            for (int d = 0; d < 4; ++d) {
+                R = PointDouble(R);
+            }
+            uint64_t nibble = (k.v[w / 16] >> ((w % 16) * 4)) & 0xF;
+
+            // 扫描整张表取出T[nibble]，访存模式与标量无关
+            JacobianPoint sel = table[0];
+            for (uint64_t i = 1; i < 16; ++i) {
+                uint64_t mask = 0 - static_cast<uint64_t>(i == nibble);
+                sel.X = Select(sel.X, table[i].X, mask);
+                sel.Y = Select(sel.Y, table[i].Y, mask);
+                sel.Z = Select(sel.Z, table[i].Z, mask);
+            }
+            R = PointAdd(R, sel);
+        }
+        return R;
+    }
+
+    bool IsOnCurve(const AffinePoint& P) {
+        if (P.infinity) {
+            return true;
+        }
+        if (Compare(P.x, SM2Curve::P) >= 0 || Compare(P.y, SM2Curve::P) >= 0) {
+            return false;
+        }
+        U256 x = FpToMont(P.x);
+        U256 y = FpToMont(P.y);
+        return Compare(FpSqr(y), CurveRhs(x)) == 0;
+    }
+
+    EncodedPoint EncodePoint(const AffinePoint& P) {
+        EncodedPoint out{};
+        if (P.infinity) {
+            return out;
+        }
+        out[0] = static_cast<uint8_t>(0x02 | (P.y.v[0] & 1));
+        ToBytes(P.x, out.data() + 1);
+        return out;
+    }
+
+    bool DecodePoint(const EncodedPoint& in, AffinePoint& P) {
+        if (in[0] == 0x00) {
+            for (size_t i = 1; i < POINT_BYTES; ++i) {
+                if (in[i] != 0) {
+                    return false;
+                }
+            }
+            std::memset(&P, 0, sizeof(P));
+            P.infinity = true;
+            return true;
+        }
+        if (in[0] != 0x02 && in[0] != 0x03) {
+            return false;
+        }
+        U256 x = FromBytes(in.data() + 1);
+        if (Compare(x, SM2Curve::P) >= 0) {
+            return false;
+        }
+        U256 y;
+        if (!FpSqrt(CurveRhs(FpToMont(x)), y)) {
+            return false;
+        }
+        y = FpFromMont(y);
+        if ((y.v[0] & 1) != static_cast<uint64_t>(in[0] & 1)) {
+            const U256 zero = { { 0, 0, 0, 0 } };
+            y = FpSub(zero, y);
+        }
+        P.x = x;
+        P.y = y;
+        P.infinity = false;
+        return true;
+    }
+
+    U256 RandomScalar() {
+        U256 k;
+        do {
+            // libgmsm 的每线程 SM4-CTR_DRBG，不必每次陷入内核；取不到熵时不能退化成全零的k
+            if (gmsm_random_bytes(k.v, sizeof(k.v)) != GMSM_OK) throw std::runtime_error("SM2: 随机数生成失败");
+        } while (IsZero(k) || Compare(k, N) >= 0);
+        return k;
+    }
+
+} // namespace SM2Curve
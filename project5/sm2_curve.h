@@ -0,0 +1,112 @@
+﻿#ifndef SM2_CURVE_H
+#define SM2_CURVE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+// SM2推荐曲线（sm2p256v1）上的原生群运算
+// 域元素采用4个64位小端limb表示，内部运算在蒙哥马利域中进行
+namespace SM2Curve {
+
+    constexpr size_t FIELD_BYTES = 32;                 // 域元素/标量字节数
+    constexpr size_t POINT_BYTES = FIELD_BYTES + 1;    // 压缩点编码长度
+
+    struct U256 {
+        uint64_t v[4];  // v[0]为最低limb
+    };
+
+    // 仿射坐标点（坐标为普通表示，非蒙哥马利域）
+    struct AffinePoint {
+        U256 x, y;
+        bool infinity;
+    };
+
+    // 雅可比坐标点（坐标在蒙哥马利域中，Z=0表示无穷远点）
+    struct JacobianPoint {
+        U256 X, Y, Z;
+    };
+
+    using EncodedPoint = std::array<uint8_t, POINT_BYTES>;
+
+    extern const U256 P;   // 素数域模数p
+    extern const U256 B;   // 曲线参数b（a = p - 3）
+    extern const U256 N;   // 基点阶n
+    extern const AffinePoint G;  // 基点
+
+    /**
+     * @brief 大端字节串 <-> U256
+     */
+    U256 FromBytes(const uint8_t in[FIELD_BYTES]);
+    void ToBytes(const U256& a, uint8_t out[FIELD_BYTES]);
+
+    /**
+     * @brief 比较两个256位整数
+     * @return a<b返回-1，相等返回0，a>b返回1
+     */
+    int Compare(const U256& a, const U256& b);
+    bool IsZero(const U256& a);
+
+    // 素数域运算（输入输出均为蒙哥马利域）
+    U256 FpToMont(const U256& a);
+    U256 FpFromMont(const U256& a);
+    U256 FpAdd(const U256& a, const U256& b);
+    U256 FpSub(const U256& a, const U256& b);
+    U256 FpMul(const U256& a, const U256& b);
+    U256 FpSqr(const U256& a);
+    U256 FpInv(const U256& a);
+
+    /**
+     * @brief 蒙哥马利域中的平方根（p ≡ 3 mod 4，r = a^((p+1)/4)）
+     * @return a为二次剩余时返回true
+     */
+    bool FpSqrt(const U256& a, U256& root);
+
+    /**
+     * @brief 把任意256位整数约减到[0, p)
+     */
+    U256 FpReduce(const U256& a);
+
+    /**
+     * @brief 计算曲线方程右侧 x^3 + ax + b（蒙哥马利域）
+     */
+    U256 CurveRhs(const U256& xMont);
+
+    // 点运算
+    JacobianPoint ToJacobian(const AffinePoint& P);
+    AffinePoint ToAffine(const JacobianPoint& P);
+
+    /**
+     * @brief 批量雅可比->仿射转换（Montgomery批量求逆，只做一次模逆）
+     * @param in 输入点
+     * @param out 输出点
+     * @param count 点数
+     */
+    void BatchToAffine(const JacobianPoint* in, AffinePoint* out, size_t count);
+
+    JacobianPoint PointDouble(const JacobianPoint& P);
+    JacobianPoint PointAdd(const JacobianPoint& P, const JacobianPoint& Q);
+
+    /**
+     * @brief 任意点标量乘（4位固定窗口，窗口选择使用全表扫描，不随标量分支）
+     * @param k 标量（大端32字节解析后的U256）
+     * @param P 点
+     */
+    JacobianPoint ScalarMul(const U256& k, const AffinePoint& P);
+
+    bool IsOnCurve(const AffinePoint& P);
+
+    /**
+     * @brief 压缩编码（0x02/0x03 || x），无穷远点编码为全0
+     */
+    EncodedPoint EncodePoint(const AffinePoint& P);
+    bool DecodePoint(const EncodedPoint& in, AffinePoint& P);
+
+    /**
+     * @brief 生成[1, n-1]内的随机标量
+     */
+    U256 RandomScalar();
+
+} // namespace SM2Curve
+
+#endif // SM2_CURVE_H
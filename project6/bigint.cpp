@@ -0,0 +1,537 @@
+﻿#include "bigint.h"
+#include "../libgmsm/gmsm.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace PSI {
+
+    namespace {
+
+        inline uint64_t MulWide(uint64_t a, uint64_t b, uint64_t& hi) {
+#if defined(_MSC_VER)
+            return _umul128(a, b, &hi);
+#else
+            unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+            hi = static_cast<uint64_t>(r >> 64);
+            return static_cast<uint64_t>(r);
+#endif
+        }
+
+        // 计算 a*b + c + d，结果不会溢出128位
+        inline uint64_t MulAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t& hi) {
+            uint64_t lo = MulWide(a, b, hi);
+            lo += c;
+            hi += (lo < c);
+            lo += d;
+            hi += (lo < d);
+            return lo;
+        }
+
+        inline uint64_t AddCarry(uint64_t a, uint64_t b, uint64_t& carry) {
+            uint64_t s = a + carry;
+            uint64_t c = (s < carry);
+            s += b;
+            c += (s < b);
+            carry = c;
+            return s;
+        }
+
+        inline uint64_t SubBorrow(uint64_t a, uint64_t b, uint64_t& borrow) {
+            uint64_t d = a - b;
+            uint64_t br = (a < b);
+            uint64_t r = d - borrow;
+            br += (d < borrow);
+            borrow = br;
+            return r;
+        }
+
+        /**
+         * @brief (hi:lo) / d，要求 hi < d
+         */
+        inline uint64_t Div128(uint64_t hi, uint64_t lo, uint64_t d, uint64_t& rem) {
+#if defined(_MSC_VER)
+            return _udiv128(hi, lo, d, &rem);
+#else
+            unsigned __int128 n = (static_cast<unsigned __int128>(hi) << 64) | lo;
+            rem = static_cast<uint64_t>(n % d);
+            return static_cast<uint64_t>(n / d);
+#endif
+        }
+
+        inline int LeadingZeros(uint64_t x) {
+            int n = 0;
+            while (!(x & (1ULL << 63))) {
+                x <<= 1;
+                ++n;
+            }
+            return n;
+        }
+
+        // 取不到熵时抛出，不能返回全零或未初始化的数
+        void FillRandom(std::vector<uint64_t>& d) {
+            if (gmsm_random_bytes(d.data(), d.size() * sizeof(uint64_t)) != GMSM_OK) {
+                throw std::runtime_error("BigInt: 随机数生成失败");
+            }
+        }
+
+        // 试除用的小素数表
+        const std::vector<uint32_t>& SmallPrimes() {
+            static const std::vector<uint32_t> primes = [] {
+                const uint32_t limit = 20000;
+                std::vector<bool> composite(limit, false);
+                std::vector<uint32_t> out;
+                for (uint32_t i = 3; i < limit; i += 2) {
+                    if (composite[i]) continue;
+                    out.push_back(i);
+                    for (uint32_t j = i * i; j < limit; j += 2 * i) composite[j] = true;
+                }
+                return out;
+            }();
+            return primes;
+        }
+
+        uint64_t ModSmall(const BigInt& a, uint64_t m) {
+            uint64_t r = 0;
+            for (size_t i = a.LimbCount(); i-- > 0;) {
+                Div128(r, a.Limb(i), m, r);
+            }
+            return r;
+        }
+
+    } // namespace
+
+    BigInt::BigInt(uint64_t v) {
+        if (v) d_.push_back(v);
+    }
+
+    void BigInt::Normalize() {
+        while (!d_.empty() && d_.back() == 0) d_.pop_back();
+    }
+
+    BigInt BigInt::FromBytes(const uint8_t* data, size_t len) {
+        BigInt r;
+        r.d_.assign((len + 7) / 8, 0);
+        for (size_t i = 0; i < len; ++i) {
+            size_t bit = (len - 1 - i) * 8;
+            r.d_[bit / 64] |= static_cast<uint64_t>(data[i]) << (bit % 64);
+        }
+        r.Normalize();
+        return r;
+    }
+
+    bool BigInt::ToBytes(uint8_t* out, size_t len) const {
+        if ((BitLength() + 7) / 8 > len) {
+            return false;
+        }
+        for (size_t i = 0; i < len; ++i) {
+            size_t bit = (len - 1 - i) * 8;
+            out[i] = static_cast<uint8_t>(Limb(bit / 64) >> (bit % 64));
+        }
+        return true;
+    }
+
+    BigInt BigInt::FromLimbs(const uint64_t* limbs, size_t count) {
+        BigInt r;
+        r.d_.assign(limbs, limbs + count);
+        r.Normalize();
+        return r;
+    }
+
+    bool BigInt::Bit(size_t i) const {
+        return (Limb(i / 64) >> (i % 64)) & 1;
+    }
+
+    size_t BigInt::BitLength() const {
+        if (d_.empty()) return 0;
+        return d_.size() * 64 - LeadingZeros(d_.back());
+    }
+
+    int BigInt::Compare(const BigInt& a, const BigInt& b) {
+        if (a.d_.size() != b.d_.size()) {
+            return a.d_.size() < b.d_.size() ? -1 : 1;
+        }
+        for (size_t i = a.d_.size(); i-- > 0;) {
+            if (a.d_[i] != b.d_[i]) return a.d_[i] < b.d_[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    BigInt BigInt::Add(const BigInt& a, const BigInt& b) {
+        const BigInt& big = a.d_.size() >= b.d_.size() ? a : b;
+        const BigInt& small = a.d_.size() >= b.d_.size() ? b : a;
+        BigInt r;
+        r.d_.resize(big.d_.size() + 1);
+        uint64_t carry = 0;
+        for (size_t i = 0; i < big.d_.size(); ++i) {
+            r.d_[i] = AddCarry(big.d_[i], small.Limb(i), carry);
+        }
+        r.d_[big.d_.size()] = carry;
+        r.Normalize();
+        return r;
+    }
+
+    BigInt BigInt::Sub(const BigInt& a, const BigInt& b) {
+        BigInt r;
+        r.d_.resize(a.d_.size());
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < a.d_.size(); ++i) {
+            r.d_[i] = SubBorrow(a.d_[i], b.Limb(i), borrow);
+        }
+        r.Normalize();
+        return r;
+    }
+
+    BigInt BigInt::Mul(const BigInt& a, const BigInt& b) {
+        if (a.IsZero() || b.IsZero()) return BigInt();
+        BigInt r;
+        r.d_.assign(a.d_.size() + b.d_.size(), 0);
+        for (size_t i = 0; i < a.d_.size(); ++i) {
+            uint64_t c = 0;
+            for (size_t j = 0; j < b.d_.size(); ++j) {
+                r.d_[i + j] = MulAdd(a.d_[i], b.d_[j], r.d_[i + j], c, c);
+            }
+            r.d_[i + b.d_.size()] = c;
+        }
+        r.Normalize();
+        return r;
+    }
+
+    BigInt BigInt::MulSmall(const BigInt& a, uint64_t b) {
+        BigInt r;
+        r.d_.resize(a.d_.size() + 1);
+        uint64_t c = 0;
+        for (size_t i = 0; i < a.d_.size(); ++i) {
+            r.d_[i] = MulAdd(a.d_[i], b, c, 0, c);
+        }
+        r.d_[a.d_.size()] = c;
+        r.Normalize();
+        return r;
+    }
+
+    void BigInt::DivMod(const BigInt& a, const BigInt& b, BigInt* q, BigInt* r) {
+        if (Compare(a, b) < 0) {
+            if (q) *q = BigInt();
+            if (r) *r = a;
+            return;
+        }
+
+        const size_t n = b.d_.size();
+        const size_t m = a.d_.size() - n;
+
+        // 单limb除数：逐limb短除
+        if (n == 1) {
+            BigInt quot;
+            quot.d_.resize(a.d_.size());
+            uint64_t rem = 0;
+            for (size_t i = a.d_.size(); i-- > 0;) {
+                quot.d_[i] = Div128(rem, a.d_[i], b.d_[0], rem);
+            }
+            quot.Normalize();
+            if (q) *q = quot;
+            if (r) *r = BigInt(rem);
+            return;
+        }
+
+        // 规格化：使除数最高limb的最高位为1
+        const int s = LeadingZeros(b.d_[n - 1]);
+        std::vector<uint64_t> vn(n), un(a.d_.size() + 1);
+        for (size_t i = n - 1; i > 0; --i) {
+            vn[i] = (b.d_[i] << s) | (s ? b.d_[i - 1] >> (64 - s) : 0);
+        }
+        vn[0] = b.d_[0] << s;
+        un[a.d_.size()] = s ? a.d_.back() >> (64 - s) : 0;
+        for (size_t i = a.d_.size() - 1; i > 0; --i) {
+            un[i] = (a.d_[i] << s) | (s ? a.d_[i - 1] >> (64 - s) : 0);
+        }
+        un[0] = a.d_[0] << s;
+
+        BigInt quot;
+        quot.d_.assign(m + 1, 0);
+        for (size_t j = m + 1; j-- > 0;) {
+            // 估计商qhat
+            uint64_t qhat, rhat;
+            bool rhatOverflow = false;
+            if (un[j + n] >= vn[n - 1]) {
+                qhat = ~0ULL;
+                rhat = un[j + n - 1] + vn[n - 1];
+                rhatOverflow = rhat < vn[n - 1];
+            }
+            else {
+                qhat = Div128(un[j + n], un[j + n - 1], vn[n - 1], rhat);
+            }
+            while (!rhatOverflow) {
+                uint64_t pHi;
+                uint64_t pLo = MulWide(qhat, vn[n - 2], pHi);
+                if (pHi < rhat || (pHi == rhat && pLo <= un[j + n - 2])) break;
+                --qhat;
+                rhat += vn[n - 1];
+                rhatOverflow = rhat < vn[n - 1];
+            }
+
+            // un[j..j+n] -= qhat * vn
+            uint64_t borrow = 0, carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t p = MulAdd(qhat, vn[i], carry, 0, carry);
+                un[i + j] = SubBorrow(un[i + j], p, borrow);
+            }
+            un[j + n] = SubBorrow(un[j + n], carry, borrow);
+
+            // 估计偏大（概率约2/2^64）时加回一次
+            if (borrow) {
+                --qhat;
+                uint64_t c = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    un[i + j] = AddCarry(un[i + j], vn[i], c);
+                }
+                un[j + n] += c;
+            }
+            quot.d_[j] = qhat;
+        }
+
+        if (q) {
+            quot.Normalize();
+            *q = quot;
+        }
+        if (r) {
+            BigInt rem;
+            rem.d_.resize(n);
+            for (size_t i = 0; i < n; ++i) {
+                rem.d_[i] = (un[i] >> s) | (s ? un[i + 1] << (64 - s) : 0);
+            }
+            rem.Normalize();
+            *r = rem;
+        }
+    }
+
+    BigInt BigInt::Mod(const BigInt& a, const BigInt& m) {
+        BigInt r;
+        DivMod(a, m, nullptr, &r);
+        return r;
+    }
+
+    BigInt BigInt::ShiftLeft(size_t bits) const {
+        if (IsZero()) return BigInt();
+        size_t limbs = bits / 64, s = bits % 64;
+        BigInt r;
+        r.d_.assign(d_.size() + limbs + 1, 0);
+        for (size_t i = 0; i < d_.size(); ++i) {
+            r.d_[i + limbs] |= d_[i] << s;
+            if (s) r.d_[i + limbs + 1] |= d_[i] >> (64 - s);
+        }
+        r.Normalize();
+        return r;
+    }
+
+    BigInt BigInt::ShiftRight(size_t bits) const {
+        size_t limbs = bits / 64, s = bits % 64;
+        if (limbs >= d_.size()) return BigInt();
+        BigInt r;
+        r.d_.resize(d_.size() - limbs);
+        for (size_t i = 0; i < r.d_.size(); ++i) {
+            r.d_[i] = d_[i + limbs] >> s;
+            if (s && i + limbs + 1 < d_.size()) r.d_[i] |= d_[i + limbs + 1] << (64 - s);
+        }
+        r.Normalize();
+        return r;
+    }
+
+    BigInt BigInt::RandomBits(size_t bits) {
+        BigInt r;
+        r.d_.resize((bits + 63) / 64);
+        FillRandom(r.d_);
+        if (bits % 64) r.d_.back() &= (1ULL << (bits % 64)) - 1;
+        r.d_[(bits - 1) / 64] |= 1ULL << ((bits - 1) % 64);
+        r.Normalize();
+        return r;
+    }
+
+    BigInt BigInt::RandomBelow(const BigInt& n) {
+        const size_t bits = n.BitLength();
+        BigInt r;
+        do {
+            r.d_.resize((bits + 63) / 64);
+            FillRandom(r.d_);
+            if (bits % 64) r.d_.back() &= (1ULL << (bits % 64)) - 1;
+            r.Normalize();
+        } while (r.IsZero() || Compare(r, n) >= 0);
+        return r;
+    }
+
+    bool BigInt::IsProbablePrime(const BigInt& n, int rounds) {
+        if (n.BitLength() <= 1) return false;
+        if (!n.IsOdd()) return n.BitLength() == 2 && n.Low64() == 2;
+        for (uint32_t p : SmallPrimes()) {
+            if (n.LimbCount() == 1 && n.Low64() == p) return true;
+            if (ModSmall(n, p) == 0) return false;
+        }
+
+        // n - 1 = d * 2^s
+        BigInt nm1 = Sub(n, BigInt(1));
+        size_t s = 0;
+        while (!nm1.Bit(s)) ++s;
+        BigInt d = nm1.ShiftRight(s);
+
+        MontContext ctx(n);
+        MontContext::Element one = ctx.One();
+        MontContext::Element minusOne = ctx.ToMont(nm1);
+        for (int i = 0; i < rounds; ++i) {
+            BigInt a = RandomBelow(nm1);
+            if (a.BitLength() <= 1) a = BigInt(2);
+            MontContext::Element x = ctx.PowMont(ctx.ToMont(a), d);
+            if (x == one || x == minusOne) continue;
+            bool witness = true;
+            for (size_t r = 1; r < s && witness; ++r) {
+                x = ctx.Mul(x, x);
+                if (x == minusOne) witness = false;
+            }
+            if (witness) return false;
+        }
+        return true;
+    }
+
+    BigInt BigInt::RandomPrime(size_t bits) {
+        const std::vector<uint32_t>& primes = SmallPrimes();
+        std::vector<uint32_t> residues(primes.size());
+        for (;;) {
+            BigInt c = RandomBits(bits);
+            c.d_[(bits - 2) / 64] |= 1ULL << ((bits - 2) % 64);
+            c.d_[0] |= 1;
+            for (size_t i = 0; i < primes.size(); ++i) {
+                residues[i] = static_cast<uint32_t>(ModSmall(c, primes[i]));
+            }
+
+            // 增量筛：只更新小素数余数，通过筛选的候选才做Miller-Rabin
+            for (uint64_t delta = 0; delta < (1u << 16); delta += 2) {
+                bool divisible = false;
+                for (size_t i = 0; i < primes.size(); ++i) {
+                    if ((residues[i] + delta) % primes[i] == 0) {
+                        divisible = true;
+                        break;
+                    }
+                }
+                if (divisible) continue;
+                BigInt candidate = Add(c, BigInt(delta));
+                if (candidate.BitLength() != bits) break;
+                if (IsProbablePrime(candidate)) return candidate;
+            }
+        }
+    }
+
+    MontContext::MontContext(const BigInt& modulus) : m_(modulus), k_(modulus.LimbCount()) {
+        // Newton迭代求 m^(-1) mod 2^64
+        uint64_t inv = 1;
+        for (int i = 0; i < 6; ++i) inv *= 2 - m_.d_[0] * inv;
+        n0inv_ = 0 - inv;
+
+        BigInt r = BigInt::Mod(BigInt(1).ShiftLeft(64 * k_), m_);
+        BigInt r2 = BigInt::Mod(BigInt(1).ShiftLeft(128 * k_), m_);
+        one_.assign(k_, 0);
+        r2_.assign(k_, 0);
+        std::copy(r.d_.begin(), r.d_.end(), one_.begin());
+        std::copy(r2.d_.begin(), r2.d_.end(), r2_.begin());
+    }
+
+    void MontContext::Mul(const uint64_t* a, const uint64_t* b, uint64_t* r) const {
+        const uint64_t* m = m_.d_.data();
+        uint64_t t[MAX_LIMBS + 2] = { 0 };
+        for (size_t i = 0; i < k_; ++i) {
+            // t += a * b[i]
+            uint64_t c = 0;
+            for (size_t j = 0; j < k_; ++j) {
+                t[j] = MulAdd(a[j], b[i], t[j], c, c);
+            }
+            uint64_t carry = 0;
+            t[k_] = AddCarry(t[k_], c, carry);
+            t[k_ + 1] = carry;
+
+            // t = (t + u*m) / 2^64
+            uint64_t u = t[0] * n0inv_;
+            MulAdd(u, m[0], t[0], 0, c);
+            for (size_t j = 1; j < k_; ++j) {
+                t[j - 1] = MulAdd(u, m[j], t[j], c, c);
+            }
+            carry = 0;
+            t[k_ - 1] = AddCarry(t[k_], c, carry);
+            t[k_] = t[k_ + 1] + carry;
+        }
+
+        // 最终约减：无分支地在 t 与 t - m 之间选择
+        uint64_t d[MAX_LIMBS];
+        uint64_t borrow = 0;
+        for (size_t j = 0; j < k_; ++j) {
+            d[j] = SubBorrow(t[j], m[j], borrow);
+        }
+        uint64_t mask = 0 - (t[k_] | (borrow ^ 1));
+        for (size_t j = 0; j < k_; ++j) {
+            r[j] = (t[j] & ~mask) | (d[j] & mask);
+        }
+    }
+
+    MontContext::Element MontContext::Mul(const Element& a, const Element& b) const {
+        Element r(k_);
+        Mul(a.data(), b.data(), r.data());
+        return r;
+    }
+
+    MontContext::Element MontContext::ToMont(const BigInt& a) const {
+        BigInt reduced = BigInt::Compare(a, m_) < 0 ? a : BigInt::Mod(a, m_);
+        Element x(k_, 0);
+        std::copy(reduced.d_.begin(), reduced.d_.end(), x.begin());
+        return Mul(x, r2_);
+    }
+
+    BigInt MontContext::FromMont(const Element& a) const {
+        Element one(k_, 0);
+        one[0] = 1;
+        Element r = Mul(a, one);
+        return BigInt::FromLimbs(r.data(), r.size());
+    }
+
+    MontContext::Element MontContext::PowMont(const Element& base, const BigInt& exp) const {
+        constexpr int WINDOW = 5;
+        constexpr size_t TABLE = 1u << WINDOW;
+
+        // table[i] = base^i（蒙哥马利域），连续存放便于整表扫描
+        std::vector<uint64_t> table(TABLE * k_);
+        std::copy(one_.begin(), one_.end(), table.begin());
+        std::copy(base.begin(), base.end(), table.begin() + k_);
+        for (size_t i = 2; i < TABLE; ++i) {
+            Mul(&table[(i - 1) * k_], base.data(), &table[i * k_]);
+        }
+
+        Element acc = one_;
+        Element sel(k_);
+        size_t bits = exp.BitLength();
+        size_t windows = (bits + WINDOW - 1) / WINDOW;
+        for (size_t w = windows; w-- > 0;) {
+            for (int s = 0; s < WINDOW; ++s) {
+                Mul(acc.data(), acc.data(), acc.data());
+            }
+            uint64_t idx = 0;
+            for (int b = WINDOW - 1; b >= 0; --b) {
+                idx = (idx << 1) | (exp.Bit(w * WINDOW + b) ? 1 : 0);
+            }
+            // 扫描整张表取出table[idx]，访存模式与指数无关
+            std::fill(sel.begin(), sel.end(), 0);
+            for (size_t i = 0; i < TABLE; ++i) {
+                uint64_t mask = 0 - static_cast<uint64_t>(i == idx);
+                const uint64_t* row = &table[i * k_];
+                for (size_t j = 0; j < k_; ++j) {
+                    sel[j] |= row[j] & mask;
+                }
+            }
+            Mul(acc.data(), sel.data(), acc.data());
+        }
+        return acc;
+    }
+
+    BigInt MontContext::Pow(const BigInt& base, const BigInt& exp) const {
+        return FromMont(PowMont(ToMont(base), exp));
+    }
+
+} // namespace PSI
@@ -0,0 +1,130 @@
+﻿#ifndef PSI_BIGINT_H
+#define PSI_BIGINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PSI {
+
+    /**
+     * 无符号多精度整数（64位小端limb，无前导零）
+     * 只实现Paillier需要的运算：加减乘、带余除法、移位、随机数与素数生成
+     */
+    class BigInt {
+    public:
+        BigInt() = default;
+        explicit BigInt(uint64_t v);
+
+        /**
+         * @brief 大端字节串 -> 整数
+         */
+        static BigInt FromBytes(const uint8_t* data, size_t len);
+
+        /**
+         * @brief 整数 -> 定长大端字节串（左侧补零）
+         * @return 长度不足以容纳时返回false
+         */
+        bool ToBytes(uint8_t* out, size_t len) const;
+
+        static BigInt FromLimbs(const uint64_t* limbs, size_t count);
+
+        bool IsZero() const { return d_.empty(); }
+        bool IsOdd() const { return !d_.empty() && (d_[0] & 1); }
+        bool Bit(size_t i) const;
+        size_t BitLength() const;
+        size_t LimbCount() const { return d_.size(); }
+        uint64_t Limb(size_t i) const { return i < d_.size() ? d_[i] : 0; }
+        uint64_t Low64() const { return Limb(0); }
+
+        static int Compare(const BigInt& a, const BigInt& b);
+
+        static BigInt Add(const BigInt& a, const BigInt& b);
+        static BigInt Sub(const BigInt& a, const BigInt& b);  // 要求 a >= b
+        static BigInt Mul(const BigInt& a, const BigInt& b);
+        static BigInt MulSmall(const BigInt& a, uint64_t b);
+
+        /**
+         * @brief 带余除法（Knuth算法D）
+         * @param q 商（可为nullptr）
+         * @param r 余数（可为nullptr）
+         */
+        static void DivMod(const BigInt& a, const BigInt& b, BigInt* q, BigInt* r);
+        static BigInt Mod(const BigInt& a, const BigInt& m);
+
+        BigInt ShiftLeft(size_t bits) const;
+        BigInt ShiftRight(size_t bits) const;
+
+        /**
+         * @brief 生成恰好bits位的随机整数（最高位为1）
+         */
+        static BigInt RandomBits(size_t bits);
+
+        /**
+         * @brief 生成[1, n)内的随机整数
+         */
+        static BigInt RandomBelow(const BigInt& n);
+
+        /**
+         * @brief 生成bits位随机素数（最高两位为1，保证两个素数之积恰为2*bits位）
+         */
+        static BigInt RandomPrime(size_t bits);
+
+        /**
+         * @brief Miller-Rabin素性检测
+         * @param rounds 随机底数的轮数
+         */
+        static bool IsProbablePrime(const BigInt& n, int rounds = 24);
+
+    private:
+        void Normalize();
+        std::vector<uint64_t> d_;
+
+        friend class MontContext;
+    };
+
+    /**
+     * 奇模数上的蒙哥马利运算上下文（R = 2^(64k)，k为模数limb数）
+     * 蒙哥马利域元素固定为k个limb
+     */
+    class MontContext {
+    public:
+        static constexpr size_t MAX_LIMBS = 128;  // 支持到8192位模数
+        using Element = std::vector<uint64_t>;
+
+        explicit MontContext(const BigInt& modulus);
+
+        const BigInt& Modulus() const { return m_; }
+        size_t Limbs() const { return k_; }
+
+        Element ToMont(const BigInt& a) const;     // a可以大于模数
+        BigInt FromMont(const Element& a) const;
+        const Element& One() const { return one_; } // R mod m
+
+        /**
+         * @brief 蒙哥马利乘法（CIOS），r = a*b*R^(-1) mod m；r可以与a、b重叠
+         */
+        void Mul(const uint64_t* a, const uint64_t* b, uint64_t* r) const;
+        Element Mul(const Element& a, const Element& b) const;
+
+        /**
+         * @brief 模幂（5位固定窗口，窗口查找扫描整张表），输入输出为普通表示
+         */
+        BigInt Pow(const BigInt& base, const BigInt& exp) const;
+
+        /**
+         * @brief 模幂，输入输出均为蒙哥马利域
+         */
+        Element PowMont(const Element& base, const BigInt& exp) const;
+
+    private:
+        BigInt m_;
+        size_t k_;
+        uint64_t n0inv_;  // -m^(-1) mod 2^64
+        Element r2_;      // R^2 mod m
+        Element one_;     // R mod m
+    };
+
+} // namespace PSI
+
+#endif // PSI_BIGINT_H
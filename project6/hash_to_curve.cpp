@@ -0,0 +1,311 @@
+﻿#include "hash_to_curve.h"
+#include "../libgmsm/gmsm.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+namespace PSI {
+
+    using namespace SM2Curve;
+
+    namespace {
+        // 域分隔标签，避免与其他用途的SM3输出产生关联
+        constexpr char TAI_DST[] = "SDU-PSI-SM2-H2C-TAI-v1";
+        constexpr char SSWU_DST[] = "SDU-PSI-V01-CS01-with-SM2_XMD:SM3_SSWU_RO_";
+
+        // SSWU常量（蒙哥马利域）
+        const U256 SSWU_Z = { { 0xFFFFFFFFFFFFFFF6ULL, 0xFFFFFFF600000009ULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFF5FFFFFFFFULL } };   // Z = -9
+        const U256 SSWU_C1 = { { 0xDAF0BACBB94049C0ULL, 0x25EFBD32F891BD39ULL, 0x1B7DD5C574E1B414ULL, 0xB6AFF5D793604B98ULL } };  // -B/A
+        const U256 SSWU_C2 = { { 0x34C56A16A2CE4115ULL, 0xE7C54DE8E2BADC23ULL, 0xADB8A5F97EC3BEACULL, 0x69A1C5FB2CD1CF82ULL } };  // B/(Z*A)
+        const U256 MONT_R3 = { { 0x0000001200000016ULL, 0x0000000EFFFFFFF8ULL, 0x0000000A0000000CULL, 0x0000001B00000009ULL } };  // R^3 mod p
+
+        constexpr size_t H2F_ELEMENT_BYTES = 48;  // L = ceil((256 + 128) / 8)
+
+        // 常数时间的相等判断，返回全1/全0掩码
+        inline uint64_t EqualMask(const U256& a, const U256& b) {
+            uint64_t d = (a.v[0] ^ b.v[0]) | (a.v[1] ^ b.v[1]) | (a.v[2] ^ b.v[2]) | (a.v[3] ^ b.v[3]);
+            return ((d | (0 - d)) >> 63) - 1;
+        }
+
+        inline U256 Select(const U256& a, const U256& b, uint64_t mask) {
+            U256 r;
+            for (int i = 0; i < 4; ++i) {
+                r.v[i] = (a.v[i] & ~mask) | (b.v[i] & mask);
+            }
+            return r;
+        }
+
+        /**
+         * @brief expand_message_xmd（RFC 9380 5.3.1），H = SM3
+         */
+        void ExpandMessageXmd(const std::string& msg, const char* dst, size_t dstLen, uint8_t* out, size_t outLen) {
+            const size_t b = GMSM_SM3_DIGEST_SIZE;
+            const size_t ell = (outLen + b - 1) / b;
+
+            // msg' = Z_pad || msg || I2OSP(len, 2) || I2OSP(0, 1) || DST'
+            std::vector<uint8_t> buf(GMSM_SM3_BLOCK_SIZE, 0);
+            buf.insert(buf.end(), msg.begin(), msg.end());
+            buf.push_back(static_cast<uint8_t>(outLen >> 8));
+            buf.push_back(static_cast<uint8_t>(outLen));
+            buf.push_back(0);
+            buf.insert(buf.end(), dst, dst + dstLen);
+            buf.push_back(static_cast<uint8_t>(dstLen));
+
+            uint8_t b0[GMSM_SM3_DIGEST_SIZE], bi[GMSM_SM3_DIGEST_SIZE];
+            gmsm_sm3(buf.data(), buf.size(), b0);
+
+            buf.assign(b + 1, 0);
+            buf.insert(buf.end(), dst, dst + dstLen);
+            buf.push_back(static_cast<uint8_t>(dstLen));
+            std::memset(bi, 0, b);
+            for (size_t i = 1; i <= ell; ++i) {
+                // b_i = H(strxor(b_0, b_(i-1)) || I2OSP(i, 1) || DST')
+                for (size_t j = 0; j < b; ++j) {
+                    buf[j] = b0[j] ^ bi[j];
+                }
+                buf[b] = static_cast<uint8_t>(i);
+                gmsm_sm3(buf.data(), buf.size(), bi);
+                size_t n = std::min(b, outLen - (i - 1) * b);
+                std::memcpy(out + (i - 1) * b, bi, n);
+            }
+        }
+
+        /**
+         * @brief 48字节大端整数 mod p，结果在蒙哥马利域
+         */
+        U256 FieldFromWideBytes(const uint8_t in[H2F_ELEMENT_BYTES]) {
+            uint8_t hiBytes[FIELD_BYTES] = { 0 };
+            std::memcpy(hiBytes + 16, in, 16);
+            U256 hi = FromBytes(hiBytes);   // 高128位
+            U256 lo = FromBytes(in + 16);   // 低256位
+            // (hi * 2^256 + lo) * R = FpMul(hi, R^3) + FpMul(lo, R^2)
+            return FpAdd(FpMul(hi, MONT_R3), FpToMont(lo));
+        }
+
+        /**
+         * @brief simplified SWU映射（RFC 9380 6.6.2，straight-line实现）
+         * @param u 域元素（蒙哥马利域）
+         * @return 雅可比坐标点（Z = 1）
+         */
+        JacobianPoint MapToCurveSSWU(const U256& u) {
+            const U256 one = FpToMont(U256{ { 1, 0, 0, 0 } });
+            const U256 zero = { { 0, 0, 0, 0 } };
+
+            U256 tv1 = FpMul(SSWU_Z, FpSqr(u));      // Z * u^2
+            U256 den = FpAdd(FpSqr(tv1), tv1);       // Z^2 * u^4 + Z * u^2
+            U256 denInv = FpInv(den);                // inv0：0的逆为0
+            U256 x1 = FpMul(SSWU_C1, FpAdd(one, denInv));
+            x1 = Select(x1, SSWU_C2, EqualMask(den, zero));
+            U256 gx1 = CurveRhs(x1);
+            U256 x2 = FpMul(tv1, x1);
+            U256 gx2 = CurveRhs(x2);
+
+            // 两个候选都开方，按掩码选择，避免依赖is_square结果的分支
+            U256 y1, y2;
+            FpSqrt(gx1, y1);
+            FpSqrt(gx2, y2);
+            uint64_t gx1Square = EqualMask(FpSqr(y1), gx1);
+
+            JacobianPoint Q;
+            Q.X = Select(x2, x1, gx1Square);
+            U256 y = Select(y2, y1, gx1Square);
+
+            // sgn0(u) != sgn0(y) 时取 -y
+            uint64_t flip = (FpFromMont(u).v[0] ^ FpFromMont(y).v[0]) & 1;
+            Q.Y = Select(y, FpSub(zero, y), 0 - flip);
+            Q.Z = one;
+            return Q;
+        }
+
+        AffinePoint HashToCurveSSWU(const std::string& identifier) {
+            uint8_t uniform[2 * H2F_ELEMENT_BYTES];
+            ExpandMessageXmd(identifier, SSWU_DST, sizeof(SSWU_DST) - 1, uniform, sizeof(uniform));
+            U256 u0 = FieldFromWideBytes(uniform);
+            U256 u1 = FieldFromWideBytes(uniform + H2F_ELEMENT_BYTES);
+            // SM2曲线余因子为1，无需clear_cofactor
+            return ToAffine(PointAdd(MapToCurveSSWU(u0), MapToCurveSSWU(u1)));
+        }
+
+        AffinePoint HashToCurveTAI(const std::string& identifier) {
+            const size_t dstLen = sizeof(TAI_DST) - 1;
+            std::vector<uint8_t> msg(dstLen + 4 + identifier.size());
+            std::memcpy(msg.data(), TAI_DST, dstLen);
+            std::memcpy(msg.data() + dstLen + 4, identifier.data(), identifier.size());
+
+            uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+            for (uint32_t ctr = 0;; ++ctr) {
+                msg[dstLen] = static_cast<uint8_t>(ctr >> 24);
+                msg[dstLen + 1] = static_cast<uint8_t>(ctr >> 16);
+                msg[dstLen + 2] = static_cast<uint8_t>(ctr >> 8);
+                msg[dstLen + 3] = static_cast<uint8_t>(ctr);
+                gmsm_sm3(msg.data(), msg.size(), digest);
+
+                U256 x = FpReduce(FromBytes(digest));
+                U256 y;
+                if (!FpSqrt(CurveRhs(FpToMont(x)), y)) {
+                    continue;  // 约一半的x不在曲线上，继续尝试下一个计数器
+                }
+                y = FpFromMont(y);
+                if ((y.v[0] & 1) != static_cast<uint64_t>(digest[GMSM_SM3_DIGEST_SIZE - 1] & 1)) {
+                    const U256 zero = { { 0, 0, 0, 0 } };
+                    y = FpSub(zero, y);
+                }
+
+                AffinePoint P;
+                P.x = x;
+                P.y = y;
+                P.infinity = false;
+                return P;
+            }
+        }
+
+        // 缓存文件格式
+        constexpr char CACHE_MAGIC[8] = { 'S', 'M', '2', 'H', '2', 'C', 'C', '\0' };
+        constexpr uint32_t CACHE_VERSION = 1;
+        constexpr size_t CACHE_HEADER_SIZE = 32;
+        constexpr size_t CACHE_RECORD_SIZE = 16 + 2 * FIELD_BYTES;
+
+        void PutU32(uint8_t* p, uint32_t v) {
+            for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+
+        uint32_t GetU32(const uint8_t* p) {
+            return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+
+    } // namespace
+
+    AffinePoint HashToCurve(const std::string& identifier, HashToCurveMethod method) {
+        if (method == HashToCurveMethod::TryAndIncrement) {
+            return HashToCurveTAI(identifier);
+        }
+        return HashToCurveSSWU(identifier);
+    }
+
+    size_t HashToCurveCache::KeyHash::operator()(const Key& k) const {
+        uint64_t h;
+        std::memcpy(&h, k.data(), sizeof(h));  // 键本身是SM3输出，直接截取
+        return static_cast<size_t>(h);
+    }
+
+    HashToCurveCache::Key HashToCurveCache::MakeKey(const std::string& identifier) {
+        uint8_t digest[GMSM_SM3_DIGEST_SIZE];
+        gmsm_sm3(identifier.data(), identifier.size(), digest);
+        Key k;
+        std::memcpy(k.data(), digest, k.size());
+        return k;
+    }
+
+    HashToCurveCache::HashToCurveCache(const std::string& path, HashToCurveMethod method)
+        : path_(path), method_(method) {
+        FILE* fp = std::fopen(path_.c_str(), "rb");
+        if (!fp) {
+            return;
+        }
+
+        uint8_t header[CACHE_HEADER_SIZE];
+        if (std::fread(header, 1, CACHE_HEADER_SIZE, fp) == CACHE_HEADER_SIZE &&
+            std::memcmp(header, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+            GetU32(header + 8) == CACHE_VERSION &&
+            GetU32(header + 12) == static_cast<uint32_t>(method_)) {
+            validBytes_ = CACHE_HEADER_SIZE;
+
+            // 逐条读入；末尾不完整的记录（写入中途崩溃）被忽略，下次Flush时截断
+            std::vector<uint8_t> chunk(CACHE_RECORD_SIZE * 4096);
+            size_t got;
+            size_t carry = 0;
+            while ((got = std::fread(chunk.data() + carry, 1, chunk.size() - carry, fp)) > 0) {
+                size_t total = carry + got;
+                size_t records = total / CACHE_RECORD_SIZE;
+                for (size_t i = 0; i < records; ++i) {
+                    const uint8_t* rec = chunk.data() + i * CACHE_RECORD_SIZE;
+                    Key k;
+                    std::memcpy(k.data(), rec, k.size());
+                    AffinePoint P;
+                    P.x = FromBytes(rec + 16);
+                    P.y = FromBytes(rec + 16 + FIELD_BYTES);
+                    P.infinity = false;
+                    // 缓存文件可能损坏或被篡改：坐标越界或不在曲线上的点若进入ScalarMul，
+                    // 会与私钥相乘（无效曲线攻击），丢弃这样的记录，查不到时由调用方重新计算
+                    if (!IsOnCurve(P)) {
+                        ++rejected_;
+                        continue;
+                    }
+                    points_[k] = P;
+                }
+                validBytes_ += records * CACHE_RECORD_SIZE;
+                carry = total - records * CACHE_RECORD_SIZE;
+                std::memmove(chunk.data(), chunk.data() + records * CACHE_RECORD_SIZE, carry);
+            }
+        }
+        std::fclose(fp);
+    }
+
+    HashToCurveCache::~HashToCurveCache() {
+        Flush();
+    }
+
+    bool HashToCurveCache::Lookup(const std::string& identifier, AffinePoint& P) const {
+        auto it = points_.find(MakeKey(identifier));
+        if (it == points_.end()) {
+            return false;
+        }
+        P = it->second;
+        return true;
+    }
+
+    void HashToCurveCache::Insert(const std::string& identifier, const AffinePoint& P) {
+        Key k = MakeKey(identifier);
+        if (points_.emplace(k, P).second) {
+            pending_.push_back(k);
+        }
+    }
+
+    bool HashToCurveCache::Flush() {
+        if (pending_.empty()) {
+            return true;
+        }
+
+        std::error_code ec;
+        FILE* fp = nullptr;
+        if (validBytes_ == 0) {
+            // 新文件（或文件头不匹配）：重写文件头
+            fp = std::fopen(path_.c_str(), "wb");
+            if (!fp) return false;
+            uint8_t header[CACHE_HEADER_SIZE] = { 0 };
+            std::memcpy(header, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+            PutU32(header + 8, CACHE_VERSION);
+            PutU32(header + 12, static_cast<uint32_t>(method_));
+            if (std::fwrite(header, 1, CACHE_HEADER_SIZE, fp) != CACHE_HEADER_SIZE) {
+                std::fclose(fp);
+                return false;
+            }
+            validBytes_ = CACHE_HEADER_SIZE;
+        }
+        else {
+            if (std::filesystem::file_size(path_, ec) != validBytes_ && !ec) {
+                std::filesystem::resize_file(path_, validBytes_, ec);  // 去掉不完整的尾部记录
+            }
+            fp = std::fopen(path_.c_str(), "ab");
+            if (!fp) return false;
+        }
+
+        std::vector<uint8_t> buf(pending_.size() * CACHE_RECORD_SIZE);
+        for (size_t i = 0; i < pending_.size(); ++i) {
+            uint8_t* rec = buf.data() + i * CACHE_RECORD_SIZE;
+            const AffinePoint& P = points_[pending_[i]];
+            std::memcpy(rec, pending_[i].data(), 16);
+            ToBytes(P.x, rec + 16);
+            ToBytes(P.y, rec + 16 + FIELD_BYTES);
+        }
+        bool ok = std::fwrite(buf.data(), 1, buf.size(), fp) == buf.size();
+        ok = (std::fclose(fp) == 0) && ok;
+        if (ok) {
+            validBytes_ += buf.size();
+            pending_.clear();
+        }
+        return ok;
+    }
+
+} // namespace PSI
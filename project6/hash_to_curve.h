@@ -0,0 +1,78 @@
+﻿#ifndef HASH_TO_CURVE_H
+#define HASH_TO_CURVE_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../project5/sm2_curve.h"
+
+namespace PSI {
+
+    // 哈希到曲线的方法（参与双方必须一致）
+    enum class HashToCurveMethod : uint32_t {
+        TryAndIncrement = 1,  // 可变时间，平均约2次开方，速度最快
+        SSWU = 2              // RFC 9380 simplified SWU（SM3 expand_message_xmd，随机预言机版本），常数时间
+    };
+
+    /**
+     * @brief 哈希函数 H: U -> G，将标识符映射到SM2曲线点
+     * @param identifier 标识符
+     * @param method 映射方法
+     * @return 曲线上的点（SM2曲线余因子为1，任意点都在素数阶群中）
+     * @note TryAndIncrement：x = SM3(DST || ctr || id) mod p，取第一个使 x^3 + ax + b 为二次剩余的ctr；
+     *       SSWU：u0, u1 = hash_to_field(id)，H(id) = map(u0) + map(u1)，Z = -9，全程无数据相关分支
+     */
+    SM2Curve::AffinePoint HashToCurve(const std::string& identifier,
+        HashToCurveMethod method = HashToCurveMethod::SSWU);
+
+    /**
+     * H(identifier)的持久化磁盘缓存
+     * 文件为追加式记录：32字节文件头（魔数、版本、方法）+ 若干80字节记录（SM3(id)前16字节 || x || y）。
+     * 重复执行协议且用户集合变化不大时，命中的标识符可跳过哈希到曲线的计算。
+     * 加载时逐条检查点在曲线上（坐标小于p且满足曲线方程），不合格的记录被丢弃，对应标识符重新计算。
+     * Lookup可多线程并发调用；Insert/Flush需由调用方串行化。
+     */
+    class HashToCurveCache {
+    public:
+        /**
+         * @brief 打开（或新建）缓存文件
+         * @param path 缓存文件路径
+         * @param method 缓存的映射方法；文件头方法不一致时丢弃旧内容
+         */
+        HashToCurveCache(const std::string& path, HashToCurveMethod method);
+        ~HashToCurveCache();
+
+        HashToCurveMethod Method() const { return method_; }
+        size_t Size() const { return points_.size(); }
+        size_t Rejected() const { return rejected_; }  // 加载时因不在曲线上而丢弃的记录数
+
+        bool Lookup(const std::string& identifier, SM2Curve::AffinePoint& P) const;
+        void Insert(const std::string& identifier, const SM2Curve::AffinePoint& P);
+
+        /**
+         * @brief 把新插入的记录追加写入文件
+         * @return 成功返回true，失败返回false
+         */
+        bool Flush();
+
+    private:
+        using Key = std::array<uint8_t, 16>;
+        struct KeyHash {
+            size_t operator()(const Key& k) const;
+        };
+
+        static Key MakeKey(const std::string& identifier);
+
+        std::string path_;
+        HashToCurveMethod method_;
+        std::unordered_map<Key, SM2Curve::AffinePoint, KeyHash> points_;
+        std::vector<Key> pending_;   // 尚未写盘的键
+        uint64_t validBytes_ = 0;    // 文件中有效内容的长度
+        size_t rejected_ = 0;
+    };
+
+} // namespace PSI
+
+#endif // HASH_TO_CURVE_H
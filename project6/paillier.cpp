@@ -0,0 +1,237 @@
+﻿#include "paillier.h"
+#include <iostream>
+#include <random>
+#include "parallel.h"
+
+namespace PSI {
+
+    namespace {
+
+        // 定长大端密文 -> k个小端limb
+        void ParseLimbs(const Ciphertext& c, uint64_t* out, size_t k) {
+            std::fill(out, out + k, 0);
+            const size_t len = c.size();
+            for (size_t i = 0; i < len && i < k * 8; ++i) {
+                out[i / 8] |= static_cast<uint64_t>(c[len - 1 - i]) << (8 * (i % 8));
+            }
+        }
+
+        Ciphertext EncodeLimbs(const uint64_t* limbs, size_t k, size_t bytes) {
+            Ciphertext c(bytes);
+            for (size_t i = 0; i < bytes; ++i) {
+                size_t limb = i / 8;
+                c[bytes - 1 - i] = limb < k ? static_cast<uint8_t>(limbs[limb] >> (8 * (i % 8))) : 0;
+            }
+            return c;
+        }
+
+        std::vector<uint64_t> ToLimbs(const BigInt& a, size_t k) {
+            std::vector<uint64_t> out(k, 0);
+            for (size_t i = 0; i < k; ++i) out[i] = a.Limb(i);
+            return out;
+        }
+
+        // 素数模下的逆元（费马小定理）
+        BigInt InversePrime(const BigInt& a, const BigInt& p) {
+            MontContext ctx(p);
+            return ctx.Pow(a, BigInt::Sub(p, BigInt(2)));
+        }
+
+        // (b - a) mod m，要求 a, b < m
+        BigInt SubMod(const BigInt& b, const BigInt& a, const BigInt& m) {
+            return BigInt::Compare(b, a) >= 0 ? BigInt::Sub(b, a) : BigInt::Sub(BigInt::Add(b, m), a);
+        }
+
+        /**
+         * @brief 连乘[begin, end)的密文，结果为普通域 mod n^2
+         * 连续做t次蒙哥马利乘得到 prod * R^(-t)，最后乘一次 R^t 修正，每个密文只需一次模乘
+         */
+        std::vector<uint64_t> ProductRange(const MontContext& ctx, const std::vector<const Ciphertext*>& items,
+            size_t begin, size_t end) {
+            const size_t k = ctx.Limbs();
+            std::vector<uint64_t> acc(k), cur(k);
+            ParseLimbs(*items[begin], acc.data(), k);
+            for (size_t i = begin + 1; i < end; ++i) {
+                ParseLimbs(*items[i], cur.data(), k);
+                ctx.Mul(acc.data(), cur.data(), acc.data());
+            }
+            size_t t = end - begin - 1;
+            if (t > 0) {
+                MontContext::Element rMont = ctx.ToMont(BigInt::FromLimbs(ctx.One().data(), k));
+                MontContext::Element corr = ctx.PowMont(rMont, BigInt(t));
+                ctx.Mul(acc.data(), corr.data(), acc.data());
+            }
+            return acc;
+        }
+
+    } // namespace
+
+    PaillierPrivateKey PaillierKeyGen(size_t modulusBits) {
+        PaillierPrivateKey key;
+        const size_t half = modulusBits / 2;
+        do {
+            key.p = BigInt::RandomPrime(half);
+            key.q = BigInt::RandomPrime(modulusBits - half);
+        } while (BigInt::Compare(key.p, key.q) == 0);
+
+        key.pub.n = BigInt::Mul(key.p, key.q);
+        key.pub.n2 = BigInt::Mul(key.pub.n, key.pub.n);
+        key.pub.ciphertextBytes = (key.pub.n2.BitLength() + 7) / 8;
+
+        key.p2 = BigInt::Mul(key.p, key.p);
+        key.q2 = BigInt::Mul(key.q, key.q);
+        key.hp = InversePrime(BigInt::Sub(key.p, BigInt::Mod(key.q, key.p)), key.p);
+        key.hq = InversePrime(BigInt::Sub(key.q, BigInt::Mod(key.p, key.q)), key.q);
+        key.pInvQ = InversePrime(BigInt::Mod(key.p, key.q), key.q);
+
+        // (p^2)^(-1) mod q^2 = (p^2)^(phi(q^2) - 1)，phi(q^2) = q(q-1)
+        BigInt phiQ2 = BigInt::Mul(key.q, BigInt::Sub(key.q, BigInt(1)));
+        MontContext q2Ctx(key.q2);
+        key.p2InvQ2 = q2Ctx.Pow(key.p2, BigInt::Sub(phiQ2, BigInt(1)));
+        return key;
+    }
+
+    PaillierHE::PaillierHE(const PaillierPublicKey& pub, size_t poolSize, unsigned threads)
+        : pub_(pub), n2Ctx_(pub.n2), threads_(threads) {
+        BuildPool(poolSize);
+    }
+
+    PaillierHE::PaillierHE(const PaillierPrivateKey& priv, size_t poolSize, unsigned threads)
+        : pub_(priv.pub), priv_(new PaillierPrivateKey(priv)), n2Ctx_(priv.pub.n2),
+        p2Ctx_(new MontContext(priv.p2)), q2Ctx_(new MontContext(priv.q2)), threads_(threads) {
+        BuildPool(poolSize);
+    }
+
+    BigInt PaillierHE::RandomPowN() const {
+        BigInt r = BigInt::RandomBelow(pub_.n);
+        if (!priv_) {
+            return n2Ctx_.Pow(r, pub_.n);
+        }
+
+        // CRT：分别在 p^2、q^2 下计算，指数先约减到 phi(p^2) = p(p-1)
+        const PaillierPrivateKey& k = *priv_;
+        BigInt ep = BigInt::Mod(pub_.n, BigInt::Mul(k.p, BigInt::Sub(k.p, BigInt(1))));
+        BigInt eq = BigInt::Mod(pub_.n, BigInt::Mul(k.q, BigInt::Sub(k.q, BigInt(1))));
+        BigInt xp = p2Ctx_->Pow(r, ep);
+        BigInt xq = q2Ctx_->Pow(r, eq);
+        BigInt t = BigInt::Mod(BigInt::Mul(SubMod(xq, BigInt::Mod(xp, k.q2), k.q2), k.p2InvQ2), k.q2);
+        return BigInt::Add(xp, BigInt::Mul(k.p2, t));
+    }
+
+    void PaillierHE::BuildPool(size_t poolSize) {
+        poolSize = std::max<size_t>(poolSize, 2);
+        pool_.resize(poolSize);
+        ParallelFor(poolSize, threads_, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                pool_[i] = n2Ctx_.ToMont(RandomPowN());
+            }
+        });
+    }
+
+    std::vector<Ciphertext> PaillierHE::EncryptBatch(const std::vector<uint64_t>& values) const {
+        std::vector<Ciphertext> out(values.size());
+        const size_t k = n2Ctx_.Limbs();
+
+        ParallelFor(values.size(), threads_, [&](size_t begin, size_t end) {
+            // 每个线程持有池的私有副本，并整体乘上一个新鲜的 r^n，
+            // 避免不同线程/不同批次从同一初始池走出相同的随机化因子
+            std::random_device rd;
+            std::mt19937_64 rng((static_cast<uint64_t>(rd()) << 32) | rd());
+            std::vector<MontContext::Element> pool = pool_;
+            MontContext::Element fresh = n2Ctx_.ToMont(RandomPowN());
+            for (auto& e : pool) {
+                n2Ctx_.Mul(e.data(), fresh.data(), e.data());
+            }
+            std::uniform_int_distribution<size_t> pick(0, pool.size() - 1);
+
+            std::vector<uint64_t> rn(k), c(k);
+            for (size_t idx = begin; idx < end; ++idx) {
+                size_t i = pick(rng), j = pick(rng);
+                while (j == i) j = pick(rng);
+                n2Ctx_.Mul(pool[i].data(), pool[j].data(), rn.data());
+                pool[i] = rn;
+
+                // g^m = 1 + m*n（m < 2^64 <= n，无需取模）
+                std::vector<uint64_t> gm = ToLimbs(BigInt::Add(BigInt::MulSmall(pub_.n, values[idx]), BigInt(1)), k);
+
+                // 蒙哥马利乘：(r^n * R) * g^m * R^(-1) = g^m * r^n（普通域）
+                n2Ctx_.Mul(rn.data(), gm.data(), c.data());
+                out[idx] = EncodeLimbs(c.data(), k, pub_.ciphertextBytes);
+            }
+        });
+        return out;
+    }
+
+    Ciphertext PaillierHE::Sum(const std::vector<const Ciphertext*>& items) const {
+        const size_t k = n2Ctx_.Limbs();
+        if (items.empty()) {
+            return EncryptBatch({ 0 })[0];
+        }
+
+        unsigned threads = threads_ ? threads_ : std::max(1u, std::thread::hardware_concurrency());
+        size_t chunks = std::min<size_t>(threads, items.size());
+        std::vector<std::vector<uint64_t>> partial(chunks);
+        ParallelFor(chunks, threads, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                size_t lo = items.size() * c / chunks, hi = items.size() * (c + 1) / chunks;
+                partial[c] = ProductRange(n2Ctx_, items, lo, hi);
+            }
+        });
+
+        std::vector<Ciphertext> encoded(chunks);
+        std::vector<const Ciphertext*> ptrs(chunks);
+        for (size_t c = 0; c < chunks; ++c) {
+            encoded[c] = EncodeLimbs(partial[c].data(), k, pub_.ciphertextBytes);
+            ptrs[c] = &encoded[c];
+        }
+        std::vector<uint64_t> total = ProductRange(n2Ctx_, ptrs, 0, chunks);
+        return EncodeLimbs(total.data(), k, pub_.ciphertextBytes);
+    }
+
+    Ciphertext PaillierHE::Rerandomize(const Ciphertext& c) const {
+        return RerandomizeBatch({ c })[0];
+    }
+
+    std::vector<Ciphertext> PaillierHE::RerandomizeBatch(const std::vector<Ciphertext>& items) const {
+        std::vector<uint64_t> zeros(items.size(), 0);
+        std::vector<Ciphertext> masks = EncryptBatch(zeros);
+        std::vector<Ciphertext> out(items.size());
+        const size_t k = n2Ctx_.Limbs();
+        ParallelFor(items.size(), threads_, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                std::vector<const Ciphertext*> pair = { &items[i], &masks[i] };
+                out[i] = EncodeLimbs(ProductRange(n2Ctx_, pair, 0, 2).data(), k, pub_.ciphertextBytes);
+            }
+        });
+        return out;
+    }
+
+    BigInt PaillierHE::DecryptHalf(const BigInt& c, const BigInt& prime, const BigInt& prime2,
+        const MontContext& ctx, const BigInt& h) const {
+        // m_p = L_p(c^(p-1) mod p^2) * hp mod p，L_p(u) = (u - 1) / p 为整除
+        BigInt u = ctx.Pow(c, BigInt::Sub(prime, BigInt(1)));
+        BigInt l;
+        BigInt::DivMod(SubMod(u, BigInt(1), prime2), prime, &l, nullptr);
+        return BigInt::Mod(BigInt::Mul(l, h), prime);
+    }
+
+    BigInt PaillierHE::DecryptBig(const Ciphertext& c) const {
+        if (!priv_) {
+            std::cerr << "Paillier: 没有私钥，无法解密\n";
+            return BigInt();
+        }
+        const PaillierPrivateKey& k = *priv_;
+        BigInt cv = BigInt::FromBytes(c.data(), c.size());
+        BigInt mp = DecryptHalf(cv, k.p, k.p2, *p2Ctx_, k.hp);
+        BigInt mq = DecryptHalf(cv, k.q, k.q2, *q2Ctx_, k.hq);
+
+        // m = mp + p * ((mq - mp) * p^(-1) mod q)
+        BigInt t = BigInt::Mod(BigInt::Mul(SubMod(mq, BigInt::Mod(mp, k.q), k.q), k.pInvQ), k.q);
+        return BigInt::Add(mp, BigInt::Mul(k.p, t));
+    }
+
+    uint64_t PaillierHE::Decrypt(const Ciphertext& c) const {
+        return DecryptBig(c).Low64();
+    }
+
+} // namespace PSI
@@ -0,0 +1,90 @@
+﻿#ifndef PSI_PAILLIER_H
+#define PSI_PAILLIER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "bigint.h"
+#include "psi_ddh.h"
+
+namespace PSI {
+
+    struct PaillierPublicKey {
+        BigInt n;
+        BigInt n2;                  // n^2
+        size_t ciphertextBytes = 0; // 密文定长大端编码的字节数
+    };
+
+    struct PaillierPrivateKey {
+        PaillierPublicKey pub;
+        BigInt p, q;
+        BigInt p2, q2;   // p^2, q^2
+        BigInt hp, hq;   // hp = (-q)^(-1) mod p, hq = (-p)^(-1) mod q
+        BigInt pInvQ;    // p^(-1) mod q
+        BigInt p2InvQ2;  // (p^2)^(-1) mod q^2，用于在CRT下生成 r^n mod n^2
+    };
+
+    /**
+     * @brief 生成Paillier密钥（g = n + 1）
+     * @param modulusBits n的位数
+     */
+    PaillierPrivateKey PaillierKeyGen(size_t modulusBits = 2048);
+
+    /**
+     * Paillier加法同态加密
+     * 加密时 g^m = 1 + m*n，随机化因子 r^n 取自预计算池：每次取两个池元素相乘，
+     * 并用乘积替换其中一个，从而单次加密只需两次模乘而不是一次完整模幂
+     */
+    class PaillierHE : public AdditiveHE {
+    public:
+        /**
+         * @param pub 公钥（只能加密与求和）
+         * @param poolSize 预计算的 r^n 个数
+         * @param threads 线程数（0表示硬件并发数）
+         */
+        explicit PaillierHE(const PaillierPublicKey& pub, size_t poolSize = 64, unsigned threads = 0);
+
+        /**
+         * @param priv 私钥（可解密，且池的预计算走CRT）
+         */
+        explicit PaillierHE(const PaillierPrivateKey& priv, size_t poolSize = 64, unsigned threads = 0);
+
+        std::vector<Ciphertext> EncryptBatch(const std::vector<uint64_t>& values) const override;
+        Ciphertext Sum(const std::vector<const Ciphertext*>& items) const override;
+        Ciphertext Rerandomize(const Ciphertext& c) const override;
+
+        /**
+         * @brief CRT解密，返回明文的低64位；没有私钥时返回0
+         */
+        uint64_t Decrypt(const Ciphertext& c) const override;
+
+        /**
+         * @brief CRT解密，返回完整明文
+         */
+        BigInt DecryptBig(const Ciphertext& c) const;
+
+        /**
+         * @brief 批量重随机化：c' = c * r^n mod n^2
+         */
+        std::vector<Ciphertext> RerandomizeBatch(const std::vector<Ciphertext>& items) const;
+
+        const PaillierPublicKey& PublicKey() const { return pub_; }
+        bool HasPrivateKey() const { return priv_ != nullptr; }
+
+    private:
+        void BuildPool(size_t poolSize);
+        BigInt RandomPowN() const;
+        BigInt DecryptHalf(const BigInt& c, const BigInt& prime, const BigInt& prime2,
+            const MontContext& ctx, const BigInt& h) const;
+
+        PaillierPublicKey pub_;
+        std::unique_ptr<PaillierPrivateKey> priv_;
+        MontContext n2Ctx_;
+        std::unique_ptr<MontContext> p2Ctx_, q2Ctx_;
+        std::vector<MontContext::Element> pool_;  // r_i^n mod n^2（蒙哥马利域）
+        unsigned threads_;
+    };
+
+} // namespace PSI
+
+#endif // PSI_PAILLIER_H
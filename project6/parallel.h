@@ -0,0 +1,41 @@
+﻿#ifndef PSI_PARALLEL_H
+#define PSI_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace PSI {
+
+    /**
+     * @brief 把[0, count)均分给多个线程执行
+     * @param count 元素总数
+     * @param threads 线程数，0表示使用硬件并发数
+     * @param func 任务函数 func(begin, end)
+     */
+    template<typename Func>
+    void ParallelFor(size_t count, unsigned threads, Func func) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_t threadCount = std::min<size_t>(threads, std::max<size_t>(1, count));
+        size_t perThread = count / threadCount;
+        size_t remaining = count % threadCount;
+
+        std::vector<std::thread> workers;
+        size_t offset = 0;
+        for (size_t i = 0; i < threadCount; ++i) {
+            size_t n = perThread + (i < remaining ? 1 : 0);
+            if (n == 0) continue;
+            workers.emplace_back(func, offset, offset + n);
+            offset += n;
+        }
+        for (auto& t : workers) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+} // namespace PSI
+
+#endif // PSI_PARALLEL_H
@@ -3,6 +3,11 @@ import hashlib
 from typing import List, Tuple, Set, Dict
 from collections import defaultdict
 
+try:
+    import gmsm_native  # ../libgmsm 的原生 SM3/SM4 扩展
+except ImportError:
+    gmsm_native = None
+
 
 class DDHPrivateIntersectionSum:
     def __init__(self, p: int = None, g: int = None):
@@ -28,9 +33,13 @@ class DDHPrivateIntersectionSum:
     def hash_function(self, identifier: str) -> int:
         """
         哈希函数 H: U -> G，将标识符映射到群元素
+        （原生扩展可用时用SM3，与C++版PSI一致，否则用SHA256）
         """
-        hash_obj = hashlib.sha256(identifier.encode())
-        hash_int = int(hash_obj.hexdigest(), 16)
+        if gmsm_native is not None:
+            digest = gmsm_native.sm3(identifier.encode())
+        else:
+            digest = hashlib.sha256(identifier.encode()).digest()
+        hash_int = int.from_bytes(digest, 'big')
         return hash_int % self.p
 
     def mod_exp(self, base: int, exp: int, mod: int) -> int:
@@ -0,0 +1,180 @@
+﻿#include "psi_ddh.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+
+namespace PSI {
+
+    using namespace SM2Curve;
+
+    namespace {
+
+        // 每次批量仿射化的点数，控制批量求逆的内存占用
+        constexpr size_t AFFINE_BATCH = 256;
+
+        /**
+         * @brief 对一段点做标量乘并编码输出
+         */
+        template<typename PointAt>
+        void ExponentiateRange(size_t begin, size_t end, const U256& k, PointAt pointAt, Element* out) {
+            std::vector<JacobianPoint> jac(AFFINE_BATCH);
+            std::vector<AffinePoint> aff(AFFINE_BATCH);
+            for (size_t base = begin; base < end; base += AFFINE_BATCH) {
+                size_t n = std::min(AFFINE_BATCH, end - base);
+                for (size_t i = 0; i < n; ++i) {
+                    AffinePoint P;
+                    if (pointAt(base + i, P)) {
+                        jac[i] = ScalarMul(k, P);
+                    }
+                    else {
+                        std::memset(&jac[i], 0, sizeof(JacobianPoint));  // 无效输入映射为无穷远点
+                    }
+                }
+                BatchToAffine(jac.data(), aff.data(), n);
+                for (size_t i = 0; i < n; ++i) {
+                    out[base + i] = EncodePoint(aff[i]);
+                }
+            }
+        }
+
+        struct ElementHash {
+            size_t operator()(const Element& e) const {
+                uint64_t h;
+                std::memcpy(&h, e.data() + 1, sizeof(h));  // x坐标已是均匀分布，直接取前8字节
+                return static_cast<size_t>(h ^ e[0]);
+            }
+        };
+
+        template<typename T>
+        void Shuffle(std::vector<T>& v) {
+            std::random_device rd;
+            std::mt19937_64 rng((static_cast<uint64_t>(rd()) << 32) | rd());
+            std::shuffle(v.begin(), v.end(), rng);
+        }
+
+    } // namespace
+
+    std::vector<Element> HashAndExponentiate(const std::vector<std::string>& ids, const U256& k,
+        unsigned threads, const HashOptions& hash) {
+        HashToCurveCache* cache = (hash.cache && hash.cache->Method() == hash.method) ? hash.cache : nullptr;
+        std::vector<Element> out(ids.size());
+        std::vector<std::pair<size_t, AffinePoint>> misses;  // 未命中缓存的(下标, H(id))
+        std::mutex missesLock;
+
+        ParallelFor(ids.size(), threads, [&](size_t begin, size_t end) {
+            std::vector<std::pair<size_t, AffinePoint>> localMisses;
+            ExponentiateRange(begin, end, k, [&](size_t i, AffinePoint& P) {
+                if (cache && cache->Lookup(ids[i], P)) {
+                    return true;
+                }
+                P = HashToCurve(ids[i], hash.method);
+                if (cache) {
+                    localMisses.emplace_back(i, P);
+                }
+                return true;
+            }, out.data());
+
+            std::lock_guard<std::mutex> guard(missesLock);
+            misses.insert(misses.end(), localMisses.begin(), localMisses.end());
+        });
+
+        if (cache && !misses.empty()) {
+            for (const auto& m : misses) {
+                cache->Insert(ids[m.first], m.second);
+            }
+            cache->Flush();
+        }
+        return out;
+    }
+
+    std::vector<Element> Exponentiate(const std::vector<Element>& in, const U256& k, unsigned threads) {
+        std::vector<Element> out(in.size());
+        ParallelFor(in.size(), threads, [&](size_t begin, size_t end) {
+            ExponentiateRange(begin, end, k, [&](size_t i, AffinePoint& P) {
+                return DecodePoint(in[i], P) && !P.infinity;
+            }, out.data());
+        });
+        return out;
+    }
+
+    Party1::Party1(std::vector<std::string> identifiers, unsigned threads, const HashOptions& hash)
+        : identifiers_(std::move(identifiers)), k1_(RandomScalar()), threads_(threads), hash_(hash) {
+    }
+
+    std::vector<Element> Party1::round1() {
+        std::vector<Element> result = HashAndExponentiate(identifiers_, k1_, threads_, hash_);
+        // 打乱顺序以保护隐私
+        Shuffle(result);
+        return result;
+    }
+
+    Ciphertext Party1::round3(const Round2Message& msg, const AdditiveHE& he, size_t* intersectionSize) const {
+        // 集合Z = {H(v_i)^(k1*k2)}
+        std::unordered_set<Element, ElementHash> z(msg.z.begin(), msg.z.end());
+
+        // (H(w_j)^k2)^k1 = H(w_j)^(k1*k2)
+        std::vector<Element> pairsK1K2 = Exponentiate(msg.pairElements, k1_, threads_);
+
+        std::vector<const Ciphertext*> matched;
+        const Element infinity{};
+        for (size_t j = 0; j < pairsK1K2.size(); ++j) {
+            if (pairsK1K2[j] != infinity && z.count(pairsK1K2[j])) {
+                matched.push_back(&msg.pairCiphertexts[j]);
+            }
+        }
+
+        if (intersectionSize) {
+            *intersectionSize = matched.size();
+        }
+        if (matched.empty()) {
+            return he.EncryptBatch({ 0 })[0];
+        }
+        // 不重随机化时P2可以把自己发出的密文按子集相乘与结果比对，从而得知哪些项在交集中
+        return he.Rerandomize(he.Sum(matched));
+    }
+
+    Party2::Party2(std::vector<std::pair<std::string, uint64_t>> pairs, const AdditiveHE& he, unsigned threads,
+        const HashOptions& hash)
+        : pairs_(std::move(pairs)), he_(he), k2_(RandomScalar()), threads_(threads), hash_(hash) {
+    }
+
+    Round2Message Party2::round2(const std::vector<Element>& round1Data) const {
+        Round2Message msg;
+
+        // 步骤1: 用k2对收到的数据进行指数运算并打乱
+        msg.z = Exponentiate(round1Data, k2_, threads_);
+        Shuffle(msg.z);
+
+        // 步骤2: 处理自己的对（哈希+指数运算，加密值）
+        std::vector<std::string> ids(pairs_.size());
+        std::vector<uint64_t> values(pairs_.size());
+        for (size_t j = 0; j < pairs_.size(); ++j) {
+            ids[j] = pairs_[j].first;
+            values[j] = pairs_[j].second;
+        }
+        std::vector<Element> elements = HashAndExponentiate(ids, k2_, threads_, hash_);
+        std::vector<Ciphertext> ciphertexts = he_.EncryptBatch(values);
+
+        // 两个数组按同一排列打乱
+        std::vector<size_t> order(pairs_.size());
+        for (size_t j = 0; j < order.size(); ++j) {
+            order[j] = j;
+        }
+        Shuffle(order);
+        msg.pairElements.resize(order.size());
+        msg.pairCiphertexts.resize(order.size());
+        for (size_t j = 0; j < order.size(); ++j) {
+            msg.pairElements[j] = elements[order[j]];
+            msg.pairCiphertexts[j] = std::move(ciphertexts[order[j]]);
+        }
+        return msg;
+    }
+
+    uint64_t Party2::decryptFinalResult(const Ciphertext& encryptedSum) const {
+        return he_.Decrypt(encryptedSum);
+    }
+
+} // namespace PSI
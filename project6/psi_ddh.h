@@ -0,0 +1,143 @@
+﻿#ifndef PSI_DDH_H
+#define PSI_DDH_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../project5/sm2_curve.h"
+#include "hash_to_curve.h"
+
+// 基于DDH的私有交集求和协议（Google Password Checkup）原生实现
+// 群取SM2曲线的素数阶点群，群元素以33字节压缩点编码在参与方之间传递
+namespace PSI {
+
+    using Element = SM2Curve::EncodedPoint;
+    using Ciphertext = std::vector<uint8_t>;
+
+    /**
+     * 加法同态加密接口
+     * Party1只使用加密/求和（公钥部分），Party2额外使用解密
+     */
+    class AdditiveHE {
+    public:
+        virtual ~AdditiveHE() = default;
+
+        /**
+         * @brief 批量加密
+         * @param values 明文值
+         * @return 与values一一对应的密文
+         */
+        virtual std::vector<Ciphertext> EncryptBatch(const std::vector<uint64_t>& values) const = 0;
+
+        /**
+         * @brief 同态求和
+         * @param items 参与求和的密文（非空）
+         * @return 和的密文
+         */
+        virtual Ciphertext Sum(const std::vector<const Ciphertext*>& items) const = 0;
+
+        /**
+         * @brief 重随机化：乘上一个新的AEnc(0)，明文不变
+         * 同态求和的结果是输入密文的乘积，持有输入的一方可以据此判断参与求和的是哪些密文，
+         * 发出之前必须重随机化
+         */
+        virtual Ciphertext Rerandomize(const Ciphertext& c) const = 0;
+
+        /**
+         * @brief 解密
+         */
+        virtual uint64_t Decrypt(const Ciphertext& c) const = 0;
+    };
+
+    // 哈希到曲线的配置（参与双方的method必须一致）
+    struct HashOptions {
+        HashToCurveMethod method = HashToCurveMethod::SSWU;
+        HashToCurveCache* cache = nullptr;  // 可选；仅当cache->Method() == method时使用
+    };
+
+    /**
+     * @brief 批量并行计算 H(id)^k（哈希到曲线 + 标量乘 + 批量仿射化 + 编码）
+     * @param ids 标识符
+     * @param k 私有指数
+     * @param threads 线程数，0表示使用硬件并发数
+     * @param hash 哈希到曲线配置；提供缓存时未命中的H(id)会写回缓存
+     */
+    std::vector<Element> HashAndExponentiate(const std::vector<std::string>& ids,
+        const SM2Curve::U256& k, unsigned threads = 0, const HashOptions& hash = HashOptions());
+
+    /**
+     * @brief 批量并行计算 X^k
+     * @param in 已编码的群元素
+     * @param k 私有指数
+     * @param threads 线程数，0表示使用硬件并发数
+     * @return 结果；无法解码的输入对应位置为全0（无穷远点编码）
+     */
+    std::vector<Element> Exponentiate(const std::vector<Element>& in,
+        const SM2Curve::U256& k, unsigned threads = 0);
+
+    // 第二轮消息：P2 -> P1
+    struct Round2Message {
+        std::vector<Element> z;               // {H(v_i)^(k1*k2)}，已打乱
+        std::vector<Element> pairElements;    // {H(w_j)^k2}，与pairCiphertexts同序打乱
+        std::vector<Ciphertext> pairCiphertexts;  // {AEnc(t_j)}
+    };
+
+    /**
+     * 参与方1（持有标识符集合V）
+     */
+    class Party1 {
+    public:
+        explicit Party1(std::vector<std::string> identifiers, unsigned threads = 0,
+            const HashOptions& hash = HashOptions());
+
+        /**
+         * @brief 第一轮：计算并打乱 {H(v_i)^k1}
+         */
+        std::vector<Element> round1();
+
+        /**
+         * @brief 第三轮：求交集并同态求和
+         * @param msg 第二轮消息
+         * @param he 同态加密公钥
+         * @param intersectionSize 输出交集大小（可为nullptr）
+         * @return 交集和的密文（已重随机化，与任何输入子集的乘积都不同）；交集为空时返回新的AEnc(0)
+         */
+        Ciphertext round3(const Round2Message& msg, const AdditiveHE& he, size_t* intersectionSize = nullptr) const;
+
+    private:
+        std::vector<std::string> identifiers_;
+        SM2Curve::U256 k1_;
+        unsigned threads_;
+        HashOptions hash_;
+    };
+
+    /**
+     * 参与方2（持有(标识符, 值)对集合W）
+     */
+    class Party2 {
+    public:
+        Party2(std::vector<std::pair<std::string, uint64_t>> pairs, const AdditiveHE& he, unsigned threads = 0,
+            const HashOptions& hash = HashOptions());
+
+        /**
+         * @brief 第二轮：对收到的数据做k2次幂，并处理自己的(标识符, 值)对
+         */
+        Round2Message round2(const std::vector<Element>& round1Data) const;
+
+        /**
+         * @brief 解密最终的交集和
+         */
+        uint64_t decryptFinalResult(const Ciphertext& encryptedSum) const;
+
+    private:
+        std::vector<std::pair<std::string, uint64_t>> pairs_;
+        const AdditiveHE& he_;
+        SM2Curve::U256 k2_;
+        unsigned threads_;
+        HashOptions hash_;
+    };
+
+} // namespace PSI
+
+#endif // PSI_DDH_H
@@ -0,0 +1,88 @@
+﻿#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include "paillier.h"
+#include "psi_ddh.h"
+
+int main(int argc, char* argv[]) {
+    // P2持有Paillier私钥；P1只拿到公钥，用于同态求和
+    auto t = std::chrono::high_resolution_clock::now();
+    PSI::PaillierPrivateKey key = PSI::PaillierKeyGen(2048);
+    PSI::PaillierHE he(key);
+    PSI::PaillierHE pubHe(key.pub);
+    std::cout << "Paillier密钥生成与 r^n 池预计算: "
+        << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t).count()
+        << " 毫秒\n\n";
+
+    // ==================== 协议演示（与project6.py相同的数据） ====================
+    std::cout << "=== 基于DDH的私有交集求和协议演示（SM2曲线群） ===\n";
+    PSI::Party1 party1({ "alice", "bob", "charlie", "david", "eve" });
+    PSI::Party2 party2({ { "alice", 10 }, { "bob", 20 }, { "frank", 15 }, { "charlie", 30 }, { "grace", 25 } }, he);
+
+    auto round1 = party1.round1();
+    auto round2 = party2.round2(round1);
+    size_t intersection = 0;
+    auto encryptedSum = party1.round3(round2, pubHe, &intersection);
+    std::cout << "交集大小: " << intersection << "（预期 3）\n";
+    std::cout << "交集和: " << party2.decryptFinalResult(encryptedSum) << "（预期 60）\n";
+
+    // 重随机化检查：P2的标识符全部在交集中时，未重随机化的结果恰是P2发出的全部密文之积，
+    // P2一比对就知道哪些项参与了求和；round3的返回值必须与之不同且仍解密为正确的和
+    {
+        PSI::Party2 all({ { "alice", 10 }, { "bob", 20 }, { "charlie", 30 } }, he);
+        auto r2 = all.round2(party1.round1());
+        std::vector<const PSI::Ciphertext*> inputs;
+        for (const auto& c : r2.pairCiphertexts) inputs.push_back(&c);
+        auto result = party1.round3(r2, pubHe);
+        bool product = result == pubHe.Sum(inputs);
+        bool single = false;
+        for (const auto& c : r2.pairCiphertexts) single = single || result == c;
+        uint64_t value = all.decryptFinalResult(result);
+        bool ok = !product && !single && value == 60;
+        std::cout << "重随机化检查: " << (ok ? "通过" : "失败") << "（结果" << (product ? "等于" : "不等于")
+            << "输入之积，解密为 " << value << "）\n";
+        if (!ok) return 1;
+    }
+
+    // ==================== 批量性能测试 ====================
+    size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 5000;
+    std::vector<std::string> v(n);
+    std::vector<std::pair<std::string, uint64_t>> w(n);
+    uint64_t expected = 0;
+    for (size_t i = 0; i < n; ++i) {
+        v[i] = "user" + std::to_string(i);
+        w[i] = { "user" + std::to_string(i + n / 2), i };  // 一半重叠
+        if (i + n / 2 < n) expected += i;
+    }
+
+    // 第二个参数为哈希到曲线缓存文件路径，重复运行时命中的标识符跳过映射
+    std::unique_ptr<PSI::HashToCurveCache> cache;
+    PSI::HashOptions hash;
+    if (argc > 2) {
+        cache.reset(new PSI::HashToCurveCache(argv[2], hash.method));
+        hash.cache = cache.get();
+        std::cout << "\n哈希缓存: " << argv[2] << "（已有 " << cache->Size() << " 条";
+        if (cache->Rejected() > 0) std::cout << "，丢弃不在曲线上的 " << cache->Rejected() << " 条";
+        std::cout << "）\n";
+    }
+
+    PSI::Party1 p1(std::move(v), 0, hash);
+    PSI::Party2 p2(std::move(w), he, 0, hash);
+    auto t0 = std::chrono::high_resolution_clock::now();
+    auto r1 = p1.round1();
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto r2 = p2.round2(r1);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    auto sum = p1.round3(r2, pubHe, &intersection);
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+    std::cout << "\n批量测试: |V| = |W| = " << n << "\n";
+    std::cout << "  round1: " << ms(t0, t1) << " 毫秒\n";
+    std::cout << "  round2: " << ms(t1, t2) << " 毫秒\n";
+    std::cout << "  round3: " << ms(t2, t3) << " 毫秒\n";
+    std::cout << "  交集大小: " << intersection << "，交集和: " << p2.decryptFinalResult(sum)
+        << "（预期 " << expected << "）\n";
+    return 0;
+}
@@ -0,0 +1,480 @@
+﻿#include "psi_stream.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace PSI {
+
+    using namespace SM2Curve;
+
+    namespace {
+
+        // ==================== 本地通道 ====================
+
+        class FdChannel : public Channel {
+        public:
+            FdChannel(int readFd, int writeFd) : readFd_(readFd), writeFd_(writeFd) {}
+
+            ~FdChannel() override {
+#if defined(_WIN32)
+                _close(readFd_);
+                if (writeFd_ != readFd_) _close(writeFd_);
+#else
+                close(readFd_);
+                if (writeFd_ != readFd_) close(writeFd_);
+#endif
+            }
+
+            bool Send(const void* data, size_t len) override {
+                const uint8_t* p = static_cast<const uint8_t*>(data);
+                while (len > 0) {
+                    unsigned chunk = static_cast<unsigned>(std::min<size_t>(len, 1 << 20));
+#if defined(_WIN32)
+                    int n = _write(writeFd_, p, chunk);
+#else
+                    ssize_t n = write(writeFd_, p, chunk);
+#endif
+                    if (n <= 0) return false;
+                    p += n;
+                    len -= static_cast<size_t>(n);
+                }
+                return true;
+            }
+
+            bool Recv(void* data, size_t len) override {
+                uint8_t* p = static_cast<uint8_t*>(data);
+                while (len > 0) {
+                    unsigned chunk = static_cast<unsigned>(std::min<size_t>(len, 1 << 20));
+#if defined(_WIN32)
+                    int n = _read(readFd_, p, chunk);
+#else
+                    ssize_t n = read(readFd_, p, chunk);
+#endif
+                    if (n <= 0) return false;
+                    p += n;
+                    len -= static_cast<size_t>(n);
+                }
+                return true;
+            }
+
+        private:
+            int readFd_;
+            int writeFd_;
+        };
+
+        // ==================== 有界队列 ====================
+
+        template<typename T>
+        class BoundedQueue {
+        public:
+            explicit BoundedQueue(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {}
+
+            /**
+             * @brief 入队，队列满时阻塞
+             * @return 队列已关闭时返回false
+             */
+            bool Push(T item) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                notFull_.wait(lock, [&] { return closed_ || items_.size() < capacity_; });
+                if (closed_) return false;
+                items_.push_back(std::move(item));
+                notEmpty_.notify_one();
+                return true;
+            }
+
+            /**
+             * @brief 出队，队列空时阻塞
+             * @return 队列已关闭且为空时返回false
+             */
+            bool Pop(T& item) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                notEmpty_.wait(lock, [&] { return closed_ || !items_.empty(); });
+                if (items_.empty()) return false;
+                item = std::move(items_.front());
+                items_.pop_front();
+                notFull_.notify_one();
+                return true;
+            }
+
+            // 关闭后Push立即失败，Pop取完剩余元素后失败
+            void Close() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+                notFull_.notify_all();
+                notEmpty_.notify_all();
+            }
+
+        private:
+            size_t capacity_;
+            std::deque<T> items_;
+            bool closed_ = false;
+            std::mutex mutex_;
+            std::condition_variable notFull_, notEmpty_;
+        };
+
+        // ==================== 分帧传输 ====================
+
+        enum FrameType : uint8_t {
+            FRAME_ROUND1 = 1,      // P1 -> P2: {H(v_i)^k1} 分片
+            FRAME_ROUND1_END = 2,
+            FRAME_Z = 3,           // P2 -> P1: {H(v_i)^(k1*k2)} 分片
+            FRAME_Z_END = 4,
+            FRAME_PAIRS = 5,       // P2 -> P1: count个元素 || count个定长密文
+            FRAME_PAIRS_END = 6,
+            FRAME_SUM = 7,         // P1 -> P2: 交集和密文
+            FRAME_BYE = 8,         // 任一方向的最后一帧
+        };
+
+        constexpr size_t HEADER_BYTES = 9;             // type(1) || count(4, LE) || length(4, LE)
+        constexpr uint32_t MAX_PAYLOAD = 1u << 30;
+
+        struct Frame {
+            uint8_t type = 0;
+            uint32_t count = 0;
+            std::vector<uint8_t> payload;
+        };
+
+        /**
+         * 通道上的双向帧流：写线程从发送队列取帧写出，读线程把收到的帧放入接收队列，
+         * 协议逻辑只与两个有界队列交互，从而使计算与传输重叠
+         */
+        class FramedStream {
+        public:
+            FramedStream(Channel& channel, size_t depth)
+                : channel_(channel), outbox_(depth), inbox_(depth) {
+                writer_ = std::thread([this] { WriteLoop(); });
+                reader_ = std::thread([this] { ReadLoop(); });
+            }
+
+            ~FramedStream() {
+                Finish();
+                // 对端在结束时同样发送BYE，读线程据此退出
+                inbox_.Close();
+                reader_.join();
+            }
+
+            bool Post(Frame frame) { return outbox_.Push(std::move(frame)); }
+            bool Next(Frame& frame) { return inbox_.Pop(frame); }
+
+            // 不再发送新帧；已排队的帧发完后追加BYE
+            void Close() { outbox_.Close(); }
+
+            // 关闭并等待所有帧写出
+            void Finish() {
+                Close();
+                if (writer_.joinable()) writer_.join();
+            }
+
+            uint64_t BytesSent() const { return sent_; }
+            uint64_t BytesReceived() const { return received_; }
+
+        private:
+            static void PutU32(uint8_t* p, uint32_t v) {
+                for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+            }
+
+            static uint32_t GetU32(const uint8_t* p) {
+                uint32_t v = 0;
+                for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(p[i]) << (8 * i);
+                return v;
+            }
+
+            bool WriteFrame(const Frame& frame) {
+                uint8_t header[HEADER_BYTES];
+                header[0] = frame.type;
+                PutU32(header + 1, frame.count);
+                PutU32(header + 5, static_cast<uint32_t>(frame.payload.size()));
+                if (!channel_.Send(header, HEADER_BYTES)) return false;
+                if (!frame.payload.empty() && !channel_.Send(frame.payload.data(), frame.payload.size())) return false;
+                sent_ += HEADER_BYTES + frame.payload.size();
+                return true;
+            }
+
+            void WriteLoop() {
+                Frame frame;
+                bool ok = true;
+                while (ok && outbox_.Pop(frame)) {
+                    ok = WriteFrame(frame);
+                }
+                if (!ok) {
+                    outbox_.Close();  // 通道已断，让阻塞中的Post返回
+                    return;
+                }
+                Frame bye;
+                bye.type = FRAME_BYE;
+                WriteFrame(bye);
+            }
+
+            void ReadLoop() {
+                for (;;) {
+                    uint8_t header[HEADER_BYTES];
+                    if (!channel_.Recv(header, HEADER_BYTES)) break;
+                    Frame frame;
+                    frame.type = header[0];
+                    frame.count = GetU32(header + 1);
+                    uint32_t length = GetU32(header + 5);
+                    if (length > MAX_PAYLOAD) break;
+                    frame.payload.resize(length);
+                    if (length && !channel_.Recv(frame.payload.data(), length)) break;
+                    received_ += HEADER_BYTES + length;
+                    if (frame.type == FRAME_BYE) break;
+                    if (!inbox_.Push(std::move(frame))) break;
+                }
+                inbox_.Close();
+            }
+
+            Channel& channel_;
+            BoundedQueue<Frame> outbox_, inbox_;
+            std::atomic<uint64_t> sent_{ 0 }, received_{ 0 };
+            std::thread writer_, reader_;
+        };
+
+        // ==================== 辅助函数 ====================
+
+        template<typename T>
+        void Shuffle(std::vector<T>& v) {
+            std::random_device rd;
+            std::mt19937_64 rng((static_cast<uint64_t>(rd()) << 32) | rd());
+            std::shuffle(v.begin(), v.end(), rng);
+        }
+
+        Frame MakeElementFrame(uint8_t type, const std::vector<Element>& elements) {
+            Frame frame;
+            frame.type = type;
+            frame.count = static_cast<uint32_t>(elements.size());
+            frame.payload.resize(elements.size() * POINT_BYTES);
+            for (size_t i = 0; i < elements.size(); ++i) {
+                std::memcpy(&frame.payload[i * POINT_BYTES], elements[i].data(), POINT_BYTES);
+            }
+            return frame;
+        }
+
+        bool ParseElements(const Frame& frame, std::vector<Element>& out) {
+            if (frame.payload.size() < static_cast<size_t>(frame.count) * POINT_BYTES) return false;
+            out.resize(frame.count);
+            for (size_t i = 0; i < out.size(); ++i) {
+                std::memcpy(out[i].data(), &frame.payload[i * POINT_BYTES], POINT_BYTES);
+            }
+            return true;
+        }
+
+        Frame MakeEmptyFrame(uint8_t type) {
+            Frame frame;
+            frame.type = type;
+            return frame;
+        }
+
+        /**
+         * @brief 群元素的64位指纹（x坐标前8字节，已是均匀分布）
+         * |Z| = 10^7 时，单次查询误判概率约 10^7 / 2^64 ≈ 5e-13
+         */
+        uint64_t Fingerprint(const Element& e) {
+            uint64_t h;
+            std::memcpy(&h, e.data() + 1, sizeof(h));
+            return h;
+        }
+
+    } // namespace
+
+    std::pair<std::unique_ptr<Channel>, std::unique_ptr<Channel>> MakeLoopbackChannels() {
+        std::pair<std::unique_ptr<Channel>, std::unique_ptr<Channel>> result;
+#if defined(_WIN32)
+        int a[2], b[2];
+        if (_pipe(a, 1 << 20, _O_BINARY) != 0) return result;
+        if (_pipe(b, 1 << 20, _O_BINARY) != 0) {
+            _close(a[0]);
+            _close(a[1]);
+            return result;
+        }
+        result.first.reset(new FdChannel(b[0], a[1]));
+        result.second.reset(new FdChannel(a[0], b[1]));
+#else
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return result;
+        result.first.reset(new FdChannel(sv[0], sv[0]));
+        result.second.reset(new FdChannel(sv[1], sv[1]));
+#endif
+        return result;
+    }
+
+    // ==================== 参与方1 ====================
+
+    StreamingParty1::StreamingParty1(IdentifierSource& source, const AdditiveHE& he, const StreamOptions& options)
+        : source_(source), he_(he), options_(options), k1_(RandomScalar()) {
+    }
+
+    bool StreamingParty1::Run(Channel& channel) {
+        stats_ = StreamStats();
+        FramedStream stream(channel, options_.queueDepth);
+
+        // 发送线程：逐片计算并打乱 {H(v_i)^k1}，与下面接收Z的循环并行
+        std::thread producer([&] {
+            std::vector<std::string> ids;
+            while (source_.NextShard(options_.shardSize, ids) > 0) {
+                std::vector<Element> elements = HashAndExponentiate(ids, k1_, options_.threads, options_.hash);
+                Shuffle(elements);
+                if (!stream.Post(MakeElementFrame(FRAME_ROUND1, elements))) return;
+                ++stats_.shardsSent;
+            }
+            stream.Post(MakeEmptyFrame(FRAME_ROUND1_END));
+        });
+
+        bool ok = true;
+        Frame frame;
+
+        // 接收Z，只保留指纹
+        std::vector<uint64_t> z;
+        std::vector<Element> elements;
+        const Element infinity{};
+        for (;;) {
+            if (!stream.Next(frame)) { ok = false; break; }
+            if (frame.type == FRAME_Z_END) break;
+            if (frame.type != FRAME_Z || !ParseElements(frame, elements)) { ok = false; break; }
+            for (const Element& e : elements) {
+                if (e != infinity) z.push_back(Fingerprint(e));
+            }
+        }
+        std::sort(z.begin(), z.end());
+
+        // 逐片处理 (H(w_j)^k2, AEnc(t_j))，交集密文随到随加
+        Ciphertext sum;
+        while (ok) {
+            if (!stream.Next(frame)) { ok = false; break; }
+            if (frame.type == FRAME_PAIRS_END) break;
+            if (frame.type != FRAME_PAIRS || frame.count == 0 || !ParseElements(frame, elements)) { ok = false; break; }
+            size_t ctBytes = (frame.payload.size() - static_cast<size_t>(frame.count) * POINT_BYTES) / frame.count;
+            if (static_cast<size_t>(frame.count) * (POINT_BYTES + ctBytes) != frame.payload.size()) { ok = false; break; }
+
+            std::vector<Element> pairsK1K2 = Exponentiate(elements, k1_, options_.threads);
+            std::vector<Ciphertext> matched;
+            const uint8_t* ctBase = frame.payload.data() + static_cast<size_t>(frame.count) * POINT_BYTES;
+            for (size_t j = 0; j < pairsK1K2.size(); ++j) {
+                if (pairsK1K2[j] != infinity && std::binary_search(z.begin(), z.end(), Fingerprint(pairsK1K2[j]))) {
+                    matched.emplace_back(ctBase + j * ctBytes, ctBase + (j + 1) * ctBytes);
+                }
+            }
+            if (matched.empty()) continue;
+            stats_.intersectionSize += matched.size();
+
+            std::vector<const Ciphertext*> items;
+            if (!sum.empty()) items.push_back(&sum);
+            for (const Ciphertext& c : matched) items.push_back(&c);
+            sum = he_.Sum(items);
+        }
+
+        if (ok) {
+            if (sum.empty()) {
+                sum = he_.EncryptBatch({ 0 })[0];
+            }
+            else {
+                // 累加结果是P2发出的密文之积，P2可按子集相乘比对出交集；发出前重随机化。
+                // 中间的部分和不出本方，只在最后做一次
+                sum = he_.Rerandomize(sum);
+            }
+            Frame result;
+            result.type = FRAME_SUM;
+            result.count = 1;
+            result.payload = std::move(sum);
+            ok = stream.Post(std::move(result));
+        }
+        stream.Close();
+        producer.join();
+        stream.Finish();
+        stats_.bytesSent = stream.BytesSent();
+        stats_.bytesReceived = stream.BytesReceived();
+        return ok;
+    }
+
+    // ==================== 参与方2 ====================
+
+    StreamingParty2::StreamingParty2(PairSource& source, const AdditiveHE& he, const StreamOptions& options)
+        : source_(source), he_(he), options_(options), k2_(RandomScalar()) {
+        options_.shardSize = std::max(options_.shardSize, MIN_SHARD_SIZE);
+    }
+
+    bool StreamingParty2::Run(Channel& channel) {
+        stats_ = StreamStats();
+        result_ = 0;
+        FramedStream stream(channel, options_.queueDepth);
+        bool ok = true;
+        Frame frame;
+
+        // 步骤1: 逐片做k2次幂，收齐后整体打乱再分片回传。只在分片内打乱的话，
+        // 参与方1能按分片对上交集元素，分片为1时就知道是自己的哪些标识符
+        std::vector<Element> elements, z;
+        for (;;) {
+            if (!stream.Next(frame)) { ok = false; break; }
+            if (frame.type == FRAME_ROUND1_END) break;
+            if (frame.type != FRAME_ROUND1 || !ParseElements(frame, elements)) { ok = false; break; }
+            std::vector<Element> powered = Exponentiate(elements, k2_, options_.threads);
+            z.insert(z.end(), powered.begin(), powered.end());
+        }
+        if (ok) Shuffle(z);
+        for (size_t begin = 0; ok && begin < z.size(); begin += options_.shardSize) {
+            size_t end = std::min(z.size(), begin + options_.shardSize);
+            ok = stream.Post(MakeElementFrame(FRAME_Z, std::vector<Element>(z.begin() + begin, z.begin() + end)));
+            ++stats_.shardsSent;
+        }
+        std::vector<Element>().swap(z);
+        ok = ok && stream.Post(MakeEmptyFrame(FRAME_Z_END));
+
+        // 步骤2: 逐片发送自己的对，元素与密文按同一排列打乱
+        std::vector<std::pair<std::string, uint64_t>> pairs;
+        while (ok && source_.NextShard(options_.shardSize, pairs) > 0) {
+            std::vector<std::string> ids(pairs.size());
+            std::vector<uint64_t> values(pairs.size());
+            for (size_t j = 0; j < pairs.size(); ++j) {
+                ids[j] = pairs[j].first;
+                values[j] = pairs[j].second;
+            }
+            std::vector<Element> hashed = HashAndExponentiate(ids, k2_, options_.threads, options_.hash);
+            std::vector<Ciphertext> ciphertexts = he_.EncryptBatch(values);
+
+            std::vector<size_t> order(pairs.size());
+            for (size_t j = 0; j < order.size(); ++j) {
+                order[j] = j;
+            }
+            Shuffle(order);
+
+            size_t ctBytes = ciphertexts[0].size();
+            Frame out;
+            out.type = FRAME_PAIRS;
+            out.count = static_cast<uint32_t>(pairs.size());
+            out.payload.resize(pairs.size() * (POINT_BYTES + ctBytes));
+            uint8_t* ctBase = out.payload.data() + pairs.size() * POINT_BYTES;
+            for (size_t j = 0; j < order.size(); ++j) {
+                std::memcpy(&out.payload[j * POINT_BYTES], hashed[order[j]].data(), POINT_BYTES);
+                std::memcpy(ctBase + j * ctBytes, ciphertexts[order[j]].data(), ctBytes);
+            }
+            ok = stream.Post(std::move(out));
+            ++stats_.shardsSent;
+        }
+        ok = ok && stream.Post(MakeEmptyFrame(FRAME_PAIRS_END));
+
+        // 步骤3: 解密交集和
+        if (ok && stream.Next(frame) && frame.type == FRAME_SUM) {
+            result_ = he_.Decrypt(frame.payload);
+        }
+        else {
+            ok = false;
+        }
+        stream.Finish();
+        stats_.bytesSent = stream.BytesSent();
+        stats_.bytesReceived = stream.BytesReceived();
+        return ok;
+    }
+
+} // namespace PSI
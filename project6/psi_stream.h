@@ -0,0 +1,142 @@
+﻿#ifndef PSI_STREAM_H
+#define PSI_STREAM_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "psi_ddh.h"
+
+// 分片流式执行的私有交集求和协议：标识符按固定大小分片处理，分片消息经本地套接字/管道传输，
+// 计算与收发由独立线程流水化重叠。参与方1只保留Z的64位指纹（每个元素8字节），其余内存与分片大小成正比
+
+namespace PSI {
+
+    /**
+     * 双向字节通道（网络连接的本地替身）
+     */
+    class Channel {
+    public:
+        virtual ~Channel() = default;
+
+        /**
+         * @brief 发送len字节
+         * @return 对端关闭或出错时返回false
+         */
+        virtual bool Send(const void* data, size_t len) = 0;
+
+        /**
+         * @brief 精确接收len字节
+         * @return 对端关闭或出错时返回false
+         */
+        virtual bool Recv(void* data, size_t len) = 0;
+    };
+
+    /**
+     * @brief 创建一对互联的本地通道（POSIX下为socketpair，Windows下为一对匿名管道）
+     * @return 两个端点；创建失败时均为空
+     */
+    std::pair<std::unique_ptr<Channel>, std::unique_ptr<Channel>> MakeLoopbackChannels();
+
+    /**
+     * 参与方1的标识符来源，按分片逐步产出，避免整个集合驻留内存
+     */
+    class IdentifierSource {
+    public:
+        virtual ~IdentifierSource() = default;
+
+        /**
+         * @brief 取下一分片
+         * @param maxCount 本分片最多取多少个
+         * @param out 输出（会先被清空）
+         * @return 取到的个数，0表示已取完
+         */
+        virtual size_t NextShard(size_t maxCount, std::vector<std::string>& out) = 0;
+    };
+
+    /**
+     * 参与方2的(标识符, 值)对来源
+     */
+    class PairSource {
+    public:
+        virtual ~PairSource() = default;
+        virtual size_t NextShard(size_t maxCount, std::vector<std::pair<std::string, uint64_t>>& out) = 0;
+    };
+
+    /**
+     * 参与方2的对按分片发送、分片内打乱，参与方1能看出每个分片里有几个交集元素；
+     * 分片不能小到让这个计数定位到具体的对
+     */
+    constexpr size_t MIN_SHARD_SIZE = 1024;
+
+    struct StreamOptions {
+        size_t shardSize = 1 << 14;  // 每个分片的元素个数，参与方2至少取MIN_SHARD_SIZE
+        size_t queueDepth = 4;       // 收发队列中最多缓存的分片数
+        unsigned threads = 0;        // 分片内计算的线程数，0表示硬件并发数
+        HashOptions hash;
+    };
+
+    struct StreamStats {
+        size_t shardsSent = 0;
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        size_t intersectionSize = 0;  // 仅参与方1
+    };
+
+    /**
+     * 流式参与方1：发送 {H(v_i)^k1} 分片，接收 Z 分片建立指纹集合，
+     * 再逐片处理 (H(w_j)^k2, AEnc(t_j)) 并累加交集密文，最后回传重随机化后的和的密文
+     */
+    class StreamingParty1 {
+    public:
+        /**
+         * @param source 标识符来源
+         * @param he 同态加密公钥
+         */
+        StreamingParty1(IdentifierSource& source, const AdditiveHE& he, const StreamOptions& options = StreamOptions());
+
+        /**
+         * @brief 在通道上执行完整协议
+         * @return 协议正常结束返回true
+         */
+        bool Run(Channel& channel);
+
+        const StreamStats& Stats() const { return stats_; }
+
+    private:
+        IdentifierSource& source_;
+        const AdditiveHE& he_;
+        StreamOptions options_;
+        SM2Curve::U256 k1_;
+        StreamStats stats_;
+    };
+
+    /**
+     * 流式参与方2：逐片对收到的数据做k2次幂，收齐后整体打乱再分片回传，随后分片发送自己的对，最后解密交集和
+     */
+    class StreamingParty2 {
+    public:
+        StreamingParty2(PairSource& source, const AdditiveHE& he, const StreamOptions& options = StreamOptions());
+
+        bool Run(Channel& channel);
+
+        /**
+         * @brief 解密得到的交集和（Run成功后有效）
+         */
+        uint64_t Result() const { return result_; }
+
+        const StreamStats& Stats() const { return stats_; }
+
+    private:
+        PairSource& source_;
+        const AdditiveHE& he_;
+        StreamOptions options_;
+        SM2Curve::U256 k2_;
+        StreamStats stats_;
+        uint64_t result_ = 0;
+    };
+
+} // namespace PSI
+
+#endif // PSI_STREAM_H